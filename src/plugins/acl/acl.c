@@ -23,6 +23,7 @@
 #include <vnet/l2/l2_in_out_feat_arc.h>
 #include <vnet/classify/in_out_acl.h>
 #include <vpp/app/version.h>
+#include <vppinfra/random.h>
 
 #include <vlibapi/api.h>
 #include <vlibmemory/api.h>
@@ -53,6 +54,7 @@
 
 #include "fa_node.h"
 #include "public_inlines.h"
+#include "dtree_lookup.h"
 
 acl_main_t acl_main;
 
@@ -2658,6 +2660,11 @@ acl_set_aclplugin_fn (vlib_main_t * vm,
       am->use_hash_acl_matching = (val != 0);
       goto done;
     }
+  if (unformat (input, "use-dtree-acl-matching %u", &val))
+    {
+      acl_plugin_lookup_context_set_dtree_all (val != 0);
+      goto done;
+    }
   if (unformat (input, "l4-match-nonfirst-fragment %u", &val))
     {
       am->l4_match_nonfirst_fragment = (val != 0);
@@ -2708,6 +2715,21 @@ acl_set_aclplugin_fn (vlib_main_t * vm,
       if (unformat (input, "table"))
 	{
 	  /* The commands here are for tuning/testing. No user-serviceable parts inside */
+	  if (unformat (input, "max-entries-per-worker"))
+	    {
+	      if (!unformat (input, "%u", &val))
+		{
+		  error = clib_error_return (0,
+					     "expecting maximum number of entries, got `%U`",
+					     format_unformat_error, input);
+		  goto done;
+		}
+	      else
+		{
+		  am->fa_conn_table_max_entries_per_worker = val;
+		  goto done;
+		}
+	    }
 	  if (unformat (input, "max-entries"))
 	    {
 	      if (!unformat (input, "%u", &val))
@@ -2753,6 +2775,48 @@ acl_set_aclplugin_fn (vlib_main_t * vm,
 		  goto done;
 		}
 	    }
+	  if (unformat (input, "timer-wheel"))
+	    {
+	      if (!unformat (input, "%u", &val))
+		{
+		  error = clib_error_return (0,
+					     "expecting 0 or 1, got `%U`",
+					     format_unformat_error, input);
+		  goto done;
+		}
+	      else if (am->fa_sessions_hash_is_initialized)
+		{
+		  error = clib_error_return (0,
+					     "session table already in use, can not change the aging");
+		  goto done;
+		}
+	      else
+		{
+		  am->fa_use_timer_wheel = val;
+		  goto done;
+		}
+	    }
+	  if (unformat (input, "per-worker"))
+	    {
+	      if (!unformat (input, "%u", &val))
+		{
+		  error = clib_error_return (0,
+					     "expecting 0 or 1, got `%U`",
+					     format_unformat_error, input);
+		  goto done;
+		}
+	      else if (am->fa_sessions_hash_is_initialized)
+		{
+		  error = clib_error_return (0,
+					     "session table already in use, can not change the layout");
+		  goto done;
+		}
+	      else
+		{
+		  am->fa_per_worker_session_tables = val;
+		  goto done;
+		}
+	    }
 	  if (unformat (input, "event-trace"))
 	    {
 	      if (!unformat (input, "%u", &val))
@@ -3187,6 +3251,14 @@ acl_plugin_show_sessions (acl_main_t * am,
     u64 n_adds = am->fa_session_total_adds;
     u64 n_dels = am->fa_session_total_dels;
     u64 n_deact = am->fa_session_total_deactivations;
+    if (am->fa_per_worker_session_tables)
+      for (wk = 0; wk < vec_len (am->per_worker_data); wk++)
+	{
+	  acl_fa_per_worker_data_t *pw = &am->per_worker_data[wk];
+	  n_adds += pw->fa_session_total_adds;
+	  n_dels += pw->fa_session_total_dels;
+	  n_deact += pw->fa_session_total_deactivations;
+	}
     vlib_cli_output (vm, "Sessions total: add %lu - del %lu = %lu", n_adds,
 		     n_dels, n_adds - n_dels);
     vlib_cli_output (vm, "Sessions active: add %lu - deact %lu = %lu", n_adds,
@@ -3291,6 +3363,16 @@ acl_plugin_show_sessions (acl_main_t * am,
 		       pw->cnt_already_deleted_sessions);
       vlib_cli_output (vm, "  Session timers restarted: %lu",
 		       pw->cnt_session_timer_restarted);
+      if (am->fa_use_timer_wheel && am->fa_sessions_hash_is_initialized)
+	vlib_cli_output (vm, "  Session timers expired: %lu, running: %u",
+			 pw->cnt_session_timer_expired,
+			 pw->n_session_timers_running);
+      if (am->fa_per_worker_session_tables)
+	vlib_cli_output (vm,
+			 "  Sessions in table: %u, remote lookups: %lu, hits: %lu",
+			 pool_elts (pw->fa_sessions_pool),
+			 pw->cnt_remote_session_probes,
+			 pw->cnt_remote_session_hits);
       vlib_cli_output (vm, "  Swipe until this time: %lu",
 		       pw->swipe_end_time);
       vlib_cli_output (vm, "  sw_if_index serviced bitmap: %U",
@@ -3326,6 +3408,19 @@ acl_plugin_show_sessions (acl_main_t * am,
 		   ((f64) am->fa_current_cleaner_timer_wait_interval) *
 		   1000.0 / (f64) vm->clib_time.clocks_per_second);
   vlib_cli_output (vm, "Reclassify sessions: %d", am->reclassify_sessions);
+  if (am->fa_use_timer_wheel)
+    vlib_cli_output (vm, "Session aging: timer wheel, %.3f sec ticks",
+		     am->fa_timer_wheel_interval);
+  else
+    vlib_cli_output (vm, "Session aging: connection lists");
+  if (am->fa_per_worker_session_tables)
+    vlib_cli_output (vm, "Session tables: per worker, max %lu sessions each",
+		     am->fa_conn_table_max_entries_per_worker ?
+		     clib_min (am->fa_conn_table_max_entries,
+			       am->fa_conn_table_max_entries_per_worker) :
+		     am->fa_conn_table_max_entries);
+  else
+    vlib_cli_output (vm, "Session tables: shared");
 }
 
 static clib_error_t *
@@ -3362,6 +3457,7 @@ acl_show_aclplugin_tables_fn (vlib_main_t * vm,
   int show_applied_info = 0;
   int show_mask_type = 0;
   int show_bihash = 0;
+  int show_dtree = 0;
   u32 show_bihash_verbose = 0;
 
   if (unformat (input, "acl"))
@@ -3385,16 +3481,22 @@ acl_show_aclplugin_tables_fn (vlib_main_t * vm,
       show_bihash = 1;
       unformat (input, "verbose %u", &show_bihash_verbose);
     }
+  else if (unformat (input, "dtree"))
+    {
+      show_dtree = 1;
+      unformat (input, "lc_index %u", &lc_index);
+    }
 
   if (!
       (show_mask_type || show_acl_hash_info || show_applied_info
-       || show_bihash))
+       || show_bihash || show_dtree))
     {
       /* if no qualifiers specified, show all */
       show_mask_type = 1;
       show_acl_hash_info = 1;
       show_applied_info = 1;
       show_bihash = 1;
+      show_dtree = 1;
     }
   if (show_mask_type)
     acl_plugin_show_tables_mask_type ();
@@ -3404,7 +3506,107 @@ acl_show_aclplugin_tables_fn (vlib_main_t * vm,
     acl_plugin_show_tables_applied_info (lc_index);
   if (show_bihash)
     acl_plugin_show_tables_bihash (show_bihash_verbose);
+  if (show_dtree)
+    acl_plugin_show_tables_dtree (lc_index);
+
+  return error;
+}
+
+/*
+ * Random port-range heavy rules, the worst case for the hash lookup:
+ * the ranges expand into many mask types.
+ */
+static vl_api_acl_rule_t *
+acl_test_random_rules (u32 n_rules, u32 * seed)
+{
+  vl_api_acl_rule_t *rules = 0, *r;
+  u16 first;
+  int i;
+
+  vec_validate (rules, n_rules - 1);
+  for (i = 0; i < n_rules; i++)
+    {
+      r = rules + i;
+      r->is_permit = random_u32 (seed) & 1;
+      r->is_ipv6 = random_u32 (seed) & 1;
+      r->proto = (random_u32 (seed) & 1) ? IP_PROTOCOL_TCP : IP_PROTOCOL_UDP;
+      r->src_ip_prefix_len = 8 * (random_u32 (seed) % 3);
+      if (r->is_ipv6)
+	{
+	  r->src_ip_addr[0] = 0x20;
+	  r->src_ip_addr[1] = 0x01;
+	  r->src_ip_addr[2] = random_u32 (seed) % 4;
+	}
+      else
+	{
+	  r->src_ip_addr[0] = 10;
+	  r->src_ip_addr[1] = random_u32 (seed) % 4;
+	}
+      first = random_u32 (seed);
+      r->srcport_or_icmptype_first = htons (first);
+      r->srcport_or_icmptype_last =
+	htons (first + random_u32 (seed) % (65536 - first));
+      first = random_u32 (seed);
+      r->dstport_or_icmpcode_first = htons (first);
+      r->dstport_or_icmpcode_last =
+	htons (first + random_u32 (seed) % clib_min (1000, 65536 - first));
+    }
+  return rules;
+}
 
+static clib_error_t *
+acl_test_aclplugin_lookup_fn (vlib_main_t * vm,
+			      unformat_input_t * input,
+			      vlib_cli_command_t * cmd)
+{
+  clib_error_t *error = 0;
+  vl_api_acl_rule_t *rules;
+  u32 lc_index = ~0, acl_index = ~0, user_id;
+  u32 *acl_vec = 0;
+  u32 n_rules = 0;
+  u32 n_packets = 100000;
+  u32 seed = 0xdeaddabe;
+  int rv;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "lc_index %u", &lc_index))
+	;
+      else if (unformat (input, "rules %u", &n_rules))
+	;
+      else if (unformat (input, "packets %u", &n_packets))
+	;
+      else if (unformat (input, "seed %u", &seed))
+	;
+      else
+	return clib_error_return (0, "unknown input '%U'",
+				  format_unformat_error, input);
+    }
+  if (0 == n_packets)
+    return clib_error_return (0, "need at least one packet");
+  if (~0 != lc_index)
+    return dtree_acl_lookup_bench (vm, lc_index, n_packets, seed);
+  if (0 == n_rules)
+    return clib_error_return (0, "lc_index or rules required");
+
+  /* a throwaway ACL in a throwaway lookup context */
+  rules = acl_test_random_rules (n_rules, &seed);
+  rv = acl_add_list (n_rules, rules, &acl_index, (u8 *) "lookup test");
+  vec_free (rules);
+  if (rv)
+    return clib_error_return (0, "acl add failed, rv %d", rv);
+
+  user_id = acl_plugin.register_user_module ("lookup test", "unused",
+					     "unused");
+  lc_index = acl_plugin.get_lookup_context_index (user_id, 0, 0);
+  vec_add1 (acl_vec, acl_index);
+  acl_plugin.set_acl_vec_for_context (lc_index, acl_vec);
+
+  error = dtree_acl_lookup_bench (vm, lc_index, n_packets, seed);
+
+  acl_plugin.put_lookup_context_index (lc_index);
+  acl_del_list (acl_index);
+  vec_free (acl_vec);
   return error;
 }
 
@@ -3470,10 +3672,16 @@ VLIB_CLI_COMMAND (aclplugin_show_sessions_command, static) = {
 
 VLIB_CLI_COMMAND (aclplugin_show_tables_command, static) = {
     .path = "show acl-plugin tables",
-    .short_help = "show acl-plugin tables [ acl [index N] | applied [ lc_index N ] | mask | hash [verbose N] ]",
+    .short_help = "show acl-plugin tables [ acl [index N] | applied [ lc_index N ] | mask | hash [verbose N] | dtree [ lc_index N ] ]",
     .function = acl_show_aclplugin_tables_fn,
 };
 
+VLIB_CLI_COMMAND (aclplugin_test_lookup_command, static) = {
+    .path = "test acl-plugin lookup",
+    .short_help = "test acl-plugin lookup {lc_index N | rules N} [packets N] [seed N]",
+    .function = acl_test_aclplugin_lookup_fn,
+};
+
 VLIB_CLI_COMMAND (aclplugin_show_macip_acl_command, static) = {
     .path = "show acl-plugin macip acl",
     .short_help = "show acl-plugin macip acl [index N]",
@@ -3500,11 +3708,15 @@ acl_plugin_config (vlib_main_t * vm, unformat_input_t * input)
   u32 conn_table_hash_buckets;
   uword conn_table_hash_memory_size;
   u32 conn_table_max_entries;
+  u32 conn_table_max_entries_per_worker;
+  u32 per_worker_session_tables;
   uword main_heap_size;
   uword hash_heap_size;
   u32 hash_lookup_hash_buckets;
   uword hash_lookup_hash_memory;
   u32 reclassify_sessions;
+  u32 use_timer_wheel;
+  f64 timer_wheel_interval;
   u32 use_tuple_merge;
   u32 tuple_merge_split_threshold;
 
@@ -3518,6 +3730,13 @@ acl_plugin_config (vlib_main_t * vm, unformat_input_t * input)
 	    (input, "connection hash memory %U", unformat_memory_size,
 	     &conn_table_hash_memory_size))
 	am->fa_conn_table_hash_memory_size = conn_table_hash_memory_size;
+      else if (unformat (input, "connection table per worker %d",
+			 &per_worker_session_tables))
+	am->fa_per_worker_session_tables = per_worker_session_tables;
+      else if (unformat (input, "connection count max per worker %d",
+			 &conn_table_max_entries_per_worker))
+	am->fa_conn_table_max_entries_per_worker =
+	  conn_table_max_entries_per_worker;
       else if (unformat (input, "connection count max %d",
 			 &conn_table_max_entries))
 	am->fa_conn_table_max_entries = conn_table_max_entries;
@@ -3550,6 +3769,17 @@ acl_plugin_config (vlib_main_t * vm, unformat_input_t * input)
       else if (unformat (input, "reclassify sessions %d",
 			 &reclassify_sessions))
 	am->reclassify_sessions = reclassify_sessions;
+      else if (unformat (input, "connection timer wheel interval %f",
+			 &timer_wheel_interval))
+	{
+	  if (timer_wheel_interval < 1e-3)
+	    return clib_error_return (0, "timer wheel interval %.6f too small",
+				      timer_wheel_interval);
+	  am->fa_timer_wheel_interval = timer_wheel_interval;
+	}
+      else if (unformat (input, "connection timer wheel %d",
+			 &use_timer_wheel))
+	am->fa_use_timer_wheel = use_timer_wheel;
 
       else
 	return clib_error_return (0, "unknown input '%U'",
@@ -3618,6 +3848,8 @@ acl_init (vlib_main_t * vm)
     ACL_FA_DEFAULT_MAX_DELETED_SESSIONS_PER_INTERVAL;
   am->fa_cleaner_wait_time_increment =
     ACL_FA_DEFAULT_CLEANER_WAIT_TIME_INCREMENT;
+  am->fa_use_timer_wheel = 0;
+  am->fa_timer_wheel_interval = ACL_FA_DEFAULT_TIMER_WHEEL_INTERVAL;
 
   vec_validate (am->per_worker_data, tm->n_vlib_mains - 1);
   {
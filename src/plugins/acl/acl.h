@@ -31,6 +31,7 @@
 #include "types.h"
 #include "fa_node.h"
 #include "hash_lookup_types.h"
+#include "dtree_lookup_types.h"
 #include "lookup_context.h"
 
 #define  ACL_PLUGIN_VERSION_MAJOR 1
@@ -207,6 +208,12 @@ typedef struct {
   /* vec of vectors of all info of all mask types present in ACEs contained in each lc_index */
   hash_applied_mask_info_t **hash_applied_mask_info_vec_by_lc_index;
 
+  /* Do new lookup contexts use a compiled decision tree rather than the hash */
+  int use_dtree_acl_matching;
+
+  /* decision trees by lc_index, 0 if the context does not use one */
+  dtree_acl_t **dtree_by_lc_index;
+
   /*
    * Classify tables used to grab the packets for the ACL check,
    * and serving as the 5-tuple session tables at the same time
@@ -261,6 +268,19 @@ typedef struct {
   uword fa_conn_table_hash_memory_size;
   u64 fa_conn_table_max_entries;
 
+  /*
+   * Split the session table per worker: each worker adds and deletes
+   * its sessions in its own bihash, and looks up the tables of the
+   * other workers only on a miss in its own one. The buckets and the
+   * memory above are divided between the workers. Latched when the
+   * session table is initialized.
+   */
+  int fa_per_worker_session_tables;
+  /* sessions per worker, 0 means up to fa_conn_table_max_entries */
+  u64 fa_conn_table_max_entries_per_worker;
+  /* slots of the per-worker session key filters, minus one */
+  u32 fa_session_key_filter_mask;
+
   int trace_sessions;
   int trace_acl;
 
@@ -285,6 +305,14 @@ typedef struct {
 
   u64 fa_current_cleaner_timer_wait_interval;
 
+  /*
+   * Expire the idle sessions from per-worker timer wheels rather than
+   * by polling the heads of the connection lists. Latched when the
+   * session table is initialized.
+   */
+  int fa_use_timer_wheel;
+  f64 fa_timer_wheel_interval;
+
   int fa_interrupt_generation;
 
   /* per-worker data related t conn management */
@@ -0,0 +1,721 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2019 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+/*
+ * Decision tree ACL lookup, in the spirit of HyperSplit: the rules of a
+ * lookup context are seen as boxes in a 7-dimensional space, and the
+ * space is recursively cut in two along the dimension and at the point
+ * that best balances the rules on both sides, until at most a few rules
+ * remain. Port ranges cost nothing extra here, unlike with the hash
+ * lookup where they multiply the number of mask types.
+ *
+ * The tree is compiled off the fast path and published with a pointer
+ * store once it is complete. The replaced tree is freed after
+ * vlib_worker_wait_for_quiescent_state, when no worker can still be
+ * walking it.
+ */
+
+#include <stddef.h>
+#include <netinet/in.h>
+
+#include <vlib/vlib.h>
+#include <vnet/vnet.h>
+#include <vppinfra/error.h>
+#include <vppinfra/random.h>
+#include <acl/acl.h>
+#include <plugins/acl/public_inlines.h>
+
+#include "dtree_lookup.h"
+#include "hash_lookup_private.h"
+
+/* stop cutting once a node has this few rules */
+#define DTREE_ACL_LEAF_RULES 4
+#define DTREE_ACL_MAX_DEPTH 48
+#define DTREE_ACL_MAX_NODES (1 << 20)
+
+typedef struct {
+  u64 lo[DTREE_ACL_N_DIMS];
+  u64 hi[DTREE_ACL_N_DIMS];
+  /* the rule matches every packet within its box */
+  u8 is_exact;
+} dtree_acl_box_t;
+
+typedef struct {
+  dtree_acl_t *t;
+  dtree_acl_box_t *boxes;
+  /* scratch vectors for the split selection */
+  u64 *los;
+  u64 *his;
+} dtree_acl_build_t;
+
+static void
+dtree_acl_ip6_range (ip6_address_t * addr, int prefixlen, u64 * lo, u64 * hi)
+{
+  u64 a_hi = clib_net_to_host_u64 (addr->as_u64[0]);
+  u64 a_lo = clib_net_to_host_u64 (addr->as_u64[1]);
+  u64 mask;
+
+  if (prefixlen <= 64)
+    {
+      mask = prefixlen ? ~0ULL << (64 - prefixlen) : 0;
+      lo[0] = a_hi & mask;
+      hi[0] = lo[0] | ~mask;
+      lo[1] = 0;
+      hi[1] = ~0ULL;
+    }
+  else
+    {
+      mask = ~0ULL << (128 - prefixlen);
+      lo[0] = hi[0] = a_hi;
+      lo[1] = a_lo & mask;
+      hi[1] = lo[1] | ~mask;
+    }
+}
+
+/*
+ * Compute the box covering every packet the rule can match, as checked
+ * by single_rule_match_5tuple(). Returns 0 if the rule can never match.
+ */
+static int
+dtree_acl_rule_box (acl_rule_t * r, dtree_acl_box_t * box)
+{
+  int i;
+
+  box->is_exact = (r->proto == 0);
+  if (r->is_ipv6)
+    {
+      /*
+       * The IPv6 address match only compares whole bytes exactly,
+       * so take the byte-aligned prefix as a (wider) box.
+       */
+      int src_len = (r->src_prefixlen / 8) * 8;
+      int dst_len = (r->dst_prefixlen / 8) * 8;
+      if ((r->src_prefixlen % 8) || (r->dst_prefixlen % 8))
+	box->is_exact = 0;
+      dtree_acl_ip6_range (&r->src.ip6, src_len,
+			   &box->lo[DTREE_ACL_DIM_SRC_HI],
+			   &box->hi[DTREE_ACL_DIM_SRC_HI]);
+      dtree_acl_ip6_range (&r->dst.ip6, dst_len,
+			   &box->lo[DTREE_ACL_DIM_DST_HI],
+			   &box->hi[DTREE_ACL_DIM_DST_HI]);
+    }
+  else
+    {
+      ip4_address_t *addr[2] = { &r->src.ip4, &r->dst.ip4 };
+      u8 len[2] = { r->src_prefixlen, r->dst_prefixlen };
+      for (i = 0; i < 2; i++)
+	{
+	  u32 a = clib_net_to_host_u32 (addr[i]->as_u32);
+	  u32 mask = len[i] ? ~0U << (32 - len[i]) : 0;
+	  /* host bits set in the rule address never match, see fa_acl_match_ip4_addr */
+	  if (len[i] && (a & mask) != a)
+	    return 0;
+	  box->lo[DTREE_ACL_DIM_SRC_HI + 2 * i] = 0;
+	  box->hi[DTREE_ACL_DIM_SRC_HI + 2 * i] = 0;
+	  box->lo[DTREE_ACL_DIM_SRC_LO + 2 * i] = a & mask;
+	  box->hi[DTREE_ACL_DIM_SRC_LO + 2 * i] = (a & mask) | ~mask;
+	}
+    }
+
+  if (r->proto)
+    {
+      if (r->src_port_or_type_first > r->src_port_or_type_last
+	  || r->dst_port_or_code_first > r->dst_port_or_code_last)
+	return 0;
+      box->lo[DTREE_ACL_DIM_PROTO] = box->hi[DTREE_ACL_DIM_PROTO] = r->proto;
+      box->lo[DTREE_ACL_DIM_SRC_PORT] = r->src_port_or_type_first;
+      box->hi[DTREE_ACL_DIM_SRC_PORT] = r->src_port_or_type_last;
+      box->lo[DTREE_ACL_DIM_DST_PORT] = r->dst_port_or_code_first;
+      box->hi[DTREE_ACL_DIM_DST_PORT] = r->dst_port_or_code_last;
+    }
+  else
+    {
+      box->lo[DTREE_ACL_DIM_PROTO] = 0;
+      box->hi[DTREE_ACL_DIM_PROTO] = 0xff;
+      box->lo[DTREE_ACL_DIM_SRC_PORT] = box->lo[DTREE_ACL_DIM_DST_PORT] = 0;
+      box->hi[DTREE_ACL_DIM_SRC_PORT] = box->hi[DTREE_ACL_DIM_DST_PORT] =
+	0xffff;
+    }
+  return 1;
+}
+
+static void
+dtree_acl_full_box (int is_ip6, u64 * lo, u64 * hi)
+{
+  int d;
+  for (d = 0; d < DTREE_ACL_N_DIMS; d++)
+    lo[d] = 0;
+  hi[DTREE_ACL_DIM_SRC_HI] = hi[DTREE_ACL_DIM_DST_HI] = is_ip6 ? ~0ULL : 0;
+  hi[DTREE_ACL_DIM_SRC_LO] = hi[DTREE_ACL_DIM_DST_LO] =
+    is_ip6 ? ~0ULL : 0xffffffff;
+  hi[DTREE_ACL_DIM_SRC_PORT] = hi[DTREE_ACL_DIM_DST_PORT] = 0xffff;
+  hi[DTREE_ACL_DIM_PROTO] = 0xff;
+}
+
+static int
+dtree_acl_box_covers (dtree_acl_box_t * box, u64 * lo, u64 * hi)
+{
+  int d;
+  for (d = 0; d < DTREE_ACL_N_DIMS; d++)
+    if (box->lo[d] > lo[d] || box->hi[d] < hi[d])
+      return 0;
+  return 1;
+}
+
+static int
+dtree_acl_cmp_u64 (void *a1, void *a2)
+{
+  u64 *v1 = a1, *v2 = a2;
+  return (*v1 > *v2) - (*v1 < *v2);
+}
+
+/* number of elements <= val in a sorted vector */
+static u32
+dtree_acl_count_le (u64 * v, u64 val)
+{
+  u32 lo = 0, hi = vec_len (v);
+  while (lo < hi)
+    {
+      u32 mid = (lo + hi) / 2;
+      if (v[mid] <= val)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+  return lo;
+}
+
+static u32
+dtree_acl_add_leaf (dtree_acl_build_t * b, u32 * rules, u32 n_rules)
+{
+  dtree_acl_t *t = b->t;
+  dtree_acl_leaf_t *leaf;
+
+  vec_add2 (t->leaves, leaf, 1);
+  leaf->first = vec_len (t->leaf_rules);
+  leaf->n_rules = n_rules;
+  vec_add (t->leaf_rules, rules, n_rules);
+  if (n_rules > t->max_leaf_rules)
+    t->max_leaf_rules = n_rules;
+  return (leaf - t->leaves) | DTREE_ACL_LEAF;
+}
+
+/*
+ * Pick the cut that minimizes the larger of the two halves, counting
+ * the rules which straddle the cut on both sides.
+ */
+static int
+dtree_acl_choose_split (dtree_acl_build_t * b, u32 * rules, u64 * lo,
+			u64 * hi, u8 * best_dim, u64 * best_split)
+{
+  u32 n = vec_len (rules);
+  u32 best_cost = n, best_sum = 2 * n;
+  u32 d, i, j, n_left, n_right;
+  u64 split;
+
+  for (d = 0; d < DTREE_ACL_N_DIMS; d++)
+    {
+      if (lo[d] == hi[d])
+	continue;
+      vec_reset_length (b->los);
+      vec_reset_length (b->his);
+      for (i = 0; i < n; i++)
+	{
+	  dtree_acl_box_t *box = b->boxes + rules[i];
+	  vec_add1 (b->los, clib_max (box->lo[d], lo[d]));
+	  vec_add1 (b->his, clib_min (box->hi[d], hi[d]));
+	}
+      vec_sort_with_function (b->los, dtree_acl_cmp_u64);
+      vec_sort_with_function (b->his, dtree_acl_cmp_u64);
+
+      /* candidate cuts are just below a rule start or at a rule end */
+      for (j = 0; j < 2 * n; j++)
+	{
+	  if (j < n)
+	    {
+	      if (b->los[j] == lo[d] || (j && b->los[j] == b->los[j - 1]))
+		continue;
+	      split = b->los[j] - 1;
+	    }
+	  else
+	    {
+	      i = j - n;
+	      if (b->his[i] == hi[d] || (i && b->his[i] == b->his[i - 1]))
+		continue;
+	      split = b->his[i];
+	    }
+	  n_left = dtree_acl_count_le (b->los, split);
+	  n_right = n - dtree_acl_count_le (b->his, split);
+	  if (clib_max (n_left, n_right) < best_cost
+	      || (clib_max (n_left, n_right) == best_cost
+		  && n_left + n_right < best_sum))
+	    {
+	      best_cost = clib_max (n_left, n_right);
+	      best_sum = n_left + n_right;
+	      *best_dim = d;
+	      *best_split = split;
+	    }
+	}
+    }
+  return best_cost < n;
+}
+
+static u32
+dtree_acl_build_node (dtree_acl_build_t * b, u32 * rules, u64 * lo, u64 * hi,
+		      u32 depth)
+{
+  dtree_acl_t *t = b->t;
+  u64 child_lo[DTREE_ACL_N_DIMS], child_hi[DTREE_ACL_N_DIMS];
+  u32 *left = 0, *right = 0;
+  u32 i, n = vec_len (rules), node_index, ref;
+  u64 split = 0;
+  u8 dim = 0;
+
+  if (depth > t->max_depth)
+    t->max_depth = depth;
+
+  /* rules after one that covers the whole box are never reached */
+  for (i = 0; i < n; i++)
+    {
+      dtree_acl_box_t *box = b->boxes + rules[i];
+      if (box->is_exact && dtree_acl_box_covers (box, lo, hi))
+	{
+	  n = i + 1;
+	  break;
+	}
+    }
+
+  if (n <= DTREE_ACL_LEAF_RULES || depth >= DTREE_ACL_MAX_DEPTH
+      || vec_len (t->nodes) >= DTREE_ACL_MAX_NODES)
+    return dtree_acl_add_leaf (b, rules, n);
+
+  _vec_len (rules) = n;
+  if (!dtree_acl_choose_split (b, rules, lo, hi, &dim, &split))
+    return dtree_acl_add_leaf (b, rules, n);
+
+  for (i = 0; i < n; i++)
+    {
+      dtree_acl_box_t *box = b->boxes + rules[i];
+      if (box->lo[dim] <= split)
+	vec_add1 (left, rules[i]);
+      if (box->hi[dim] > split)
+	vec_add1 (right, rules[i]);
+    }
+
+  node_index = vec_len (t->nodes);
+  vec_validate (t->nodes, node_index);
+  t->nodes[node_index].dim = dim;
+  t->nodes[node_index].split = split;
+
+  clib_memcpy (child_lo, lo, sizeof (child_lo));
+  clib_memcpy (child_hi, hi, sizeof (child_hi));
+  child_hi[dim] = split;
+  ref = dtree_acl_build_node (b, left, child_lo, child_hi, depth + 1);
+  t->nodes[node_index].child[0] = ref;
+
+  child_hi[dim] = hi[dim];
+  child_lo[dim] = split + 1;
+  ref = dtree_acl_build_node (b, right, child_lo, child_hi, depth + 1);
+  t->nodes[node_index].child[1] = ref;
+
+  vec_free (left);
+  vec_free (right);
+  return node_index;
+}
+
+static dtree_acl_t *
+dtree_acl_compile (acl_main_t * am, u32 lc_index)
+{
+  acl_lookup_context_t *acontext =
+    pool_elt_at_index (am->acl_lookup_contexts, lc_index);
+  dtree_acl_build_t _b = { 0 }, *b = &_b;
+  u64 lo[DTREE_ACL_N_DIMS], hi[DTREE_ACL_N_DIMS];
+  dtree_acl_rule_t *dr;
+  dtree_acl_t *t;
+  u32 *rules = 0;
+  int i, j, is_ip6;
+  applied_hash_ace_entry_t *pae, **applied_hash_aces = 0;
+  uword *entry_by_rule = hash_create (0, sizeof (uword)), *p;
+
+  t = clib_mem_alloc (sizeof (*t));
+  clib_memset (t, 0, sizeof (*t));
+  b->t = t;
+
+  /* hits are counted on the first applied hash entry of each rule */
+  if (lc_index < vec_len (am->hash_entry_vec_by_lc_index))
+    applied_hash_aces = vec_elt_at_index (am->hash_entry_vec_by_lc_index,
+					  lc_index);
+  if (applied_hash_aces)
+    vec_foreach (pae, (*applied_hash_aces))
+    {
+      u64 key = ((u64) pae->acl_index << 32) | pae->ace_index;
+      if (!hash_get (entry_by_rule, key))
+	hash_set (entry_by_rule, key, pae - (*applied_hash_aces));
+    }
+
+  for (i = 0; i < vec_len (acontext->acl_indices); i++)
+    {
+      u32 acl_index = acontext->acl_indices[i];
+      acl_list_t *a;
+      if (pool_is_free_index (am->acls, acl_index))
+	continue;
+      a = pool_elt_at_index (am->acls, acl_index);
+      for (j = 0; j < vec_len (a->rules); j++)
+	{
+	  vec_add2 (t->rules, dr, 1);
+	  dr->rule = a->rules[j];
+	  dr->acl_index = acl_index;
+	  dr->ace_index = j;
+	  dr->acl_position = i;
+	  p = hash_get (entry_by_rule, ((u64) acl_index << 32) | j);
+	  dr->applied_entry_index = p ? p[0] : ~0;
+	}
+    }
+  hash_free (entry_by_rule);
+
+  vec_validate (b->boxes, vec_len (t->rules));
+  for (is_ip6 = 0; is_ip6 < 2; is_ip6++)
+    {
+      vec_reset_length (rules);
+      vec_foreach (dr, t->rules)
+      {
+	if (dr->rule.is_ipv6 != is_ip6)
+	  continue;
+	if (dtree_acl_rule_box (&dr->rule, b->boxes + (dr - t->rules)))
+	  vec_add1 (rules, dr - t->rules);
+      }
+      dtree_acl_full_box (is_ip6, lo, hi);
+      t->root[is_ip6] = dtree_acl_build_node (b, rules, lo, hi, 0);
+    }
+
+  vec_free (rules);
+  vec_free (b->boxes);
+  vec_free (b->los);
+  vec_free (b->his);
+  return t;
+}
+
+static void
+dtree_acl_free (dtree_acl_t * t)
+{
+  if (!t)
+    return;
+  vec_free (t->rules);
+  vec_free (t->nodes);
+  vec_free (t->leaves);
+  vec_free (t->leaf_rules);
+  clib_mem_free (t);
+}
+
+static void
+dtree_acl_swap (acl_main_t * am, u32 lc_index, dtree_acl_t * t)
+{
+  dtree_acl_t **old_trees = 0, **trees;
+  dtree_acl_t *old;
+
+  if (!t && lc_index >= vec_len (am->dtree_by_lc_index))
+    return;
+
+  /* workers may be reading the vector, grow a copy */
+  if (lc_index >= vec_len (am->dtree_by_lc_index))
+    {
+      trees = vec_dup (am->dtree_by_lc_index);
+      vec_validate (trees, lc_index);
+      old_trees = am->dtree_by_lc_index;
+      CLIB_MEMORY_STORE_BARRIER ();
+      am->dtree_by_lc_index = trees;
+    }
+
+  old = am->dtree_by_lc_index[lc_index];
+  CLIB_MEMORY_STORE_BARRIER ();
+  am->dtree_by_lc_index[lc_index] = t;
+
+  /* free what workers may still use once they all moved on */
+  if (old || old_trees)
+    {
+      vlib_worker_wait_for_quiescent_state ();
+      vec_free (old_trees);
+      dtree_acl_free (old);
+    }
+}
+
+void
+dtree_acl_rebuild (acl_main_t * am, u32 lc_index)
+{
+  acl_lookup_context_t *acontext;
+  void *oldheap;
+
+  if (pool_is_free_index (am->acl_lookup_contexts, lc_index))
+    return;
+  acontext = pool_elt_at_index (am->acl_lookup_contexts, lc_index);
+  if (!acontext->use_dtree)
+    {
+      dtree_acl_remove (am, lc_index);
+      return;
+    }
+
+  oldheap = acl_plugin_set_heap ();
+  DBG0 ("DTREE rebuild lc_index %d", lc_index);
+  dtree_acl_swap (am, lc_index, dtree_acl_compile (am, lc_index));
+  clib_mem_set_heap (oldheap);
+}
+
+void
+dtree_acl_remove (acl_main_t * am, u32 lc_index)
+{
+  void *oldheap = acl_plugin_set_heap ();
+  dtree_acl_swap (am, lc_index, 0);
+  clib_mem_set_heap (oldheap);
+}
+
+void
+dtree_acl_notify_acl_change (acl_main_t * am, u32 acl_index)
+{
+  u32 *lc_indices, *plc;
+
+  if (acl_index >= vec_len (am->lc_index_vec_by_acl))
+    return;
+  /* rebuilding does not change the vector, but be safe against it */
+  lc_indices = vec_dup (am->lc_index_vec_by_acl[acl_index]);
+  vec_foreach (plc, lc_indices) dtree_acl_rebuild (am, *plc);
+  vec_free (lc_indices);
+}
+
+void
+acl_plugin_show_tables_dtree (u32 lc_index)
+{
+  acl_main_t *am = &acl_main;
+  vlib_main_t *vm = am->vlib_main;
+  dtree_acl_t *t;
+  u32 lci;
+
+  vlib_cli_output (vm, "Decision trees for lookup contexts");
+  for (lci = 0; lci < vec_len (am->dtree_by_lc_index); lci++)
+    {
+      if ((lc_index != ~0) && (lc_index != lci))
+	continue;
+      t = am->dtree_by_lc_index[lci];
+      if (!t)
+	continue;
+      vlib_cli_output (vm,
+		       "lc_index %d: rules %d nodes %d leaves %d leaf rules %d max depth %d max leaf rules %d",
+		       lci, vec_len (t->rules), vec_len (t->nodes),
+		       vec_len (t->leaves), vec_len (t->leaf_rules),
+		       t->max_depth, t->max_leaf_rules);
+    }
+}
+
+typedef struct {
+  u8 matched;
+  u8 action;
+  u32 acl_pos;
+  u32 ace_index;
+} dtree_acl_bench_result_t;
+
+static u64
+dtree_acl_bench_random (u32 * seed, u64 lo, u64 hi)
+{
+  u64 r = ((u64) random_u32 (seed) << 32) | random_u32 (seed);
+  if (hi - lo == ~0ULL)
+    return r;
+  return lo + r % (hi - lo + 1);
+}
+
+/*
+ * Most packets are drawn from within the box of a random rule, so that
+ * deep and shadowed rules get exercised; the rest are uniformly random.
+ */
+static void
+dtree_acl_bench_packet (dtree_acl_t * t, u32 lc_index, u32 * seed,
+			fa_5tuple_t * pkt)
+{
+  dtree_acl_box_t box;
+  u64 key[DTREE_ACL_N_DIMS];
+  int d, is_ip6 = random_u32 (seed) & 1;
+  acl_rule_t *r = 0;
+
+  if (vec_len (t->rules) && (random_u32 (seed) % 8))
+    {
+      r = &t->rules[random_u32 (seed) % vec_len (t->rules)].rule;
+      is_ip6 = r->is_ipv6;
+      if (!dtree_acl_rule_box (r, &box))
+	r = 0;
+    }
+  if (!r)
+    dtree_acl_full_box (is_ip6, box.lo, box.hi);
+  for (d = 0; d < DTREE_ACL_N_DIMS; d++)
+    key[d] = dtree_acl_bench_random (seed, box.lo[d], box.hi[d]);
+  if (!r || !r->proto)
+    {
+      u8 protos[] = { IP_PROTOCOL_TCP, IP_PROTOCOL_UDP,
+	IP_PROTOCOL_ICMP, key[DTREE_ACL_DIM_PROTO]
+      };
+      key[DTREE_ACL_DIM_PROTO] = protos[random_u32 (seed) % 4];
+    }
+
+  clib_memset (pkt, 0, sizeof (*pkt));
+  if (is_ip6)
+    {
+      pkt->ip6_addr[0].as_u64[0] =
+	clib_host_to_net_u64 (key[DTREE_ACL_DIM_SRC_HI]);
+      pkt->ip6_addr[0].as_u64[1] =
+	clib_host_to_net_u64 (key[DTREE_ACL_DIM_SRC_LO]);
+      pkt->ip6_addr[1].as_u64[0] =
+	clib_host_to_net_u64 (key[DTREE_ACL_DIM_DST_HI]);
+      pkt->ip6_addr[1].as_u64[1] =
+	clib_host_to_net_u64 (key[DTREE_ACL_DIM_DST_LO]);
+    }
+  else
+    {
+      pkt->ip4_addr[0].as_u32 =
+	clib_host_to_net_u32 (key[DTREE_ACL_DIM_SRC_LO]);
+      pkt->ip4_addr[1].as_u32 =
+	clib_host_to_net_u32 (key[DTREE_ACL_DIM_DST_LO]);
+    }
+  pkt->l4.port[0] = key[DTREE_ACL_DIM_SRC_PORT];
+  pkt->l4.port[1] = key[DTREE_ACL_DIM_DST_PORT];
+  pkt->l4.proto = key[DTREE_ACL_DIM_PROTO];
+  pkt->pkt.is_ip6 = is_ip6;
+  pkt->pkt.l4_valid = 1;
+  pkt->pkt.tcp_flags_valid = (pkt->l4.proto == IP_PROTOCOL_TCP);
+  pkt->pkt.tcp_flags = random_u32 (seed);
+  pkt->pkt.lc_index = lc_index;
+}
+
+clib_error_t *
+dtree_acl_lookup_bench (vlib_main_t * vm, u32 lc_index, u32 n_packets,
+			u32 seed)
+{
+  acl_main_t *am = &acl_main;
+  dtree_acl_bench_result_t *res[3] = { 0 }, *r;
+  char *names[3] = { "linear", "hash", "dtree" };
+  applied_hash_ace_entry_t **applied_hash_aces;
+  fa_5tuple_t *pkts = 0, *pkt;
+  dtree_acl_t *t, *tmp = 0;
+  u32 n_mismatch[3] = { 0 }, n_matched[3] = { 0 };
+  u32 trace_bitmap, acl_match, e, i;
+  u64 t0, t1;
+  f64 ns[3];
+  void *oldheap;
+
+  if (pool_is_free_index (am->acl_lookup_contexts, lc_index))
+    return clib_error_return (0, "lookup context %d does not exist",
+			      lc_index);
+  if (lc_index >= vec_len (am->hash_entry_vec_by_lc_index))
+    return clib_error_return (0, "lookup context %d has no hash ACLs",
+			      lc_index);
+  applied_hash_aces = vec_elt_at_index (am->hash_entry_vec_by_lc_index,
+					lc_index);
+
+  oldheap = acl_plugin_set_heap ();
+  t = lc_index < vec_len (am->dtree_by_lc_index) ?
+    am->dtree_by_lc_index[lc_index] : 0;
+  if (!t)
+    t = tmp = dtree_acl_compile (am, lc_index);
+
+  vec_validate (pkts, n_packets - 1);
+  for (i = 0; i < 3; i++)
+    vec_validate (res[i], n_packets - 1);
+  vec_foreach (pkt, pkts) dtree_acl_bench_packet (t, lc_index, &seed, pkt);
+
+  for (e = 0; e < 3; e++)
+    {
+      t0 = clib_cpu_time_now ();
+      for (i = 0; i < n_packets; i++)
+	{
+	  pkt = pkts + i;
+	  r = res[e] + i;
+	  if (e == 0)
+	    r->matched = linear_multi_acl_match_5tuple (am, lc_index, pkt,
+							pkt->pkt.is_ip6,
+							&r->action,
+							&r->acl_pos,
+							&acl_match,
+							&r->ace_index,
+							&trace_bitmap);
+	  else if (e == 1)
+	    {
+	      /* not hash_multi_acl_match_5tuple(), to leave hitcounts alone */
+	      u32 index = multi_acl_match_get_applied_ace_index (am,
+								 pkt->pkt.is_ip6,
+								 pkt);
+	      r->matched = index < vec_len ((*applied_hash_aces));
+	      if (r->matched)
+		{
+		  applied_hash_ace_entry_t *pae = (*applied_hash_aces) + index;
+		  r->action = pae->action;
+		  r->acl_pos = pae->acl_position;
+		  r->ace_index = pae->ace_index;
+		}
+	    }
+	  else
+	    {
+	      /* not dtree_multi_acl_match_5tuple(), same as above */
+	      dtree_acl_rule_t *dr = dtree_acl_match_rule (t, pkt,
+							   pkt->pkt.is_ip6);
+	      r->matched = dr != 0;
+	      if (r->matched)
+		{
+		  r->action = dr->rule.is_permit;
+		  r->acl_pos = dr->acl_position;
+		  r->ace_index = dr->ace_index;
+		}
+	    }
+	}
+      t1 = clib_cpu_time_now ();
+      ns[e] = (f64) (t1 - t0) * 1e9 / vm->clib_time.clocks_per_second
+	/ (f64) (n_packets ? n_packets : 1);
+    }
+
+  for (e = 0; e < 3; e++)
+    for (i = 0; i < n_packets; i++)
+      {
+	dtree_acl_bench_result_t *r0 = res[0] + i;
+	r = res[e] + i;
+	n_matched[e] += r->matched;
+	if (r->matched != r0->matched || (r->matched &&
+					  (r->acl_pos != r0->acl_pos
+					   || r->ace_index != r0->ace_index)))
+	  n_mismatch[e]++;
+      }
+
+  vlib_cli_output (vm, "lc_index %d: %d rules, %d tree nodes, %d packets",
+		   lc_index, vec_len (t->rules), vec_len (t->nodes),
+		   n_packets);
+  for (e = 0; e < 3; e++)
+    vlib_cli_output (vm, "  %-8s %8.2f ns/packet, %d matched, %d mismatched",
+		     names[e], ns[e], n_matched[e], n_mismatch[e]);
+
+  dtree_acl_free (tmp);
+  vec_free (pkts);
+  for (i = 0; i < 3; i++)
+    vec_free (res[i]);
+  clib_mem_set_heap (oldheap);
+
+  if (n_mismatch[2])
+    return clib_error_return (0, "dtree lookup mismatch on %d packets",
+			      n_mismatch[2]);
+  return 0;
+}
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,44 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2019 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+#ifndef _ACL_DTREE_LOOKUP_H_
+#define _ACL_DTREE_LOOKUP_H_
+
+#include "acl.h"
+
+/*
+ * Compile the ACLs of the lookup context into a decision tree and swap it
+ * in for the lookups. Does nothing unless the context has use_dtree set.
+ */
+void dtree_acl_rebuild (acl_main_t *am, u32 lc_index);
+
+/* Stop using the decision tree for the lookup context and free it */
+void dtree_acl_remove (acl_main_t *am, u32 lc_index);
+
+/* Rebuild the trees of all the lookup contexts the ACL is used in */
+void dtree_acl_notify_acl_change (acl_main_t *am, u32 acl_index);
+
+void acl_plugin_show_tables_dtree (u32 lc_index);
+
+/*
+ * Run the same random packets through the linear, hash and decision tree
+ * engines for a lookup context, compare the verdicts and report ns/packet.
+ */
+clib_error_t *dtree_acl_lookup_bench (vlib_main_t *vm, u32 lc_index,
+                                      u32 n_packets, u32 seed);
+
+#endif
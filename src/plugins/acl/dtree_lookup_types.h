@@ -0,0 +1,82 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2019 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+#ifndef _ACL_DTREE_LOOKUP_TYPES_H_
+#define _ACL_DTREE_LOOKUP_TYPES_H_
+
+#include "types.h"
+
+/*
+ * The dimensions the decision tree cuts along. IPv6 addresses are
+ * split into two 64-bit halves so every dimension is a u64 range;
+ * IPv4 addresses live in the low half with the high half zero.
+ */
+typedef enum {
+  DTREE_ACL_DIM_SRC_HI,
+  DTREE_ACL_DIM_SRC_LO,
+  DTREE_ACL_DIM_DST_HI,
+  DTREE_ACL_DIM_DST_LO,
+  DTREE_ACL_DIM_SRC_PORT,
+  DTREE_ACL_DIM_DST_PORT,
+  DTREE_ACL_DIM_PROTO,
+  DTREE_ACL_N_DIMS,
+} dtree_acl_dim_t;
+
+/* child references with this bit set are leaf indices */
+#define DTREE_ACL_LEAF (1 << 31)
+
+typedef struct {
+  /* packets with key[dim] <= split go to child[0], the rest to child[1] */
+  u64 split;
+  u32 child[2];
+  u8 dim;
+} dtree_acl_node_t;
+
+typedef struct {
+  /* candidate rules, in priority order, at leaf_rules[first] */
+  u32 first;
+  u32 n_rules;
+} dtree_acl_leaf_t;
+
+typedef struct {
+  /* a copy of the rule, so the tree does not depend on the ACL pool */
+  acl_rule_t rule;
+  u32 acl_index;
+  u32 ace_index;
+  u32 acl_position;
+  /* applied hash ACE entry whose hitcount a match bumps, ~0 if none */
+  u32 applied_entry_index;
+} dtree_acl_rule_t;
+
+/*
+ * The decision tree compiled from all the ACLs of one lookup context.
+ * Built off the fast path, then swapped in as a whole.
+ */
+typedef struct {
+  /* rules of the context, index == priority */
+  dtree_acl_rule_t *rules;
+  dtree_acl_node_t *nodes;
+  dtree_acl_leaf_t *leaves;
+  u32 *leaf_rules;
+  /* root reference for IPv4 and IPv6 */
+  u32 root[2];
+  /* Debug Information */
+  u32 max_depth;
+  u32 max_leaf_rules;
+} dtree_acl_t;
+
+#endif
@@ -74,6 +74,14 @@ typedef int (*acl_plugin_match_5tuple_fn_t) (u32 lc_index,
                                            u32 * r_rule_match_p,
                                            u32 * trace_bitmap);
 
+/*
+ * Match the packets in the lookup context with a decision tree compiled
+ * from its ACLs, rather than with the hash. Suits large rule sets with
+ * many port ranges. The tree is rebuilt whenever the ACLs change.
+ */
+
+typedef int (*acl_plugin_set_dtree_for_context_fn_t) (u32 lc_index, int enable);
+
 
 #define foreach_acl_plugin_exported_method_name \
 _(acl_exists)                          \
@@ -82,7 +90,8 @@ _(get_lookup_context_index)            \
 _(put_lookup_context_index)            \
 _(set_acl_vec_for_context)             \
 _(fill_5tuple)                         \
-_(match_5tuple)                        
+_(match_5tuple)                        \
+_(set_dtree_for_context)
 
 #define _(name) acl_plugin_ ## name ## _fn_t name;
 typedef struct {
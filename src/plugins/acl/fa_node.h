@@ -4,6 +4,7 @@
 #include <stddef.h>
 #include <vppinfra/bihash_16_8.h>
 #include <vppinfra/bihash_40_8.h>
+#include <vppinfra/tw_timer_4t_3w_256sl.h>
 
 #include <plugins/acl/exported_types.h>
 
@@ -24,6 +25,10 @@
 #define ACL_FA_CONN_TABLE_DEFAULT_HASH_MEMORY_SIZE (1ULL<<30)
 #define ACL_FA_CONN_TABLE_DEFAULT_MAX_ENTRIES 500000
 
+/* the session timer wheel ticks, and the longest timer it can hold */
+#define ACL_FA_DEFAULT_TIMER_WHEEL_INTERVAL 0.1
+#define ACL_FA_TIMER_WHEEL_MAX_TICKS ((1 << 24) - 1)
+
 typedef union {
   u64 as_u64;
   struct {
@@ -118,7 +123,9 @@ typedef struct {
   u8 deleted;             /* +1 bytes = 18 */
   u8 is_ip6;              /* +1 bytes = 19 */
   u8 reserved1[5];        /* +5 bytes = 24 */
-  u64 reserved2[5];       /* +5*8 bytes = 64 */
+  u32 timer_handle;       /* +4 bytes = 28 */
+  u32 reserved3;          /* +4 bytes = 32 */
+  u64 reserved2[4];       /* +4*8 bytes = 64 */
 } fa_session_t;
 
 #define FA_POLICY_EPOCH_MASK 0x7fff
@@ -168,6 +175,25 @@ CT_ASSERT_EQUAL(fa_5tuple_opaque_t_must_match_5tuple, sizeof(fa_5tuple_opaque_t)
 typedef struct {
   /* The pool of sessions managed by this worker */
   fa_session_t *fa_sessions_pool;
+  /*
+   * With the per-worker session tables, the keys of the sessions
+   * of this worker. Only this worker writes them, any worker reads.
+   */
+  clib_bihash_40_8_t fa_ip6_sessions_hash;
+  clib_bihash_16_8_t fa_ip4_sessions_hash;
+  /* session totals of this worker, with the per-worker session tables */
+  u64 fa_session_total_adds;
+  u64 fa_session_total_dels;
+  u64 fa_session_total_deactivations;
+  /*
+   * Counts of the session keys in the tables above, by key hash.
+   * Only this worker writes them, the other workers read them on
+   * a miss in their own table before probing this worker's one.
+   */
+  u32 *fa_session_key_counts;
+  /* sessions found in the table of another worker, and the tables probed */
+  u64 cnt_remote_session_hits;
+  u64 cnt_remote_session_probes;
   /* incoming session change requests from other workers */
   clib_spinlock_t pending_session_change_request_lock;
   u64 *pending_session_change_requests;
@@ -184,6 +210,8 @@ typedef struct {
   u64 *fa_session_adds_by_sw_if_index;
   /* sessions deleted due to epoch change */
   u64 *fa_session_epoch_change_by_sw_if_index;
+  /* Session idle timers, when the timer wheel is in use */
+  tw_timer_wheel_4t_3w_256sl_t session_timer_wheel;
   /* Vector of expired connections retrieved from lists */
   u32 *expired;
   /* the earliest next expiry time */
@@ -198,6 +226,13 @@ typedef struct {
   u64 cnt_already_deleted_sessions;
   /* Number of times we requeued a session to a head of the list */
   u64 cnt_session_timer_restarted;
+  /* Number of session timers fired by the timer wheel */
+  u64 cnt_session_timer_expired;
+  /* Number of session timers currently on the timer wheel */
+  u32 n_session_timers_running;
+  /* Hash ACL lookups: mask type bihash probes and bloom filter skips */
+  u64 cnt_hash_mask_probes;
+  u64 cnt_hash_mask_bloom_skips;
   /* swipe up to this enqueue time, rather than following the timeouts */
   u64 swipe_end_time;
   /* bitmap of sw_if_index serviced by this worker */
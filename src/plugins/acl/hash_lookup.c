@@ -421,6 +421,50 @@ add_del_hashtable_entry(acl_main_t *am,
 }
 
 
+/*
+ * Build the per-mask-type bloom filters for a lookup context: every applied
+ * entry sets the bits of its bihash key hash in the filter of its mask type.
+ */
+static void
+build_hash_applied_mask_bloom (acl_main_t * am,
+                               applied_hash_ace_entry_t ** applied_hash_aces,
+                               u32 lc_index,
+                               hash_applied_mask_info_t * minfo_vec)
+{
+  hash_applied_mask_info_t *minfo;
+  clib_bihash_kv_48_8_t kv;
+  u32 b0, b1;
+  u64 hash;
+  int i, j;
+
+  vec_foreach (minfo, minfo_vec)
+    {
+      minfo->bloom_log2_bits = clib_max (min_log2 (minfo->num_entries) + 4, 6);
+      minfo->bloom_log2_bits = clib_min (minfo->bloom_log2_bits, 24);
+      vec_validate_aligned (minfo->bloom,
+                            (1 << (minfo->bloom_log2_bits - 6)) - 1,
+                            CLIB_CACHE_LINE_BYTES);
+    }
+
+  for (i = 0; i < vec_len ((*applied_hash_aces)); i++)
+    {
+      applied_hash_ace_entry_t *pae =
+        vec_elt_at_index ((*applied_hash_aces), i);
+      for (j = 0; j < vec_len (minfo_vec); j++)
+        if (minfo_vec[j].mask_type_index == pae->mask_type_index)
+          break;
+      if (j == vec_len (minfo_vec))
+        continue;
+      minfo = vec_elt_at_index (minfo_vec, j);
+
+      fill_applied_hash_ace_kv (am, applied_hash_aces, lc_index, i, &kv);
+      hash = clib_bihash_hash_48_8 (&kv);
+      hash_acl_bloom_bits (minfo->bloom_log2_bits, hash, &b0, &b1);
+      minfo->bloom[b0 / 64] |= 1ULL << (b0 % 64);
+      minfo->bloom[b1 / 64] |= 1ULL << (b1 % 64);
+    }
+}
+
 static void
 remake_hash_applied_mask_info_vec (acl_main_t * am,
                                    applied_hash_ace_entry_t **
@@ -468,9 +512,14 @@ remake_hash_applied_mask_info_vec (acl_main_t * am,
         minfo->first_rule_index = i;
     }
 
+  build_hash_applied_mask_bloom (am, applied_hash_aces, lc_index,
+                                 new_hash_applied_mask_info_vec);
+
   hash_applied_mask_info_t **hash_applied_mask_info_vec =
     vec_elt_at_index (am->hash_applied_mask_info_vec_by_lc_index, lc_index);
 
+  vec_foreach (minfo, (*hash_applied_mask_info_vec))
+    vec_free (minfo->bloom);
   vec_free ((*hash_applied_mask_info_vec));
   (*hash_applied_mask_info_vec) = new_hash_applied_mask_info_vec;
 }
@@ -1294,8 +1343,9 @@ static void
 acl_plugin_print_applied_mask_info (vlib_main_t * vm, int j, hash_applied_mask_info_t *mi)
 {
   vlib_cli_output (vm,
-		   "    %4d: mask type index %d first rule index %d num_entries %d max_collisions %d",
-		   j, mi->mask_type_index, mi->first_rule_index, mi->num_entries, mi->max_collisions);
+		   "    %4d: mask type index %d first rule index %d num_entries %d max_collisions %d bloom bits %d",
+		   j, mi->mask_type_index, mi->first_rule_index, mi->num_entries, mi->max_collisions,
+		   mi->bloom ? 1 << mi->bloom_log2_bits : 0);
 }
 
 void
@@ -1304,6 +1354,12 @@ acl_plugin_show_tables_applied_info (u32 lc_index)
   acl_main_t *am = &acl_main;
   vlib_main_t *vm = am->vlib_main;
   u32 lci, j;
+  acl_fa_per_worker_data_t *pw;
+
+  vec_foreach (pw, am->per_worker_data)
+    vlib_cli_output (vm, "Thread #%d: mask type probes %lu, bloom filter skips %lu",
+                     (int) (pw - am->per_worker_data), pw->cnt_hash_mask_probes,
+                     pw->cnt_hash_mask_bloom_skips);
   vlib_cli_output (vm, "Applied lookup entries for lookup contexts");
 
   for (lci = 0;
@@ -1623,6 +1679,8 @@ split_partition(acl_main_t *am, u32 first_index,
 	minfo->num_entries = 0;
 	minfo->max_collisions = 0;
 	minfo->first_rule_index = ~0;
+	/* entries are about to move in: probe unfiltered until the next remake */
+	vec_free(minfo->bloom);
 
 	DBG( "TM-split_partition - mask type index-assigned!! -> %d", new_mask_type_index);
 
@@ -107,8 +107,32 @@ typedef struct {
    /* Debug Information */
    u32 num_entries;
    u32 max_collisions;
+   /*
+    * Bloom filter over the bihash hashes of the entries with this mask
+    * type in this lookup context. A miss means the bihash probe can be
+    * skipped. Zero means "no filter, always probe".
+    */
+   u64 *bloom;
+   u32 bloom_log2_bits;
 } hash_applied_mask_info_t;
 
+/* two bit positions per hash; the filter is sized to ~16 bits per entry */
+static inline void
+hash_acl_bloom_bits (u32 log2_bits, u64 hash, u32 *b0, u32 *b1)
+{
+  u32 h = (u32) hash;
+  *b0 = h & pow2_mask (log2_bits);
+  *b1 = (h * 0x9e3779b1) >> (32 - log2_bits);
+}
+
+static inline int
+hash_acl_bloom_test (u64 *bloom, u32 log2_bits, u64 hash)
+{
+  u32 b0, b1;
+  hash_acl_bloom_bits (log2_bits, hash, &b0, &b1);
+  return ((bloom[b0 / 64] >> (b0 % 64)) & (bloom[b1 / 64] >> (b1 % 64)) & 1);
+}
+
 
 #define CT_ASSERT_EQUAL(name, x,y) typedef int assert_ ## name ## _compile_time_assertion_failed[((x) == (y))-1]
 
@@ -18,6 +18,7 @@
 #include <vlib/unix/plugin.h>
 #include <plugins/acl/public_inlines.h>
 #include "hash_lookup.h"
+#include "dtree_lookup.h"
 #include "elog_acl_trace.h"
 
 /* check if a given ACL exists */
@@ -107,6 +108,7 @@ static int acl_plugin_get_lookup_context_index (u32 acl_user_id, u32 val1, u32 v
   acontext->context_user_id = acl_user_id;
   acontext->user_val1 = val1;
   acontext->user_val2 = val2;
+  acontext->use_dtree = am->use_dtree_acl_matching;
 
   u32 new_context_id = acontext - am->acl_lookup_contexts;
   vec_add1(am->acl_users[acl_user_id].lookup_contexts, new_context_id);
@@ -198,6 +200,7 @@ static void acl_plugin_put_lookup_context_index (u32 lc_index)
   ASSERT(index != ~0);
 
   vec_del1(am->acl_users[acontext->context_user_id].lookup_contexts, index);
+  dtree_acl_remove(am, lc_index);
   unapply_acl_vec(lc_index, acontext->acl_indices);
   unlock_acl_vec(lc_index, acontext->acl_indices);
   vec_free(acontext->acl_indices);
@@ -256,6 +259,7 @@ static int acl_plugin_set_acl_vec_for_context (u32 lc_index, u32 *acl_list)
   unlock_acl_vec(lc_index, old_acl_vector);
   lock_acl_vec(lc_index, acontext->acl_indices);
   apply_acl_vec(lc_index, acontext->acl_indices);
+  dtree_acl_rebuild(am, lc_index);
 
   vec_free(old_acl_vector);
 
@@ -279,6 +283,37 @@ void acl_plugin_lookup_context_notify_acl_change(u32 acl_num)
     /* this is a deletion notification */
     hash_acl_delete(am, acl_num);
   }
+  dtree_acl_notify_acl_change(am, acl_num);
+}
+
+/*
+ * Select the decision tree or the hash for the lookups in a context.
+ */
+static int acl_plugin_set_dtree_for_context (u32 lc_index, int enable)
+{
+  acl_main_t *am = &acl_main;
+  acl_lookup_context_t *acontext;
+
+  if (!acl_lc_index_valid(am, lc_index)) {
+    clib_warning("BUG: lc_index %d is not valid", lc_index);
+    return -1;
+  }
+  acontext = pool_elt_at_index(am->acl_lookup_contexts, lc_index);
+  acontext->use_dtree = (enable != 0);
+  dtree_acl_rebuild(am, lc_index);
+  return 0;
+}
+
+void acl_plugin_lookup_context_set_dtree_all (int enable)
+{
+  acl_main_t *am = &acl_main;
+  acl_lookup_context_t *acontext;
+
+  am->use_dtree_acl_matching = (enable != 0);
+  pool_foreach (acontext, am->acl_lookup_contexts,
+  ({
+    acl_plugin_set_dtree_for_context (acontext - am->acl_lookup_contexts, enable);
+  }));
 }
 
 
@@ -36,10 +36,15 @@ typedef struct {
   u32 user_val1;
   /* per-instance user value 2 */
   u32 user_val2;
+  /* match with a compiled decision tree instead of the hash */
+  u8 use_dtree;
 } acl_lookup_context_t;
 
 void acl_plugin_lookup_context_notify_acl_change(u32 acl_num);
 
+/* Switch all the lookup contexts, and the new ones, to or from decision trees */
+void acl_plugin_lookup_context_set_dtree_all (int enable);
+
 void acl_plugin_show_lookup_context (u32 lc_index);
 void acl_plugin_show_lookup_user (u32 user_index);
 
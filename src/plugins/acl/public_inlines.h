@@ -555,6 +555,10 @@ multi_acl_match_get_applied_ace_index (acl_main_t * am, int is_ip6, fa_5tuple_t
     vec_elt_at_index (am->hash_applied_mask_info_vec_by_lc_index, lc_index);
 
   hash_applied_mask_info_t *minfo;
+  acl_fa_per_worker_data_t *pw;
+  /* counted locally, stored to the per worker counters once per lookup */
+  u32 n_probes = 0, n_bloom_skips = 0;
+  u64 hash;
 
   DBG ("TRYING TO MATCH: %016llx %016llx %016llx %016llx %016llx %016llx",
        pmatch[0], pmatch[1], pmatch[2], pmatch[3], pmatch[4], pmatch[5]);
@@ -599,8 +603,22 @@ multi_acl_match_get_applied_ace_index (acl_main_t * am, int is_ip6, fa_5tuple_t
       tmp_pkt.mask_type_index_lsb = mask_type_index;
       kv_key->pkt.as_u64 = tmp_pkt.as_u64;
 
+      /*
+       * Most mask types miss for any given packet: let the bloom filter
+       * reject those before we touch the bihash buckets.
+       */
+      hash = clib_bihash_hash_48_8 (&kv);
+      n_probes++;
+      if (minfo->bloom
+	  && !hash_acl_bloom_test (minfo->bloom, minfo->bloom_log2_bits, hash))
+	{
+	  n_bloom_skips++;
+	  continue;
+	}
+
       int res =
-	clib_bihash_search_inline_2_48_8 (&am->acl_lookup_hash, &kv, &result);
+	clib_bihash_search_inline_2_with_hash_48_8 (&am->acl_lookup_hash,
+						    hash, &kv, &result);
 
       if (res == 0)
 	{
@@ -623,6 +641,9 @@ multi_acl_match_get_applied_ace_index (acl_main_t * am, int is_ip6, fa_5tuple_t
 	    }
 	}
     }
+  pw = vec_elt_at_index (am->per_worker_data, os_get_thread_index ());
+  pw->cnt_hash_mask_probes += n_probes;
+  pw->cnt_hash_mask_bloom_skips += n_bloom_skips;
   DBG ("MATCH-RESULT: %d", curr_match_index);
   return curr_match_index;
 }
@@ -648,6 +669,94 @@ hash_multi_acl_match_5tuple (void *p_acl_main, u32 lc_index, fa_5tuple_t * pkt_5
 }
 
 
+always_inline void
+dtree_acl_fill_key (fa_5tuple_t * pkt_5tuple, int is_ip6, u64 * key)
+{
+  if (is_ip6)
+    {
+      key[DTREE_ACL_DIM_SRC_HI] = clib_net_to_host_u64 (pkt_5tuple->ip6_addr[0].as_u64[0]);
+      key[DTREE_ACL_DIM_SRC_LO] = clib_net_to_host_u64 (pkt_5tuple->ip6_addr[0].as_u64[1]);
+      key[DTREE_ACL_DIM_DST_HI] = clib_net_to_host_u64 (pkt_5tuple->ip6_addr[1].as_u64[0]);
+      key[DTREE_ACL_DIM_DST_LO] = clib_net_to_host_u64 (pkt_5tuple->ip6_addr[1].as_u64[1]);
+    }
+  else
+    {
+      key[DTREE_ACL_DIM_SRC_HI] = 0;
+      key[DTREE_ACL_DIM_SRC_LO] = clib_net_to_host_u32 (pkt_5tuple->ip4_addr[0].as_u32);
+      key[DTREE_ACL_DIM_DST_HI] = 0;
+      key[DTREE_ACL_DIM_DST_LO] = clib_net_to_host_u32 (pkt_5tuple->ip4_addr[1].as_u32);
+    }
+  key[DTREE_ACL_DIM_SRC_PORT] = pkt_5tuple->l4.port[0];
+  key[DTREE_ACL_DIM_DST_PORT] = pkt_5tuple->l4.port[1];
+  key[DTREE_ACL_DIM_PROTO] = pkt_5tuple->l4.proto;
+}
+
+/*
+ * Walk the decision tree down to a leaf, then check the few candidate
+ * rules there in priority order. The tree only narrows down the
+ * candidates, the leaf check is the same as for the hash lookup.
+ */
+always_inline dtree_acl_rule_t *
+dtree_acl_match_rule (dtree_acl_t * t, fa_5tuple_t * pkt_5tuple, int is_ip6)
+{
+  u64 key[DTREE_ACL_N_DIMS];
+  dtree_acl_node_t *node;
+  dtree_acl_leaf_t *leaf;
+  dtree_acl_rule_t *dr;
+  u32 ref, i;
+
+  dtree_acl_fill_key (pkt_5tuple, is_ip6, key);
+
+  ref = t->root[is_ip6 != 0];
+  while (!(ref & DTREE_ACL_LEAF))
+    {
+      node = t->nodes + ref;
+      ref = node->child[key[node->dim] > node->split];
+    }
+
+  leaf = t->leaves + (ref & ~DTREE_ACL_LEAF);
+  for (i = 0; i < leaf->n_rules; i++)
+    {
+      dr = t->rules + t->leaf_rules[leaf->first + i];
+      if (single_rule_match_5tuple (&dr->rule, is_ip6, pkt_5tuple))
+        return dr;
+    }
+  return 0;
+}
+
+/*
+ * As hash_multi_acl_match_5tuple: the hit is counted on the applied hash
+ * ACE entry of the rule, and 0x20000000 in the trace bitmap tells the
+ * match came from the decision tree.
+ */
+always_inline int
+dtree_multi_acl_match_5tuple (acl_main_t * am, u32 lc_index,
+                              dtree_acl_t * t, fa_5tuple_t * pkt_5tuple,
+                              int is_ip6, u8 * action, u32 * acl_pos_p,
+                              u32 * acl_match_p, u32 * rule_match_p,
+                              u32 * trace_bitmap)
+{
+  dtree_acl_rule_t *dr = dtree_acl_match_rule (t, pkt_5tuple, is_ip6);
+  applied_hash_ace_entry_t **applied_hash_aces;
+
+  if (!dr)
+    return 0;
+
+  if (lc_index < vec_len (am->hash_entry_vec_by_lc_index))
+    {
+      applied_hash_aces = vec_elt_at_index (am->hash_entry_vec_by_lc_index,
+                                            lc_index);
+      if (dr->applied_entry_index < vec_len ((*applied_hash_aces)))
+        (*applied_hash_aces)[dr->applied_entry_index].hitcount++;
+    }
+
+  *trace_bitmap |= 0x20000000;
+  *acl_pos_p = dr->acl_position;
+  *acl_match_p = dr->acl_index;
+  *rule_match_p = dr->ace_index;
+  *action = dr->rule.is_permit;
+  return 1;
+}
 
 always_inline int
 acl_plugin_match_5tuple_inline (void *p_acl_main, u32 lc_index,
@@ -660,7 +769,16 @@ acl_plugin_match_5tuple_inline (void *p_acl_main, u32 lc_index,
 {
   acl_main_t *am = p_acl_main;
   fa_5tuple_t * pkt_5tuple_internal = (fa_5tuple_t *)pkt_5tuple;
+  /* the trees are swapped without barrier, read them once */
+  dtree_acl_t **dtrees = am->dtree_by_lc_index;
+  dtree_acl_t *dtree = lc_index < vec_len(dtrees) ? dtrees[lc_index] : 0;
   pkt_5tuple_internal->pkt.lc_index = lc_index;
+  if (PREDICT_FALSE(dtree
+                    && !pkt_5tuple_internal->pkt.is_nonfirst_fragment)) {
+    return dtree_multi_acl_match_5tuple(am, lc_index, dtree, pkt_5tuple_internal,
+                               is_ip6, r_action, r_acl_pos_p, r_acl_match_p,
+                               r_rule_match_p, trace_bitmap);
+  }
   if (PREDICT_TRUE(am->use_hash_acl_matching)) {
     if (PREDICT_FALSE(pkt_5tuple_internal->pkt.is_nonfirst_fragment)) {
       /*
@@ -82,6 +82,53 @@ format_ip4_session_bihash_kv (u8 * s, va_list * args)
 }
 
 
+/*
+ * Each worker owns the session hash tables for the sessions it creates,
+ * sized for its share of the configured table, and a key filter of its
+ * own, a counter of the keys it holds per hash slot. On a miss in their
+ * own table, the other workers only probe the tables of the workers
+ * whose filter counts a key in that slot.
+ */
+static void
+acl_fa_verify_init_per_worker_session_tables (acl_main_t * am)
+{
+  u32 n_tables = vec_len (vlib_mains) > 1 ? vec_len (vlib_mains) - 1 : 1;
+  u32 n_buckets = clib_max (am->fa_conn_table_hash_num_buckets / n_tables,
+			    1024);
+  uword memory_size = clib_max (am->fa_conn_table_hash_memory_size /
+				n_tables, 32 << 20);
+  /*
+   * Two slots of the key filter per key a worker may hold, a forward
+   * and a reverse key per session, between 64K and 1M slots. Past 256K
+   * sessions per worker the filter gets denser, and more of the misses
+   * of the other workers probe the table of this one.
+   */
+  u64 n_keys = 2 * acl_fa_max_sessions_per_worker (am);
+  u32 filter_log2 = clib_min (clib_max (min_log2 (n_keys) + 1, 16), 20);
+  void *oldheap;
+  u16 wk;
+
+  for (wk = 0; wk < vec_len (am->per_worker_data); wk++)
+    {
+      acl_fa_per_worker_data_t *pw = &am->per_worker_data[wk];
+      clib_bihash_init_40_8 (&pw->fa_ip6_sessions_hash,
+			     "ACL plugin FA IPv6 per-worker session bihash",
+			     n_buckets, memory_size);
+      clib_bihash_set_kvp_format_fn_40_8 (&pw->fa_ip6_sessions_hash,
+					  format_ip6_session_bihash_kv);
+      clib_bihash_init_16_8 (&pw->fa_ip4_sessions_hash,
+			     "ACL plugin FA IPv4 per-worker session bihash",
+			     n_buckets, memory_size);
+      clib_bihash_set_kvp_format_fn_16_8 (&pw->fa_ip4_sessions_hash,
+					  format_ip4_session_bihash_kv);
+      oldheap = clib_mem_set_heap (am->acl_mheap);
+      vec_validate_aligned (pw->fa_session_key_counts,
+			    (1 << filter_log2) - 1, CLIB_CACHE_LINE_BYTES);
+      clib_mem_set_heap (oldheap);
+    }
+  am->fa_session_key_filter_mask = (1 << filter_log2) - 1;
+}
+
 static void
 acl_fa_verify_init_sessions (acl_main_t * am)
 {
@@ -100,6 +147,23 @@ acl_fa_verify_init_sessions (acl_main_t * am)
 	   */
 	  pool_init_fixed (pw->fa_sessions_pool,
 			   am->fa_conn_table_max_entries);
+	  if (am->fa_use_timer_wheel)
+	    {
+	      void *oldheap = clib_mem_set_heap (am->acl_mheap);
+	      tw_timer_wheel_init_4t_3w_256sl (&pw->session_timer_wheel, 0,
+					       am->fa_timer_wheel_interval,
+					       am->fa_max_deleted_sessions_per_interval);
+	      pw->session_timer_wheel.last_run_time =
+		acl_fa_timer_wheel_time (am, clib_cpu_time_now ());
+	      clib_mem_set_heap (oldheap);
+	    }
+	}
+
+      if (am->fa_per_worker_session_tables)
+	{
+	  acl_fa_verify_init_per_worker_session_tables (am);
+	  am->fa_sessions_hash_is_initialized = 1;
+	  return;
 	}
 
       /* ... and the interface session hash table */
@@ -151,12 +215,52 @@ acl_fa_conn_time_to_check (acl_main_t * am, acl_fa_per_worker_data_t * pw,
   if (session_index == FA_SESSION_BOGUS_INDEX)
     return 0;
   fa_session_t *sess = get_session_ptr (am, thread_index, session_index);
+  /* with the timer wheel, the lists are only walked to swipe */
+  if (am->fa_use_timer_wheel)
+    return (sess->link_enqueue_time <= pw->swipe_end_time);
   u64 timeout_time =
     sess->link_enqueue_time + fa_session_get_list_timeout (am, sess);
   return (timeout_time < now)
     || (sess->link_enqueue_time <= pw->swipe_end_time);
 }
 
+/*
+ * Advance the timer wheel of the worker and add the sessions whose
+ * timers fired to the expired vector, unlinked from their lists.
+ * The wheel stops after fa_max_deleted_sessions_per_interval timers,
+ * the rest are picked up by the next run.
+ */
+static void
+acl_fa_expire_session_timers (acl_main_t * am, u16 thread_index, u64 now)
+{
+  acl_fa_per_worker_data_t *pw = &am->per_worker_data[thread_index];
+  fa_full_session_id_t fsid;
+  u32 i, n_before = vec_len (pw->expired);
+  void *oldheap;
+
+  fsid.thread_index = thread_index;
+  oldheap = clib_mem_set_heap (am->acl_mheap);
+  pw->expired =
+    tw_timer_expire_timers_vec_4t_3w_256sl (&pw->session_timer_wheel,
+					    acl_fa_timer_wheel_time (am, now),
+					    pw->expired);
+  clib_mem_set_heap (oldheap);
+  pw->n_session_timers_running -= vec_len (pw->expired) - n_before;
+
+  for (i = n_before; i < vec_len (pw->expired); i++)
+    {
+      fsid.session_index = pw->expired[i];
+      if (pool_is_free_index (pw->fa_sessions_pool, fsid.session_index))
+	continue;
+      fa_session_t *sess =
+	get_session_ptr (am, thread_index, fsid.session_index);
+      /* the wheel has already freed the timer */
+      sess->timer_handle = ~0;
+      acl_fa_conn_list_delete_session (am, fsid, now);
+      pw->cnt_session_timer_expired++;
+    }
+}
+
 /*
  * see if there are sessions ready to be checked,
  * do the maintenance (requeue or delete), and
@@ -233,6 +337,9 @@ acl_fa_check_idle_sessions (acl_main_t * am, u16 thread_index, u64 now)
       }
   }
 
+  if (am->fa_use_timer_wheel)
+    acl_fa_expire_session_timers (am, thread_index, now);
+
   u32 *psid = NULL;
   vec_foreach (psid, pw->expired)
   {
@@ -550,8 +657,12 @@ acl_fa_worker_conn_cleaner_process (vlib_main_t * vm,
 			       "i8i4i4", now, ((u32) pw->interrupt_is_needed),
 			       ((u32) pw->interrupt_is_unwanted));
     }
-  /* be persistent about quickly deleting the connections from the purgatory */
-  if (purgatory_has_connections (vm, am, thread_index))
+  /*
+   * be persistent about quickly deleting the connections from the purgatory,
+   * unless they are on the timer wheel which fires them on its next tick
+   */
+  if (!am->fa_use_timer_wheel
+      && purgatory_has_connections (vm, am, thread_index))
     {
       send_one_worker_interrupt (vm, am, thread_index);
     }
@@ -613,7 +724,10 @@ acl_fa_session_cleaner_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
 	  acl_fa_per_worker_data_t *pw = &am->per_worker_data[ti];
 	  for (tt = 0; tt < vec_len (pw->fa_conn_list_head); tt++)
 	    {
-	      u64 head_expiry =
+	      /* the timer wheels need to be advanced every tick */
+	      u64 head_expiry = am->fa_use_timer_wheel ?
+		(FA_SESSION_BOGUS_INDEX != pw->fa_conn_list_head[tt] ?
+		 now + am->fa_timer_wheel_interval * cpu_cps : ~0ULL) :
 		acl_fa_get_list_head_expiry_time (am, pw, now, ti, tt);
 	      if ((head_expiry < next_expire) && !pw->interrupt_is_pending)
 		{
@@ -920,7 +1034,24 @@ void
 show_fa_sessions_hash (vlib_main_t * vm, u32 verbose)
 {
   acl_main_t *am = &acl_main;
-  if (am->fa_sessions_hash_is_initialized)
+  if (am->fa_sessions_hash_is_initialized
+      && am->fa_per_worker_session_tables)
+    {
+      u16 wk;
+      for (wk = 0; wk < vec_len (am->per_worker_data); wk++)
+	{
+	  acl_fa_per_worker_data_t *pw = &am->per_worker_data[wk];
+	  vlib_cli_output (vm,
+			   "\nThread #%d IPv6 Session lookup hash table:\n%U\n\n",
+			   wk, format_bihash_40_8, &pw->fa_ip6_sessions_hash,
+			   verbose);
+	  vlib_cli_output (vm,
+			   "\nThread #%d IPv4 Session lookup hash table:\n%U\n\n",
+			   wk, format_bihash_16_8, &pw->fa_ip4_sessions_hash,
+			   verbose);
+	}
+    }
+  else if (am->fa_sessions_hash_is_initialized)
     {
       vlib_cli_output (vm, "\nIPv6 Session lookup hash table:\n%U\n\n",
 		       format_bihash_40_8, &am->fa_ip6_sessions_hash,
@@ -143,6 +143,60 @@ is_valid_session_ptr (acl_main_t * am, u16 thread_index, fa_session_t * sess)
 	      pool_len (pw->fa_sessions_pool)));
 }
 
+/*
+ * With the timer wheel, a packet hit only bumps last_active_time.
+ * When the timer fires, the session is either expired or re-armed
+ * for the rest of its idle time, so the wheel sees one start and one
+ * expiry per timeout period rather than one update per packet.
+ */
+
+always_inline f64
+acl_fa_timer_wheel_time (acl_main_t * am, u64 now)
+{
+  return (f64) now / am->vlib_main->clib_time.clocks_per_second;
+}
+
+always_inline void
+acl_fa_session_timer_start (acl_main_t * am, acl_fa_per_worker_data_t * pw,
+			    fa_session_t * sess, u32 session_index, u64 now)
+{
+  u64 tick = am->fa_timer_wheel_interval *
+    am->vlib_main->clib_time.clocks_per_second;
+  u64 expiry, ticks;
+  void *oldheap;
+
+  /* the purgatory time counts from the deletion, not the last packet */
+  expiry = (sess->link_list_id == ACL_TIMEOUT_PURGATORY) ? now :
+    sess->last_active_time;
+  expiry += fa_session_get_timeout (am, sess);
+  ticks = expiry > now ? (expiry - now + tick - 1) / tick : 1;
+  ticks = clib_max (ticks, 1);
+  ticks = clib_min (ticks, ACL_FA_TIMER_WHEEL_MAX_TICKS);
+
+  oldheap = clib_mem_set_heap (am->acl_mheap);
+  /* timer id 0, so the expired handle is the session index */
+  sess->timer_handle =
+    tw_timer_start_4t_3w_256sl (&pw->session_timer_wheel, session_index, 0,
+				ticks);
+  clib_mem_set_heap (oldheap);
+  pw->n_session_timers_running++;
+}
+
+always_inline void
+acl_fa_session_timer_stop (acl_main_t * am, acl_fa_per_worker_data_t * pw,
+			   fa_session_t * sess)
+{
+  void *oldheap;
+
+  if (~0 == sess->timer_handle)
+    return;
+  oldheap = clib_mem_set_heap (am->acl_mheap);
+  tw_timer_stop_4t_3w_256sl (&pw->session_timer_wheel, sess->timer_handle);
+  clib_mem_set_heap (oldheap);
+  sess->timer_handle = ~0;
+  pw->n_session_timers_running--;
+}
+
 always_inline void
 acl_fa_conn_list_add_session (acl_main_t * am, fa_full_session_id_t sess_id,
 			      u64 now)
@@ -187,6 +241,9 @@ acl_fa_conn_list_add_session (acl_main_t * am, fa_full_session_id_t sess_id,
       pw->fa_conn_list_head_expiry_time[list_id] =
 	now + fa_session_get_timeout (am, sess);
     }
+
+  if (am->fa_use_timer_wheel)
+    acl_fa_session_timer_start (am, pw, sess, sess_id.session_index, now);
 }
 
 static int
@@ -213,6 +270,7 @@ acl_fa_conn_list_delete_session (acl_main_t * am,
 	("Attempting to delete session belonging to thread %d by thread %d",
 	 sess->thread_index, thread_index);
     }
+  acl_fa_session_timer_stop (am, pw, sess);
   if (FA_SESSION_BOGUS_INDEX != sess->link_prev_idx)
     {
       fa_session_t *prev_sess =
@@ -355,8 +413,71 @@ reverse_l4_u64_slowpath_valid (u64 l4, int is_ip6, u64 * out)
   return 1;
 }
 
+/*
+ * The session table the sessions of a thread live in: its own one
+ * with the per-worker session tables, the global one otherwise.
+ */
+always_inline clib_bihash_40_8_t *
+acl_fa_ip6_sessions_hash (acl_main_t * am, u16 thread_index)
+{
+  if (am->fa_per_worker_session_tables)
+    return &am->per_worker_data[thread_index].fa_ip6_sessions_hash;
+  return &am->fa_ip6_sessions_hash;
+}
+
+always_inline clib_bihash_16_8_t *
+acl_fa_ip4_sessions_hash (acl_main_t * am, u16 thread_index)
+{
+  if (am->fa_per_worker_session_tables)
+    return &am->per_worker_data[thread_index].fa_ip4_sessions_hash;
+  return &am->fa_ip4_sessions_hash;
+}
+
+/*
+ * Account a session key added to or deleted from the table of the
+ * thread, so the other workers know whether a miss in their own
+ * table is worth looking up in this one. The filter belongs to the
+ * thread, so a plain increment will do.
+ */
 always_inline void
-reverse_session_add_del_ip6 (acl_main_t * am,
+acl_fa_session_key_filter_update (acl_main_t * am, u16 thread_index,
+				  u64 hash, int is_add)
+{
+  acl_fa_per_worker_data_t *pw = &am->per_worker_data[thread_index];
+  u32 slot = hash & am->fa_session_key_filter_mask;
+
+  if (!am->fa_per_worker_session_tables)
+    return;
+  if (is_add)
+    pw->fa_session_key_counts[slot]++;
+  else
+    pw->fa_session_key_counts[slot]--;
+}
+
+always_inline void
+acl_fa_session_add_del_ip6 (acl_main_t * am, u16 thread_index,
+			    clib_bihash_kv_40_8_t * kv, int is_add)
+{
+  clib_bihash_add_del_40_8 (acl_fa_ip6_sessions_hash (am, thread_index),
+			    kv, is_add);
+  if (am->fa_per_worker_session_tables)
+    acl_fa_session_key_filter_update (am, thread_index,
+				      clib_bihash_hash_40_8 (kv), is_add);
+}
+
+always_inline void
+acl_fa_session_add_del_ip4 (acl_main_t * am, u16 thread_index,
+			    clib_bihash_kv_16_8_t * kv, int is_add)
+{
+  clib_bihash_add_del_16_8 (acl_fa_ip4_sessions_hash (am, thread_index),
+			    kv, is_add);
+  if (am->fa_per_worker_session_tables)
+    acl_fa_session_key_filter_update (am, thread_index,
+				      clib_bihash_hash_16_8 (kv), is_add);
+}
+
+always_inline void
+reverse_session_add_del_ip6 (acl_main_t * am, u16 thread_index,
 			     clib_bihash_kv_40_8_t * pkv, int is_add)
 {
   clib_bihash_kv_40_8_t kv2;
@@ -369,17 +490,17 @@ reverse_session_add_del_ip6 (acl_main_t * am,
   if (PREDICT_FALSE (is_session_l4_key_u64_slowpath (pkv->key[4])))
     {
       if (reverse_l4_u64_slowpath_valid (pkv->key[4], 1, &kv2.key[4]))
-	clib_bihash_add_del_40_8 (&am->fa_ip6_sessions_hash, &kv2, is_add);
+	acl_fa_session_add_del_ip6 (am, thread_index, &kv2, is_add);
     }
   else
     {
       kv2.key[4] = reverse_l4_u64_fastpath (pkv->key[4], 1);
-      clib_bihash_add_del_40_8 (&am->fa_ip6_sessions_hash, &kv2, is_add);
+      acl_fa_session_add_del_ip6 (am, thread_index, &kv2, is_add);
     }
 }
 
 always_inline void
-reverse_session_add_del_ip4 (acl_main_t * am,
+reverse_session_add_del_ip4 (acl_main_t * am, u16 thread_index,
 			     clib_bihash_kv_16_8_t * pkv, int is_add)
 {
   clib_bihash_kv_16_8_t kv2;
@@ -390,12 +511,12 @@ reverse_session_add_del_ip4 (acl_main_t * am,
   if (PREDICT_FALSE (is_session_l4_key_u64_slowpath (pkv->key[1])))
     {
       if (reverse_l4_u64_slowpath_valid (pkv->key[1], 0, &kv2.key[1]))
-	clib_bihash_add_del_16_8 (&am->fa_ip4_sessions_hash, &kv2, is_add);
+	acl_fa_session_add_del_ip4 (am, thread_index, &kv2, is_add);
     }
   else
     {
       kv2.key[1] = reverse_l4_u64_fastpath (pkv->key[1], 0);
-      clib_bihash_add_del_16_8 (&am->fa_ip4_sessions_hash, &kv2, is_add);
+      acl_fa_session_add_del_ip4 (am, thread_index, &kv2, is_add);
     }
 }
 
@@ -409,19 +530,28 @@ acl_fa_deactivate_session (acl_main_t * am, u32 sw_if_index,
   void *oldheap = clib_mem_set_heap (am->acl_mheap);
   if (sess->is_ip6)
     {
-      clib_bihash_add_del_40_8 (&am->fa_ip6_sessions_hash,
-				&sess->info.kv_40_8, 0);
-      reverse_session_add_del_ip6 (am, &sess->info.kv_40_8, 0);
+      acl_fa_session_add_del_ip6 (am, sess_id.thread_index,
+				  &sess->info.kv_40_8, 0);
+      reverse_session_add_del_ip6 (am, sess_id.thread_index,
+				   &sess->info.kv_40_8, 0);
     }
   else
     {
-      clib_bihash_add_del_16_8 (&am->fa_ip4_sessions_hash,
-				&sess->info.kv_16_8, 0);
-      reverse_session_add_del_ip4 (am, &sess->info.kv_16_8, 0);
+      acl_fa_session_add_del_ip4 (am, sess_id.thread_index,
+				  &sess->info.kv_16_8, 0);
+      reverse_session_add_del_ip4 (am, sess_id.thread_index,
+				   &sess->info.kv_16_8, 0);
     }
 
   sess->deleted = 1;
-  clib_atomic_fetch_add (&am->fa_session_total_deactivations, 1);
+  if (am->fa_per_worker_session_tables)
+    {
+      acl_fa_per_worker_data_t *pw =
+	&am->per_worker_data[sess_id.thread_index];
+      pw->fa_session_total_deactivations++;
+    }
+  else
+    clib_atomic_fetch_add (&am->fa_session_total_deactivations, 1);
   clib_mem_set_heap (oldheap);
 }
 
@@ -443,7 +573,10 @@ acl_fa_put_session (acl_main_t * am, u32 sw_if_index,
   vec_validate (pw->fa_session_dels_by_sw_if_index, sw_if_index);
   clib_mem_set_heap (oldheap);
   pw->fa_session_dels_by_sw_if_index[sw_if_index]++;
-  clib_atomic_fetch_add (&am->fa_session_total_dels, 1);
+  if (am->fa_per_worker_session_tables)
+    pw->fa_session_total_dels++;
+  else
+    clib_atomic_fetch_add (&am->fa_session_total_dels, 1);
 }
 
 always_inline int
@@ -465,10 +598,31 @@ acl_fa_two_stage_delete_session (acl_main_t * am, u32 sw_if_index,
     }
 }
 
+/*
+ * The most sessions one worker may hold with the per-worker session
+ * tables, bounded by the size of its session pool.
+ */
+always_inline u64
+acl_fa_max_sessions_per_worker (acl_main_t * am)
+{
+  u64 max_entries = am->fa_conn_table_max_entries;
+  if (am->fa_conn_table_max_entries_per_worker)
+    max_entries = clib_min (max_entries,
+			    am->fa_conn_table_max_entries_per_worker);
+  return max_entries;
+}
+
 always_inline int
 acl_fa_can_add_session (acl_main_t * am, int is_input, u32 sw_if_index)
 {
   u64 curr_sess_count;
+  if (am->fa_per_worker_session_tables)
+    {
+      acl_fa_per_worker_data_t *pw =
+	&am->per_worker_data[os_get_thread_index ()];
+      return (pool_elts (pw->fa_sessions_pool) <
+	      acl_fa_max_sessions_per_worker (am));
+    }
   curr_sess_count = am->fa_session_total_adds - am->fa_session_total_dels;
   return (curr_sess_count + vec_len (vlib_mains) <
 	  am->fa_conn_table_max_entries);
@@ -560,6 +714,7 @@ acl_fa_add_session (acl_main_t * am, int is_input, int is_ip6,
   sess->link_list_id = ACL_TIMEOUT_UNUSED;
   sess->link_prev_idx = FA_SESSION_BOGUS_INDEX;
   sess->link_next_idx = FA_SESSION_BOGUS_INDEX;
+  sess->timer_handle = ~0;
   sess->deleted = 0;
   sess->is_ip6 = is_ip6;
 
@@ -568,44 +723,23 @@ acl_fa_add_session (acl_main_t * am, int is_input, int is_ip6,
   ASSERT (am->fa_sessions_hash_is_initialized == 1);
   if (is_ip6)
     {
-      reverse_session_add_del_ip6 (am, &sess->info.kv_40_8, 1);
-      clib_bihash_add_del_40_8 (&am->fa_ip6_sessions_hash,
-				&sess->info.kv_40_8, 1);
+      reverse_session_add_del_ip6 (am, thread_index, &sess->info.kv_40_8, 1);
+      acl_fa_session_add_del_ip6 (am, thread_index, &sess->info.kv_40_8, 1);
     }
   else
     {
-      reverse_session_add_del_ip4 (am, &sess->info.kv_16_8, 1);
-      clib_bihash_add_del_16_8 (&am->fa_ip4_sessions_hash,
-				&sess->info.kv_16_8, 1);
+      reverse_session_add_del_ip4 (am, thread_index, &sess->info.kv_16_8, 1);
+      acl_fa_session_add_del_ip4 (am, thread_index, &sess->info.kv_16_8, 1);
     }
 
   vec_validate (pw->fa_session_adds_by_sw_if_index, sw_if_index);
   clib_mem_set_heap (oldheap);
   pw->fa_session_adds_by_sw_if_index[sw_if_index]++;
-  clib_atomic_fetch_add (&am->fa_session_total_adds, 1);
-  return f_sess_id;
-}
-
-always_inline int
-acl_fa_find_session (acl_main_t * am, int is_ip6, u32 sw_if_index0,
-		     fa_5tuple_t * p5tuple, u64 * pvalue_sess)
-{
-  int res = 0;
-  if (is_ip6)
-    {
-      clib_bihash_kv_40_8_t kv_result;
-      res = (clib_bihash_search_inline_2_40_8
-	     (&am->fa_ip6_sessions_hash, &p5tuple->kv_40_8, &kv_result) == 0);
-      *pvalue_sess = kv_result.value;
-    }
+  if (am->fa_per_worker_session_tables)
+    pw->fa_session_total_adds++;
   else
-    {
-      clib_bihash_kv_16_8_t kv_result;
-      res = (clib_bihash_search_inline_2_16_8
-	     (&am->fa_ip4_sessions_hash, &p5tuple->kv_16_8, &kv_result) == 0);
-      *pvalue_sess = kv_result.value;
-    }
-  return res;
+    clib_atomic_fetch_add (&am->fa_session_total_adds, 1);
+  return f_sess_id;
 }
 
 always_inline u64
@@ -622,25 +756,31 @@ always_inline void
 acl_fa_prefetch_session_bucket_for_hash (acl_main_t * am, int is_ip6,
 					 u64 hash)
 {
+  u16 thread_index = os_get_thread_index ();
   if (is_ip6)
-    clib_bihash_prefetch_bucket_40_8 (&am->fa_ip6_sessions_hash, hash);
+    clib_bihash_prefetch_bucket_40_8 (acl_fa_ip6_sessions_hash
+				      (am, thread_index), hash);
   else
-    clib_bihash_prefetch_bucket_16_8 (&am->fa_ip4_sessions_hash, hash);
+    clib_bihash_prefetch_bucket_16_8 (acl_fa_ip4_sessions_hash
+				      (am, thread_index), hash);
 }
 
 always_inline void
 acl_fa_prefetch_session_data_for_hash (acl_main_t * am, int is_ip6, u64 hash)
 {
+  u16 thread_index = os_get_thread_index ();
   if (is_ip6)
-    clib_bihash_prefetch_data_40_8 (&am->fa_ip6_sessions_hash, hash);
+    clib_bihash_prefetch_data_40_8 (acl_fa_ip6_sessions_hash
+				    (am, thread_index), hash);
   else
-    clib_bihash_prefetch_data_16_8 (&am->fa_ip4_sessions_hash, hash);
+    clib_bihash_prefetch_data_16_8 (acl_fa_ip4_sessions_hash
+				    (am, thread_index), hash);
 }
 
 always_inline int
-acl_fa_find_session_with_hash (acl_main_t * am, int is_ip6, u32 sw_if_index0,
-			       u64 hash, fa_5tuple_t * p5tuple,
-			       u64 * pvalue_sess)
+acl_fa_find_session_in_table (acl_main_t * am, int is_ip6, u16 thread_index,
+			      u64 hash, fa_5tuple_t * p5tuple,
+			      u64 * pvalue_sess)
 {
   int res = 0;
   if (is_ip6)
@@ -648,8 +788,8 @@ acl_fa_find_session_with_hash (acl_main_t * am, int is_ip6, u32 sw_if_index0,
       clib_bihash_kv_40_8_t kv_result;
       kv_result.value = ~0ULL;
       res = (clib_bihash_search_inline_2_with_hash_40_8
-	     (&am->fa_ip6_sessions_hash, hash, &p5tuple->kv_40_8,
-	      &kv_result) == 0);
+	     (acl_fa_ip6_sessions_hash (am, thread_index), hash,
+	      &p5tuple->kv_40_8, &kv_result) == 0);
       *pvalue_sess = kv_result.value;
     }
   else
@@ -657,13 +797,71 @@ acl_fa_find_session_with_hash (acl_main_t * am, int is_ip6, u32 sw_if_index0,
       clib_bihash_kv_16_8_t kv_result;
       kv_result.value = ~0ULL;
       res = (clib_bihash_search_inline_2_with_hash_16_8
-	     (&am->fa_ip4_sessions_hash, hash, &p5tuple->kv_16_8,
-	      &kv_result) == 0);
+	     (acl_fa_ip4_sessions_hash (am, thread_index), hash,
+	      &p5tuple->kv_16_8, &kv_result) == 0);
       *pvalue_sess = kv_result.value;
     }
   return res;
 }
 
+/*
+ * A miss in the table of this worker, with the per-worker session tables.
+ * The flow may still belong to a session created by another worker
+ * (e.g. the return traffic lands on a different RX queue). The key filter
+ * of each other worker tells whether it holds a key with this hash, only
+ * then is its table probed. The filters and the bihash readers are
+ * lock-free, so this never stalls the owner.
+ */
+static_always_inline int
+acl_fa_find_session_other_workers (acl_main_t * am, int is_ip6,
+				   u16 thread_index, u64 hash,
+				   fa_5tuple_t * p5tuple, u64 * pvalue_sess)
+{
+  acl_fa_per_worker_data_t *pw = &am->per_worker_data[thread_index];
+  u32 slot = hash & am->fa_session_key_filter_mask;
+  u16 ti;
+
+  for (ti = 0; ti < vec_len (am->per_worker_data); ti++)
+    {
+      if (ti == thread_index
+	  || PREDICT_TRUE (am->per_worker_data[ti].fa_session_key_counts[slot]
+			   == 0))
+	continue;
+      pw->cnt_remote_session_probes++;
+      if (acl_fa_find_session_in_table (am, is_ip6, ti, hash, p5tuple,
+					pvalue_sess))
+	{
+	  pw->cnt_remote_session_hits++;
+	  return 1;
+	}
+    }
+  *pvalue_sess = ~0ULL;
+  return 0;
+}
+
+always_inline int
+acl_fa_find_session_with_hash (acl_main_t * am, int is_ip6, u32 sw_if_index0,
+			       u64 hash, fa_5tuple_t * p5tuple,
+			       u64 * pvalue_sess)
+{
+  u16 thread_index = os_get_thread_index ();
+  if (acl_fa_find_session_in_table (am, is_ip6, thread_index, hash, p5tuple,
+				    pvalue_sess))
+    return 1;
+  if (!am->fa_per_worker_session_tables)
+    return 0;
+  return acl_fa_find_session_other_workers (am, is_ip6, thread_index, hash,
+					    p5tuple, pvalue_sess);
+}
+
+always_inline int
+acl_fa_find_session (acl_main_t * am, int is_ip6, u32 sw_if_index0,
+		     fa_5tuple_t * p5tuple, u64 * pvalue_sess)
+{
+  u64 hash = acl_fa_make_session_hash (am, is_ip6, sw_if_index0, p5tuple);
+  return acl_fa_find_session_with_hash (am, is_ip6, sw_if_index0, hash,
+					p5tuple, pvalue_sess);
+}
 
 /*
  * fd.io coding-style-patch-verification: ON
@@ -395,8 +395,11 @@ dpdk_ops_vpp_dequeue_no_cache (struct rte_mempool *mp, void **obj_table,
 static unsigned
 dpdk_ops_vpp_get_count (const struct rte_mempool *mp)
 {
-  clib_warning ("");
-  return 0;
+  vlib_main_t *vm = vlib_get_main ();
+  vlib_buffer_pool_t *bp = vlib_get_buffer_pool (vm, mp->pool_id);
+
+  /* buffers parked in the depot are free too */
+  return vlib_buffer_pool_n_available (bp);
 }
 
 static unsigned
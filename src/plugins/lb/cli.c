@@ -32,6 +32,7 @@ lb_vip_command_fn (vlib_main_t * vm,
   clib_error_t *error = 0;
 
   args.new_length = 1024;
+  args.maglev = 0;
 
   if (!unformat_user (input, unformat_line_input, line_input))
     return 0;
@@ -47,6 +48,8 @@ lb_vip_command_fn (vlib_main_t * vm,
   {
     if (unformat(line_input, "new_len %d", &(args.new_length)))
       ;
+    else if (unformat(line_input, "maglev"))
+      args.maglev = 1;
     else if (unformat(line_input, "del"))
       del = 1;
     else if (unformat(line_input, "protocol tcp"))
@@ -185,7 +188,7 @@ VLIB_CLI_COMMAND (lb_vip_command, static) =
       "[encap (gre6|gre4|l3dsr|nat4|nat6)] "
       "[dscp <n>] "
       "[type (nodeport|clusterip) target_port <n>] "
-      "[new_len <n>] [del]",
+      "[new_len <n>] [maglev] [del]",
   .function = lb_vip_command_fn,
 };
 
@@ -197,11 +200,13 @@ lb_as_command_fn (vlib_main_t * vm,
   ip46_address_t vip_prefix, as_addr;
   u8 vip_plen;
   ip46_address_t *as_array = 0;
+  ip46_address_t *existing_array = 0, *new_array = 0;
   u32 vip_index;
   u32 port = 0;
   u8 protocol = 0;
   u8 del = 0;
   u8 flush = 0;
+  u32 weight = ~0;
   int ret;
   clib_error_t *error = 0;
 
@@ -241,6 +246,8 @@ lb_as_command_fn (vlib_main_t * vm,
       }
     else if (unformat(line_input, "port %d", &port))
       ;
+    else if (unformat(line_input, "weight %d", &weight))
+      ;
     else {
       error = clib_error_return (0, "parse error: '%U'",
                                  format_unformat_error, line_input);
@@ -248,6 +255,11 @@ lb_as_command_fn (vlib_main_t * vm,
     }
   }
 
+  if (weight != ~0 && weight > 255) {
+    error = clib_error_return (0, "weight should be less than 256");
+    goto done;
+  }
+
   /* If port == 0, it means all-port VIP */
   if (port == 0)
     {
@@ -274,17 +286,42 @@ lb_as_command_fn (vlib_main_t * vm,
       error = clib_error_return (0, "lb_vip_del_ass error %d", ret);
       goto done;
     }
-  } else {
+  } else if (weight == ~0) {
     if ((ret = lb_vip_add_ass(vip_index, as_array, vec_len(as_array))))
     {
       error = clib_error_return (0, "lb_vip_add_ass error %d", ret);
       goto done;
     }
+  } else {
+    //Change the weight of existing ASs, add the others
+    ip46_address_t *as;
+    vec_foreach(as, as_array) {
+      if (lb_vip_as_is_used(vip_index, as))
+        vec_add1(existing_array, *as);
+      else
+        vec_add1(new_array, *as);
+    }
+    if (vec_len(existing_array) &&
+        (ret = lb_vip_set_ass_weight(vip_index, existing_array,
+                                     vec_len(existing_array), (u8) weight)))
+    {
+      error = clib_error_return (0, "lb_vip_set_ass_weight error %d", ret);
+      goto done;
+    }
+    if (vec_len(new_array) &&
+        (ret = lb_vip_add_ass_weighted(vip_index, new_array,
+                                       vec_len(new_array), (u8) weight)))
+    {
+      error = clib_error_return (0, "lb_vip_add_ass error %d", ret);
+      goto done;
+    }
   }
 
 done:
   unformat_free (line_input);
   vec_free(as_array);
+  vec_free(existing_array);
+  vec_free(new_array);
 
   return error;
 }
@@ -293,7 +330,7 @@ VLIB_CLI_COMMAND (lb_as_command, static) =
 {
   .path = "lb as",
   .short_help = "lb as <vip-prefix> [protocol (tcp|udp) port <n>]"
-      " [<address> [<address> [...]]] [del] [flush]",
+      " [<address> [<address> [...]]] [weight <n>] [del] [flush]",
   .function = lb_as_command_fn,
 };
 
@@ -308,6 +345,8 @@ lb_conf_command_fn (vlib_main_t * vm,
   u32 per_cpu_sticky_buckets = lbm->per_cpu_sticky_buckets;
   u32 per_cpu_sticky_buckets_log2 = 0;
   u32 flow_timeout = lbm->flow_timeout;
+  u32 max_buckets = lbm->per_cpu_sticky_max_buckets;
+  u32 max_buckets_log2 = 0;
   int ret;
   clib_error_t *error = 0;
 
@@ -328,7 +367,13 @@ lb_conf_command_fn (vlib_main_t * vm,
       per_cpu_sticky_buckets = 1 << per_cpu_sticky_buckets_log2;
     } else if (unformat(line_input, "timeout %d", &flow_timeout))
       ;
-    else {
+    else if (unformat(line_input, "max-buckets %d", &max_buckets))
+      ;
+    else if (unformat(line_input, "max-buckets-log2 %d", &max_buckets_log2)) {
+      if (max_buckets_log2 >= 32)
+        return clib_error_return (0, "max-buckets-log2 value is too high");
+      max_buckets = 1 << max_buckets_log2;
+    } else {
       error = clib_error_return (0, "parse error: '%U'",
                                  format_unformat_error, line_input);
       goto done;
@@ -342,6 +387,11 @@ lb_conf_command_fn (vlib_main_t * vm,
     goto done;
   }
 
+  if ((ret = lb_set_sticky_auto_grow(max_buckets))) {
+    error = clib_error_return (0, "lb_set_sticky_auto_grow error %d", ret);
+    goto done;
+  }
+
 done:
   unformat_free (line_input);
 
@@ -351,7 +401,7 @@ done:
 VLIB_CLI_COMMAND (lb_conf_command, static) =
 {
   .path = "lb conf",
-  .short_help = "lb conf [ip4-src-address <addr>] [ip6-src-address <addr>] [buckets <n>] [timeout <s>]",
+  .short_help = "lb conf [ip4-src-address <addr>] [ip6-src-address <addr>] [buckets <n>] [timeout <s>] [max-buckets <n>]",
   .function = lb_conf_command_fn,
 };
 
@@ -103,6 +103,8 @@ u8 *format_lb_main (u8 * s, va_list * args)
   s = format(s, " ip6-src-address: %U \n", format_ip6_address, &lbm->ip6_src_address);
   s = format(s, " #vips: %u\n", pool_elts(lbm->vips));
   s = format(s, " #ass: %u\n", pool_elts(lbm->ass) - 1);
+  if (lbm->per_cpu_sticky_max_buckets)
+    s = format(s, " sticky table max buckets: %u\n", lbm->per_cpu_sticky_max_buckets);
 
   u32 thread_index;
   for(thread_index = 0; thread_index < tm->n_vlib_mains; thread_index++ ) {
@@ -111,6 +113,10 @@ u8 *format_lb_main (u8 * s, va_list * args)
       s = format(s, "core %d\n", thread_index);
       s = format(s, "  timeout: %ds\n", h->timeout);
       s = format(s, "  usage: %d / %d\n", lb_hash_elts(h, lb_hash_time_now(vlib_get_main())),  lb_hash_size(h));
+      s = format(s, "  evictions: %lu grows: %u%s\n",
+                 lbm->per_cpu[thread_index].sticky_evictions,
+                 lbm->per_cpu[thread_index].sticky_grows,
+                 lbm->per_cpu[thread_index].sticky_ht_old ? " (migrating)" : "");
     }
   }
 
@@ -152,10 +158,11 @@ uword unformat_lb_vip_type (unformat_input_t * input, va_list * args)
 u8 *format_lb_vip (u8 * s, va_list * args)
 {
   lb_vip_t *vip = va_arg (*args, lb_vip_t *);
-  s = format(s, "%U %U new_size:%u #as:%u%s",
+  s = format(s, "%U %U new_size:%u%s #as:%u%s",
              format_lb_vip_type, vip->type,
              format_ip46_prefix, &vip->prefix, vip->plen, IP46_TYPE_ANY,
              vip->new_flow_table_mask + 1,
+             (vip->flags & LB_VIP_FLAGS_MAGLEV)?" maglev":"",
              pool_elts(vip->as_indexes),
              (vip->flags & LB_VIP_FLAGS_USED)?"":" removed");
 
@@ -195,14 +202,18 @@ u8 *format_lb_vip_detailed (u8 * s, va_list * args)
   u32 indent = format_get_indent (s);
 
   s = format(s, "%U %U [%lu] %U%s\n"
-                   "%U  new_size:%u\n",
+                   "%U  new_size:%u%s\n"
+                   "%U  last update moved:%u buckets\n",
                   format_white_space, indent,
                   format_lb_vip_type, vip->type,
                   vip - lbm->vips,
                   format_ip46_prefix, &vip->prefix, (u32) vip->plen, IP46_TYPE_ANY,
                   (vip->flags & LB_VIP_FLAGS_USED)?"":" removed",
                   format_white_space, indent,
-                  vip->new_flow_table_mask + 1);
+                  vip->new_flow_table_mask + 1,
+                  (vip->flags & LB_VIP_FLAGS_MAGLEV)?" maglev":"",
+                  format_white_space, indent,
+                  vip->new_flow_table_moved);
 
   if (vip->port != 0)
     {
@@ -270,6 +281,7 @@ typedef struct {
   u32 as_index;
   u32 last;
   u32 skip;
+  u32 credit;
 } lb_pseudorand_t;
 
 static int lb_pseudorand_compare(void *a, void *b)
@@ -375,6 +387,69 @@ void lb_garbage_collection()
   lb_put_writer_lock();
 }
 
+/**
+ * Maglev table population (Eisenbud et al., NSDI'16).
+ * Each AS walks its own permutation of the (prime sized) table, derived
+ * from its address only, and takes turns claiming the next free bucket.
+ * The result only depends on the set of ASs, so all nodes build the same
+ * table, and adding or removing one of N ASs moves about 1/N buckets.
+ * ASs take turns in proportion to their weight.
+ */
+static int lb_is_prime(u32 n)
+{
+  u32 d;
+
+  if (n < 2)
+    return 0;
+  for (d = 2; d * d <= n; d++)
+    if (n % d == 0)
+      return 0;
+  return 1;
+}
+
+static void lb_vip_maglev_populate(lb_vip_t *vip, lb_pseudorand_t *sort_arr,
+                                   lb_new_flow_entry_t *new_flow_table)
+{
+  lb_main_t *lbm = &lb_main;
+  u32 len = vec_len(new_flow_table);
+  u32 max_weight = 0, done = 0;
+  lb_pseudorand_t *pr;
+
+  vec_foreach(pr, sort_arr) {
+    lb_as_t *as = &lbm->ass[pr->as_index];
+    u64 seed = clib_xxhash(as->address.as_u64[0] ^
+                           as->address.as_u64[1]);
+
+    pr->last = (seed >> 32) % len;
+    pr->skip = (seed & 0xffffffff) % (len - 1) + 1;
+    pr->credit = 0;
+    max_weight = clib_max(max_weight, as->weight);
+  }
+
+  while (1) {
+    vec_foreach(pr, sort_arr) {
+      pr->credit += lbm->ass[pr->as_index].weight;
+      if (pr->credit < max_weight)
+        continue;
+      pr->credit -= max_weight;
+
+      while (1) {
+        u32 last = pr->last;
+        pr->last += pr->skip;
+        if (pr->last >= len)
+          pr->last -= len;
+        if (new_flow_table[last].as_index == ~0) {
+          new_flow_table[last].as_index = pr->as_index;
+          break;
+        }
+      }
+      done++;
+      if (done == len)
+        return;
+    }
+  }
+}
+
 static void lb_vip_update_new_flow_table(lb_vip_t *vip)
 {
   lb_main_t *lbm = &lb_main;
@@ -390,7 +465,8 @@ static void lb_vip_update_new_flow_table(lb_vip_t *vip)
   i = 0;
   pool_foreach(as_index, vip->as_indexes, {
       as = &lbm->ass[*as_index];
-      if (as->flags & LB_AS_FLAGS_USED) { //Not used anymore
+      if ((as->flags & LB_AS_FLAGS_USED) && //Not used anymore
+          (as->weight || !(vip->flags & LB_VIP_FLAGS_MAGLEV))) {
         i = 1;
         goto out; //Not sure 'break' works in this macro-loop
       }
@@ -414,6 +490,8 @@ out:
       as = &lbm->ass[*as_index];
       if (!(as->flags & LB_AS_FLAGS_USED)) //Not used anymore
         continue;
+      if ((vip->flags & LB_VIP_FLAGS_MAGLEV) && !as->weight) //Draining
+        continue;
 
       sort_arr[i].as_index = as - lbm->ass;
       i++;
@@ -422,6 +500,15 @@ out:
 
   vec_sort_with_function(sort_arr, lb_pseudorand_compare);
 
+  if (vip->flags & LB_VIP_FLAGS_MAGLEV) {
+    vec_validate(new_flow_table, vip->new_flow_table_mask);
+    for (i=0; i<vec_len(new_flow_table); i++)
+      new_flow_table[i].as_index = ~0;
+
+    lb_vip_maglev_populate(vip, sort_arr, new_flow_table);
+    goto finished;
+  }
+
   //Now let's pseudo-randomly generate permutations
   vec_foreach(pr, sort_arr) {
     lb_as_t *as = &lbm->ass[pr->as_index];
@@ -464,6 +551,13 @@ out:
 finished:
   vec_free(sort_arr);
 
+  //Measure how many buckets, hence new flows, moved to another AS
+  vip->new_flow_table_moved = 0;
+  if (vec_len(vip->new_flow_table) == vec_len(new_flow_table))
+    for (i=0; i<vec_len(new_flow_table); i++)
+      vip->new_flow_table_moved +=
+        vip->new_flow_table[i].as_index != new_flow_table[i].as_index;
+
   old_table = vip->new_flow_table;
   vip->new_flow_table = new_flow_table;
   vec_free(old_table);
@@ -487,6 +581,76 @@ int lb_conf(ip4_address_t *ip4_address, ip6_address_t *ip6_address,
 }
 
 
+static vlib_node_registration_t lb_sticky_resize_node;
+
+int lb_set_sticky_auto_grow(u32 max_buckets)
+{
+  lb_main_t *lbm = &lb_main;
+
+  if (max_buckets && (!is_pow2(max_buckets) ||
+                      max_buckets < lbm->per_cpu_sticky_buckets))
+    return VNET_API_ERROR_INVALID_MEMORY_SIZE;
+
+  lb_get_writer_lock();
+  lbm->per_cpu_sticky_max_buckets = max_buckets;
+  lb_put_writer_lock();
+
+  //Wake the resize process up
+  vlib_process_signal_event (lbm->vlib_main, lb_sticky_resize_node.index,
+                             0, 0);
+  return 0;
+}
+
+/*
+ * Grow the per-cpu sticky tables whose full buckets keep evicting flows.
+ * Tables are allocated here and handed over to the workers, which switch
+ * to them and migrate the entries of their old table incrementally.
+ */
+static uword
+lb_sticky_resize_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
+                          vlib_frame_t * f)
+{
+  lb_main_t *lbm = &lb_main;
+  lb_per_cpu_t *pc;
+
+  while (1)
+    {
+      if (lbm->per_cpu_sticky_max_buckets)
+        vlib_process_wait_for_event_or_clock (vm, LB_STICKY_RESIZE_INTERVAL);
+      else
+        vlib_process_wait_for_event (vm);
+      vlib_process_get_events (vm, NULL);
+
+      vec_foreach(pc, lbm->per_cpu)
+        {
+          u64 evictions = pc->sticky_evictions;
+          u32 nbuckets = pc->sticky_nbuckets;
+
+          if (lbm->per_cpu_sticky_max_buckets &&
+              pc->sticky_ht != NULL && pc->sticky_ht_next == NULL &&
+              pc->sticky_ht_old == NULL &&
+              nbuckets < lbm->per_cpu_sticky_max_buckets &&
+              evictions - pc->sticky_evictions_last >
+                (nbuckets >> LB_STICKY_GROW_EVICTION_SHIFT))
+            {
+              lb_hash_t *next = lb_hash_alloc (nbuckets << 1,
+                                               lbm->flow_timeout);
+              CLIB_MEMORY_BARRIER();
+              pc->sticky_ht_next = next;
+            }
+          pc->sticky_evictions_last = evictions;
+        }
+    }
+
+  return 0;
+}
+
+VLIB_REGISTER_NODE (lb_sticky_resize_node, static) =
+{
+  .function = lb_sticky_resize_process,
+  .type = VLIB_NODE_TYPE_PROCESS,
+  .name = "lb-sticky-resize-process",
+};
 
 static
 int lb_vip_port_find_index(ip46_address_t *prefix, u8 plen,
@@ -576,7 +740,23 @@ static int lb_as_find_index_vip(lb_vip_t *vip, ip46_address_t *address, u32 *as_
   return -1;
 }
 
-int lb_vip_add_ass(u32 vip_index, ip46_address_t *addresses, u32 n)
+int lb_vip_as_is_used(u32 vip_index, ip46_address_t *address)
+{
+  lb_main_t *lbm = &lb_main;
+  lb_vip_t *vip;
+  u32 i;
+  int used = 0;
+
+  lb_get_writer_lock();
+  if ((vip = lb_vip_get_by_index(vip_index)) &&
+      !lb_as_find_index_vip(vip, address, &i))
+    used = !!(lbm->ass[i].flags & LB_AS_FLAGS_USED);
+  lb_put_writer_lock();
+  return used;
+}
+
+int lb_vip_add_ass_weighted(u32 vip_index, ip46_address_t *addresses, u32 n,
+                            u8 weight)
 {
   lb_main_t *lbm = &lb_main;
   lb_get_writer_lock();
@@ -586,6 +766,12 @@ int lb_vip_add_ass(u32 vip_index, ip46_address_t *addresses, u32 n)
     return VNET_API_ERROR_NO_SUCH_ENTRY;
   }
 
+  //Only Maglev takes weights into account
+  if (!(vip->flags & LB_VIP_FLAGS_MAGLEV) && weight != LB_AS_DEFAULT_WEIGHT) {
+    lb_put_writer_lock();
+    return VNET_API_ERROR_INVALID_ARGUMENT;
+  }
+
   ip46_type_t type = lb_encap_is_ip4(vip)?IP46_TYPE_IP4:IP46_TYPE_IP6;
   u32 *to_be_added = 0;
   u32 *to_be_updated = 0;
@@ -631,6 +817,7 @@ next:
   //Update reused ASs
   vec_foreach(ip, to_be_updated) {
     lbm->ass[*ip].flags = LB_AS_FLAGS_USED;
+    lbm->ass[*ip].weight = weight;
   }
   vec_free(to_be_updated);
 
@@ -641,6 +828,7 @@ next:
     pool_get(lbm->ass, as);
     as->address = addresses[*ip];
     as->flags = LB_AS_FLAGS_USED;
+    as->weight = weight;
     as->vip_index = vip_index;
     pool_get(vip->as_indexes, as_index);
     *as_index = as - lbm->ass;
@@ -752,6 +940,74 @@ next:
   return 0;
 }
 
+int lb_vip_add_ass(u32 vip_index, ip46_address_t *addresses, u32 n)
+{
+  return lb_vip_add_ass_weighted(vip_index, addresses, n,
+                                 LB_AS_DEFAULT_WEIGHT);
+}
+
+int lb_vip_set_ass_weight(u32 vip_index, ip46_address_t *addresses, u32 n,
+                          u8 weight)
+{
+  lb_main_t *lbm = &lb_main;
+  lb_get_writer_lock();
+  lb_vip_t *vip;
+  u32 *indexes = 0;
+  u32 i, *ip;
+
+  if (!(vip = lb_vip_get_by_index(vip_index))) {
+    lb_put_writer_lock();
+    return VNET_API_ERROR_NO_SUCH_ENTRY;
+  }
+
+  if (!(vip->flags & LB_VIP_FLAGS_MAGLEV)) {
+    lb_put_writer_lock();
+    return VNET_API_ERROR_INVALID_ARGUMENT;
+  }
+
+  while (n--) {
+    if (lb_as_find_index_vip(vip, &addresses[n], &i) ||
+        !(lbm->ass[i].flags & LB_AS_FLAGS_USED)) {
+      vec_free(indexes);
+      lb_put_writer_lock();
+      return VNET_API_ERROR_NO_SUCH_ENTRY;
+    }
+    vec_add1(indexes, i);
+  }
+
+  vec_foreach(ip, indexes) {
+    lbm->ass[*ip].weight = weight;
+  }
+  vec_free(indexes);
+
+  //Recompute flows
+  lb_vip_update_new_flow_table(vip);
+
+  lb_put_writer_lock();
+  return 0;
+}
+
+static void
+lb_flush_sticky_table (lb_hash_t *h, u32 thread_index, u32 vip_index,
+                       u32 as_index)
+{
+  lb_main_t *lbm = &lb_main;
+  u32 i;
+  lb_hash_bucket_t *b;
+
+  lb_hash_foreach_entry(h, b, i) {
+    if ((vip_index == ~0)
+        || ((b->vip[i] == vip_index) && (as_index == ~0))
+        || ((b->vip[i] == vip_index) && (b->value[i] == as_index)))
+      {
+        vlib_refcount_add(&lbm->as_refcount, thread_index, b->value[i], -1);
+        vlib_refcount_add(&lbm->as_refcount, thread_index, 0, 1);
+        b->vip[i] = ~0;
+        b->value[i] = ~0;
+      }
+  }
+}
+
 int
 lb_flush_vip_as (u32 vip_index, u32 as_index)
 {
@@ -760,28 +1016,31 @@ lb_flush_vip_as (u32 vip_index, u32 as_index)
   lb_main_t *lbm = &lb_main;
 
   for(thread_index = 0; thread_index < tm->n_vlib_mains; thread_index++ ) {
-    lb_hash_t *h = lbm->per_cpu[thread_index].sticky_ht;
+    lb_per_cpu_t *pc = &lbm->per_cpu[thread_index];
+    lb_hash_t *h = pc->sticky_ht;
     if (h != NULL) {
-        u32 i;
-        lb_hash_bucket_t *b;
-
-        lb_hash_foreach_entry(h, b, i) {
-          if ((vip_index == ~0)
-              || ((b->vip[i] == vip_index) && (as_index == ~0))
-              || ((b->vip[i] == vip_index) && (b->value[i] == as_index)))
-            {
-              vlib_refcount_add(&lbm->as_refcount, thread_index, b->value[i], -1);
-              vlib_refcount_add(&lbm->as_refcount, thread_index, 0, 1);
-              b->vip[i] = ~0;
-              b->value[i] = ~0;
-            }
-        }
+        lb_flush_sticky_table (h, thread_index, vip_index, as_index);
         if (vip_index == ~0)
           {
             lb_hash_free(h);
-            lbm->per_cpu[thread_index].sticky_ht = 0;
+            pc->sticky_ht = 0;
           }
       }
+    //Entries not migrated yet after the table grew
+    h = pc->sticky_ht_old;
+    if (h != NULL) {
+        lb_flush_sticky_table (h, thread_index, vip_index, as_index);
+        if (vip_index == ~0)
+          {
+            lb_hash_free(h);
+            pc->sticky_ht_old = 0;
+          }
+      }
+    if (vip_index == ~0 && pc->sticky_ht_next != NULL)
+      {
+        lb_hash_free(pc->sticky_ht_next);
+        pc->sticky_ht_next = 0;
+      }
     }
 
   return 0;
@@ -1085,7 +1344,15 @@ int lb_vip_add(lb_vip_add_args_t args, u32 *vip_index)
       return VNET_API_ERROR_INVALID_ARGUMENT;
     }
 
-  if (!is_pow2(args.new_length)) {
+  if (args.maglev) {
+    //Maglev needs a prime table length, so that every skip is coprime
+    if (args.new_length < 2 || args.new_length > LB_MAGLEV_MAX_LENGTH) {
+      lb_put_writer_lock();
+      return VNET_API_ERROR_INVALID_MEMORY_SIZE;
+    }
+    while (!lb_is_prime(args.new_length))
+      args.new_length++;
+  } else if (!is_pow2(args.new_length)) {
     lb_put_writer_lock();
     return VNET_API_ERROR_INVALID_MEMORY_SIZE;
   }
@@ -1139,6 +1406,8 @@ int lb_vip_add(lb_vip_add_args_t args, u32 *vip_index)
     }
 
   vip->flags = LB_VIP_FLAGS_USED;
+  if (args.maglev)
+    vip->flags |= LB_VIP_FLAGS_MAGLEV;
   vip->as_indexes = 0;
 
   //Validate counters
@@ -1151,6 +1420,7 @@ int lb_vip_add(lb_vip_add_args_t args, u32 *vip_index)
   //Configure new flow table
   vip->new_flow_table_mask = args.new_length - 1;
   vip->new_flow_table = 0;
+  vip->new_flow_table_moved = 0;
 
   //Update flow hash table
   lb_vip_update_new_flow_table(vip);
@@ -1386,6 +1656,7 @@ lb_init (vlib_main_t * vm)
   lbm->writer_lock = clib_mem_alloc_aligned (CLIB_CACHE_LINE_BYTES,  CLIB_CACHE_LINE_BYTES);
   lbm->writer_lock[0] = 0;
   lbm->per_cpu_sticky_buckets = LB_DEFAULT_PER_CPU_STICKY_BUCKETS;
+  lbm->per_cpu_sticky_max_buckets = 0;
   lbm->flow_timeout = LB_DEFAULT_FLOW_TIMEOUT;
   lbm->ip4_src_address.as_u32 = 0xffffffff;
   lbm->ip6_src_address.as_u64[0] = 0xffffffffffffffffL;
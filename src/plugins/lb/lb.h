@@ -44,9 +44,18 @@
 
 #define LB_DEFAULT_PER_CPU_STICKY_BUCKETS 1 << 10
 #define LB_DEFAULT_FLOW_TIMEOUT 40
+
+/* Sticky table buckets migrated per frame after the table grew */
+#define LB_STICKY_MIGRATE_BUCKETS 64
+/* Grow the sticky table when more than nbuckets >> shift flows were
+ * evicted during the last resize interval */
+#define LB_STICKY_GROW_EVICTION_SHIFT 8
+#define LB_STICKY_RESIZE_INTERVAL 1.0
 #define LB_MAPPING_BUCKETS  1024
 #define LB_MAPPING_MEMORY_SIZE  64<<20
 
+#define LB_MAGLEV_MAX_LENGTH  (1 << 24)
+
 #define LB_VIP_PER_PORT_BUCKETS  1024
 #define LB_VIP_PER_PORT_MEMORY_SIZE  64<<20
 
@@ -133,6 +142,14 @@ typedef struct {
 
 #define LB_AS_FLAGS_USED 0x1
 
+  /**
+   * Relative share of the new flow table, only used by Maglev VIPs.
+   * An AS with zero weight gets no new flows (draining).
+   */
+  u8 weight;
+
+#define LB_AS_DEFAULT_WEIGHT 1
+
   /**
    * Rotating timestamp of when LB_AS_FLAGS_USED flag was last set.
    *
@@ -171,7 +188,8 @@ typedef struct {
  _(NEXT_PACKET, "packet from existing sessions", 0) \
  _(FIRST_PACKET, "first session packet", 1) \
  _(UNTRACKED_PACKET, "untracked packet", 2) \
- _(NO_SERVER, "no server configured", 3)
+ _(NO_SERVER, "no server configured", 3) \
+ _(EVICTED_PACKET, "first session packet evicting an older session", 4)
 
 typedef enum {
 #define _(a,b,c) LB_VIP_COUNTER_##a = c,
@@ -270,7 +288,7 @@ typedef struct {
 
   /**
    * New flows table length - 1
-   * (length MUST be a power of 2)
+   * (length MUST be a power of 2, or a prime for Maglev VIPs)
    */
   u32 new_flow_table_mask;
 
@@ -323,6 +341,14 @@ typedef struct {
    */
   u8 flags;
 #define LB_VIP_FLAGS_USED 0x1
+#define LB_VIP_FLAGS_MAGLEV 0x2
+
+  /**
+   * Number of new flow table buckets which changed AS during the last
+   * table update, i.e. the share of new flows disrupted by the last
+   * AS add/remove.
+   */
+  u32 new_flow_table_moved;
 
   /**
    * Pool of AS indexes used for this VIP.
@@ -331,6 +357,20 @@ typedef struct {
   u32 *as_indexes;
 } lb_vip_t;
 
+/**
+ * Index of the new flow table bucket for a flow hash.
+ * Maglev tables have a prime length, so the hash is scaled to the table
+ * length with a multiply and shift instead of a modulo.
+ */
+always_inline u32
+lb_vip_new_flow_index (lb_vip_t * vip, u32 hash)
+{
+  if (vip->flags & LB_VIP_FLAGS_MAGLEV)
+    return ((u64) hash * (vip->new_flow_table_mask + 1)) >> 32;
+
+  return hash & vip->new_flow_table_mask;
+}
+
 #define lb_vip_is_ip4(type) (type == LB_VIP_TYPE_IP4_GRE6 \
                             || type == LB_VIP_TYPE_IP4_GRE4 \
                             || type == LB_VIP_TYPE_IP4_L3DSR \
@@ -464,6 +504,45 @@ typedef struct {
    * One single table is used for all VIPs.
    */
   lb_hash_t *sticky_ht;
+
+  /**
+   * Bigger table allocated by the resize process, picked up by the
+   * worker on its next frame.
+   */
+  lb_hash_t *sticky_ht_next;
+
+  /**
+   * Table being migrated to sticky_ht after a resize. Flows in buckets
+   * not yet migrated are still looked up there.
+   */
+  lb_hash_t *sticky_ht_old;
+
+  /**
+   * Next sticky_ht_old bucket to migrate.
+   */
+  u32 sticky_migrate_bucket;
+
+  /**
+   * Configured number of buckets the table was allocated for, and
+   * its current number of buckets.
+   */
+  u32 sticky_conf_buckets;
+  u32 sticky_nbuckets;
+
+  /**
+   * Number of times the table grew.
+   */
+  u32 sticky_grows;
+
+  /**
+   * Entries of full buckets replaced by new flows.
+   */
+  u64 sticky_evictions;
+
+  /**
+   * sticky_evictions on the last resize process run.
+   */
+  u64 sticky_evictions_last;
 } lb_per_cpu_t;
 
 typedef struct {
@@ -520,6 +599,12 @@ typedef struct {
    */
   u32 per_cpu_sticky_buckets;
 
+  /**
+   * Maximum number of buckets the per-cpu sticky hash tables may grow to.
+   * 0 disables growing.
+   */
+  u32 per_cpu_sticky_max_buckets;
+
   /**
    * Flow timeout in seconds.
    */
@@ -576,6 +661,9 @@ typedef struct {
   u16 port;
   lb_vip_type_t type;
   u32 new_length;
+  /* populate the new flow table with Maglev, new_length is rounded up to
+     a prime */
+  u8 maglev;
   lb_vip_encap_args_t encap_args;
 } lb_vip_add_args_t;
 
@@ -596,6 +684,13 @@ extern vlib_node_registration_t lb_nat6_in2out_node;
 int lb_conf(ip4_address_t *ip4_address, ip6_address_t *ip6_address,
             u32 sticky_buckets, u32 flow_timeout);
 
+/**
+ * Let the per-cpu sticky hash tables grow when flows get evicted.
+ * @param max_buckets Maximum number of buckets (power of 2), 0 to disable
+ * @return 0 on success. VNET_LB_ERR_XXX on error
+ */
+int lb_set_sticky_auto_grow(u32 max_buckets);
+
 int lb_vip_add(lb_vip_add_args_t args, u32 *vip_index);
 
 int lb_vip_del(u32 vip_index);
@@ -606,6 +701,11 @@ int lb_vip_find_index(ip46_address_t *prefix, u8 plen, u8 protocol,
 #define lb_vip_get_by_index(index) (pool_is_free_index(lb_main.vips, index)?NULL:pool_elt_at_index(lb_main.vips, index))
 
 int lb_vip_add_ass(u32 vip_index, ip46_address_t *addresses, u32 n);
+int lb_vip_add_ass_weighted(u32 vip_index, ip46_address_t *addresses, u32 n,
+                            u8 weight);
+int lb_vip_set_ass_weight(u32 vip_index, ip46_address_t *addresses, u32 n,
+                          u8 weight);
+int lb_vip_as_is_used(u32 vip_index, ip46_address_t *address);
 int lb_vip_del_ass(u32 vip_index, ip46_address_t *addresses, u32 n, u8 flush);
 int lb_flush_vip_as (u32 vip_index, u32 as_index);
 
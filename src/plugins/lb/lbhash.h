@@ -181,6 +181,37 @@ void lb_hash_put(lb_hash_t *h, u32 hash, u32 value, u32 vip,
   bucket->vip[available_index] = vip;
 }
 
+/*
+ * @brief Get the least recently used entry of a bucket.
+ * The timeout of an entry is refreshed each time it is used,
+ * so the least recently used entry is the one expiring first.
+ */
+static_always_inline
+u32 lb_hash_lru_index(lb_hash_t *h, u32 hash)
+{
+  lb_hash_bucket_t *bucket = &h->buckets[hash & h->buckets_mask];
+  u32 i, lru = 0;
+  for (i = 1; i < LBHASH_ENTRY_PER_BUCKET; i++)
+    lru = clib_u32_loop_gt(bucket->timeout[lru], bucket->timeout[i])?i:lru;
+  return lru;
+}
+
+/*
+ * @brief Look a valid entry up, without refreshing it.
+ * @return The entry index in the bucket, or ~0 if not found.
+ */
+static_always_inline
+u32 lb_hash_find(lb_hash_t *h, u32 hash, u32 vip, u32 time_now)
+{
+  lb_hash_bucket_t *bucket = &h->buckets[hash & h->buckets_mask];
+  u32 i;
+  for (i = 0; i < LBHASH_ENTRY_PER_BUCKET; i++)
+    if (bucket->hash[i] == hash && bucket->vip[i] == vip &&
+        clib_u32_loop_gt(bucket->timeout[i], time_now))
+      return i;
+  return ~0;
+}
+
 static_always_inline
 u32 lb_hash_elts(lb_hash_t *h, u32 time_now)
 {
@@ -123,41 +123,178 @@ format_lb_nat_trace (u8 * s, va_list * args)
   return s;
 }
 
-lb_hash_t *
-lb_get_sticky_table (u32 thread_index)
+static void
+lb_sticky_table_free (lb_hash_t *sticky_ht, u32 thread_index)
 {
   lb_main_t *lbm = &lb_main;
-  lb_hash_t *sticky_ht = lbm->per_cpu[thread_index].sticky_ht;
-  //Check if size changed
-  if (PREDICT_FALSE(
-      sticky_ht && (lbm->per_cpu_sticky_buckets != lb_hash_nbuckets(sticky_ht))))
+  lb_hash_bucket_t *b;
+  u32 i;
+
+  //Dereference everything in there
+  lb_hash_foreach_entry(sticky_ht, b, i)
+    {
+      vlib_refcount_add (&lbm->as_refcount, thread_index, b->value[i], -1);
+      vlib_refcount_add (&lbm->as_refcount, thread_index, 0, 1);
+    }
+
+  lb_hash_free (sticky_ht);
+}
+
+/*
+ * Move an entry of the old sticky table to the current one.
+ * The AS reference moves with it. The entry is dropped if its new
+ * bucket is full.
+ */
+static_always_inline void
+lb_sticky_entry_migrate (lb_per_cpu_t *pc, lb_hash_bucket_t *b, u32 i,
+                         u32 thread_index, u32 time_now)
+{
+  lb_main_t *lbm = &lb_main;
+  lb_hash_t *sticky_ht = pc->sticky_ht;
+  lb_hash_bucket_t *nb = &sticky_ht->buckets[b->hash[i] & sticky_ht->buckets_mask];
+  u32 available_index, value;
+
+  lb_hash_get (sticky_ht, b->hash[i], b->vip[i], time_now,
+               &available_index, &value);
+  if (PREDICT_TRUE(value == ~0 && available_index != ~0))
+    {
+      vlib_refcount_add (&lbm->as_refcount, thread_index,
+                         nb->value[available_index], -1);
+      nb->hash[available_index] = b->hash[i];
+      nb->vip[available_index] = b->vip[i];
+      nb->value[available_index] = b->value[i];
+      nb->timeout[available_index] = b->timeout[i];
+    }
+  else
     {
-      //Dereference everything in there
-      lb_hash_bucket_t *b;
-      u32 i;
-      lb_hash_foreach_entry(sticky_ht, b, i)
+      vlib_refcount_add (&lbm->as_refcount, thread_index, b->value[i], -1);
+      vlib_refcount_add (&lbm->as_refcount, thread_index, 0, 1);
+      pc->sticky_evictions += (value == ~0);
+    }
+
+  b->value[i] = 0;
+  b->timeout[i] = 0;
+}
+
+/*
+ * Migrate a few buckets of the old sticky table after the table grew.
+ * The old table is freed once fully migrated.
+ */
+static void
+lb_sticky_table_migrate (lb_per_cpu_t *pc, u32 thread_index, u32 time_now)
+{
+  lb_main_t *lbm = &lb_main;
+  lb_hash_t *old = pc->sticky_ht_old;
+  u32 last = clib_min (pc->sticky_migrate_bucket + LB_STICKY_MIGRATE_BUCKETS,
+                       lb_hash_nbuckets(old));
+  lb_hash_bucket_t *b;
+  u32 i;
+
+  for (; pc->sticky_migrate_bucket < last; pc->sticky_migrate_bucket++)
+    {
+      b = &old->buckets[pc->sticky_migrate_bucket];
+      for (i = 0; i < LBHASH_ENTRY_PER_BUCKET; i++)
         {
-          vlib_refcount_add (&lbm->as_refcount, thread_index, b->value[i], -1);
-          vlib_refcount_add (&lbm->as_refcount, thread_index, 0, 1);
+          if (clib_u32_loop_gt(b->timeout[i], time_now))
+            {
+              lb_sticky_entry_migrate (pc, b, i, thread_index, time_now);
+            }
+          else
+            {
+              vlib_refcount_add (&lbm->as_refcount, thread_index,
+                                 b->value[i], -1);
+              vlib_refcount_add (&lbm->as_refcount, thread_index, 0, 1);
+              b->value[i] = 0;
+            }
         }
+    }
 
-      lb_hash_free (sticky_ht);
+  if (pc->sticky_migrate_bucket == lb_hash_nbuckets(old))
+    {
+      //All entries were moved or dereferenced
+      lb_hash_free (old);
+      pc->sticky_ht_old = NULL;
+    }
+}
+
+/*
+ * Look a flow up in the part of the old sticky table which was not
+ * migrated yet. A found entry is moved to the current table.
+ * Returns the AS index, or ~0 if not found.
+ */
+static_always_inline u32
+lb_sticky_old_lookup (lb_per_cpu_t *pc, u32 hash, u32 vip_index,
+                      u32 thread_index, u32 time_now)
+{
+  lb_hash_t *old = pc->sticky_ht_old;
+  lb_hash_bucket_t *b = &old->buckets[hash & old->buckets_mask];
+  u32 i, value;
+
+  if ((hash & old->buckets_mask) < pc->sticky_migrate_bucket)
+    return ~0;
+
+  i = lb_hash_find (old, hash, vip_index, time_now);
+  if (i == ~0)
+    return ~0;
+
+  value = b->value[i];
+  b->timeout[i] = time_now + pc->sticky_ht->timeout;
+  lb_sticky_entry_migrate (pc, b, i, thread_index, time_now);
+  return value;
+}
+
+lb_hash_t *
+lb_get_sticky_table (u32 thread_index, u32 time_now)
+{
+  lb_main_t *lbm = &lb_main;
+  lb_per_cpu_t *pc = &lbm->per_cpu[thread_index];
+  lb_hash_t *sticky_ht = pc->sticky_ht;
+  //Check if size changed
+  if (PREDICT_FALSE(
+      sticky_ht && (lbm->per_cpu_sticky_buckets != pc->sticky_conf_buckets)))
+    {
+      lb_sticky_table_free (sticky_ht, thread_index);
       sticky_ht = NULL;
+      pc->sticky_ht = NULL;
+      if (pc->sticky_ht_old)
+        lb_sticky_table_free (pc->sticky_ht_old, thread_index);
+      pc->sticky_ht_old = NULL;
+      if (pc->sticky_ht_next)
+        lb_hash_free (pc->sticky_ht_next);
+      pc->sticky_ht_next = NULL;
     }
 
   //Create if necessary
   if (PREDICT_FALSE(sticky_ht == NULL))
     {
-      lbm->per_cpu[thread_index].sticky_ht = lb_hash_alloc (
-          lbm->per_cpu_sticky_buckets, lbm->flow_timeout);
-      sticky_ht = lbm->per_cpu[thread_index].sticky_ht;
+      pc->sticky_ht = lb_hash_alloc (lbm->per_cpu_sticky_buckets,
+                                     lbm->flow_timeout);
+      sticky_ht = pc->sticky_ht;
+      pc->sticky_conf_buckets = lbm->per_cpu_sticky_buckets;
+      pc->sticky_nbuckets = lbm->per_cpu_sticky_buckets;
       clib_warning("Regenerated sticky table %p", sticky_ht);
     }
 
+  //Switch to the bigger table allocated by the resize process
+  if (PREDICT_FALSE(pc->sticky_ht_next != NULL && pc->sticky_ht_old == NULL))
+    {
+      pc->sticky_ht_old = sticky_ht;
+      pc->sticky_migrate_bucket = 0;
+      pc->sticky_ht = pc->sticky_ht_next;
+      pc->sticky_ht_next = NULL;
+      sticky_ht = pc->sticky_ht;
+      pc->sticky_nbuckets = lb_hash_nbuckets(sticky_ht);
+      pc->sticky_grows++;
+    }
+
   ASSERT(sticky_ht);
 
   //Update timeout
   sticky_ht->timeout = lbm->flow_timeout;
+
+  if (PREDICT_FALSE(pc->sticky_ht_old != NULL))
+    lb_sticky_table_migrate (pc, thread_index, time_now);
+
   return sticky_ht;
 }
 
@@ -264,7 +401,8 @@ lb_node_fn (vlib_main_t * vm,
   u32 thread_index = vm->thread_index;
   u32 lb_time = lb_hash_time_now (vm);
 
-  lb_hash_t *sticky_ht = lb_get_sticky_table (thread_index);
+  lb_per_cpu_t *pc = &lbm->per_cpu[thread_index];
+  lb_hash_t *sticky_ht = lb_get_sticky_table (thread_index, lb_time);
   from = vlib_frame_vector_args (frame);
   n_left_from = frame->n_vectors;
   next_index = node->cached_next_index;
@@ -348,12 +486,27 @@ lb_node_fn (vlib_main_t * vm,
               //Found an existing entry
               counter = LB_VIP_COUNTER_NEXT_PACKET;
             }
-          else if (PREDICT_TRUE(available_index0 != ~0))
+          else if (PREDICT_FALSE(pc->sticky_ht_old != NULL) &&
+              (asindex0 = lb_sticky_old_lookup (pc, hash0, vip_index0,
+                                                thread_index, lb_time)) != ~0)
+            {
+              //Found an entry not migrated yet after the table grew
+              counter = LB_VIP_COUNTER_NEXT_PACKET;
+            }
+          else
             {
-              //There is an available slot for a new flow
-              asindex0 =
-                  vip0->new_flow_table[hash0 & vip0->new_flow_table_mask].as_index;
+              //Use an available slot for the new flow, or replace the
+              //least recently used entry when the bucket is full
               counter = LB_VIP_COUNTER_FIRST_PACKET;
+              if (PREDICT_FALSE(available_index0 == ~0))
+                {
+                  available_index0 = lb_hash_lru_index (sticky_ht, hash0);
+                  pc->sticky_evictions++;
+                  counter = LB_VIP_COUNTER_EVICTED_PACKET;
+                }
+
+              asindex0 = vip0->new_flow_table[
+                  lb_vip_new_flow_index (vip0, hash0)].as_index;
               counter = (asindex0 == 0) ? LB_VIP_COUNTER_NO_SERVER : counter;
 
               //TODO: There are race conditions with as0 and vip0 manipulation.
@@ -373,13 +526,6 @@ lb_node_fn (vlib_main_t * vm,
                            vip_index0,
                            available_index0, lb_time);
             }
-          else
-            {
-              //Could not store new entry in the table
-              asindex0 =
-                  vip0->new_flow_table[hash0 & vip0->new_flow_table_mask].as_index;
-              counter = LB_VIP_COUNTER_UNTRACKED_PACKET;
-            }
 
           vlib_increment_simple_counter (
               &lbm->vip_counters[counter], thread_index,
@@ -190,323 +190,196 @@ ip4_map_fragment (vlib_buffer_t * b, u16 mtu, bool df, u8 * error)
 }
 
 /*
- * ip4_map
+ * Domain of the last packet and its not yet counted TX packets.
+ * Packets of a frame mostly go to the same shared address.
  */
-static uword
-ip4_map (vlib_main_t * vm, vlib_node_runtime_t * node, vlib_frame_t * frame)
+typedef struct
+{
+  u32 dst_address;
+  u32 map_domain_index;
+  map_domain_t *d;
+  u32 n_packets;
+  u32 n_bytes;
+} ip4_map_domain_cache_t;
+
+static_always_inline void
+ip4_map_domain_cache_flush (ip4_map_domain_cache_t * c,
+			    vlib_combined_counter_main_t * cm,
+			    u32 thread_index)
+{
+  if (c->n_packets)
+    vlib_increment_combined_counter (cm + MAP_DOMAIN_COUNTER_TX,
+				     thread_index, c->map_domain_index,
+				     c->n_packets, c->n_bytes);
+  c->n_packets = 0;
+  c->n_bytes = 0;
+}
+
+static_always_inline u16
+ip4_map_one (vlib_main_t * vm, vlib_node_runtime_t * node,
+	     vlib_node_runtime_t * error_node, vlib_buffer_t * p0,
+	     ip4_map_domain_cache_t * c, u32 thread_index)
 {
-  u32 n_left_from, *from, next_index, *to_next, n_left_to_next;
-  vlib_node_runtime_t *error_node =
-    vlib_node_get_runtime (vm, ip4_map_node.index);
-  from = vlib_frame_vector_args (frame);
-  n_left_from = frame->n_vectors;
-  next_index = node->cached_next_index;
   map_main_t *mm = &map_main;
-  vlib_combined_counter_main_t *cm = mm->domain_counters;
-  u32 thread_index = vm->thread_index;
+  map_domain_t *d0;
+  u8 error0 = MAP_ERROR_NONE;
+  ip4_header_t *ip40;
+  u16 port0 = 0;
+  ip6_header_t *ip6h0;
+  u32 next0 = IP4_MAP_NEXT_IP6_LOOKUP;
+  u32 map_domain_index0 = ~0;
 
-  while (n_left_from > 0)
+  ip40 = vlib_buffer_get_current (p0);
+
+  if (PREDICT_TRUE (c->d && c->dst_address == ip40->dst_address.as_u32))
     {
-      vlib_get_next_frame (vm, node, next_index, to_next, n_left_to_next);
+      d0 = c->d;
+      map_domain_index0 = c->map_domain_index;
+    }
+  else
+    {
+      d0 =
+	ip4_map_get_domain (&ip40->dst_address, &map_domain_index0, &error0);
+      if (!d0)
+	{			/* Guess it wasn't for us */
+	  vnet_feature_next (&next0, p0);
+	  return next0;
+	}
+      ip4_map_domain_cache_flush (c, mm->domain_counters, thread_index);
+      c->dst_address = ip40->dst_address.as_u32;
+      c->map_domain_index = map_domain_index0;
+      c->d = d0;
+    }
 
-      /* Dual loop */
-      while (n_left_from >= 4 && n_left_to_next >= 2)
+  /*
+   * Shared IPv4 address
+   */
+  port0 = ip4_map_port_and_security_check (d0, ip40, &next0, &error0);
+
+  /* Decrement IPv4 TTL */
+  ip4_map_decrement_ttl (ip40, &error0);
+  bool df0 =
+    ip40->flags_and_fragment_offset &
+    clib_host_to_net_u16 (IP4_HEADER_FLAG_DONT_FRAGMENT);
+
+  /* MAP calc */
+  u32 da40 = clib_net_to_host_u32 (ip40->dst_address.as_u32);
+  u16 dp40 = clib_net_to_host_u16 (port0);
+  u64 dal60 = map_get_pfx (d0, da40, dp40);
+  u64 dar60 = map_get_sfx (d0, da40, dp40);
+  if (dal60 == 0 && dar60 == 0 && error0 == MAP_ERROR_NONE
+      && next0 != IP4_MAP_NEXT_REASS)
+    error0 = MAP_ERROR_NO_BINDING;
+
+  /* construct ipv6 header */
+  vlib_buffer_advance (p0, -(sizeof (ip6_header_t)));
+  ip6h0 = vlib_buffer_get_current (p0);
+  vnet_buffer (p0)->sw_if_index[VLIB_TX] = (u32) ~ 0;
+
+  ip6h0->ip_version_traffic_class_and_flow_label = ip4_map_vtcfl (ip40, p0);
+  ip6h0->payload_length = ip40->length;
+  ip6h0->protocol = IP_PROTOCOL_IP_IN_IP;
+  ip6h0->hop_limit = 0x40;
+  ip6h0->src_address = d0->ip6_src;
+  ip6h0->dst_address.as_u64[0] = clib_host_to_net_u64 (dal60);
+  ip6h0->dst_address.as_u64[1] = clib_host_to_net_u64 (dar60);
+
+  /*
+   * Determine next node. Can be one of:
+   * ip6-lookup, ip6-rewrite, ip4-fragment, ip4-virtreass, error-drop
+   */
+  if (PREDICT_TRUE (error0 == MAP_ERROR_NONE))
+    {
+      if (PREDICT_FALSE
+	  (d0->mtu
+	   && (clib_net_to_host_u16 (ip6h0->payload_length) +
+	       sizeof (*ip6h0) > d0->mtu)))
 	{
-	  u32 pi0, pi1;
-	  vlib_buffer_t *p0, *p1;
-	  map_domain_t *d0, *d1;
-	  u8 error0 = MAP_ERROR_NONE, error1 = MAP_ERROR_NONE;
-	  ip4_header_t *ip40, *ip41;
-	  u16 port0 = 0, port1 = 0;
-	  ip6_header_t *ip6h0, *ip6h1;
-	  u32 map_domain_index0 = ~0, map_domain_index1 = ~0;
-	  u32 next0 = IP4_MAP_NEXT_IP6_LOOKUP, next1 =
-	    IP4_MAP_NEXT_IP6_LOOKUP;
-
-	  /* Prefetch next iteration. */
-	  {
-	    vlib_buffer_t *p2, *p3;
-
-	    p2 = vlib_get_buffer (vm, from[2]);
-	    p3 = vlib_get_buffer (vm, from[3]);
-
-	    vlib_prefetch_buffer_header (p2, STORE);
-	    vlib_prefetch_buffer_header (p3, STORE);
-	    /* IPv4 + 8 = 28. possibly plus -40 */
-	    CLIB_PREFETCH (p2->data - 40, 68, STORE);
-	    CLIB_PREFETCH (p3->data - 40, 68, STORE);
-	  }
-
-	  pi0 = to_next[0] = from[0];
-	  pi1 = to_next[1] = from[1];
-	  from += 2;
-	  n_left_from -= 2;
-	  to_next += 2;
-	  n_left_to_next -= 2;
-
-	  p0 = vlib_get_buffer (vm, pi0);
-	  p1 = vlib_get_buffer (vm, pi1);
-	  ip40 = vlib_buffer_get_current (p0);
-	  ip41 = vlib_buffer_get_current (p1);
-	  d0 =
-	    ip4_map_get_domain (&ip40->dst_address, &map_domain_index0,
-				&error0);
-	  d1 =
-	    ip4_map_get_domain (&ip41->dst_address, &map_domain_index1,
-				&error1);
-
-	  /*
-	   * Shared IPv4 address
-	   */
-	  port0 = ip4_map_port_and_security_check (d0, ip40, &next0, &error0);
-	  port1 = ip4_map_port_and_security_check (d1, ip41, &next1, &error1);
-
-	  /* Decrement IPv4 TTL */
-	  ip4_map_decrement_ttl (ip40, &error0);
-	  ip4_map_decrement_ttl (ip41, &error1);
-	  bool df0 =
-	    ip40->flags_and_fragment_offset &
-	    clib_host_to_net_u16 (IP4_HEADER_FLAG_DONT_FRAGMENT);
-	  bool df1 =
-	    ip41->flags_and_fragment_offset &
-	    clib_host_to_net_u16 (IP4_HEADER_FLAG_DONT_FRAGMENT);
-
-	  /* MAP calc */
-	  u32 da40 = clib_net_to_host_u32 (ip40->dst_address.as_u32);
-	  u32 da41 = clib_net_to_host_u32 (ip41->dst_address.as_u32);
-	  u16 dp40 = clib_net_to_host_u16 (port0);
-	  u16 dp41 = clib_net_to_host_u16 (port1);
-	  u64 dal60 = map_get_pfx (d0, da40, dp40);
-	  u64 dal61 = map_get_pfx (d1, da41, dp41);
-	  u64 dar60 = map_get_sfx (d0, da40, dp40);
-	  u64 dar61 = map_get_sfx (d1, da41, dp41);
-	  if (dal60 == 0 && dar60 == 0 && error0 == MAP_ERROR_NONE
-	      && next0 != IP4_MAP_NEXT_REASS)
-	    error0 = MAP_ERROR_NO_BINDING;
-	  if (dal61 == 0 && dar61 == 0 && error1 == MAP_ERROR_NONE
-	      && next1 != IP4_MAP_NEXT_REASS)
-	    error1 = MAP_ERROR_NO_BINDING;
-
-	  /* construct ipv6 header */
-	  vlib_buffer_advance (p0, -sizeof (ip6_header_t));
-	  vlib_buffer_advance (p1, -sizeof (ip6_header_t));
-	  ip6h0 = vlib_buffer_get_current (p0);
-	  ip6h1 = vlib_buffer_get_current (p1);
-	  vnet_buffer (p0)->sw_if_index[VLIB_TX] = (u32) ~ 0;
-	  vnet_buffer (p1)->sw_if_index[VLIB_TX] = (u32) ~ 0;
-
-	  ip6h0->ip_version_traffic_class_and_flow_label =
-	    ip4_map_vtcfl (ip40, p0);
-	  ip6h1->ip_version_traffic_class_and_flow_label =
-	    ip4_map_vtcfl (ip41, p1);
-	  ip6h0->payload_length = ip40->length;
-	  ip6h1->payload_length = ip41->length;
-	  ip6h0->protocol = IP_PROTOCOL_IP_IN_IP;
-	  ip6h1->protocol = IP_PROTOCOL_IP_IN_IP;
-	  ip6h0->hop_limit = 0x40;
-	  ip6h1->hop_limit = 0x40;
-	  ip6h0->src_address = d0->ip6_src;
-	  ip6h1->src_address = d1->ip6_src;
-	  ip6h0->dst_address.as_u64[0] = clib_host_to_net_u64 (dal60);
-	  ip6h0->dst_address.as_u64[1] = clib_host_to_net_u64 (dar60);
-	  ip6h1->dst_address.as_u64[0] = clib_host_to_net_u64 (dal61);
-	  ip6h1->dst_address.as_u64[1] = clib_host_to_net_u64 (dar61);
-
-	  /*
-	   * Determine next node. Can be one of:
-	   * ip6-lookup, ip6-rewrite, ip4-fragment, ip4-virtreass, error-drop
-	   */
-	  if (PREDICT_TRUE (error0 == MAP_ERROR_NONE))
-	    {
-	      if (PREDICT_FALSE
-		  (d0->mtu
-		   && (clib_net_to_host_u16 (ip6h0->payload_length) +
-		       sizeof (*ip6h0) > d0->mtu)))
-		{
-		  next0 = ip4_map_fragment (p0, d0->mtu, df0, &error0);
-		}
-	      else
-		{
-		  next0 =
-		    ip4_map_ip6_lookup_bypass (p0,
-					       ip40) ?
-		    IP4_MAP_NEXT_IP6_REWRITE : next0;
-		  vlib_increment_combined_counter (cm + MAP_DOMAIN_COUNTER_TX,
-						   thread_index,
-						   map_domain_index0, 1,
-						   clib_net_to_host_u16
-						   (ip6h0->payload_length) +
-						   40);
-		}
-	    }
-	  else
-	    {
-	      next0 = IP4_MAP_NEXT_DROP;
-	    }
+	  next0 = ip4_map_fragment (p0, d0->mtu, df0, &error0);
+	}
+      else
+	{
+	  if (ip4_map_ip6_lookup_bypass (p0, ip40))
+	    next0 = IP4_MAP_NEXT_IP6_REWRITE;
+	  c->n_packets += 1;
+	  c->n_bytes += clib_net_to_host_u16 (ip6h0->payload_length) + 40;
+	}
+    }
+  else
+    {
+      next0 = IP4_MAP_NEXT_DROP;
+    }
 
-	  /*
-	   * Determine next node. Can be one of:
-	   * ip6-lookup, ip6-rewrite, ip4-fragment, ip4-virtreass, error-drop
-	   */
-	  if (PREDICT_TRUE (error1 == MAP_ERROR_NONE))
-	    {
-	      if (PREDICT_FALSE
-		  (d1->mtu
-		   && (clib_net_to_host_u16 (ip6h1->payload_length) +
-		       sizeof (*ip6h1) > d1->mtu)))
-		{
-		  next1 = ip4_map_fragment (p1, d1->mtu, df1, &error1);
-		}
-	      else
-		{
-		  next1 =
-		    ip4_map_ip6_lookup_bypass (p1,
-					       ip41) ?
-		    IP4_MAP_NEXT_IP6_REWRITE : next1;
-		  vlib_increment_combined_counter (cm + MAP_DOMAIN_COUNTER_TX,
-						   thread_index,
-						   map_domain_index1, 1,
-						   clib_net_to_host_u16
-						   (ip6h1->payload_length) +
-						   40);
-		}
-	    }
-	  else
-	    {
-	      next1 = IP4_MAP_NEXT_DROP;
-	    }
+  if (PREDICT_FALSE (p0->flags & VLIB_BUFFER_IS_TRACED))
+    {
+      map_trace_t *tr = vlib_add_trace (vm, node, p0, sizeof (*tr));
+      tr->map_domain_index = map_domain_index0;
+      tr->port = port0;
+    }
 
-	  if (PREDICT_FALSE (p0->flags & VLIB_BUFFER_IS_TRACED))
-	    {
-	      map_trace_t *tr = vlib_add_trace (vm, node, p0, sizeof (*tr));
-	      tr->map_domain_index = map_domain_index0;
-	      tr->port = port0;
-	    }
-	  if (PREDICT_FALSE (p1->flags & VLIB_BUFFER_IS_TRACED))
-	    {
-	      map_trace_t *tr = vlib_add_trace (vm, node, p1, sizeof (*tr));
-	      tr->map_domain_index = map_domain_index1;
-	      tr->port = port1;
-	    }
+  p0->error = error_node->errors[error0];
 
-	  p0->error = error_node->errors[error0];
-	  p1->error = error_node->errors[error1];
+  return next0;
+}
 
-	  vlib_validate_buffer_enqueue_x2 (vm, node, next_index, to_next,
-					   n_left_to_next, pi0, pi1, next0,
-					   next1);
-	}
+/*
+ * ip4_map
+ */
+static uword
+ip4_map (vlib_main_t * vm, vlib_node_runtime_t * node, vlib_frame_t * frame)
+{
+  u32 n_left_from, *from;
+  vlib_node_runtime_t *error_node =
+    vlib_node_get_runtime (vm, ip4_map_node.index);
+  vlib_buffer_t *bufs[VLIB_FRAME_SIZE], **b;
+  u16 nexts[VLIB_FRAME_SIZE], *next;
+  map_main_t *mm = &map_main;
+  u32 thread_index = vm->thread_index;
+  ip4_map_domain_cache_t c = { 0 };
 
-      while (n_left_from > 0 && n_left_to_next > 0)
-	{
-	  u32 pi0;
-	  vlib_buffer_t *p0;
-	  map_domain_t *d0;
-	  u8 error0 = MAP_ERROR_NONE;
-	  ip4_header_t *ip40;
-	  u16 port0 = 0;
-	  ip6_header_t *ip6h0;
-	  u32 next0 = IP4_MAP_NEXT_IP6_LOOKUP;
-	  u32 map_domain_index0 = ~0;
+  from = vlib_frame_vector_args (frame);
+  n_left_from = frame->n_vectors;
+  vlib_get_buffers (vm, from, bufs, n_left_from);
 
-	  pi0 = to_next[0] = from[0];
-	  from += 1;
-	  n_left_from -= 1;
-	  to_next += 1;
-	  n_left_to_next -= 1;
+  b = bufs;
+  next = nexts;
 
-	  p0 = vlib_get_buffer (vm, pi0);
-	  ip40 = vlib_buffer_get_current (p0);
+  /* Quad loop */
+  while (n_left_from >= 8)
+    {
+      /* Prefetch next iteration. */
+      vlib_prefetch_buffer_header (b[4], STORE);
+      vlib_prefetch_buffer_header (b[5], STORE);
+      vlib_prefetch_buffer_header (b[6], STORE);
+      vlib_prefetch_buffer_header (b[7], STORE);
+      /* IPv4 + 8 = 28. possibly plus -40 */
+      CLIB_PREFETCH (b[4]->data - 40, 68, STORE);
+      CLIB_PREFETCH (b[5]->data - 40, 68, STORE);
+      CLIB_PREFETCH (b[6]->data - 40, 68, STORE);
+      CLIB_PREFETCH (b[7]->data - 40, 68, STORE);
+
+      next[0] = ip4_map_one (vm, node, error_node, b[0], &c, thread_index);
+      next[1] = ip4_map_one (vm, node, error_node, b[1], &c, thread_index);
+      next[2] = ip4_map_one (vm, node, error_node, b[2], &c, thread_index);
+      next[3] = ip4_map_one (vm, node, error_node, b[3], &c, thread_index);
+
+      b += 4;
+      next += 4;
+      n_left_from -= 4;
+    }
 
-	  d0 =
-	    ip4_map_get_domain (&ip40->dst_address, &map_domain_index0,
-				&error0);
-	  if (!d0)
-	    {			/* Guess it wasn't for us */
-	      vnet_feature_next (&next0, p0);
-	      goto exit;
-	    }
+  while (n_left_from > 0)
+    {
+      next[0] = ip4_map_one (vm, node, error_node, b[0], &c, thread_index);
 
-	  /*
-	   * Shared IPv4 address
-	   */
-	  port0 = ip4_map_port_and_security_check (d0, ip40, &next0, &error0);
-
-	  /* Decrement IPv4 TTL */
-	  ip4_map_decrement_ttl (ip40, &error0);
-	  bool df0 =
-	    ip40->flags_and_fragment_offset &
-	    clib_host_to_net_u16 (IP4_HEADER_FLAG_DONT_FRAGMENT);
-
-	  /* MAP calc */
-	  u32 da40 = clib_net_to_host_u32 (ip40->dst_address.as_u32);
-	  u16 dp40 = clib_net_to_host_u16 (port0);
-	  u64 dal60 = map_get_pfx (d0, da40, dp40);
-	  u64 dar60 = map_get_sfx (d0, da40, dp40);
-	  if (dal60 == 0 && dar60 == 0 && error0 == MAP_ERROR_NONE
-	      && next0 != IP4_MAP_NEXT_REASS)
-	    error0 = MAP_ERROR_NO_BINDING;
-
-	  /* construct ipv6 header */
-	  vlib_buffer_advance (p0, -(sizeof (ip6_header_t)));
-	  ip6h0 = vlib_buffer_get_current (p0);
-	  vnet_buffer (p0)->sw_if_index[VLIB_TX] = (u32) ~ 0;
-
-	  ip6h0->ip_version_traffic_class_and_flow_label =
-	    ip4_map_vtcfl (ip40, p0);
-	  ip6h0->payload_length = ip40->length;
-	  ip6h0->protocol = IP_PROTOCOL_IP_IN_IP;
-	  ip6h0->hop_limit = 0x40;
-	  ip6h0->src_address = d0->ip6_src;
-	  ip6h0->dst_address.as_u64[0] = clib_host_to_net_u64 (dal60);
-	  ip6h0->dst_address.as_u64[1] = clib_host_to_net_u64 (dar60);
-
-	  /*
-	   * Determine next node. Can be one of:
-	   * ip6-lookup, ip6-rewrite, ip4-fragment, ip4-virtreass, error-drop
-	   */
-	  if (PREDICT_TRUE (error0 == MAP_ERROR_NONE))
-	    {
-	      if (PREDICT_FALSE
-		  (d0->mtu
-		   && (clib_net_to_host_u16 (ip6h0->payload_length) +
-		       sizeof (*ip6h0) > d0->mtu)))
-		{
-		  next0 = ip4_map_fragment (p0, d0->mtu, df0, &error0);
-		}
-	      else
-		{
-		  next0 =
-		    ip4_map_ip6_lookup_bypass (p0,
-					       ip40) ?
-		    IP4_MAP_NEXT_IP6_REWRITE : next0;
-		  vlib_increment_combined_counter (cm + MAP_DOMAIN_COUNTER_TX,
-						   thread_index,
-						   map_domain_index0, 1,
-						   clib_net_to_host_u16
-						   (ip6h0->payload_length) +
-						   40);
-		}
-	    }
-	  else
-	    {
-	      next0 = IP4_MAP_NEXT_DROP;
-	    }
+      b += 1;
+      next += 1;
+      n_left_from -= 1;
+    }
 
-	  if (PREDICT_FALSE (p0->flags & VLIB_BUFFER_IS_TRACED))
-	    {
-	      map_trace_t *tr = vlib_add_trace (vm, node, p0, sizeof (*tr));
-	      tr->map_domain_index = map_domain_index0;
-	      tr->port = port0;
-	    }
+  ip4_map_domain_cache_flush (&c, mm->domain_counters, thread_index);
 
-	  p0->error = error_node->errors[error0];
-	exit:
-	  vlib_validate_buffer_enqueue_x1 (vm, node, next_index, to_next,
-					   n_left_to_next, pi0, next0);
-	}
-      vlib_put_next_frame (vm, node, next_index, n_left_to_next);
-    }
+  vlib_buffer_enqueue_to_next (vm, node, from, nexts, frame->n_vectors);
 
   return frame->n_vectors;
 }
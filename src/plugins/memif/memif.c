@@ -185,7 +185,6 @@ memif_int_fd_read_ready (clib_file_t * uf)
 clib_error_t *
 memif_connect (memif_if_t * mif)
 {
-  vlib_main_t *vm = vlib_get_main ();
   vnet_main_t *vnm = vnet_get_main ();
   clib_file_t template = { 0 };
   memif_region_t *mr;
@@ -258,7 +257,8 @@ memif_connect (memif_if_t * mif)
       vnet_hw_interface_assign_rx_thread (vnm, mif->hw_if_index, i, ~0);
       ti = vnet_get_device_input_thread_index (vnm, mif->hw_if_index, i);
       mq->buffer_pool_index =
-	vlib_buffer_pool_get_default_for_numa (vm, vlib_mains[ti]->numa_node);
+	vnet_hw_interface_get_rx_buffer_pool (vnm, mif->hw_if_index, i,
+					      vlib_mains[ti]->numa_node);
       rv = vnet_hw_interface_set_rx_mode (vnm, mif->hw_if_index, i,
 					  VNET_HW_INTERFACE_RX_MODE_DEFAULT);
       if (rv)
@@ -983,6 +983,7 @@ memif_create_if (vlib_main_t * vm, memif_create_if_args_t * args)
 
   hw = vnet_get_hw_interface (vnm, mif->hw_if_index);
   hw->flags |= VNET_HW_INTERFACE_FLAG_SUPPORTS_INT_MODE;
+  hw->flags |= VNET_HW_INTERFACE_FLAG_SUPPORTS_RX_BUFFER_POOL;
   vnet_hw_interface_set_input_node (vnm, mif->hw_if_index,
 				    memif_input_node.index);
 
@@ -280,8 +280,8 @@ memif_device_input_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
 
   /* allocate free buffers */
   vec_validate_aligned (ptd->buffers, n_buffers - 1, CLIB_CACHE_LINE_BYTES);
-  n_alloc = vlib_buffer_alloc_from_pool (vm, ptd->buffers, n_buffers,
-					 mq->buffer_pool_index);
+  n_alloc = vlib_buffer_alloc_from_rx_pool (vm, ptd->buffers, n_buffers,
+					    mq->buffer_pool_index);
   if (PREDICT_FALSE (n_alloc != n_buffers))
     {
       if (n_alloc)
@@ -788,9 +788,10 @@ refill:
   clib_memset (dt, 0, sizeof (memif_desc_t));
   dt->length = buffer_length;
 
-  n_alloc = vlib_buffer_alloc_to_ring_from_pool (vm, mq->buffers, head & mask,
-						 ring_size, n_slots,
-						 mq->buffer_pool_index);
+  n_alloc = vlib_buffer_alloc_to_ring_from_rx_pool (vm, mq->buffers,
+						    head & mask, ring_size,
+						    n_slots,
+						    mq->buffer_pool_index);
 
   if (PREDICT_FALSE (n_alloc != n_slots))
     {
@@ -217,7 +217,8 @@ dslite_add_del_pool_addr (dslite_main_t * dm, ip4_address_t * addr, u8 is_add)
       vec_validate_init_empty (a->busy_##n##_ports_per_thread, tm->n_vlib_mains - 1, 0);
       foreach_snat_protocol
 #undef _
-	dslite_dpo_create (DPO_PROTO_IP4, 0, &dpo_v4);
+	snat_address_port_slices_init (a);
+      dslite_dpo_create (DPO_PROTO_IP4, 0, &dpo_v4);
       fib_table_entry_special_dpo_add (0, &pfx, FIB_SOURCE_PLUGIN_HI,
 				       FIB_ENTRY_FLAG_EXCLUSIVE, &dpo_v4);
       dpo_reset (&dpo_v4);
@@ -231,7 +232,8 @@ dslite_add_del_pool_addr (dslite_main_t * dm, ip4_address_t * addr, u8 is_add)
       vec_free (a->busy_##n##_ports_per_thread);
       foreach_snat_protocol
 #undef _
-	fib_table_entry_special_remove (0, &pfx, FIB_SOURCE_PLUGIN_HI);
+	snat_address_port_slices_free (a);
+      fib_table_entry_special_remove (0, &pfx, FIB_SOURCE_PLUGIN_HI);
       vec_del1 (dm->addr_pool, i);
     }
   return 0;
@@ -31,6 +31,7 @@
 #include <nat/nat_affinity.h>
 #include <nat/nat_syslog.h>
 #include <nat/nat_ha.h>
+#include <nat/nat_rss.h>
 #include <vnet/fib/fib_table.h>
 #include <vnet/fib/ip4_fib.h>
 
@@ -398,6 +399,7 @@ nat_session_alloc_or_recycle (snat_main_t * sm, snat_user_t * u,
     {
       pool_get (tsm->sessions, s);
       clib_memset (s, 0, sizeof (*s));
+      s->lru_index = s->timer_handle = ~0;
 
       /* Create list elts */
       pool_get (tsm->list_pool, per_user_translation_list_elt);
@@ -422,6 +424,60 @@ nat_session_alloc_or_recycle (snat_main_t * sm, snat_user_t * u,
   return s;
 }
 
+/*
+ * Expiry of endpoint-dependent sessions
+ *
+ * Each session sits on the per-thread LRU list and has a timer on the
+ * per-thread timer wheel. Packets only refresh last_heard and move the
+ * session to the LRU tail; when the timer fires, the session is either
+ * deleted or re-armed for the rest of its timeout. The LRU head is the
+ * first candidate to reclaim when the session table is full.
+ */
+static_always_inline u64
+nat44_ed_session_timer_ticks (f64 timeout)
+{
+  u64 ticks = (u64) (timeout / NAT44_ED_SESSION_TIMER_INTERVAL) + 1;
+
+  /* 3 wheels of 256 slots */
+  return clib_min (ticks, (1 << 24) - 1);
+}
+
+static void
+nat44_ed_session_link (snat_main_t * sm, snat_session_t * s,
+		       u32 thread_index)
+{
+  snat_main_per_thread_data_t *tsm = &sm->per_thread_data[thread_index];
+  dlist_elt_t *lru_elt;
+  u32 min_timeout;
+  u64 ticks;
+
+  if (s->lru_index == ~0)
+    {
+      pool_get (tsm->list_pool, lru_elt);
+      s->lru_index = lru_elt - tsm->list_pool;
+      clib_dlist_init (tsm->list_pool, s->lru_index);
+      lru_elt->value = s - tsm->sessions;
+    }
+  else
+    clib_dlist_remove (tsm->list_pool, s->lru_index);
+  clib_dlist_addtail (tsm->list_pool, tsm->lru_head_index, s->lru_index);
+
+  /*
+   * Protocol and state are not known yet, so fire after the shortest
+   * timeout; the expiry re-arms the timer for the rest of the real one.
+   */
+  min_timeout = clib_min (sm->udp_timeout, sm->tcp_transitory_timeout);
+  min_timeout = clib_min (min_timeout, sm->icmp_timeout);
+  ticks = nat44_ed_session_timer_ticks (min_timeout);
+  if (s->timer_handle == ~0)
+    s->timer_handle =
+      tw_timer_start_4t_3w_256sl (&tsm->session_timer_wheel,
+				  s - tsm->sessions, 0, ticks);
+  else
+    tw_timer_update_4t_3w_256sl (&tsm->session_timer_wheel,
+				 s->timer_handle, ticks);
+}
+
 snat_session_t *
 nat_ed_session_alloc (snat_main_t * sm, snat_user_t * u, u32 thread_index,
 		      f64 now)
@@ -477,6 +533,7 @@ nat_ed_session_alloc (snat_main_t * sm, snat_user_t * u, u32 thread_index,
 	alloc_new:
 	  pool_get (tsm->sessions, s);
 	  clib_memset (s, 0, sizeof (*s));
+	  s->lru_index = s->timer_handle = ~0;
 
 	  /* Create list elts */
 	  pool_get (tsm->list_pool, per_user_translation_list_elt);
@@ -496,11 +553,168 @@ nat_ed_session_alloc (snat_main_t * sm, snat_user_t * u, u32 thread_index,
 			       pool_elts (tsm->sessions));
     }
 
+  nat44_ed_session_link (sm, s, thread_index);
   s->ha_last_refreshed = now;
 
   return s;
 }
 
+void
+nat44_ed_session_timer_update (snat_main_t * sm, snat_session_t * s,
+			       u32 thread_index)
+{
+  snat_main_per_thread_data_t *tsm = &sm->per_thread_data[thread_index];
+
+  tw_timer_update_4t_3w_256sl (&tsm->session_timer_wheel, s->timer_handle,
+			       nat44_ed_session_timer_ticks
+			       (nat44_session_get_timeout (sm, s)));
+}
+
+void
+nat44_ed_session_unlink (snat_main_t * sm, snat_session_t * s,
+			 u32 thread_index)
+{
+  snat_main_per_thread_data_t *tsm = &sm->per_thread_data[thread_index];
+
+  if (s->timer_handle != ~0)
+    {
+      tw_timer_stop_4t_3w_256sl (&tsm->session_timer_wheel, s->timer_handle);
+      s->timer_handle = ~0;
+    }
+  clib_dlist_remove (tsm->list_pool, s->lru_index);
+  pool_put_index (tsm->list_pool, s->lru_index);
+  s->lru_index = ~0;
+}
+
+int
+nat44_ed_session_lru_reclaim (snat_main_t * sm, u32 thread_index, f64 now)
+{
+  snat_main_per_thread_data_t *tsm = &sm->per_thread_data[thread_index];
+  dlist_elt_t *head, *oldest;
+  snat_session_t *s;
+
+  if (tsm->lru_head_index == ~0)
+    return 0;
+
+  head = pool_elt_at_index (tsm->list_pool, tsm->lru_head_index);
+  if (head->next == tsm->lru_head_index)
+    return 0;
+
+  oldest = pool_elt_at_index (tsm->list_pool, head->next);
+  s = pool_elt_at_index (tsm->sessions, oldest->value);
+  if (now < s->last_heard + (f64) nat44_session_get_timeout (sm, s))
+    return 0;
+
+  nat_free_session_data (sm, s, thread_index, 0);
+  nat44_delete_session (sm, s, thread_index);
+  tsm->sessions_reclaimed++;
+  return 1;
+}
+
+static void
+nat44_ed_session_timers_init (snat_main_per_thread_data_t * tsm)
+{
+  dlist_elt_t *head;
+
+  pool_get (tsm->list_pool, head);
+  tsm->lru_head_index = head - tsm->list_pool;
+  clib_dlist_init (tsm->list_pool, tsm->lru_head_index);
+
+  tw_timer_wheel_init_4t_3w_256sl (&tsm->session_timer_wheel, 0,
+				   NAT44_ED_SESSION_TIMER_INTERVAL,
+				   NAT44_ED_SESSION_MAX_EXPIRATIONS);
+  tsm->session_timer_wheel.last_run_time =
+    vlib_time_now (vlib_get_main ());
+}
+
+/* per thread node expiring sessions, woken up by interrupt */
+static uword
+nat44_ed_session_expire_fn (vlib_main_t * vm, vlib_node_runtime_t * rt,
+			    vlib_frame_t * f)
+{
+  snat_main_t *sm = &snat_main;
+  u32 thread_index = vm->thread_index;
+  snat_main_per_thread_data_t *tsm = &sm->per_thread_data[thread_index];
+  f64 now = vlib_time_now (vm);
+  snat_session_t *s;
+  u32 *session_index;
+  f64 expire_time;
+
+  vec_reset_length (tsm->expired_sessions);
+  tsm->expired_sessions =
+    tw_timer_expire_timers_vec_4t_3w_256sl (&tsm->session_timer_wheel, now,
+					    tsm->expired_sessions);
+
+  vec_foreach (session_index, tsm->expired_sessions)
+  {
+    if (pool_is_free_index (tsm->sessions, session_index[0]))
+      continue;
+    s = pool_elt_at_index (tsm->sessions, session_index[0]);
+    s->timer_handle = ~0;
+
+    expire_time = s->last_heard + (f64) nat44_session_get_timeout (sm, s);
+    if (now < expire_time)
+      {
+	s->timer_handle =
+	  tw_timer_start_4t_3w_256sl (&tsm->session_timer_wheel,
+				      session_index[0], 0,
+				      nat44_ed_session_timer_ticks
+				      (expire_time - now));
+	continue;
+      }
+
+    nat_free_session_data (sm, s, thread_index, 0);
+    nat44_delete_session (sm, s, thread_index);
+    tsm->sessions_expired++;
+  }
+
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (nat44_ed_session_expire_node) = {
+    .function = nat44_ed_session_expire_fn,
+    .type = VLIB_NODE_TYPE_INPUT,
+    .state = VLIB_NODE_STATE_INTERRUPT,
+    .name = "nat44-ed-session-expire",
+};
+/* *INDENT-ON* */
+
+/* periodically send interrupt to each thread with sessions */
+static uword
+nat44_ed_session_expire_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
+				 vlib_frame_t * f)
+{
+  snat_main_t *sm = &snat_main;
+  snat_main_per_thread_data_t *tsm;
+  u32 ti;
+
+  while (1)
+    {
+      vlib_process_suspend (vm, NAT44_ED_SESSION_EXPIRE_PERIOD);
+      if (!sm->endpoint_dependent)
+	continue;
+      for (ti = 0; ti < vec_len (vlib_mains); ti++)
+	{
+	  tsm = vec_elt_at_index (sm->per_thread_data, ti);
+	  if (!pool_elts (tsm->sessions))
+	    continue;
+	  vlib_node_set_interrupt_pending (vlib_mains[ti],
+					   nat44_ed_session_expire_node.index);
+	}
+    }
+
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (nat44_ed_session_expire_process_node) = {
+    .function = nat44_ed_session_expire_process,
+    .type = VLIB_NODE_TYPE_PROCESS,
+    .name = "nat44-ed-session-expire-process",
+};
+/* *INDENT-ON* */
+
 void
 snat_add_del_addr_to_fib (ip4_address_t * addr, u8 p_len, u32 sw_if_index,
 			  int is_add)
@@ -568,7 +782,8 @@ snat_add_address (snat_main_t * sm, ip4_address_t * addr, u32 vrf_id,
   vec_validate_init_empty (ap->busy_##n##_ports_per_thread, tm->n_vlib_mains - 1, 0);
   foreach_snat_protocol
 #undef _
-    if (twice_nat)
+    snat_address_port_slices_init (ap);
+  if (twice_nat)
     return 0;
 
   /* Add external address to FIB */
@@ -665,6 +880,93 @@ get_thread_idx_by_port (u16 e_port)
   return thread_idx;
 }
 
+/* Sessions of a static mapping to delete, see
+   nat44_static_mapping_flush_sessions */
+typedef struct
+{
+  ip4_address_t l_addr;
+  ip4_address_t e_addr;
+  u32 fib_index;
+  u16 l_port;
+  u16 e_port;
+  u8 addr_only;
+  u8 is_add;
+} nat44_static_mapping_flush_args_t;
+
+/*
+ * Run by the thread owning the sessions of the mapping local address,
+ * after the mapping was added (dynamic sessions overridden by the mapping)
+ * or deleted (static sessions of the mapping).
+ */
+static void
+nat44_static_mapping_flush_sessions (vlib_main_t * vm, void *data)
+{
+  nat44_static_mapping_flush_args_t *a = data;
+  snat_main_t *sm = &snat_main;
+  u32 thread_index = vm->thread_index;
+  snat_main_per_thread_data_t *tsm =
+    vec_elt_at_index (sm->per_thread_data, thread_index);
+  snat_user_key_t u_key;
+  clib_bihash_kv_8_8_t kv, value;
+  snat_user_t *u;
+  dlist_elt_t *head, *elt;
+  u32 elt_index, head_index, ses_index;
+  snat_session_t *s;
+
+  u_key.addr = a->l_addr;
+  u_key.fib_index = a->fib_index;
+  kv.key = u_key.as_u64;
+  if (clib_bihash_search_8_8 (&tsm->user_hash, &kv, &value))
+    return;
+
+  u = pool_elt_at_index (tsm->users, value.value);
+  if (!(a->is_add ? u->nsessions : u->nstaticsessions))
+    return;
+
+  head_index = u->sessions_per_user_list_head_index;
+  head = pool_elt_at_index (tsm->list_pool, head_index);
+  elt_index = head->next;
+  elt = pool_elt_at_index (tsm->list_pool, elt_index);
+  ses_index = elt->value;
+  while (ses_index != ~0)
+    {
+      s = pool_elt_at_index (tsm->sessions, ses_index);
+      elt = pool_elt_at_index (tsm->list_pool, elt->next);
+      ses_index = elt->value;
+
+      if (a->is_add)
+	{
+	  if (snat_is_session_static (s))
+	    continue;
+
+	  if (!a->addr_only
+	      && (clib_net_to_host_u16 (s->in2out.port) != a->l_port))
+	    continue;
+	}
+      else
+	{
+	  if (!a->addr_only)
+	    {
+	      if ((s->out2in.addr.as_u32 != a->e_addr.as_u32) ||
+		  (clib_net_to_host_u16 (s->out2in.port) != a->e_port))
+		continue;
+	    }
+
+	  if (is_lb_session (s))
+	    continue;
+
+	  if (!snat_is_session_static (s))
+	    continue;
+	}
+
+      nat_free_session_data (sm, s, thread_index, 0);
+      nat44_delete_session (sm, s, thread_index);
+
+      if (!a->addr_only && !sm->endpoint_dependent)
+	break;
+    }
+}
+
 int
 snat_add_static_mapping (ip4_address_t l_addr, ip4_address_t e_addr,
 			 u16 l_port, u16 e_port, u32 vrf_id, int addr_only,
@@ -681,13 +983,7 @@ snat_add_static_mapping (ip4_address_t l_addr, ip4_address_t e_addr,
   snat_interface_t *interface;
   int i;
   snat_main_per_thread_data_t *tsm;
-  snat_user_key_t u_key;
-  snat_user_t *u;
-  dlist_elt_t *head, *elt;
-  u32 elt_index, head_index;
-  u32 ses_index;
-  u64 user_index;
-  snat_session_t *s;
+  nat44_static_mapping_flush_args_t flush = { 0 };
   snat_static_map_resolve_t *rp, *rp_match = 0;
   nat44_lb_addr_port_t *local;
   u32 find = ~0;
@@ -950,43 +1246,14 @@ snat_add_static_mapping (ip4_address_t l_addr, ip4_address_t e_addr,
       /* Delete dynamic sessions matching local address (+ local port) */
       if (!(sm->static_mapping_only))
 	{
-	  u_key.addr = m->local_addr;
-	  u_key.fib_index = m->fib_index;
-	  kv.key = u_key.as_u64;
-	  if (!clib_bihash_search_8_8 (&tsm->user_hash, &kv, &value))
-	    {
-	      user_index = value.value;
-	      u = pool_elt_at_index (tsm->users, user_index);
-	      if (u->nsessions)
-		{
-		  head_index = u->sessions_per_user_list_head_index;
-		  head = pool_elt_at_index (tsm->list_pool, head_index);
-		  elt_index = head->next;
-		  elt = pool_elt_at_index (tsm->list_pool, elt_index);
-		  ses_index = elt->value;
-		  while (ses_index != ~0)
-		    {
-		      s = pool_elt_at_index (tsm->sessions, ses_index);
-		      elt = pool_elt_at_index (tsm->list_pool, elt->next);
-		      ses_index = elt->value;
-
-		      if (snat_is_session_static (s))
-			continue;
-
-		      if (!addr_only
-			  && (clib_net_to_host_u16 (s->in2out.port) !=
-			      m->local_port))
-			continue;
-
-		      nat_free_session_data (sm, s,
-					     tsm - sm->per_thread_data, 0);
-		      nat44_delete_session (sm, s, tsm - sm->per_thread_data);
-
-		      if (!addr_only && !sm->endpoint_dependent)
-			break;
-		    }
-		}
-	    }
+	  flush.l_addr = m->local_addr;
+	  flush.l_port = m->local_port;
+	  flush.fib_index = m->fib_index;
+	  flush.addr_only = addr_only;
+	  flush.is_add = 1;
+	  vlib_worker_rpc_call (tsm - sm->per_thread_data,
+				nat44_static_mapping_flush_sessions,
+				&flush, sizeof (flush));
 	}
     }
   else
@@ -1038,6 +1305,7 @@ snat_add_static_mapping (ip4_address_t l_addr, ip4_address_t e_addr,
                         { \
                           a->busy_##n##_ports--; \
                           a->busy_##n##_ports_per_thread[get_thread_idx_by_port(e_port)]--; \
+                          snat_address_port_slice_put (a->n##_port_slices, ~0, e_port); \
                         } \
                       break;
 		      foreach_snat_protocol
@@ -1068,49 +1336,15 @@ snat_add_static_mapping (ip4_address_t l_addr, ip4_address_t e_addr,
       if (!(sm->static_mapping_only) ||
 	  (sm->static_mapping_only && sm->static_mapping_connection_tracking))
 	{
-	  u_key.addr = m->local_addr;
-	  u_key.fib_index = fib_index;
-	  kv.key = u_key.as_u64;
-	  if (!clib_bihash_search_8_8 (&tsm->user_hash, &kv, &value))
-	    {
-	      user_index = value.value;
-	      u = pool_elt_at_index (tsm->users, user_index);
-	      if (u->nstaticsessions)
-		{
-		  head_index = u->sessions_per_user_list_head_index;
-		  head = pool_elt_at_index (tsm->list_pool, head_index);
-		  elt_index = head->next;
-		  elt = pool_elt_at_index (tsm->list_pool, elt_index);
-		  ses_index = elt->value;
-		  while (ses_index != ~0)
-		    {
-		      s = pool_elt_at_index (tsm->sessions, ses_index);
-		      elt = pool_elt_at_index (tsm->list_pool, elt->next);
-		      ses_index = elt->value;
-
-		      if (!addr_only)
-			{
-			  if ((s->out2in.addr.as_u32 != e_addr.as_u32) ||
-			      (clib_net_to_host_u16 (s->out2in.port) !=
-			       e_port))
-			    continue;
-			}
-
-		      if (is_lb_session (s))
-			continue;
-
-		      if (!snat_is_session_static (s))
-			continue;
-
-		      nat_free_session_data (sm, s,
-					     tsm - sm->per_thread_data, 0);
-		      nat44_delete_session (sm, s, tsm - sm->per_thread_data);
-
-		      if (!addr_only && !sm->endpoint_dependent)
-			break;
-		    }
-		}
-	    }
+	  flush.l_addr = m->local_addr;
+	  flush.e_addr = e_addr;
+	  flush.e_port = e_port;
+	  flush.fib_index = fib_index;
+	  flush.addr_only = addr_only;
+	  flush.is_add = 0;
+	  vlib_worker_rpc_call (tsm - sm->per_thread_data,
+				nat44_static_mapping_flush_sessions,
+				&flush, sizeof (flush));
 	}
 
       fib_table_unlock (fib_index, FIB_PROTOCOL_IP4, FIB_SOURCE_PLUGIN_LOW);
@@ -1332,6 +1566,7 @@ nat44_add_del_lb_static_mapping (ip4_address_t e_addr, u16 e_port,
                         { \
                           a->busy_##n##_ports--; \
                           a->busy_##n##_ports_per_thread[get_thread_idx_by_port(e_port)]--; \
+                          snat_address_port_slice_put (a->n##_port_slices, ~0, e_port); \
                         } \
                       break;
 		      foreach_snat_protocol
@@ -1697,7 +1932,8 @@ snat_del_address (snat_main_t * sm, ip4_address_t addr, u8 delete_sm,
   vec_free (a->busy_##n##_ports_per_thread);
   foreach_snat_protocol
 #undef _
-    if (twice_nat)
+    snat_address_port_slices_free (a);
+  if (twice_nat)
     {
       vec_del1 (sm->twice_nat_addresses, i);
       return 0;
@@ -1769,12 +2005,24 @@ snat_interface_add_del (u32 sw_if_index, u8 is_inside, int is_del)
     }
 
   if (sm->fq_in2out_index == ~0 && !sm->deterministic && sm->num_workers > 1)
-    sm->fq_in2out_index = vlib_frame_queue_main_init (sm->in2out_node_index,
-						      NAT_FQ_NELTS);
+    {
+      sm->fq_in2out_index =
+	vlib_frame_queue_main_init (sm->in2out_node_index, NAT_FQ_NELTS);
+      sm->in2out_handoff_next =
+	vlib_node_add_next (sm->vlib_main,
+			    snat_in2out_worker_handoff_node.index,
+			    sm->in2out_node_index);
+    }
 
   if (sm->fq_out2in_index == ~0 && !sm->deterministic && sm->num_workers > 1)
-    sm->fq_out2in_index = vlib_frame_queue_main_init (sm->out2in_node_index,
-						      NAT_FQ_NELTS);
+    {
+      sm->fq_out2in_index =
+	vlib_frame_queue_main_init (sm->out2in_node_index, NAT_FQ_NELTS);
+      sm->out2in_handoff_next =
+	vlib_node_add_next (sm->vlib_main,
+			    snat_out2in_worker_handoff_node.index,
+			    sm->out2in_node_index);
+    }
 
   if (!is_inside)
     {
@@ -2078,12 +2326,24 @@ feature_set:
 
 fq:
   if (sm->fq_in2out_output_index == ~0 && sm->num_workers > 1)
-    sm->fq_in2out_output_index =
-      vlib_frame_queue_main_init (sm->in2out_output_node_index, 0);
+    {
+      sm->fq_in2out_output_index =
+	vlib_frame_queue_main_init (sm->in2out_output_node_index, 0);
+      sm->in2out_output_handoff_next =
+	vlib_node_add_next (sm->vlib_main,
+			    snat_in2out_output_worker_handoff_node.index,
+			    sm->in2out_output_node_index);
+    }
 
   if (sm->fq_out2in_index == ~0 && sm->num_workers > 1)
-    sm->fq_out2in_index =
-      vlib_frame_queue_main_init (sm->out2in_node_index, 0);
+    {
+      sm->fq_out2in_index =
+	vlib_frame_queue_main_init (sm->out2in_node_index, 0);
+      sm->out2in_handoff_next =
+	vlib_node_add_next (sm->vlib_main,
+			    snat_out2in_worker_handoff_node.index,
+			    sm->out2in_node_index);
+    }
 
   /* *INDENT-OFF* */
   pool_foreach (i, sm->output_feature_interfaces,
@@ -2279,6 +2539,7 @@ snat_init (vlib_main_t * vm)
   sm->forwarding_enabled = 0;
   sm->log_class = vlib_log_register_class ("nat", 0);
   sm->mss_clamping = 0;
+  nat_rss_main.sw_if_index = ~0;
 
   node = vlib_get_node_by_name (vm, (u8 *) "error-drop");
   sm->error_node_index = node->index;
@@ -2347,6 +2608,8 @@ snat_init (vlib_main_t * vm)
     }
 
   vec_validate (sm->per_thread_data, tm->n_vlib_mains - 1);
+  for (i = 0; i < vec_len (sm->per_thread_data); i++)
+    sm->per_thread_data[i].port_alloc_seed = random_default_seed () ^ i;
 
   /* Use all available workers by default */
   if (sm->num_workers > 1)
@@ -2411,6 +2674,67 @@ snat_init (vlib_main_t * vm)
 
 VLIB_INIT_FUNCTION (snat_init);
 
+void
+snat_address_port_slices_init (snat_address_t * a)
+{
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+
+#define _(N, i, n, s) \
+  a->n##_port_slices = 0; \
+  vec_validate (a->n##_port_slices, tm->n_vlib_mains - 1);
+  foreach_snat_protocol
+#undef _
+}
+
+void
+snat_address_port_slices_free (snat_address_t * a)
+{
+  snat_port_slice_t *ps;
+
+#define _(N, i, n, s) \
+  vec_foreach (ps, a->n##_port_slices) \
+    vec_free (ps->free_ports); \
+  vec_free (a->n##_port_slices);
+  foreach_snat_protocol
+#undef _
+}
+
+/*
+ * Count the freed port in the slice it belongs to, and give it back to
+ * the slice when that is the slice of the freeing thread. Anything else
+ * is picked up by the next refill of the slice from the busy port bitmap.
+ * Other threads free ports of the slice too, so the count is atomic.
+ */
+void
+snat_address_port_slice_put (snat_port_slice_t * slices, u32 thread_index,
+			     u16 port)
+{
+  snat_main_t *sm = &snat_main;
+  snat_port_slice_t *ps;
+  u32 slice;
+
+  if (port < 1025)
+    return;
+
+  slice = (port - 1025) / sm->port_per_thread;
+  if (slice >= vec_len (slices))
+    return;
+
+  ps = vec_elt_at_index (slices, slice);
+  clib_atomic_fetch_add (&ps->n_freed, 1);
+
+  if (sm->addr_and_port_alloc_alg != NAT_ADDR_AND_PORT_ALLOC_ALG_DEFAULT
+      || thread_index >= vec_len (sm->per_thread_data)
+      || slice != sm->per_thread_data[thread_index].snat_thread_index)
+    return;
+
+  if (vec_len (ps->free_ports) == 0
+      || vec_len (ps->free_ports) >= NAT_PORT_SLICE_BATCH)
+    return;
+
+  vec_add1 (ps->free_ports, port);
+}
+
 void
 snat_free_outside_address_and_port (snat_address_t * addresses,
 				    u32 thread_index, snat_session_key_t * k)
@@ -2440,6 +2764,8 @@ snat_free_outside_address_and_port (snat_address_t * addresses,
         port_host_byte_order, 0); \
       a->busy_##n##_ports--; \
       a->busy_##n##_ports_per_thread[thread_index]--; \
+      snat_address_port_slice_put (a->n##_port_slices, thread_index, \
+                                   port_host_byte_order); \
       break;
       foreach_snat_protocol
 #undef _
@@ -2644,17 +2970,107 @@ snat_alloc_outside_address_and_port (snat_address_t * addresses,
 				  port_per_thread, snat_thread_index);
 }
 
-static int
-nat_alloc_addr_and_port_default (snat_address_t * addresses,
-				 u32 fib_index,
-				 u32 thread_index,
-				 snat_session_key_t * k,
-				 u16 port_per_thread, u32 snat_thread_index)
+/*
+ * Take a random free port of the slice of the NAT thread. Up to
+ * NAT_PORT_SLICE_BATCH free ports are cached unordered, so taking any one
+ * of them is a swap with the last. The busy port bitmap stays
+ * authoritative: ports taken meanwhile by static mappings or other paths
+ * are dropped on the way, and the cache gets refilled from the bitmap,
+ * starting at a random port of the slice, once it runs empty. A refill
+ * which finds the slice full is not repeated until a port of it is
+ * freed, so allocation failure stays O(1) no matter how many ports of the
+ * slice are in use.
+ */
+static_always_inline int
+nat_port_slice_get (snat_main_per_thread_data_t * tsm,
+		    snat_port_slice_t * slices, uword * busy_port_bitmap,
+		    u16 port_per_thread, u32 snat_thread_index,
+		    ip4_address_t * addr, nat_rss_ctx_t * rss, u32 * port)
+{
+  snat_port_slice_t *ps;
+  u32 first = port_per_thread * snat_thread_index + 1025;
+  u32 last = first + port_per_thread - 1;
+  u32 i, j, n, tries = 0;
+  u16 p;
+
+  if (PREDICT_FALSE (snat_thread_index >= vec_len (slices)))
+    return 1;
+
+  ps = vec_elt_at_index (slices, snat_thread_index);
+  while (1)
+    {
+      n = vec_len (ps->free_ports);
+      if (PREDICT_FALSE (n == 0))
+	{
+	  /* nothing was freed since the last refill found the slice full */
+	  if (ps->is_full && ps->n_freed == 0)
+	    return 1;
+	  tsm->port_alloc_refills++;
+	  /* ports freed from now on are seen by the next refill */
+	  clib_atomic_swap_acq_n (&ps->n_freed, 0);
+	  i = random_u32 (&tsm->port_alloc_seed) % port_per_thread;
+	  for (j = 0; j < port_per_thread && n < NAT_PORT_SLICE_BATCH; j++)
+	    {
+	      p = first + (i + j) % port_per_thread;
+	      if (!clib_bitmap_get_no_check (busy_port_bitmap, p))
+		{
+		  vec_add1 (ps->free_ports, p);
+		  n++;
+		}
+	    }
+	  ps->is_full = n == 0;
+	  if (n == 0)
+	    return 1;
+	}
+
+      i = random_u32 (&tsm->port_alloc_seed) % n;
+      p = ps->free_ports[i];
+
+      if (PREDICT_FALSE (p < first || p > last ||
+			 clib_bitmap_get_no_check (busy_port_bitmap, p)))
+	{
+	  ps->free_ports[i] = ps->free_ports[n - 1];
+	  _vec_len (ps->free_ports) = n - 1;
+	  tsm->port_alloc_stale++;
+	  continue;
+	}
+
+      /* prefer ports whose return traffic is received by this thread */
+      if (rss)
+	{
+	  if (nat_rss_thread_index (&nat_rss_main, rss->remote_hash, addr, p)
+	      == rss->thread_index)
+	    tsm->rss_port_matches++;
+	  else if (++tries < NAT_RSS_MAX_TRIES && tries < n)
+	    continue;
+	  else
+	    tsm->rss_port_fallbacks++;
+	}
+
+      ps->free_ports[i] = ps->free_ports[n - 1];
+      _vec_len (ps->free_ports) = n - 1;
+      *port = p;
+      return 0;
+    }
+}
+
+static_always_inline int
+nat_alloc_addr_and_port_default_inline (snat_address_t * addresses,
+					u32 fib_index,
+					u32 thread_index,
+					snat_session_key_t * k,
+					u16 port_per_thread,
+					u32 snat_thread_index,
+					nat_rss_ctx_t * rss)
 {
+  snat_main_t *sm = &snat_main;
+  snat_main_per_thread_data_t *tsm = &sm->per_thread_data[thread_index];
   int i;
   snat_address_t *a, *ga = 0;
   u32 portnum;
 
+  tsm->port_alloc_attempts++;
+
   for (i = 0; i < vec_len (addresses); i++)
     {
       a = addresses + i;
@@ -2666,20 +3082,18 @@ nat_alloc_addr_and_port_default (snat_address_t * addresses,
             { \
               if (a->fib_index == fib_index) \
                 { \
-                  while (1) \
-                    { \
-                      portnum = (port_per_thread * \
-                        snat_thread_index) + \
-                        snat_random_port(1, port_per_thread) + 1024; \
-                      if (clib_bitmap_get_no_check (a->busy_##n##_port_bitmap, portnum)) \
-                        continue; \
-                      clib_bitmap_set_no_check (a->busy_##n##_port_bitmap, portnum, 1); \
-                      a->busy_##n##_ports_per_thread[thread_index]++; \
-                      a->busy_##n##_ports++; \
-                      k->addr = a->addr; \
-                      k->port = clib_host_to_net_u16(portnum); \
-                      return 0; \
-                    } \
+                  if (nat_port_slice_get (tsm, a->n##_port_slices, \
+                                          a->busy_##n##_port_bitmap, \
+                                          port_per_thread, \
+                                          snat_thread_index, &a->addr, \
+                                          rss, &portnum)) \
+                    break; \
+                  clib_bitmap_set_no_check (a->busy_##n##_port_bitmap, portnum, 1); \
+                  a->busy_##n##_ports_per_thread[thread_index]++; \
+                  a->busy_##n##_ports++; \
+                  k->addr = a->addr; \
+                  k->port = clib_host_to_net_u16(portnum); \
+                  return 0; \
                 } \
               else if (a->fib_index == ~0) \
                 { \
@@ -2703,21 +3117,17 @@ nat_alloc_addr_and_port_default (snat_address_t * addresses,
 	{
 #define _(N, j, n, s) \
         case SNAT_PROTOCOL_##N: \
-          while (1) \
-            { \
-              portnum = (port_per_thread * \
-                snat_thread_index) + \
-                snat_random_port(1, port_per_thread) + 1024; \
-              if (clib_bitmap_get_no_check (a->busy_##n##_port_bitmap, portnum)) \
-                continue; \
-              clib_bitmap_set_no_check (a->busy_##n##_port_bitmap, portnum, 1); \
-              a->busy_##n##_ports_per_thread[thread_index]++; \
-              a->busy_##n##_ports++; \
-              k->addr = a->addr; \
-              k->port = clib_host_to_net_u16(portnum); \
-              return 0; \
-            }
-	  break;
+          if (nat_port_slice_get (tsm, a->n##_port_slices, \
+                                  a->busy_##n##_port_bitmap, \
+                                  port_per_thread, snat_thread_index, \
+                                  &a->addr, rss, &portnum)) \
+            break; \
+          clib_bitmap_set_no_check (a->busy_##n##_port_bitmap, portnum, 1); \
+          a->busy_##n##_ports_per_thread[thread_index]++; \
+          a->busy_##n##_ports++; \
+          k->addr = a->addr; \
+          k->port = clib_host_to_net_u16(portnum); \
+          return 0;
 	  foreach_snat_protocol
 #undef _
 	default:
@@ -2727,10 +3137,54 @@ nat_alloc_addr_and_port_default (snat_address_t * addresses,
     }
 
   /* Totally out of translations to use... */
+  tsm->port_alloc_failures++;
   snat_ipfix_logging_addresses_exhausted (thread_index, 0);
   return 1;
 }
 
+static int
+nat_alloc_addr_and_port_default (snat_address_t * addresses,
+				 u32 fib_index,
+				 u32 thread_index,
+				 snat_session_key_t * k,
+				 u16 port_per_thread, u32 snat_thread_index)
+{
+  return nat_alloc_addr_and_port_default_inline (addresses, fib_index,
+						 thread_index, k,
+						 port_per_thread,
+						 snat_thread_index, 0);
+}
+
+int
+snat_alloc_outside_address_and_port_rss (snat_address_t * addresses,
+					 u32 fib_index,
+					 u32 thread_index,
+					 snat_session_key_t * k,
+					 u16 port_per_thread,
+					 u32 snat_thread_index,
+					 ip4_address_t * r_addr, u16 r_port)
+{
+  snat_main_t *sm = &snat_main;
+  nat_rss_main_t *rm = &nat_rss_main;
+  nat_rss_ctx_t rss;
+
+  if (!rm->enabled || k->protocol == SNAT_PROTOCOL_ICMP ||
+      sm->addr_and_port_alloc_alg != NAT_ADDR_AND_PORT_ALLOC_ALG_DEFAULT ||
+      !clib_bitmap_get (rm->threads, thread_index))
+    return snat_alloc_outside_address_and_port (addresses, fib_index,
+						thread_index, k,
+						port_per_thread,
+						snat_thread_index);
+
+  rss.remote_hash = nat_rss_remote_hash (rm, r_addr, r_port);
+  rss.thread_index = thread_index;
+
+  return nat_alloc_addr_and_port_default_inline (addresses, fib_index,
+						 thread_index, k,
+						 port_per_thread,
+						 snat_thread_index, &rss);
+}
+
 static int
 nat_alloc_addr_and_port_mape (snat_address_t * addresses,
 			      u32 fib_index,
@@ -3644,8 +4098,10 @@ snat_config (vlib_main_t * vm, unformat_input_t * input)
           /* *INDENT-OFF* */
           vec_foreach (tsm, sm->per_thread_data)
             {
+              tsm->lru_head_index = ~0;
               if (sm->endpoint_dependent)
                 {
+                  nat44_ed_session_timers_init (tsm);
                   clib_bihash_init_16_8 (&tsm->in2out_ed, "in2out-ed",
                                          translation_buckets,
                                          translation_memory_size);
@@ -27,6 +27,7 @@
 #include <vppinfra/bihash_16_8.h>
 #include <vppinfra/dlist.h>
 #include <vppinfra/error.h>
+#include <vppinfra/tw_timer_4t_3w_256sl.h>
 #include <vlibapi/api.h>
 #include <vlib/log.h>
 
@@ -36,6 +37,12 @@
 #define SNAT_TCP_ESTABLISHED_TIMEOUT 7440
 #define SNAT_ICMP_TIMEOUT 60
 
+/* endpoint-dependent session timer wheel tick (seconds) */
+#define NAT44_ED_SESSION_TIMER_INTERVAL 1.0
+/* how often the workers expire sessions (seconds) and how many at most */
+#define NAT44_ED_SESSION_EXPIRE_PERIOD 0.1
+#define NAT44_ED_SESSION_MAX_EXPIRATIONS 8192
+
 /* number of worker handoff frame queue elements */
 #define NAT_FQ_NELTS 64
 
@@ -228,6 +235,10 @@ typedef CLIB_PACKED(struct
 
   /* user index */
   u32 user_index;
+
+  /* Per-thread LRU list element and expiry timer (endpoint-dependent) */
+  u32 lru_index;
+  u32 timer_handle;
 }) snat_session_t;
 /* *INDENT-ON* */
 
@@ -241,6 +252,21 @@ typedef struct
   u32 nstaticsessions;
 } snat_user_t;
 
+/* Free ports of one thread's slice of an outside address */
+typedef struct
+{
+  /* unordered, up to NAT_PORT_SLICE_BATCH refilled from the busy port
+     bitmap when empty, only touched by the thread owning the slice */
+  u16 *free_ports;
+  /* the last refill found no free port in the whole slice */
+  u8 is_full;
+  /* ports of the slice freed by any thread since the last refill */
+  volatile u32 n_freed;
+} snat_port_slice_t;
+
+/* Free ports cached per slice, the busy port bitmap tracks the rest */
+#define NAT_PORT_SLICE_BATCH 256
+
 typedef struct
 {
   ip4_address_t addr;
@@ -249,7 +275,8 @@ typedef struct
 #define _(N, i, n, s) \
   u16 busy_##n##_ports; \
   u16 * busy_##n##_ports_per_thread; \
-  uword * busy_##n##_port_bitmap;
+  uword * busy_##n##_port_bitmap; \
+  snat_port_slice_t * n##_port_slices;
   foreach_snat_protocol
 #undef _
 /* *INDENT-ON* */
@@ -401,8 +428,31 @@ typedef struct
   /* Pool of doubly-linked list elements */
   dlist_elt_t *list_pool;
 
+  /* Endpoint-dependent sessions, least recently used first */
+  u32 lru_head_index;
+
+  /* Endpoint-dependent session expiry */
+  tw_timer_wheel_4t_3w_256sl_t session_timer_wheel;
+  u32 *expired_sessions;
+  u64 sessions_expired;
+  u64 sessions_reclaimed;
+
   /* NAT thread index */
   u32 snat_thread_index;
+
+  /* Outside port allocation */
+  u32 port_alloc_seed;
+  u64 port_alloc_attempts;
+  u64 port_alloc_failures;
+  u64 port_alloc_refills;
+  u64 port_alloc_stale;
+
+  /* RSS-aware outside port selection */
+  u64 rss_port_matches;
+  u64 rss_port_fallbacks;
+
+  /* out2in packets the handoff node found on their owner thread */
+  u64 out2in_handoffs_avoided;
 } snat_main_per_thread_data_t;
 
 struct snat_main_s;
@@ -496,6 +546,12 @@ typedef struct snat_main_s
   u32 fq_in2out_output_index;
   u32 fq_out2in_index;
 
+  /* Handoff node next index of the node fed by its frame-queue, for
+     packets staying on the current thread */
+  u32 in2out_handoff_next;
+  u32 in2out_output_handoff_next;
+  u32 out2in_handoff_next;
+
   /* node indexes */
   u32 error_node_index;
 
@@ -1014,6 +1070,39 @@ snat_session_t *nat_session_alloc_or_recycle (snat_main_t * sm,
 snat_session_t *nat_ed_session_alloc (snat_main_t * sm, snat_user_t * u,
 				      u32 thread_index, f64 now);
 
+/**
+ * @brief Re-arm endpoint-dependent session expiry timer
+ *
+ * Called when the session timeout got shorter, e.g. TCP session closing.
+ *
+ * @param s            NAT session
+ * @param thread_index thread index
+ */
+void nat44_ed_session_timer_update (snat_main_t * sm, snat_session_t * s,
+				    u32 thread_index);
+
+/**
+ * @brief Stop endpoint-dependent session expiry timer and remove session
+ *        from the per-thread LRU list
+ *
+ * @param s            NAT session
+ * @param thread_index thread index
+ */
+void nat44_ed_session_unlink (snat_main_t * sm, snat_session_t * s,
+			      u32 thread_index);
+
+/**
+ * @brief Free the least recently used endpoint-dependent session if it
+ *        timed out
+ *
+ * @param thread_index thread index
+ * @param now          current time
+ *
+ * @return 1 if a session was freed otherwise 0
+ */
+int nat44_ed_session_lru_reclaim (snat_main_t * sm, u32 thread_index,
+				  f64 now);
+
 /**
  * @brief Set address and port assignment algorithm for MAP-E CE
  *
@@ -1067,6 +1156,57 @@ int snat_alloc_outside_address_and_port (snat_address_t * addresses,
 					 u16 port_per_thread,
 					 u32 snat_thread_index);
 
+/**
+ * @brief Alloc outside address and port steering return traffic to thread
+ *
+ * If RSS-aware port selection is enabled, the port is picked so that the
+ * RSS hash of the return traffic from the remote endpoint lands on a
+ * receive queue of the outside interface polled by the thread.
+ *
+ * @param addresses         vector of outside addresses
+ * @param fib_index         FIB table index
+ * @param thread_index      thread index
+ * @param k                 allocated address and port pair
+ * @param port_per_thread   number of ports per threead
+ * @param snat_thread_index NAT thread index
+ * @param r_addr            remote address
+ * @param r_port            remote port in network byte order
+ *
+ * @return 0 on success, non-zero value otherwise
+ */
+int snat_alloc_outside_address_and_port_rss (snat_address_t * addresses,
+					     u32 fib_index,
+					     u32 thread_index,
+					     snat_session_key_t * k,
+					     u16 port_per_thread,
+					     u32 snat_thread_index,
+					     ip4_address_t * r_addr,
+					     u16 r_port);
+
+/**
+ * @brief Allocate the free port slices of outside address
+ *
+ * @param a outside address
+ */
+void snat_address_port_slices_init (snat_address_t * a);
+
+/**
+ * @brief Free the free port slices of outside address
+ *
+ * @param a outside address
+ */
+void snat_address_port_slices_free (snat_address_t * a);
+
+/**
+ * @brief Account a port freed in the busy port bitmap of outside address
+ *
+ * @param slices       free port slices of the address and protocol
+ * @param thread_index thread index of the freeing thread, ~0 if none
+ * @param port         port number in host byte order
+ */
+void snat_address_port_slice_put (snat_port_slice_t * slices,
+				  u32 thread_index, u16 port);
+
 /**
  * @brief Match NAT44 static mapping.
  *
@@ -25,11 +25,14 @@
 #include <nat/nat_affinity.h>
 #include <vnet/fib/fib_table.h>
 #include <nat/nat_ha.h>
+#include <nat/nat_rss.h>
 
 #define UNSUPPORTED_IN_DET_MODE_STR \
   "This command is unsupported in deterministic mode"
 #define SUPPORTED_ONLY_IN_DET_MODE_STR \
   "This command is supported only in deterministic mode"
+#define SUPPORTED_ONLY_IN_ED_MODE_STR \
+  "This command is supported only in endpoint dependent mode"
 
 static clib_error_t *
 set_workers_command_fn (vlib_main_t * vm,
@@ -274,6 +277,7 @@ nat44_show_alloc_addr_and_port_alg_command_fn (vlib_main_t * vm,
 					       vlib_cli_command_t * cmd)
 {
   snat_main_t *sm = &snat_main;
+  snat_main_per_thread_data_t *tsm;
 
   if (sm->deterministic)
     return clib_error_return (0, UNSUPPORTED_IN_DET_MODE_STR);
@@ -292,12 +296,150 @@ nat44_show_alloc_addr_and_port_alg_command_fn (vlib_main_t * vm,
 		       sm->end_port);
       break;
     default:
+      /* *INDENT-OFF* */
+      vec_foreach (tsm, sm->per_thread_data)
+        {
+          if (!tsm->port_alloc_attempts)
+            continue;
+          vlib_cli_output (vm, "  thread %d: attempts %lu failures %lu "
+                           "refills %lu stale %lu",
+                           tsm - sm->per_thread_data,
+                           tsm->port_alloc_attempts,
+                           tsm->port_alloc_failures,
+                           tsm->port_alloc_refills, tsm->port_alloc_stale);
+        }
+      /* *INDENT-ON* */
       break;
     }
 
   return 0;
 }
 
+static clib_error_t *
+nat44_rss_aware_ports_command_fn (vlib_main_t * vm, unformat_input_t * input,
+				  vlib_cli_command_t * cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  snat_main_t *sm = &snat_main;
+  vnet_main_t *vnm = vnet_get_main ();
+  clib_error_t *error = 0;
+  u32 sw_if_index = ~0, reta_size = 0, queue, *reta = 0;
+  u8 *key = 0, disable = 0;
+  int rv;
+
+  if (!sm->endpoint_dependent)
+    return clib_error_return (0, SUPPORTED_ONLY_IN_ED_MODE_STR);
+
+  /* Get a line of input. */
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return 0;
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "disable"))
+	disable = 1;
+      else if (unformat (line_input, "reta-size %u", &reta_size))
+	;
+      else if (unformat (line_input, "key %U", unformat_hex_string, &key))
+	;
+      else if (unformat (line_input, "reta"))
+	{
+	  while (unformat (line_input, "%u", &queue))
+	    vec_add1 (reta, queue);
+	}
+      else if (unformat (line_input, "%U", unformat_vnet_sw_interface, vnm,
+			 &sw_if_index))
+	;
+      else
+	{
+	  error = clib_error_return (0, "unknown input '%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+
+  if (disable)
+    {
+      nat_rss_disable ();
+      goto done;
+    }
+
+  if (sw_if_index == ~0)
+    {
+      error = clib_error_return (0, "interface required");
+      goto done;
+    }
+
+  rv = nat_rss_enable (sw_if_index, reta_size, key, reta);
+  switch (rv)
+    {
+    case 0:
+      break;
+    case VNET_API_ERROR_INVALID_VALUE:
+      error = clib_error_return (0, "reta size must be a power of two");
+      goto done;
+    case VNET_API_ERROR_INVALID_VALUE_2:
+      error = clib_error_return (0, "key must be at least %u bytes long",
+				 NAT_RSS_INPUT_LEN + 4);
+      goto done;
+    case VNET_API_ERROR_INVALID_INTERFACE:
+      error = clib_error_return (0, "interface has no receive queues");
+      goto done;
+    case VNET_API_ERROR_INVALID_VALUE_3:
+      error = clib_error_return (0, "reta does not match the receive "
+				 "queues, give it explicitly");
+      goto done;
+    default:
+      error = clib_error_return (0, "nat_rss_enable return %d", rv);
+      goto done;
+    }
+
+done:
+  vec_free (key);
+  vec_free (reta);
+  unformat_free (line_input);
+
+  return error;
+}
+
+static clib_error_t *
+nat44_show_rss_aware_ports_command_fn (vlib_main_t * vm,
+				       unformat_input_t * input,
+				       vlib_cli_command_t * cmd)
+{
+  snat_main_t *sm = &snat_main;
+  nat_rss_main_t *rm = &nat_rss_main;
+  vnet_main_t *vnm = vnet_get_main ();
+  snat_main_per_thread_data_t *tsm;
+
+  if (!sm->endpoint_dependent)
+    return clib_error_return (0, SUPPORTED_ONLY_IN_ED_MODE_STR);
+
+  if (!rm->enabled)
+    {
+      vlib_cli_output (vm, "NAT44 RSS-aware port selection disabled");
+      return 0;
+    }
+
+  vlib_cli_output (vm, "NAT44 RSS-aware port selection on %U, reta-size %u",
+		   format_vnet_sw_if_index_name, vnm, rm->sw_if_index,
+		   vec_len (rm->thread_by_reta));
+  /* *INDENT-OFF* */
+  vec_foreach (tsm, sm->per_thread_data)
+    {
+      if (!tsm->rss_port_matches && !tsm->rss_port_fallbacks
+          && !tsm->out2in_handoffs_avoided)
+        continue;
+      vlib_cli_output (vm, "  thread %d: ports matched %lu fallbacks %lu "
+                       "handoffs avoided %lu", tsm - sm->per_thread_data,
+                       tsm->rss_port_matches, tsm->rss_port_fallbacks,
+                       tsm->out2in_handoffs_avoided);
+    }
+  /* *INDENT-ON* */
+
+  return 0;
+}
+
 static clib_error_t *
 nat_set_mss_clamping_command_fn (vlib_main_t * vm, unformat_input_t * input,
 				 vlib_cli_command_t * cmd)
@@ -426,6 +568,49 @@ done:
   return error;
 }
 
+static clib_error_t *
+nat_ha_sync_options_command_fn (vlib_main_t * vm, unformat_input_t * input,
+				vlib_cli_command_t * cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  u32 coalesce_window;
+  u8 compact;
+  u64 events_coalesced;
+  int rv;
+  clib_error_t *error = 0;
+
+  nat_ha_get_sync_options (&coalesce_window, &compact, &events_coalesced);
+
+  /* Get a line of input. */
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return 0;
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "coalesce-window %u", &coalesce_window))
+	;
+      else if (unformat (line_input, "compact"))
+	compact = 1;
+      else if (unformat (line_input, "full"))
+	compact = 0;
+      else
+	{
+	  error = clib_error_return (0, "unknown input '%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+
+  rv = nat_ha_set_sync_options (coalesce_window, compact);
+  if (rv)
+    error = clib_error_return (0, "set HA sync options failed");
+
+done:
+  unformat_free (line_input);
+
+  return error;
+}
+
 static clib_error_t *
 nat_show_ha_command_fn (vlib_main_t * vm, unformat_input_t * input,
 			vlib_cli_command_t * cmd)
@@ -433,7 +618,9 @@ nat_show_ha_command_fn (vlib_main_t * vm, unformat_input_t * input,
   ip4_address_t addr;
   u16 port;
   u32 path_mtu, session_refresh_interval, resync_ack_missed;
-  u8 in_resync;
+  u32 coalesce_window;
+  u8 in_resync, compact;
+  u64 events_coalesced;
 
   nat_ha_get_listener (&addr, &port, &path_mtu);
   if (!port)
@@ -455,6 +642,12 @@ nat_show_ha_command_fn (vlib_main_t * vm, unformat_input_t * input,
   else
     vlib_cli_output (vm, "  NA\n");
 
+  nat_ha_get_sync_options (&coalesce_window, &compact, &events_coalesced);
+  vlib_cli_output (vm, "SYNC:\n");
+  vlib_cli_output (vm, "  coalesce-window %umsec %s encoding\n",
+		   coalesce_window, compact ? "compact" : "full");
+  vlib_cli_output (vm, "  %lu events coalesced\n", events_coalesced);
+
   nat_ha_get_resync_status (&in_resync, &resync_ack_missed);
   vlib_cli_output (vm, "RESYNC:\n");
   if (in_resync)
@@ -1320,6 +1513,9 @@ nat44_show_sessions_command_fn (vlib_main_t * vm, unformat_input_t * input,
       vlib_cli_output (vm, "-------- thread %d %s: %d sessions --------\n",
                        i, vlib_worker_threads[i].name,
                        pool_elts (tsm->sessions));
+      if (sm->endpoint_dependent)
+        vlib_cli_output (vm, "  expired %lu, reclaimed when full %lu\n",
+                         tsm->sessions_expired, tsm->sessions_reclaimed);
       pool_foreach (u, tsm->users,
       ({
         vlib_cli_output (vm, "  %U", format_snat_user, tsm, u, verbose);
@@ -1988,6 +2184,45 @@ VLIB_CLI_COMMAND (nat44_show_alloc_addr_and_port_alg_command, static) = {
     .function = nat44_show_alloc_addr_and_port_alg_command_fn,
 };
 
+/*?
+ * @cliexpar
+ * @cliexstart{nat44 rss-aware-ports}
+ * Pick outside ports of endpoint-dependent sessions so that the NIC RSS
+ * hash of the return traffic lands on the worker owning the session,
+ * avoiding the out2in worker handoff. The redirection table is not read
+ * from the NIC. By default its entries are taken to be assigned to the
+ * receive queues of the interface round-robin, as drivers program it, and
+ * reta-size must be at least the number of queues. Any other table has
+ * to be given entry by entry, as the receive queue of each entry.
+ * To enable RSS-aware port selection on outside interface use:
+ *  vpp# nat44 rss-aware-ports GigabitEthernet0/8/0 reta-size 128
+ * To give a redirection table explicitly use:
+ *  vpp# nat44 rss-aware-ports GigabitEthernet0/8/0 reta 0 1 1 0
+ * To disable RSS-aware port selection use:
+ *  vpp# nat44 rss-aware-ports disable
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (nat44_rss_aware_ports_command, static) = {
+    .path = "nat44 rss-aware-ports",
+    .short_help = "nat44 rss-aware-ports <interface> [reta-size <n>] "
+                  "[reta <queue> ...] [key <hex>] | disable",
+    .function = nat44_rss_aware_ports_command_fn,
+};
+
+/*?
+ * @cliexpar
+ * @cliexstart{show nat44 rss-aware-ports}
+ * Show RSS-aware port selection configuration, the outside ports picked
+ * for the receiving thread, the fallbacks to another port and the out2in
+ * packets that arrived on their owner thread and skipped the handoff
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (nat44_show_rss_aware_ports_command, static) = {
+    .path = "show nat44 rss-aware-ports",
+    .short_help = "show nat44 rss-aware-ports",
+    .function = nat44_show_rss_aware_ports_command_fn,
+};
+
 /*?
  * @cliexpar
  * @cliexstart{nat mss-clamping}
@@ -2028,6 +2263,24 @@ VLIB_CLI_COMMAND (nat_ha_failover_command, static) = {
     .function = nat_ha_failover_command_fn,
 };
 
+/*?
+ * @cliexpar
+ * @cliexstart{nat ha sync-options}
+ * Set HA state sync options. Events of the same session queued within the
+ * coalesce window are merged (repeated refreshes collapse into one, add
+ * followed by delete is not sent at all). Compact encoding sends delete
+ * and refresh events without unused fields, the failover must understand
+ * protocol version 2.
+ *  vpp# nat ha sync-options coalesce-window 500 compact
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (nat_ha_sync_options_command, static) = {
+    .path = "nat ha sync-options",
+    .short_help = "nat ha sync-options [coalesce-window <msec>] "
+                  "[compact|full]",
+    .function = nat_ha_sync_options_command_fn,
+};
+
 /*?
  * @cliexpar
  * @cliexstart{nat ha listener}
@@ -74,18 +74,19 @@ nat44_worker_handoff_fn_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
   snat_main_t *sm = &snat_main;
   vlib_buffer_t *bufs[VLIB_FRAME_SIZE], **b;
   u32 n_enq, n_left_from, *from;
-  u16 thread_indices[VLIB_FRAME_SIZE], *ti;
-  u32 fq_index;
+  u32 to_thread[VLIB_FRAME_SIZE], to_local[VLIB_FRAME_SIZE];
+  u16 thread_indices[VLIB_FRAME_SIZE];
+  u32 fq_index, next_index;
   snat_get_worker_function_t *get_worker;
   u32 thread_index = vm->thread_index;
   u32 do_handoff = 0, same_worker = 0;
+  u32 ti0;
 
   from = vlib_frame_vector_args (frame);
   n_left_from = frame->n_vectors;
   vlib_get_buffers (vm, from, bufs, n_left_from);
 
   b = bufs;
-  ti = thread_indices;
 
   ASSERT (vec_len (sm->workers));
 
@@ -93,13 +94,20 @@ nat44_worker_handoff_fn_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
     {
       get_worker = sm->worker_in2out_cb;
       if (is_output)
-	fq_index = sm->fq_in2out_output_index;
+	{
+	  fq_index = sm->fq_in2out_output_index;
+	  next_index = sm->in2out_output_handoff_next;
+	}
       else
-	fq_index = sm->fq_in2out_index;
+	{
+	  fq_index = sm->fq_in2out_index;
+	  next_index = sm->in2out_handoff_next;
+	}
     }
   else
     {
       fq_index = sm->fq_out2in_index;
+      next_index = sm->out2in_handoff_next;
       get_worker = sm->worker_out2in_cb;
     }
 
@@ -112,35 +120,49 @@ nat44_worker_handoff_fn_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
       sw_if_index0 = vnet_buffer (b[0])->sw_if_index[VLIB_RX];
       rx_fib_index0 = ip4_fib_table_get_index_for_sw_if_index (sw_if_index0);
       ip0 = vlib_buffer_get_current (b[0]);
-      ti[0] = get_worker (ip0, rx_fib_index0);
+      ti0 = get_worker (ip0, rx_fib_index0);
 
-      if (ti[0] != thread_index)
-	do_handoff++;
+      /* packets for this thread skip the frame queue */
+      if (ti0 != thread_index)
+	{
+	  to_thread[do_handoff] = from[0];
+	  thread_indices[do_handoff] = ti0;
+	  do_handoff++;
+	}
       else
-	same_worker++;
+	to_local[same_worker++] = from[0];
 
       if (PREDICT_FALSE ((node->flags & VLIB_NODE_FLAG_TRACE)
 			 && (b[0]->flags & VLIB_BUFFER_IS_TRACED)))
 	{
 	  nat44_handoff_trace_t *t =
 	    vlib_add_trace (vm, node, b[0], sizeof (*t));
-	  t->next_worker_index = ti[0];
+	  t->next_worker_index = ti0;
 	  t->in2out = is_in2out;
 	}
 
       n_left_from -= 1;
-      ti += 1;
+      from += 1;
       b += 1;
     }
 
-  n_enq =
-    vlib_buffer_enqueue_to_thread (vm, fq_index, from, thread_indices,
-				   frame->n_vectors, 1);
+  if (same_worker)
+    vlib_buffer_enqueue_to_single_next (vm, node, to_local, next_index,
+					same_worker);
+
+  if (do_handoff)
+    {
+      n_enq = vlib_buffer_enqueue_to_thread (vm, fq_index, to_thread,
+					     thread_indices, do_handoff, 1);
+      if (n_enq < do_handoff)
+	vlib_node_increment_counter (vm, node->node_index,
+				     NAT44_HANDOFF_ERROR_CONGESTION_DROP,
+				     do_handoff - n_enq);
+    }
+
+  if (!is_in2out)
+    sm->per_thread_data[thread_index].out2in_handoffs_avoided += same_worker;
 
-  if (n_enq < frame->n_vectors)
-    vlib_node_increment_counter (vm, node->node_index,
-				 NAT44_HANDOFF_ERROR_CONGESTION_DROP,
-				 frame->n_vectors - n_enq);
   vlib_node_increment_counter (vm, node->node_index,
 			       NAT44_HANDOFF_ERROR_SAME_WORKER, same_worker);
   vlib_node_increment_counter (vm, node->node_index,
@@ -282,6 +282,11 @@ nat64_init (vlib_main_t * vm)
   vlib_validate_simple_counter (&nm->total_sessions, 0);
   vlib_zero_simple_counter (&nm->total_sessions, 0);
 
+  mhash_init (&nm->stateless_by_in, sizeof (uword),
+	      sizeof (nat64_stateless_key_t));
+  clib_bihash_init_24_8 (&nm->stateless_in, "nat64-stateless-in", 1024,
+			 128 << 10);
+
   return 0;
 }
 
@@ -350,6 +355,7 @@ nat64_add_del_pool_addr (u32 thread_index,
       vec_validate_init_empty (a->busy_##n##_ports_per_thread, tm->n_vlib_mains - 1, 0);
       foreach_snat_protocol
 #undef _
+      snat_address_port_slices_init (a);
     }
   else
     {
@@ -374,6 +380,7 @@ nat64_add_del_pool_addr (u32 thread_index,
       foreach_snat_protocol
 #undef _
         /* *INDENT-ON* */
+      snat_address_port_slices_free (a);
       vec_del1 (nm->addr_pool, i);
     }
 
@@ -455,6 +462,7 @@ nat64_add_del_interface (u32 sw_if_index, u8 is_inside, u8 is_add)
   nat64_main_t *nm = &nat64_main;
   snat_interface_t *interface = 0, *i;
   snat_address_t *ap;
+  nat64_stateless_mapping_t *m;
   const char *feature_name, *arc_name;
 
   /* Check if interface already exists */
@@ -510,6 +518,11 @@ nat64_add_del_interface (u32 sw_if_index, u8 is_inside, u8 is_add)
       /* *INDENT-OFF* */
       vec_foreach (ap, nm->addr_pool)
         snat_add_del_addr_to_fib(&ap->addr, 32, sw_if_index, is_add);
+      pool_foreach (m, nm->stateless_mappings,
+      ({
+        snat_add_del_addr_to_fib(&m->out_prefix, m->out_plen, sw_if_index,
+                                 is_add);
+      }));
       /* *INDENT-ON* */
     }
 
@@ -602,6 +615,8 @@ nat64_free_out_addr_and_port (struct nat64_db_s *db, ip4_address_t * addr,
           clib_bitmap_set_no_check (a->busy_##n##_port_bitmap, port, 0); \
           a->busy_##n##_ports--; \
           a->busy_##n##_ports_per_thread[thread_index]--; \
+          snat_address_port_slice_put (a->n##_port_slices, thread_index, \
+                                       port_host_byte_order); \
           break;
 	  foreach_snat_protocol
 #undef _
@@ -1061,6 +1076,146 @@ nat64_prefix_walk (nat64_prefix_walk_fn_t fn, void *ctx)
   /* *INDENT-ON* */
 }
 
+static void
+nat64_stateless_plen_update (u8 plen, int is_add)
+{
+  nat64_main_t *nm = &nat64_main;
+  int i;
+
+  if (is_add)
+    {
+      if (nm->stateless_plen_refcnt[plen]++)
+	return;
+    }
+  else
+    {
+      if (--nm->stateless_plen_refcnt[plen])
+	return;
+    }
+
+  /* rebuild the list of lengths in use, longest prefix first */
+  vec_reset_length (nm->stateless_plens);
+  for (i = 32; i >= 0; i--)
+    if (nm->stateless_plen_refcnt[i])
+      vec_add1 (nm->stateless_plens, i);
+}
+
+int
+nat64_add_del_stateless_mapping (ip6_address_t * in_prefix, u8 in_plen,
+				 ip4_address_t * out_prefix, u8 out_plen,
+				 u32 vrf_id, u8 is_add)
+{
+  nat64_main_t *nm = &nat64_main;
+  vlib_main_t *vm = vlib_get_main ();
+  nat64_stateless_mapping_t *m;
+  nat64_stateless_key_t key;
+  clib_bihash_kv_24_8_t kv;
+  snat_interface_t *interface;
+  ip4_address_t out;
+  u32 fib_index;
+  uword *p_in, *p_out;
+  u64 out_key;
+
+  if (in_plen < 96 || in_plen > 128 || out_plen > 32)
+    return VNET_API_ERROR_INVALID_VALUE;
+
+  /* host bits are copied 1:1, so both prefixes must have the same number */
+  if (in_plen - 96 != out_plen)
+    return VNET_API_ERROR_INVALID_VALUE_2;
+
+  out.as_u32 = out_prefix->as_u32 & ip4_main.fib_masks[out_plen];
+  out_key = (u64) out.as_u32 << 8 | out_plen;
+  p_out = hash_get (nm->stateless_by_out, out_key);
+
+  fib_index = fib_table_find (FIB_PROTOCOL_IP6, vrf_id);
+
+  clib_memset (&key, 0, sizeof (key));
+  key.prefix.as_u64[0] = in_prefix->as_u64[0];
+  key.prefix.as_u32[2] = in_prefix->as_u32[2];
+  key.prefix.as_u32[3] = in_prefix->as_u32[3] & ip4_main.fib_masks[out_plen];
+  key.fib_index = fib_index;
+  key.plen = out_plen;
+  p_in = fib_index == ~0 ? 0 : mhash_get (&nm->stateless_by_in, &key);
+
+  if (is_add)
+    {
+      if (p_in || p_out)
+	return VNET_API_ERROR_VALUE_EXIST;
+
+      /* workers read the pool, the length list and the bihash */
+      vlib_worker_thread_barrier_sync (vm);
+      pool_get (nm->stateless_mappings, m);
+      clib_memset (m, 0, sizeof (*m));
+      m->in_prefix = key.prefix;
+      m->in_plen = in_plen;
+      m->out_prefix = out;
+      m->out_plen = out_plen;
+      m->vrf_id = vrf_id;
+      m->fib_index =
+	fib_table_find_or_create_and_lock (FIB_PROTOCOL_IP6, vrf_id,
+					   FIB_SOURCE_PLUGIN_HI);
+      key.fib_index = m->fib_index;
+
+      mhash_set (&nm->stateless_by_in, &key, m - nm->stateless_mappings, 0);
+      kv.key[0] = key.as_u64[0];
+      kv.key[1] = key.as_u64[1];
+      kv.key[2] = key.as_u64[2];
+      kv.value = m - nm->stateless_mappings;
+      clib_bihash_add_del_24_8 (&nm->stateless_in, &kv, 1);
+      hash_set (nm->stateless_by_out, out_key, m - nm->stateless_mappings);
+      nat64_stateless_plen_update (out_plen, 1);
+      vlib_worker_thread_barrier_release (vm);
+    }
+  else
+    {
+      if (!p_in || !p_out || p_in[0] != p_out[0])
+	return VNET_API_ERROR_NO_SUCH_ENTRY;
+
+      vlib_worker_thread_barrier_sync (vm);
+      m = pool_elt_at_index (nm->stateless_mappings, p_in[0]);
+      mhash_unset (&nm->stateless_by_in, &key, 0);
+      kv.key[0] = key.as_u64[0];
+      kv.key[1] = key.as_u64[1];
+      kv.key[2] = key.as_u64[2];
+      clib_bihash_add_del_24_8 (&nm->stateless_in, &kv, 0);
+      hash_unset (nm->stateless_by_out, out_key);
+      nat64_stateless_plen_update (out_plen, 0);
+      fib_table_unlock (m->fib_index, FIB_PROTOCOL_IP6, FIB_SOURCE_PLUGIN_HI);
+      pool_put (nm->stateless_mappings, m);
+      vlib_worker_thread_barrier_release (vm);
+    }
+
+  /* Add/del outside prefix to FIB */
+  /* *INDENT-OFF* */
+  pool_foreach (interface, nm->interfaces,
+  ({
+    if (nat_interface_is_inside(interface))
+      continue;
+
+    snat_add_del_addr_to_fib (&out, out_plen, interface->sw_if_index, is_add);
+    break;
+  }));
+  /* *INDENT-ON* */
+
+  return 0;
+}
+
+void
+nat64_stateless_mapping_walk (nat64_stateless_mapping_walk_fn_t fn,
+			      void *ctx)
+{
+  nat64_main_t *nm = &nat64_main;
+  nat64_stateless_mapping_t *m = 0;
+
+  /* *INDENT-OFF* */
+  pool_foreach (m, nm->stateless_mappings,
+  ({
+    if (fn (m, ctx))
+      break;
+  }));
+  /* *INDENT-ON* */
+}
+
 void
 nat64_compose_ip6 (ip6_address_t * ip6, ip4_address_t * ip4, u32 fib_index)
 {
@@ -21,6 +21,7 @@
 
 #include <nat/nat.h>
 #include <nat/nat64_db.h>
+#include <vppinfra/mhash.h>
 
 #define foreach_nat64_tcp_ses_state            \
   _(0, CLOSED, "closed")                       \
@@ -65,6 +66,28 @@ typedef struct
   u8 done;
 } nat64_static_bib_to_update_t;
 
+/* Stateless (SIIT/EAM) prefix mapping, host bits are copied 1:1 */
+typedef struct
+{
+  ip6_address_t in_prefix;
+  ip4_address_t out_prefix;
+  u8 in_plen;
+  u8 out_plen;
+  u32 vrf_id;
+  u32 fib_index;
+} nat64_stateless_mapping_t;
+
+typedef union
+{
+  struct
+  {
+    ip6_address_t prefix;
+    u32 fib_index;
+    u32 plen;
+  };
+  u64 as_u64[3];
+} nat64_stateless_key_t;
+
 typedef struct
 {
   /** Interface pool */
@@ -89,6 +112,19 @@ typedef struct
   /** Pool of static BIB entries to be added/deleted in worker threads */
   nat64_static_bib_to_update_t *static_bibs;
 
+  /** Pool of stateless prefix mappings */
+  nat64_stateless_mapping_t *stateless_mappings;
+  /* stateless mapping lookup by inside prefix, fib index and length,
+     control plane only */
+  mhash_t stateless_by_in;
+  /* same, for the data plane, updated under the barrier */
+  clib_bihash_24_8_t stateless_in;
+  /* stateless mapping lookup by outside prefix and length */
+  uword *stateless_by_out;
+  /* outside prefix lengths in use, longest first */
+  u8 *stateless_plens;
+  u32 stateless_plen_refcnt[33];
+
   /** config parameters */
   u32 bib_buckets;
   u32 bib_memory_size;
@@ -382,6 +418,122 @@ u32 nat64_get_worker_in2out (ip6_address_t * addr);
  */
 u32 nat64_get_worker_out2in (ip4_header_t * ip);
 
+/**
+ * @brief Add/delete stateless NAT64 prefix mapping.
+ *
+ * Packets from the inside prefix are translated without BIB and session
+ * entries, the host bits are copied to the outside prefix and back. The
+ * inside and outside prefixes must have the same number of host bits.
+ *
+ * @param in_prefix  Inside IPv6 prefix.
+ * @param in_plen    Inside IPv6 prefix length (96-128).
+ * @param out_prefix Outside IPv4 prefix.
+ * @param out_plen   Outside IPv4 prefix length.
+ * @param vrf_id     Inside VRF id.
+ * @param is_add     1 if add, 0 if delete.
+ *
+ * @returns 0 on success, non-zero value otherwise.
+ */
+int nat64_add_del_stateless_mapping (ip6_address_t * in_prefix, u8 in_plen,
+				     ip4_address_t * out_prefix, u8 out_plen,
+				     u32 vrf_id, u8 is_add);
+
+/**
+ * @brief Call back function when walking stateless mappings, non-zero
+ * return value stop walk.
+ */
+typedef int (*nat64_stateless_mapping_walk_fn_t) (nat64_stateless_mapping_t
+						  * m, void *ctx);
+
+/**
+ * @brief Walk stateless NAT64 prefix mappings.
+ */
+void nat64_stateless_mapping_walk (nat64_stateless_mapping_walk_fn_t fn,
+				   void *ctx);
+
+/**
+ * @brief Find stateless mapping covering inside IPv6 address.
+ */
+always_inline nat64_stateless_mapping_t *
+nat64_stateless_mapping_find_in (ip6_address_t * addr, u32 fib_index)
+{
+  nat64_main_t *nm = &nat64_main;
+  nat64_stateless_key_t key;
+  clib_bihash_kv_24_8_t kv, value;
+  u8 *plen;
+
+  if (PREDICT_TRUE (vec_len (nm->stateless_plens) == 0))
+    return 0;
+
+  key.prefix.as_u64[0] = addr->as_u64[0];
+  key.prefix.as_u32[2] = addr->as_u32[2];
+  key.fib_index = fib_index;
+
+  vec_foreach (plen, nm->stateless_plens)
+  {
+    key.prefix.as_u32[3] = addr->as_u32[3] & ip4_main.fib_masks[*plen];
+    key.plen = *plen;
+    kv.key[0] = key.as_u64[0];
+    kv.key[1] = key.as_u64[1];
+    kv.key[2] = key.as_u64[2];
+    if (!clib_bihash_search_24_8 (&nm->stateless_in, &kv, &value))
+      return pool_elt_at_index (nm->stateless_mappings, value.value);
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Find stateless mapping covering outside IPv4 address.
+ */
+always_inline nat64_stateless_mapping_t *
+nat64_stateless_mapping_find_out (ip4_address_t * addr)
+{
+  nat64_main_t *nm = &nat64_main;
+  uword *p;
+  u8 *plen;
+
+  if (PREDICT_TRUE (vec_len (nm->stateless_plens) == 0))
+    return 0;
+
+  vec_foreach (plen, nm->stateless_plens)
+  {
+    p = hash_get (nm->stateless_by_out,
+		  (u64) (addr->as_u32 & ip4_main.fib_masks[*plen]) << 8 |
+		  *plen);
+    if (p)
+      return pool_elt_at_index (nm->stateless_mappings, p[0]);
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Translate inside IPv6 address to IPv4 using stateless mapping.
+ */
+always_inline void
+nat64_stateless_map_in2out (nat64_stateless_mapping_t * m,
+			    ip6_address_t * in, ip4_address_t * out)
+{
+  u32 mask = ip4_main.fib_masks[m->out_plen];
+
+  out->as_u32 = m->out_prefix.as_u32 | (in->as_u32[3] & ~mask);
+}
+
+/**
+ * @brief Translate outside IPv4 address to IPv6 using stateless mapping.
+ */
+always_inline void
+nat64_stateless_map_out2in (nat64_stateless_mapping_t * m,
+			    ip4_address_t * out, ip6_address_t * in)
+{
+  u32 mask = ip4_main.fib_masks[m->out_plen];
+
+  in->as_u64[0] = m->in_prefix.as_u64[0];
+  in->as_u32[2] = m->in_prefix.as_u32[2];
+  in->as_u32[3] = m->in_prefix.as_u32[3] | (out->as_u32 & ~mask);
+}
+
 #endif /* __included_nat64_h__ */
 
 /*
@@ -682,6 +682,101 @@ nat64_show_prefix_command_fn (vlib_main_t * vm,
   return 0;
 }
 
+static clib_error_t *
+nat64_add_del_stateless_mapping_command_fn (vlib_main_t * vm,
+					    unformat_input_t * input,
+					    vlib_cli_command_t * cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  clib_error_t *error = 0;
+  ip6_address_t in_prefix;
+  ip4_address_t out_prefix;
+  u32 in_plen = 0, out_plen = ~0, vrf_id = 0;
+  u8 is_add = 1;
+  int rv;
+
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return 0;
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "%U/%u", unformat_ip6_address, &in_prefix,
+		    &in_plen))
+	;
+      else if (unformat (line_input, "%U/%u", unformat_ip4_address,
+			 &out_prefix, &out_plen))
+	;
+      else if (unformat (line_input, "vrf %u", &vrf_id))
+	;
+      else if (unformat (line_input, "del"))
+	is_add = 0;
+      else
+	{
+	  error = clib_error_return (0, "unknown input: '%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+
+  if (!in_plen || out_plen == ~0)
+    {
+      error = clib_error_return (0, "IPv6 and IPv4 prefix must be set.");
+      goto done;
+    }
+
+  rv =
+    nat64_add_del_stateless_mapping (&in_prefix, (u8) in_plen, &out_prefix,
+				     (u8) out_plen, vrf_id, is_add);
+
+  switch (rv)
+    {
+    case VNET_API_ERROR_NO_SUCH_ENTRY:
+      error = clib_error_return (0, "NAT64 stateless mapping not exist.");
+      goto done;
+    case VNET_API_ERROR_VALUE_EXIST:
+      error = clib_error_return (0, "NAT64 stateless mapping exist.");
+      goto done;
+    case VNET_API_ERROR_INVALID_VALUE:
+      error = clib_error_return (0, "Invalid prefix length.");
+      goto done;
+    case VNET_API_ERROR_INVALID_VALUE_2:
+      error =
+	clib_error_return (0, "Prefixes must have the same host bits count.");
+      goto done;
+    default:
+      break;
+    }
+
+done:
+  unformat_free (line_input);
+
+  return error;
+}
+
+static int
+nat64_cli_stateless_mapping_walk (nat64_stateless_mapping_t * m, void *ctx)
+{
+  vlib_main_t *vm = ctx;
+
+  vlib_cli_output (vm, " %U/%u %U/%u vrf %u",
+		   format_ip6_address, &m->in_prefix, m->in_plen,
+		   format_ip4_address, &m->out_prefix, m->out_plen,
+		   m->vrf_id);
+
+  return 0;
+}
+
+static clib_error_t *
+nat64_show_stateless_mapping_command_fn (vlib_main_t * vm,
+					 unformat_input_t * input,
+					 vlib_cli_command_t * cmd)
+{
+  vlib_cli_output (vm, "NAT64 stateless mappings:");
+  nat64_stateless_mapping_walk (nat64_cli_stateless_mapping_walk, vm);
+
+  return 0;
+}
+
 static clib_error_t *
 nat64_add_interface_address_command_fn (vlib_main_t * vm,
 					unformat_input_t * input,
@@ -906,6 +1001,38 @@ VLIB_CLI_COMMAND (show_nat64_prefix_command, static) = {
   .function = nat64_show_prefix_command_fn,
 };
 
+/*?
+ * @cliexpar
+ * @cliexstart{nat64 add stateless mapping}
+ * Add/delete NAT64 stateless (SIIT) prefix mapping. Packets of hosts covered
+ * by the mapping are translated by the prefix rule only, without BIB and
+ * session entries, both prefixes must have the same number of host bits.
+ * To map 2001:db8:1::/120 to 10.1.1.0/24 use:
+ *  vpp# nat64 add stateless mapping 2001:db8:1::/120 10.1.1.0/24
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (nat64_add_del_stateless_mapping_command, static) = {
+  .path = "nat64 add stateless mapping",
+  .short_help = "nat64 add stateless mapping <ip6-prefix>/<plen> "
+                "<ip4-prefix>/<plen> [vrf <vrf-id>] [del]",
+  .function = nat64_add_del_stateless_mapping_command_fn,
+};
+
+/*?
+ * @cliexpar
+ * @cliexstart{show nat64 stateless mapping}
+ * Show NAT64 stateless prefix mappings.
+ *  vpp# show nat64 stateless mapping
+ *  NAT64 stateless mappings:
+ *   2001:db8:1::/120 10.1.1.0/24 vrf 0
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (show_nat64_stateless_mapping_command, static) = {
+  .path = "show nat64 stateless mapping",
+  .short_help = "show nat64 stateless mapping",
+  .function = nat64_show_stateless_mapping_command_fn,
+};
+
 /*?
  * @cliexpar
  * @cliexstart{nat64 add interface address}
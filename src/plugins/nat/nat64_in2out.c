@@ -85,7 +85,8 @@ _(ICMP_PACKETS, "ICMP packets")                          \
 _(OTHER_PACKETS, "other protocol packets")               \
 _(FRAGMENTS, "fragments")                                \
 _(CACHED_FRAGMENTS, "cached fragments")                  \
-_(PROCESSED_FRAGMENTS, "processed fragments")
+_(PROCESSED_FRAGMENTS, "processed fragments")            \
+_(STATELESS_PACKETS, "stateless translated packets")
 
 
 typedef enum
@@ -957,6 +958,119 @@ nat64_in2out_unk_proto_hairpinning (vlib_main_t * vm, vlib_buffer_t * b,
   return 0;
 }
 
+typedef struct nat64_in2out_stateless_ctx_t_
+{
+  nat64_stateless_mapping_t *m;
+  u32 fib_index;
+} nat64_in2out_stateless_ctx_t;
+
+/* hosts covered by a stateless mapping use it, others the pref64 */
+static_always_inline void
+nat64_in2out_stateless_addr (ip6_address_t * ip6, ip4_address_t * ip4,
+			     u32 fib_index)
+{
+  nat64_stateless_mapping_t *m;
+
+  m = nat64_stateless_mapping_find_in (ip6, fib_index);
+  if (m)
+    nat64_stateless_map_in2out (m, ip6, ip4);
+  else
+    nat64_extract_ip4 (ip6, ip4, fib_index);
+}
+
+static int
+nat64_in2out_stateless_set_cb (ip6_header_t * ip6, ip4_header_t * ip4,
+			       void *arg)
+{
+  nat64_in2out_stateless_ctx_t *ctx = arg;
+  ip4_address_t saddr, daddr;
+
+  /* IPv4 header overlaps the IPv6 addresses, translate both first */
+  nat64_stateless_map_in2out (ctx->m, &ip6->src_address, &saddr);
+  nat64_in2out_stateless_addr (&ip6->dst_address, &daddr, ctx->fib_index);
+
+  ip4->src_address.as_u32 = saddr.as_u32;
+  ip4->dst_address.as_u32 = daddr.as_u32;
+
+  return 0;
+}
+
+static int
+nat64_in2out_stateless_inner_set_cb (ip6_header_t * ip6, ip4_header_t * ip4,
+				     void *arg)
+{
+  nat64_in2out_stateless_ctx_t *ctx = arg;
+  ip4_address_t saddr, daddr;
+
+  nat64_in2out_stateless_addr (&ip6->src_address, &saddr, ctx->fib_index);
+  nat64_in2out_stateless_addr (&ip6->dst_address, &daddr, ctx->fib_index);
+
+  ip4->src_address.as_u32 = saddr.as_u32;
+  ip4->dst_address.as_u32 = daddr.as_u32;
+
+  return 0;
+}
+
+/**
+ * @brief Translate packet of host covered by stateless mapping.
+ *
+ * Addresses are translated by prefix rules only, no BIB or session entry is
+ * looked up or created and the ports are left untouched.
+ *
+ * @returns 1 if the source is covered by a stateless mapping, 0 otherwise.
+ */
+static_always_inline int
+nat64_in2out_stateless (vlib_node_runtime_t * node, vlib_buffer_t * b,
+			ip6_header_t * ip6, u8 l4_protocol, u16 frag_offset,
+			u32 * next)
+{
+  nat64_in2out_stateless_ctx_t ctx;
+  u32 sw_if_index = vnet_buffer (b)->sw_if_index[VLIB_RX];
+  int rv;
+
+  ctx.fib_index =
+    fib_table_get_index_for_sw_if_index (FIB_PROTOCOL_IP6, sw_if_index);
+  ctx.m = nat64_stateless_mapping_find_in (&ip6->src_address, ctx.fib_index);
+  if (!ctx.m)
+    return 0;
+
+  *next = NAT64_IN2OUT_NEXT_IP4_LOOKUP;
+
+  if (PREDICT_FALSE (frag_offset))
+    {
+      ip6_frag_hdr_t *hdr = (ip6_frag_hdr_t *) u8_ptr_add (ip6, frag_offset);
+
+      /* ICMP checksum covers the whole message, can't fix it per fragment */
+      if (l4_protocol == IP_PROTOCOL_ICMP6)
+	{
+	  *next = NAT64_IN2OUT_NEXT_DROP;
+	  b->error = node->errors[NAT64_IN2OUT_ERROR_DROP_FRAGMENT];
+	  return 1;
+	}
+
+      if (ip6_frag_hdr_offset (hdr) ||
+	  (l4_protocol != IP_PROTOCOL_TCP && l4_protocol != IP_PROTOCOL_UDP))
+	rv = ip6_to_ip4_fragmented (b, nat64_in2out_stateless_set_cb, &ctx);
+      else
+	rv = ip6_to_ip4_tcp_udp (b, nat64_in2out_stateless_set_cb, &ctx, 1);
+    }
+  else if (l4_protocol == IP_PROTOCOL_TCP || l4_protocol == IP_PROTOCOL_UDP)
+    rv = ip6_to_ip4_tcp_udp (b, nat64_in2out_stateless_set_cb, &ctx, 1);
+  else if (l4_protocol == IP_PROTOCOL_ICMP6)
+    rv = icmp6_to_icmp (b, nat64_in2out_stateless_set_cb, &ctx,
+			nat64_in2out_stateless_inner_set_cb, &ctx);
+  else
+    rv = ip6_to_ip4 (b, nat64_in2out_stateless_set_cb, &ctx);
+
+  if (rv)
+    {
+      *next = NAT64_IN2OUT_NEXT_DROP;
+      b->error = node->errors[NAT64_IN2OUT_ERROR_NO_TRANSLATION];
+    }
+
+  return 1;
+}
+
 static inline uword
 nat64_in2out_node_fn_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
 			     vlib_frame_t * frame, u8 is_slow_path)
@@ -969,7 +1083,7 @@ nat64_in2out_node_fn_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
   nat64_main_t *nm = &nat64_main;
 
   u32 tcp_packets = 0, udp_packets = 0, icmp_packets = 0, other_packets =
-    0, fragments = 0;
+    0, fragments = 0, stateless_packets = 0;
 
   stats_node_index =
     is_slow_path ? nm->in2out_slowpath_node_index : nm->in2out_node_index;
@@ -1031,6 +1145,14 @@ nat64_in2out_node_fn_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
 	      goto trace0;
 	    }
 
+	  if (PREDICT_FALSE (vec_len (nm->stateless_plens) != 0) &&
+	      nat64_in2out_stateless (node, b0, ip60, l4_protocol0,
+				      frag_offset0, &next0))
+	    {
+	      stateless_packets++;
+	      goto trace0;
+	    }
+
 	  proto0 = ip_proto_to_snat_proto (l4_protocol0);
 
 	  if (is_slow_path)
@@ -1165,6 +1287,9 @@ nat64_in2out_node_fn_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
 			       other_packets);
   vlib_node_increment_counter (vm, stats_node_index,
 			       NAT64_IN2OUT_ERROR_FRAGMENTS, fragments);
+  vlib_node_increment_counter (vm, stats_node_index,
+			       NAT64_IN2OUT_ERROR_STATELESS_PACKETS,
+			       stateless_packets);
 
   return frame->n_vectors;
 }
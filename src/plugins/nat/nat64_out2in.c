@@ -82,7 +82,8 @@ _(ICMP_PACKETS, "ICMP packets")                          \
 _(OTHER_PACKETS, "other protocol packets")               \
 _(FRAGMENTS, "fragments")                                \
 _(CACHED_FRAGMENTS, "cached fragments")                  \
-_(PROCESSED_FRAGMENTS, "processed fragments")
+_(PROCESSED_FRAGMENTS, "processed fragments")            \
+_(STATELESS_PACKETS, "stateless translated packets")
 
 
 typedef enum
@@ -430,6 +431,110 @@ nat64_out2in_unk_proto_set_cb (ip4_header_t * ip4, ip6_header_t * ip6,
   return 0;
 }
 
+/* hosts covered by a stateless mapping use it, others the pref64 */
+static_always_inline void
+nat64_out2in_stateless_addr (ip4_address_t * ip4, ip6_address_t * ip6,
+			     u32 fib_index)
+{
+  nat64_stateless_mapping_t *m;
+
+  m = nat64_stateless_mapping_find_out (ip4);
+  if (m)
+    nat64_stateless_map_out2in (m, ip4, ip6);
+  else
+    nat64_compose_ip6 (ip6, ip4, fib_index);
+}
+
+static int
+nat64_out2in_stateless_set_cb (ip4_header_t * ip4, ip6_header_t * ip6,
+			       void *arg)
+{
+  nat64_stateless_mapping_t *m = arg;
+  ip4_address_t saddr, daddr;
+
+  /* IPv6 header overlaps the IPv4 addresses, save them first */
+  saddr.as_u32 = ip4->src_address.as_u32;
+  daddr.as_u32 = ip4->dst_address.as_u32;
+
+  nat64_compose_ip6 (&ip6->src_address, &saddr, m->fib_index);
+  nat64_stateless_map_out2in (m, &daddr, &ip6->dst_address);
+
+  return 0;
+}
+
+static int
+nat64_out2in_stateless_inner_set_cb (ip4_header_t * ip4, ip6_header_t * ip6,
+				     void *arg)
+{
+  nat64_stateless_mapping_t *m = arg;
+  ip4_address_t saddr, daddr;
+
+  saddr.as_u32 = ip4->src_address.as_u32;
+  daddr.as_u32 = ip4->dst_address.as_u32;
+
+  nat64_out2in_stateless_addr (&saddr, &ip6->src_address, m->fib_index);
+  nat64_out2in_stateless_addr (&daddr, &ip6->dst_address, m->fib_index);
+
+  return 0;
+}
+
+/**
+ * @brief Translate packet destined to stateless mapping outside prefix.
+ *
+ * Addresses are translated by prefix rules only, no BIB or session entry is
+ * looked up and the ports are left untouched.
+ *
+ * @returns 1 if the destination is covered by a stateless mapping,
+ * 0 otherwise.
+ */
+static_always_inline int
+nat64_out2in_stateless (vlib_node_runtime_t * node, vlib_buffer_t * b,
+			ip4_header_t * ip4, u32 * next)
+{
+  nat64_stateless_mapping_t *m;
+  int rv;
+
+  m = nat64_stateless_mapping_find_out (&ip4->dst_address);
+  if (!m)
+    return 0;
+
+  *next = NAT64_OUT2IN_NEXT_IP6_LOOKUP;
+
+  if (PREDICT_FALSE (ip4_is_fragment (ip4)))
+    {
+      /* ICMP checksum covers the whole message, can't fix it per fragment */
+      if (ip4->protocol == IP_PROTOCOL_ICMP)
+	{
+	  *next = NAT64_OUT2IN_NEXT_DROP;
+	  b->error = node->errors[NAT64_OUT2IN_ERROR_DROP_FRAGMENT];
+	  return 1;
+	}
+
+      if (ip4_is_first_fragment (ip4) &&
+	  (ip4->protocol == IP_PROTOCOL_TCP
+	   || ip4->protocol == IP_PROTOCOL_UDP))
+	rv = ip4_to_ip6_tcp_udp (b, nat64_out2in_stateless_set_cb, m);
+      else
+	rv = ip4_to_ip6_fragmented (b, nat64_out2in_stateless_set_cb, m);
+    }
+  else if (ip4->protocol == IP_PROTOCOL_TCP
+	   || ip4->protocol == IP_PROTOCOL_UDP)
+    rv = ip4_to_ip6_tcp_udp (b, nat64_out2in_stateless_set_cb, m);
+  else if (ip4->protocol == IP_PROTOCOL_ICMP)
+    rv = icmp_to_icmp6 (b, nat64_out2in_stateless_set_cb, m,
+			nat64_out2in_stateless_inner_set_cb, m);
+  else
+    rv = ip4_to_ip6 (b, nat64_out2in_stateless_set_cb, m);
+
+  if (rv)
+    {
+      *next = NAT64_OUT2IN_NEXT_DROP;
+      b->error = node->errors[NAT64_OUT2IN_ERROR_NO_TRANSLATION];
+    }
+
+  return 1;
+}
+
 VLIB_NODE_FN (nat64_out2in_node) (vlib_main_t * vm,
 				  vlib_node_runtime_t * node,
 				  vlib_frame_t * frame)
@@ -440,7 +545,7 @@ VLIB_NODE_FN (nat64_out2in_node) (vlib_main_t * vm,
   u32 pkts_processed = 0;
   u32 thread_index = vm->thread_index;
   u32 tcp_packets = 0, udp_packets = 0, icmp_packets = 0, other_packets =
-    0, fragments = 0;
+    0, fragments = 0, stateless_packets = 0;
 
   from = vlib_frame_vector_args (frame);
   n_left_from = frame->n_vectors;
@@ -478,6 +583,13 @@ VLIB_NODE_FN (nat64_out2in_node) (vlib_main_t * vm,
 
 	  next0 = NAT64_OUT2IN_NEXT_IP6_LOOKUP;
 
+	  if (PREDICT_FALSE (vec_len (nm->stateless_plens) != 0) &&
+	      nat64_out2in_stateless (node, b0, ip40, &next0))
+	    {
+	      stateless_packets++;
+	      goto trace0;
+	    }
+
 	  proto0 = ip_proto_to_snat_proto (ip40->protocol);
 
 	  if (PREDICT_FALSE (proto0 == ~0))
@@ -569,6 +681,9 @@ VLIB_NODE_FN (nat64_out2in_node) (vlib_main_t * vm,
 			       other_packets);
   vlib_node_increment_counter (vm, nm->out2in_node_index,
 			       NAT64_OUT2IN_ERROR_FRAGMENTS, fragments);
+  vlib_node_increment_counter (vm, nm->out2in_node_index,
+			       NAT64_OUT2IN_ERROR_STATELESS_PACKETS,
+			       stateless_packets);
 
   return frame->n_vectors;
 }
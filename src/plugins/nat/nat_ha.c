@@ -17,6 +17,7 @@
 #include <vnet/udp/udp.h>
 #include <nat/nat.h>
 #include <vppinfra/atomics.h>
+#include <vppinfra/mhash.h>
 
 /* number of retries */
 #define NAT_HA_RETRIES 3
@@ -31,10 +32,16 @@ _(SEND_REFRESH, "refresh-event-send", 5) \
 _(RECV_ACK, "ack-recv", 6)               \
 _(SEND_ACK, "ack-send", 7)               \
 _(RETRY_COUNT, "retry-count", 8)         \
-_(MISSED_COUNT, "missed-count", 9)
+_(MISSED_COUNT, "missed-count", 9)       \
+_(COALESCED, "event-coalesced", 10)
 
 /* NAT HA protocol version */
 #define NAT_HA_VERSION 0x01
+/* NAT HA protocol version with event type specific encoding */
+#define NAT_HA_VERSION_COMPACT 0x02
+
+/* maximum number of events held back for coalescing per thread */
+#define NAT_HA_COALESCE_MAX_EVENTS (64 << 10)
 
 /* NAT HA protocol flags */
 #define NAT_HA_FLAG_ACK 0x01
@@ -83,6 +90,43 @@ typedef struct
   u64 total_bytes;
 } __attribute__ ((packed)) nat_ha_event_t;
 
+/* NAT HA protocol compact session delete event data */
+typedef struct
+{
+  u8 event_type;
+  u8 protocol;
+  u16 out_port;
+  u32 out_addr;
+  u32 eh_addr;
+  u16 eh_port;
+  u32 fib_index;
+} __attribute__ ((packed)) nat_ha_compact_del_event_t;
+
+/* NAT HA protocol compact session refresh event data */
+typedef struct
+{
+  u8 event_type;
+  u8 protocol;
+  u16 out_port;
+  u32 out_addr;
+  u32 eh_addr;
+  u16 eh_port;
+  u32 fib_index;
+  u32 total_pkts;
+  u64 total_bytes;
+} __attribute__ ((packed)) nat_ha_compact_refresh_event_t;
+
+/* session identification for event coalescing */
+typedef struct
+{
+  u32 out_addr;
+  u32 eh_addr;
+  u16 out_port;
+  u16 eh_port;
+  u8 protocol;
+  u8 pad[3];
+} nat_ha_session_key_t;
+
 typedef enum
 {
 #define _(N, s, v) NAT_HA_COUNTER_##N = v,
@@ -117,8 +161,16 @@ typedef struct
   u16 state_sync_count;
   /* next event offset */
   u32 state_sync_next_event_offset;
+  /* 1 if buffer under construction uses compact encoding */
+  u8 state_sync_compact;
   /* data waiting for ACK */
   nat_ha_resend_entry_t *resend_queue;
+  /* events held back for coalescing */
+  nat_ha_event_t *coalesce_events;
+  /* held event index by session */
+  mhash_t coalesce_hash;
+  /* time when the oldest held event was queued */
+  f64 coalesce_start;
 } nat_ha_per_thread_data_t;
 
 /* NAT HA settings */
@@ -134,6 +186,10 @@ typedef struct nat_ha_main_s
   u32 state_sync_path_mtu;
   /* number of seconds after which to send session counters refresh */
   u32 session_refresh_interval;
+  /* time window to coalesce events of the same session in, 0 if disabled */
+  f64 coalesce_window;
+  /* 1 if event type specific encoding is used */
+  u8 compact;
   /* counters */
   vlib_simple_counter_main_t counters[NAT_HA_N_COUNTERS];
   vlib_main_t *vlib_main;
@@ -318,6 +374,8 @@ nat_ha_init (vlib_main_t * vm, nat_ha_sadd_cb_t sadd_cb,
   ha->in_resync = 0;
   ha->resync_ack_count = 0;
   ha->resync_ack_missed = 0;
+  ha->coalesce_window = 0;
+  ha->compact = 0;
   ha->vlib_main = vm;
   ha->sadd_cb = sadd_cb;
   ha->sdel_cb = sdel_cb;
@@ -410,6 +468,32 @@ nat_ha_get_failover (ip4_address_t * addr, u16 * port,
   *session_refresh_interval = ha->session_refresh_interval;
 }
 
+int
+nat_ha_set_sync_options (u32 coalesce_window_ms, u8 compact)
+{
+  nat_ha_main_t *ha = &nat_ha_main;
+
+  ha->coalesce_window = coalesce_window_ms * 1e-3;
+  ha->compact = compact != 0;
+
+  /* wake up the process to apply new period */
+  vlib_process_signal_event (ha->vlib_main, nat_ha_process_node.index, 1, 0);
+
+  return 0;
+}
+
+void
+nat_ha_get_sync_options (u32 * coalesce_window_ms, u8 * compact,
+			 u64 * events_coalesced)
+{
+  nat_ha_main_t *ha = &nat_ha_main;
+
+  *coalesce_window_ms = (u32) (ha->coalesce_window * 1e3 + 0.5);
+  *compact = ha->compact;
+  *events_coalesced =
+    vlib_get_simple_counter (&ha->counters[NAT_HA_COUNTER_COALESCED], 0);
+}
+
 static_always_inline void
 nat_ha_recv_add (nat_ha_event_t * event, f64 now, u32 thread_index)
 {
@@ -498,6 +582,7 @@ static inline void
 nat_ha_header_create (vlib_buffer_t * b, u32 * offset, u32 thread_index)
 {
   nat_ha_main_t *ha = &nat_ha_main;
+  nat_ha_per_thread_data_t *td = &ha->per_thread_data[thread_index];
   nat_ha_message_header_t *h;
   ip4_header_t *ip;
   udp_header_t *udp;
@@ -527,7 +612,9 @@ nat_ha_header_create (vlib_buffer_t * b, u32 * offset, u32 thread_index)
   udp->checksum = 0;
 
   /* NAT HA protocol header */
-  h->version = NAT_HA_VERSION;
+  td->state_sync_compact = ha->compact;
+  h->version = td->state_sync_compact ? NAT_HA_VERSION_COMPACT :
+    NAT_HA_VERSION;
   h->flags = 0;
   h->count = 0;
   h->thread_index = clib_host_to_net_u32 (thread_index);
@@ -566,6 +653,97 @@ nat_ha_send (vlib_frame_t * f, vlib_buffer_t * b, u8 is_resync,
   vlib_put_frame_to_node (vm, ip4_lookup_node.index, f);
 }
 
+/* write NAT HA protocol event, return number of bytes written */
+static_always_inline u32
+nat_ha_event_encode (u8 * data, nat_ha_event_t * event, u8 compact)
+{
+  nat_ha_compact_del_event_t *del;
+  nat_ha_compact_refresh_event_t *ref;
+
+  if (!compact || event->event_type == NAT_HA_ADD)
+    {
+      clib_memcpy_fast (data, event, sizeof (*event));
+      return sizeof (*event);
+    }
+
+  if (event->event_type == NAT_HA_DEL)
+    {
+      del = (nat_ha_compact_del_event_t *) data;
+      del->event_type = event->event_type;
+      del->protocol = event->protocol;
+      del->out_port = event->out_port;
+      del->out_addr = event->out_addr;
+      del->eh_addr = event->eh_addr;
+      del->eh_port = event->eh_port;
+      del->fib_index = event->fib_index;
+      return sizeof (*del);
+    }
+
+  ref = (nat_ha_compact_refresh_event_t *) data;
+  ref->event_type = event->event_type;
+  ref->protocol = event->protocol;
+  ref->out_port = event->out_port;
+  ref->out_addr = event->out_addr;
+  ref->eh_addr = event->eh_addr;
+  ref->eh_port = event->eh_port;
+  ref->fib_index = event->fib_index;
+  ref->total_pkts = event->total_pkts;
+  ref->total_bytes = event->total_bytes;
+  return sizeof (*ref);
+}
+
+/*
+ * Read NAT HA protocol event, return number of bytes read or 0 if the event
+ * does not fit into the message.
+ */
+static_always_inline u32
+nat_ha_event_decode (u8 * data, u32 len, nat_ha_event_t * event, u8 compact)
+{
+  nat_ha_compact_del_event_t *del;
+  nat_ha_compact_refresh_event_t *ref;
+
+  if (len < 1)
+    return 0;
+
+  if (!compact || data[0] == NAT_HA_ADD)
+    {
+      if (len < sizeof (*event))
+	return 0;
+      clib_memcpy_fast (event, data, sizeof (*event));
+      return sizeof (*event);
+    }
+
+  clib_memset (event, 0, sizeof (*event));
+  if (data[0] == NAT_HA_DEL)
+    {
+      if (len < sizeof (*del))
+	return 0;
+      del = (nat_ha_compact_del_event_t *) data;
+      event->event_type = del->event_type;
+      event->protocol = del->protocol;
+      event->out_port = del->out_port;
+      event->out_addr = del->out_addr;
+      event->eh_addr = del->eh_addr;
+      event->eh_port = del->eh_port;
+      event->fib_index = del->fib_index;
+      return sizeof (*del);
+    }
+
+  if (len < sizeof (*ref))
+    return 0;
+  ref = (nat_ha_compact_refresh_event_t *) data;
+  event->event_type = ref->event_type;
+  event->protocol = ref->protocol;
+  event->out_port = ref->out_port;
+  event->out_addr = ref->out_addr;
+  event->eh_addr = ref->eh_addr;
+  event->eh_port = ref->eh_port;
+  event->fib_index = ref->fib_index;
+  event->total_pkts = ref->total_pkts;
+  event->total_bytes = ref->total_bytes;
+  return sizeof (*ref);
+}
+
 /* add NAT HA protocol event */
 static_always_inline void
 nat_ha_event_add (nat_ha_event_t * event, u8 do_flush, u32 thread_index,
@@ -576,7 +754,7 @@ nat_ha_event_add (nat_ha_event_t * event, u8 do_flush, u32 thread_index,
   vlib_main_t *vm = vlib_mains[thread_index];
   vlib_buffer_t *b = 0;
   vlib_frame_t *f;
-  u32 bi = ~0, offset;
+  u32 bi = ~0, offset, len;
 
   b = td->state_sync_buffer;
 
@@ -618,10 +796,11 @@ nat_ha_event_add (nat_ha_event_t * event, u8 do_flush, u32 thread_index,
 
   if (PREDICT_TRUE (do_flush == 0))
     {
-      clib_memcpy_fast (b->data + offset, event, sizeof (*event));
-      offset += sizeof (*event);
+      len = nat_ha_event_encode (b->data + offset, event,
+				 td->state_sync_compact);
+      offset += len;
       td->state_sync_count++;
-      b->current_length += sizeof (*event);
+      b->current_length += len;
 
       switch (event->event_type)
 	{
@@ -663,6 +842,116 @@ nat_ha_event_add (nat_ha_event_t * event, u8 do_flush, u32 thread_index,
   td->state_sync_next_event_offset = offset;
 }
 
+/* send events held back for coalescing */
+static void
+nat_ha_coalesce_flush (u32 thread_index)
+{
+  nat_ha_main_t *ha = &nat_ha_main;
+  nat_ha_per_thread_data_t *td = &ha->per_thread_data[thread_index];
+  nat_ha_event_t *event;
+
+  if (!vec_len (td->coalesce_events))
+    return;
+
+  vec_foreach (event, td->coalesce_events)
+  {
+    /* cancelled */
+    if (!event->event_type)
+      continue;
+    nat_ha_event_add (event, 0, thread_index, 0);
+  }
+
+  vec_reset_length (td->coalesce_events);
+  mhash_init (&td->coalesce_hash, sizeof (uword),
+	      sizeof (nat_ha_session_key_t));
+}
+
+/*
+ * Hold event back for the coalesce window and merge it with event of the
+ * same session held already: refresh replaces held refresh, delete
+ * replaces held refresh and cancels held add, refresh after held add is
+ * dropped (the next refresh interval carries the counters).
+ */
+static_always_inline void
+nat_ha_event_coalesce (nat_ha_event_t * event, u32 thread_index, f64 now)
+{
+  nat_ha_main_t *ha = &nat_ha_main;
+  nat_ha_per_thread_data_t *td = &ha->per_thread_data[thread_index];
+  nat_ha_event_t *held;
+  nat_ha_session_key_t key = {
+    .out_addr = event->out_addr,
+    .eh_addr = event->eh_addr,
+    .out_port = event->out_port,
+    .eh_port = event->eh_port,
+    .protocol = event->protocol,
+  };
+  uword *p;
+
+  if (PREDICT_FALSE (!td->coalesce_hash.hash))
+    mhash_init (&td->coalesce_hash, sizeof (uword),
+		sizeof (nat_ha_session_key_t));
+
+  p = mhash_get (&td->coalesce_hash, &key);
+  if (p)
+    {
+      held = vec_elt_at_index (td->coalesce_events, p[0]);
+      switch (held->event_type)
+	{
+	case NAT_HA_ADD:
+	  if (event->event_type == NAT_HA_REFRESH)
+	    {
+	      vlib_increment_simple_counter (&ha->counters
+					     [NAT_HA_COUNTER_COALESCED],
+					     thread_index, 0, 1);
+	      return;
+	    }
+	  if (event->event_type == NAT_HA_DEL)
+	    {
+	      held->event_type = 0;
+	      mhash_unset (&td->coalesce_hash, &key, 0);
+	      vlib_increment_simple_counter (&ha->counters
+					     [NAT_HA_COUNTER_COALESCED],
+					     thread_index, 0, 2);
+	      return;
+	    }
+	  break;
+	case NAT_HA_REFRESH:
+	  if (event->event_type != NAT_HA_ADD)
+	    {
+	      clib_memcpy_fast (held, event, sizeof (*held));
+	      vlib_increment_simple_counter (&ha->counters
+					     [NAT_HA_COUNTER_COALESCED],
+					     thread_index, 0, 1);
+	      return;
+	    }
+	  break;
+	default:
+	  break;
+	}
+    }
+
+  if (!vec_len (td->coalesce_events))
+    td->coalesce_start = now;
+  vec_add1 (td->coalesce_events, *event);
+  mhash_set (&td->coalesce_hash, &key, vec_len (td->coalesce_events) - 1, 0);
+
+  if (PREDICT_FALSE
+      (vec_len (td->coalesce_events) >= NAT_HA_COALESCE_MAX_EVENTS))
+    nat_ha_coalesce_flush (thread_index);
+}
+
+/* send event now or hold it back for coalescing */
+static_always_inline void
+nat_ha_event_queue (nat_ha_event_t * event, u32 thread_index, f64 now)
+{
+  nat_ha_main_t *ha = &nat_ha_main;
+
+  if (ha->coalesce_window > 0)
+    nat_ha_event_coalesce (event, thread_index, now);
+  else
+    nat_ha_event_add (event, 0, thread_index, 0);
+}
+
 #define skip_if_disabled()          \
 do {                                \
   nat_ha_main_t *ha = &nat_ha_main; \
@@ -670,11 +959,30 @@ do {                                \
     return;                         \
 } while (0)
 
+/* send the held events and the data under construction of the thread */
+static void
+nat_ha_flush_thread (vlib_main_t * vm, void *data)
+{
+  nat_ha_main_t *ha = &nat_ha_main;
+  u32 thread_index = vm->thread_index;
+
+  if (!ha->dst_port || thread_index >= vec_len (ha->per_thread_data))
+    return;
+
+  nat_ha_coalesce_flush (thread_index);
+  nat_ha_event_add (0, 1, thread_index, 0);
+}
+
 void
 nat_ha_flush (u8 is_resync)
 {
   skip_if_disabled ();
+  /* resync events are all queued by the main thread */
+  nat_ha_coalesce_flush (0);
   nat_ha_event_add (0, 1, 0, is_resync);
+  /* each worker flushes its own queue */
+  if (vlib_num_workers ())
+    vlib_worker_rpc_call_all (nat_ha_flush_thread, 0, 0);
 }
 
 void
@@ -700,7 +1008,11 @@ nat_ha_sadd (ip4_address_t * in_addr, u16 in_port, ip4_address_t * out_addr,
   event.ehn_port = ehn_port;
   event.fib_index = clib_host_to_net_u32 (fib_index);
   event.protocol = proto;
-  nat_ha_event_add (&event, 0, thread_index, is_resync);
+  if (is_resync)
+    nat_ha_event_add (&event, 0, thread_index, is_resync);
+  else
+    nat_ha_event_queue (&event, thread_index,
+			vlib_time_now (vlib_mains[thread_index]));
 }
 
 void
@@ -719,7 +1031,8 @@ nat_ha_sdel (ip4_address_t * out_addr, u16 out_port, ip4_address_t * eh_addr,
   event.eh_port = eh_port;
   event.fib_index = clib_host_to_net_u32 (fib_index);
   event.protocol = proto;
-  nat_ha_event_add (&event, 0, thread_index, 0);
+  nat_ha_event_queue (&event, thread_index,
+		      vlib_time_now (vlib_mains[thread_index]));
 }
 
 void
@@ -746,7 +1059,7 @@ nat_ha_sref (ip4_address_t * out_addr, u16 out_port, ip4_address_t * eh_addr,
   event.protocol = proto;
   event.total_pkts = clib_host_to_net_u32 (total_pkts);
   event.total_bytes = clib_host_to_net_u64 (total_bytes);
-  nat_ha_event_add (&event, 0, thread_index, 0);
+  nat_ha_event_queue (&event, thread_index, now);
 }
 
 /* per thread process waiting for interrupt */
@@ -754,11 +1067,18 @@ static uword
 nat_ha_worker_fn (vlib_main_t * vm, vlib_node_runtime_t * rt,
 		  vlib_frame_t * f)
 {
+  nat_ha_main_t *ha = &nat_ha_main;
   u32 thread_index = vm->thread_index;
+  nat_ha_per_thread_data_t *td = &ha->per_thread_data[thread_index];
+  f64 now = vlib_time_now (vm);
+  /* send events whose coalesce window expired */
+  if (vec_len (td->coalesce_events) &&
+      (td->coalesce_start + ha->coalesce_window <= now))
+    nat_ha_coalesce_flush (thread_index);
   /* flush HA NAT data under construction */
   nat_ha_event_add (0, 1, thread_index, 0);
   /* scan if we need to resend some non-ACKed data */
-  nat_ha_resend_scan (vlib_time_now (vm), thread_index);
+  nat_ha_resend_scan (now, thread_index);
   return 0;
 }
 
@@ -788,7 +1108,9 @@ nat_ha_process (vlib_main_t * vm, vlib_node_runtime_t * rt, vlib_frame_t * f)
 
   while (1)
     {
-      vlib_process_wait_for_event_or_clock (vm, 1.0);
+      vlib_process_wait_for_event_or_clock (vm, ha->coalesce_window > 0 ?
+					    clib_min (ha->coalesce_window,
+						      1.0) : 1.0);
       event_type = vlib_process_get_events (vm, &event_data);
       vec_reset_length (event_data);
       for (ti = 0; ti < vec_len (vlib_mains); ti++)
@@ -888,7 +1210,8 @@ typedef enum
 
 #define foreach_nat_ha_error   \
 _(PROCESSED, "pkts-processed") \
-_(BAD_VERSION, "bad-version")
+_(BAD_VERSION, "bad-version")  \
+_(TRUNCATED, "truncated-message")
 
 typedef enum
 {
@@ -932,7 +1255,9 @@ nat_ha_node_fn (vlib_main_t * vm, vlib_node_runtime_t * node,
 	  u32 bi0, next0, src_addr0, dst_addr0;;
 	  vlib_buffer_t *b0;
 	  nat_ha_message_header_t *h0;
-	  nat_ha_event_t *e0;
+	  nat_ha_event_t e0;
+	  u8 *data0;
+	  u32 data_len0, hdr_len0, event_len0;
 	  u16 event_count0, src_port0, dst_port0, old_len0;
 	  ip4_header_t *ip0;
 	  udp_header_t *udp0;
@@ -954,7 +1279,8 @@ nat_ha_node_fn (vlib_main_t * vm, vlib_node_runtime_t * node,
 
 	  next0 = NAT_HA_NEXT_DROP;
 
-	  if (h0->version != NAT_HA_VERSION)
+	  if (h0->version != NAT_HA_VERSION &&
+	      h0->version != NAT_HA_VERSION_COMPACT)
 	    {
 	      b0->error = node->errors[NAT_HA_ERROR_BAD_VERSION];
 	      goto done0;
@@ -969,14 +1295,27 @@ nat_ha_node_fn (vlib_main_t * vm, vlib_node_runtime_t * node,
 	      goto done0;
 	    }
 
-	  e0 = (nat_ha_event_t *) (h0 + 1);
+	  data0 = (u8 *) (h0 + 1);
+	  data_len0 = clib_net_to_host_u16 (ip0->length);
+	  hdr_len0 = data0 - (u8 *) ip0;
+	  data_len0 = data_len0 > hdr_len0 ? data_len0 - hdr_len0 : 0;
 
 	  /* process each event */
 	  while (event_count0)
 	    {
-	      nat_ha_event_process (e0, now, thread_index);
+	      event_len0 =
+		nat_ha_event_decode (data0, data_len0, &e0,
+				     h0->version == NAT_HA_VERSION_COMPACT);
+	      if (PREDICT_FALSE (!event_len0))
+		{
+		  b0->error = node->errors[NAT_HA_ERROR_TRUNCATED];
+		  next0 = NAT_HA_NEXT_DROP;
+		  goto done0;
+		}
+	      nat_ha_event_process (&e0, now, thread_index);
 	      event_count0--;
-	      e0 = (nat_ha_event_t *) ((u8 *) e0 + sizeof (nat_ha_event_t));
+	      data0 += event_len0;
+	      data_len0 -= event_len0;
 	    }
 
 	  next0 = NAT_HA_NEXT_IP4_LOOKUP;
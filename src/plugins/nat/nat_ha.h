@@ -79,6 +79,25 @@ int nat_ha_set_failover (ip4_address_t * addr, u16 port,
 void nat_ha_get_failover (ip4_address_t * addr, u16 * port,
 			  u32 * session_refresh_interval);
 
+/**
+ * @brief Set HA state sync options
+ *
+ * @param coalesce_window_ms time window in milliseconds in which events of
+ *                           the same session are merged before sending,
+ *                           0 to send events right away
+ * @param compact 1 to encode events with type specific size (protocol
+ *                version 2), 0 to keep version 1 encoding
+ *
+ * @returns 0 on success, non-zero value otherwise.
+ */
+int nat_ha_set_sync_options (u32 coalesce_window_ms, u8 compact);
+
+/**
+ * @brief Get HA state sync options
+ */
+void nat_ha_get_sync_options (u32 * coalesce_window_ms, u8 * compact,
+			      u64 * events_coalesced);
+
 /**
  * @brief Create session add HA event
  *
@@ -138,7 +157,9 @@ void nat_ha_sref (ip4_address_t * out_addr, u16 out_port,
 		  u32 thread_index, f64 * last_refreshed, f64 now);
 
 /**
- * @brief Flush the current HA data (for testing)
+ * @brief Flush the current HA data of all threads (for testing)
+ *
+ * The workers flush their data asynchronously, by RPC.
  */
 void nat_ha_flush (u8 is_resync);
 
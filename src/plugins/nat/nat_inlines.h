@@ -101,6 +101,21 @@ maximum_sessions_exceeded (snat_main_t * sm, u32 thread_index)
   return 0;
 }
 
+/**
+ * @brief Check if maximum sessions per thread would be exceeded by new
+ *        endpoint-dependent session, after trying to reclaim the least
+ *        recently used one
+ */
+always_inline u8
+nat44_ed_maximum_sessions_exceeded (snat_main_t * sm, u32 thread_index,
+				    f64 now)
+{
+  if (PREDICT_TRUE (!maximum_sessions_exceeded (sm, thread_index)))
+    return 0;
+
+  return !nat44_ed_session_lru_reclaim (sm, thread_index, now);
+}
+
 always_inline void
 nat_send_all_to_node (vlib_main_t * vm, u32 * bi_vector,
 		      vlib_node_runtime_t * node, vlib_error_t * error,
@@ -177,6 +192,8 @@ nat44_delete_session (snat_main_t * sm, snat_session_t * ses,
 
   nat_log_debug ("session deleted %U", format_snat_session, tsm, ses);
 
+  if (ses->lru_index != ~0)
+    nat44_ed_session_unlink (sm, ses, thread_index);
   clib_dlist_remove (tsm->list_pool, ses->per_user_index);
   pool_put_index (tsm->list_pool, ses->per_user_index);
   pool_put (tsm->sessions, ses);
@@ -205,6 +222,8 @@ always_inline int
 nat44_set_tcp_session_state_i2o (snat_main_t * sm, snat_session_t * ses,
 				 tcp_header_t * tcp, u32 thread_index)
 {
+  u8 old_state = ses->state;
+
   if ((ses->state == 0) && (tcp->flags & TCP_FLAG_RST))
     ses->state = NAT44_SES_RST;
   if ((ses->state == NAT44_SES_RST) && !(tcp->flags & TCP_FLAG_RST))
@@ -233,6 +252,9 @@ nat44_set_tcp_session_state_i2o (snat_main_t * sm, snat_session_t * ses,
       nat44_delete_session (sm, ses, thread_index);
       return 1;
     }
+  /* transitory timeout is shorter, do not wait for the established one */
+  if (!old_state && ses->state && ses->timer_handle != ~0)
+    nat44_ed_session_timer_update (sm, ses, thread_index);
   return 0;
 }
 
@@ -240,6 +262,8 @@ always_inline int
 nat44_set_tcp_session_state_o2i (snat_main_t * sm, snat_session_t * ses,
 				 tcp_header_t * tcp, u32 thread_index)
 {
+  u8 old_state = ses->state;
+
   if ((ses->state == 0) && (tcp->flags & TCP_FLAG_RST))
     ses->state = NAT44_SES_RST;
   if ((ses->state == NAT44_SES_RST) && !(tcp->flags & TCP_FLAG_RST))
@@ -267,6 +291,9 @@ nat44_set_tcp_session_state_o2i (snat_main_t * sm, snat_session_t * ses,
       nat44_delete_session (sm, ses, thread_index);
       return 1;
     }
+  /* transitory timeout is shorter, do not wait for the established one */
+  if (!old_state && ses->state && ses->timer_handle != ~0)
+    nat44_ed_session_timer_update (sm, ses, thread_index);
   return 0;
 }
 
@@ -306,15 +333,22 @@ nat44_session_update_counters (snat_session_t * s, f64 now, uword bytes,
 	       &s->ha_last_refreshed, now);
 }
 
-/** \brief Per-user LRU list maintenance */
+/** \brief Per-user and per-thread LRU list maintenance */
 always_inline void
 nat44_session_update_lru (snat_main_t * sm, snat_session_t * s,
 			  u32 thread_index)
 {
-  clib_dlist_remove (sm->per_thread_data[thread_index].list_pool,
-		     s->per_user_index);
-  clib_dlist_addtail (sm->per_thread_data[thread_index].list_pool,
-		      s->per_user_list_head_index, s->per_user_index);
+  snat_main_per_thread_data_t *tsm = &sm->per_thread_data[thread_index];
+
+  clib_dlist_remove (tsm->list_pool, s->per_user_index);
+  clib_dlist_addtail (tsm->list_pool, s->per_user_list_head_index,
+		      s->per_user_index);
+  if (s->lru_index != ~0)
+    {
+      clib_dlist_remove (tsm->list_pool, s->lru_index);
+      clib_dlist_addtail (tsm->list_pool, tsm->lru_head_index,
+			  s->lru_index);
+    }
 }
 
 always_inline void
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2019 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @file
+ * @brief NAT plugin RSS-aware outside port selection
+ */
+
+#include <nat/nat.h>
+#include <nat/nat_rss.h>
+
+nat_rss_main_t nat_rss_main;
+
+/* default Toeplitz key used by most NIC drivers */
+static u8 nat_rss_default_key[40] = {
+  0x6d, 0x5a, 0x56, 0xda, 0x25, 0x5b, 0x0e, 0xc2,
+  0x41, 0x67, 0x25, 0x3d, 0x43, 0xa3, 0x8f, 0xb0,
+  0xd0, 0xca, 0x2b, 0xcb, 0xae, 0x7b, 0x30, 0xb4,
+  0x77, 0xcb, 0x2d, 0xa3, 0x80, 0x30, 0xf2, 0x0c,
+  0x6a, 0x42, 0xb7, 0x3b, 0xbe, 0xac, 0x01, 0xfa,
+};
+
+/* 32 key bits starting at given bit position */
+static u32
+nat_rss_key_window (u8 * key, u32 bit)
+{
+  u64 w = 0;
+  u32 i;
+
+  for (i = 0; i < 5; i++)
+    w = (w << 8) | key[bit / 8 + i];
+
+  return (u32) (w >> (8 - bit % 8));
+}
+
+static void
+nat_rss_hash_init (nat_rss_main_t * rm)
+{
+  u32 offset, value, bit;
+  u32 hash;
+
+  for (offset = 0; offset < NAT_RSS_INPUT_LEN; offset++)
+    for (value = 0; value < 256; value++)
+      {
+	hash = 0;
+	for (bit = 0; bit < 8; bit++)
+	  if (value & (0x80 >> bit))
+	    hash ^= nat_rss_key_window (rm->key, offset * 8 + bit);
+	rm->hash_by_byte[offset][value] = hash;
+      }
+}
+
+int
+nat_rss_enable (u32 sw_if_index, u32 reta_size, u8 * key, u32 * reta)
+{
+  nat_rss_main_t *rm = &nat_rss_main;
+  snat_main_t *sm = &snat_main;
+  vlib_main_t *vm = vlib_get_main ();
+  vnet_hw_interface_t *hw;
+  nat_rss_main_t *new;
+  u32 *old_thread_by_reta;
+  uword *old_threads;
+  u8 *old_key;
+  u32 i, q, n_queues;
+
+  if (!sm->endpoint_dependent)
+    return VNET_API_ERROR_UNSUPPORTED;
+
+  if (reta)
+    reta_size = vec_len (reta);
+  else if (!reta_size)
+    reta_size = NAT_RSS_DEFAULT_RETA_SIZE;
+  if (!is_pow2 (reta_size) || reta_size > 4096)
+    return VNET_API_ERROR_INVALID_VALUE;
+
+  /* the key must cover the whole hash input plus one 32-bit window */
+  if (key && vec_len (key) < NAT_RSS_INPUT_LEN + 4)
+    return VNET_API_ERROR_INVALID_VALUE_2;
+
+  if (!vnet_sw_interface_is_valid (sm->vnet_main, sw_if_index))
+    return VNET_API_ERROR_INVALID_SW_IF_INDEX;
+
+  hw = vnet_get_sup_hw_interface (sm->vnet_main, sw_if_index);
+  n_queues = vec_len (hw->input_node_thread_index_by_queue);
+  if (!n_queues)
+    return VNET_API_ERROR_INVALID_INTERFACE;
+
+  /* a round-robin table with fewer entries than queues is not a default */
+  if (!reta && reta_size < n_queues)
+    return VNET_API_ERROR_INVALID_VALUE_3;
+  vec_foreach_index (i, reta)
+  {
+    if (reta[i] >= n_queues)
+      return VNET_API_ERROR_INVALID_VALUE_3;
+  }
+
+  /* build the new tables aside, the workers use the current ones */
+  new = clib_mem_alloc (sizeof (*new));
+  clib_memset (new, 0, sizeof (*new));
+  if (key)
+    new->key = vec_dup (key);
+  else
+    vec_add (new->key, nat_rss_default_key, ARRAY_LEN (nat_rss_default_key));
+  nat_rss_hash_init (new);
+
+  for (i = 0; i < reta_size; i++)
+    {
+      q = reta ? reta[i] : i % n_queues;
+      vec_add1 (new->thread_by_reta, hw->input_node_thread_index_by_queue[q]);
+      new->threads = clib_bitmap_set (new->threads,
+				      new->thread_by_reta[i], 1);
+    }
+
+  /* and swap them in while no worker is allocating ports */
+  vlib_worker_thread_barrier_sync (vm);
+  clib_memcpy_fast (rm->hash_by_byte, new->hash_by_byte,
+		    sizeof (rm->hash_by_byte));
+  old_key = rm->key;
+  old_thread_by_reta = rm->thread_by_reta;
+  old_threads = rm->threads;
+  rm->key = new->key;
+  rm->thread_by_reta = new->thread_by_reta;
+  rm->threads = new->threads;
+  rm->sw_if_index = sw_if_index;
+  rm->enabled = 1;
+  vlib_worker_thread_barrier_release (vm);
+
+  vec_free (old_key);
+  vec_free (old_thread_by_reta);
+  clib_bitmap_free (old_threads);
+  clib_mem_free (new);
+
+  return 0;
+}
+
+void
+nat_rss_disable (void)
+{
+  nat_rss_main_t *rm = &nat_rss_main;
+
+  rm->enabled = 0;
+  rm->sw_if_index = ~0;
+}
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2019 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @file
+ * @brief NAT plugin RSS-aware outside port selection
+ *
+ * The outside port of a new endpoint-dependent session is picked so that
+ * the NIC RSS (Toeplitz) hash of the return 5-tuple steers out2in packets
+ * to the receive queue polled by the worker owning the session, so they
+ * need no handoff.
+ */
+
+#ifndef __included_nat_rss_h__
+#define __included_nat_rss_h__
+
+#include <vnet/ip/ip.h>
+
+/* Size of the IPv4 RSS hash input: src addr, dst addr, src port, dst port */
+#define NAT_RSS_INPUT_LEN 12
+
+/* Random port picks to try before accepting a port hashed elsewhere */
+#define NAT_RSS_MAX_TRIES 32
+
+#define NAT_RSS_DEFAULT_RETA_SIZE 128
+
+typedef struct
+{
+  /* Toeplitz hash contribution of each byte value at each input offset */
+  u32 hash_by_byte[NAT_RSS_INPUT_LEN][256];
+
+  /* RSS redirection table resolved to the thread polling each queue */
+  u32 *thread_by_reta;
+
+  /* threads present in the redirection table */
+  uword *threads;
+
+  /* outside interface receiving the out2in traffic */
+  u32 sw_if_index;
+
+  u8 *key;
+  u8 enabled;
+} nat_rss_main_t;
+
+/* RSS context of a single port allocation */
+typedef struct
+{
+  /* hash of the remote endpoint part of the return 5-tuple */
+  u32 remote_hash;
+  /* thread the return traffic should be steered to */
+  u32 thread_index;
+} nat_rss_ctx_t;
+
+extern nat_rss_main_t nat_rss_main;
+
+always_inline u32
+nat_rss_hash_bytes (nat_rss_main_t * rm, u8 * data, u32 offset, u32 len)
+{
+  u32 i, hash = 0;
+
+  for (i = 0; i < len; i++)
+    hash ^= rm->hash_by_byte[offset + i][data[i]];
+
+  return hash;
+}
+
+/**
+ * @brief Partial RSS hash of the return 5-tuple covering the remote endpoint
+ *
+ * @param rm     NAT RSS main
+ * @param r_addr remote address (source of the return traffic)
+ * @param r_port remote port in network byte order
+ */
+always_inline u32
+nat_rss_remote_hash (nat_rss_main_t * rm, ip4_address_t * r_addr, u16 r_port)
+{
+  return nat_rss_hash_bytes (rm, r_addr->as_u8, 0, 4) ^
+    nat_rss_hash_bytes (rm, (u8 *) & r_port, 8, 2);
+}
+
+/**
+ * @brief Get thread receiving the return traffic of outside address and port
+ *
+ * @param rm          NAT RSS main
+ * @param remote_hash partial hash from nat_rss_remote_hash
+ * @param addr        outside address (destination of the return traffic)
+ * @param port        outside port in host byte order
+ */
+always_inline u32
+nat_rss_thread_index (nat_rss_main_t * rm, u32 remote_hash,
+		      ip4_address_t * addr, u16 port)
+{
+  u32 hash;
+
+  hash = remote_hash ^ nat_rss_hash_bytes (rm, addr->as_u8, 4, 4) ^
+    rm->hash_by_byte[10][port >> 8] ^ rm->hash_by_byte[11][port & 0xff];
+
+  return rm->thread_by_reta[hash & (vec_len (rm->thread_by_reta) - 1)];
+}
+
+/**
+ * @brief Enable RSS-aware outside port selection
+ *
+ * The redirection table is not read from the NIC. Without reta, it is
+ * taken to be the driver default, the receive queues assigned to the
+ * entries round-robin, which needs at least one entry per queue.
+ * Any other table has to be given in reta.
+ *
+ * @param sw_if_index outside interface
+ * @param reta_size   RSS redirection table size, power of two
+ * @param key         RSS hash key, default key is used if 0
+ * @param reta        receive queue of each redirection table entry,
+ *                    overrides reta_size, round-robin is used if 0
+ *
+ * @return 0 on success, non-zero value otherwise
+ */
+int nat_rss_enable (u32 sw_if_index, u32 reta_size, u8 * key, u32 * reta);
+
+/**
+ * @brief Disable RSS-aware outside port selection
+ */
+void nat_rss_disable (void);
+
+#endif /* __included_nat_rss_h__ */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
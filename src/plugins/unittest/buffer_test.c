@@ -0,0 +1,294 @@
+/*
+ * Copyright (c) 2019 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vlib/vlib.h>
+#include <pthread.h>
+
+typedef struct
+{
+  volatile u32 thread_barrier;
+  volatile u32 threads_running;
+  u32 n_magazines;
+  u32 n_cycles;
+
+  /* thread holding each magazine, ~0 while it sits in the depot */
+  u32 *owner;
+
+  /* magazines owned by two threads at once, or not returned */
+  volatile u32 n_errors;
+
+  vlib_buffer_depot_t depot;
+} buffer_test_main_t;
+
+static buffer_test_main_t buffer_test_main;
+
+#define BUFFER_TEST_I(_cond, _comment, _args...)		\
+({								\
+  int _evald = (_cond);						\
+  if (!(_evald)) {						\
+    fformat(stderr, "FAIL:%d: " _comment "\n",			\
+	    __LINE__, ##_args);					\
+  }								\
+  _evald;							\
+})
+
+#define BUFFER_TEST(_cond, _comment, _args...)			\
+{								\
+  if (!BUFFER_TEST_I(_cond, _comment, ##_args)) {		\
+    return 1;							\
+  }								\
+}
+
+/* Fill, overflow and drain a depot many times, so the slot sequence
+   numbers wrap around the ring */
+static int
+buffer_test_depot_fifo (vlib_main_t * vm)
+{
+  vlib_buffer_depot_t _d, *d = &_d;
+  u32 i, round;
+
+  clib_memset (d, 0, sizeof (*d));
+  vlib_buffer_depot_init (d, 8);
+
+  for (round = 0; round < 1000; round++)
+    {
+      BUFFER_TEST (vlib_buffer_depot_dequeue (d) == ~0,
+		   "round %u: empty depot dequeued", round);
+      for (i = 0; i < 8; i++)
+	BUFFER_TEST (vlib_buffer_depot_enqueue (d, round + i) == 0,
+		     "round %u: enqueue %u failed", round, i);
+      BUFFER_TEST (vlib_buffer_depot_enqueue (d, ~0) == -1,
+		   "round %u: full depot enqueued", round);
+      for (i = 0; i < 8; i++)
+	BUFFER_TEST (vlib_buffer_depot_dequeue (d) == round + i,
+		     "round %u: dequeue %u out of order", round, i);
+    }
+
+  vec_free (d->slots);
+  vlib_cli_output (vm, "depot fifo test passed");
+  return 0;
+}
+
+static void *
+buffer_test_depot_thread_fn (void *arg)
+{
+  buffer_test_main_t *tm = &buffer_test_main;
+  u32 my_thread_index = (uword) arg;
+  u32 held[4], n_held, i, j;
+
+  while (tm->thread_barrier)
+    ;
+
+  for (i = 0; i < tm->n_cycles; i++)
+    {
+      /* take a few magazines, as a refill would */
+      for (n_held = 0; n_held < ARRAY_LEN (held); n_held++)
+	{
+	  held[n_held] = vlib_buffer_depot_dequeue (&tm->depot);
+	  if (held[n_held] == ~0)
+	    break;
+	  if (!clib_atomic_bool_cmp_and_swap (&tm->owner[held[n_held]], ~0,
+					      my_thread_index))
+	    clib_atomic_fetch_add (&tm->n_errors, 1);
+	}
+
+      /* and give them back, as a spill would */
+      for (j = 0; j < n_held; j++)
+	{
+	  clib_atomic_store_rel_n (&tm->owner[held[j]], ~0);
+	  if (vlib_buffer_depot_enqueue (&tm->depot, held[j]))
+	    clib_atomic_fetch_add (&tm->n_errors, 1);
+	}
+    }
+
+  clib_atomic_fetch_sub (&tm->threads_running, 1);
+  pthread_exit (0);
+  return 0;
+}
+
+/* Threads exchange magazines through one depot, each magazine must be
+   held by a single thread at a time and none may get lost */
+static int
+buffer_test_depot_threads (vlib_main_t * vm, u32 n_threads)
+{
+  buffer_test_main_t *tm = &buffer_test_main;
+  vlib_buffer_depot_t *d = &tm->depot;
+  uword *seen = 0;
+  pthread_t handle;
+  u32 i, magazine, n_seen = 0;
+  int rv;
+
+  clib_memset (d, 0, sizeof (*d));
+  vlib_buffer_depot_init (d, max_pow2 (tm->n_magazines));
+  vec_validate_init_empty (tm->owner, tm->n_magazines - 1, ~0);
+  for (i = 0; i < tm->n_magazines; i++)
+    vlib_buffer_depot_enqueue (d, i);
+  tm->n_errors = 0;
+
+  tm->thread_barrier = 1;
+  tm->threads_running = 0;
+  for (i = 0; i < n_threads; i++)
+    {
+      rv = pthread_create (&handle, NULL, buffer_test_depot_thread_fn,
+			   (void *) (uword) i);
+      if (rv)
+	{
+	  clib_unix_warning ("pthread_create returned %d", rv);
+	  continue;
+	}
+      pthread_detach (handle);
+      tm->threads_running++;
+    }
+  CLIB_MEMORY_BARRIER ();
+  tm->thread_barrier = 0;
+
+  while (tm->threads_running > 0)
+    CLIB_PAUSE ();
+
+  while ((magazine = vlib_buffer_depot_dequeue (d)) != ~0)
+    {
+      BUFFER_TEST (magazine < tm->n_magazines,
+		   "bogus magazine %u dequeued", magazine);
+      BUFFER_TEST (!clib_bitmap_get (seen, magazine),
+		   "magazine %u dequeued twice", magazine);
+      seen = clib_bitmap_set (seen, magazine, 1);
+      n_seen++;
+    }
+
+  clib_bitmap_free (seen);
+  vec_free (tm->owner);
+  vec_free (d->slots);
+
+  BUFFER_TEST (tm->n_errors == 0, "%u ownership or enqueue errors",
+	       tm->n_errors);
+  BUFFER_TEST (n_seen == tm->n_magazines, "%u of %u magazines left",
+	       n_seen, tm->n_magazines);
+
+  vlib_cli_output (vm, "depot threads test passed: %u threads, %u cycles",
+		   n_threads, tm->n_cycles);
+  return 0;
+}
+
+/* Allocate from a pool as an rx queue refill does, the shortfall shows
+   up in the pool counters */
+static clib_error_t *
+buffer_test_rx_pool (vlib_main_t * vm, u8 * pool_name, u32 n_buffers)
+{
+  vlib_buffer_main_t *bm = vm->buffer_main;
+  vlib_buffer_pool_t *bp;
+  u8 index = ~0;
+  u32 *buffers = 0, n_alloc;
+
+  /* *INDENT-OFF* */
+  vec_foreach (bp, bm->buffer_pools)
+    if (!strcmp ((char *) bp->name, (char *) pool_name))
+      index = bp->index;
+  /* *INDENT-ON* */
+
+  if (index == (u8) ~ 0)
+    return clib_error_return (0, "unknown buffer pool '%s'", pool_name);
+
+  vec_validate (buffers, n_buffers - 1);
+  n_alloc = vlib_buffer_alloc_from_rx_pool (vm, buffers, n_buffers, index);
+  vlib_cli_output (vm, "allocated %u of %u buffers", n_alloc, n_buffers);
+  vlib_buffer_free (vm, buffers, n_alloc);
+  vec_free (buffers);
+
+  return 0;
+}
+
+static clib_error_t *
+test_buffer_command_fn (vlib_main_t * vm,
+			unformat_input_t * input, vlib_cli_command_t * cmd)
+{
+  buffer_test_main_t *tm = &buffer_test_main;
+  clib_error_t *error = 0;
+  u8 *pool_name = 0;
+  u32 n_threads = 0, n_buffers = 1024;
+  int res = 0;
+
+  tm->n_magazines = 16;
+  tm->n_cycles = 100000;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "depot"))
+	;
+      else if (unformat (input, "threads %u", &n_threads))
+	;
+      else if (unformat (input, "magazines %u", &tm->n_magazines))
+	;
+      else if (unformat (input, "cycles %u", &tm->n_cycles))
+	;
+      else if (unformat (input, "rx-pool %s", &pool_name))
+	;
+      else if (unformat (input, "buffers %u", &n_buffers))
+	;
+      else
+	return clib_error_return (0, "unknown input '%U'",
+				  format_unformat_error, input);
+    }
+
+  if (pool_name)
+    {
+      vec_add1 (pool_name, 0);
+      if (n_buffers)
+	error = buffer_test_rx_pool (vm, pool_name, n_buffers);
+      else
+	error = clib_error_return (0, "buffers must be non-zero");
+      vec_free (pool_name);
+      return error;
+    }
+
+  if (tm->n_magazines == 0)
+    return clib_error_return (0, "magazines must be non-zero");
+
+  res = buffer_test_depot_fifo (vm);
+  if (!res && n_threads)
+    res = buffer_test_depot_threads (vm, n_threads);
+
+  if (res)
+    return clib_error_return (0, "buffer depot unit test failed");
+
+  return 0;
+}
+
+/*?
+ * Unit test of the buffer pool magazine depot. With threads, the threads
+ * repeatedly take and return magazines through a shared depot. With
+ * rx-pool, allocate and free buffers the way an rx queue refills from the
+ * given pool.
+ *
+ * @cliexpar
+ * @cliexcmd{test buffer depot threads 4 magazines 16}
+ * @cliexcmd{test buffer rx-pool small buffers 1024}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (test_buffer_command, static) =
+{
+  .path = "test buffer",
+  .short_help = "test buffer depot [threads <n>] [magazines <n>] "
+    "[cycles <n>] | rx-pool <name> [buffers <n>]",
+  .function = test_buffer_command_fn,
+};
+/* *INDENT-ON* */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2019 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <vlib/vlib.h>
+#include <vnet/classify/vnet_classify.h>
+#include <vppinfra/random.h>
+
+/*
+ * Classifier hash + lookup micro-benchmark. The lookup loop is built
+ * for each CPU variant, and the best one for the running CPU is chosen
+ * at start-up, just as it is for the classifier graph nodes.
+ */
+
+/* *INDENT-OFF* */
+CLIB_MARCH_FN (classify_test_lookup, u32, vnet_classify_table_t * t,
+	       u8 * packets, u32 packet_size, u32 n_packets, u32 n_lookups)
+{
+  vnet_classify_entry_t *e;
+  u32 i, pi, n_hits = 0;
+  u8 *h;
+  u64 hash;
+
+  for (i = 0; i < n_lookups; i++)
+    {
+      pi = i % n_packets;
+      h = packets + pi * packet_size;
+      hash = vnet_classify_hash_packet_inline (t, h);
+      e = vnet_classify_find_entry_inline (t, h, hash, 0 /* now */ );
+      if (e && e->opaque_index == pi)
+	n_hits++;
+    }
+
+  return n_hits;
+}
+/* *INDENT-ON* */
+
+#ifndef CLIB_MARCH_VARIANT
+static clib_error_t *
+test_classify_command_fn (vlib_main_t * vm,
+			  unformat_input_t * input, vlib_cli_command_t * cmd)
+{
+  vnet_classify_main_t *cm = &vnet_classify_main;
+  clib_error_t *error = 0;
+  u32 n_sessions = 10000, n_lookups = 1000000;
+  u32 skip = 0, match = 1, packet_size, table_index = ~0;
+  uword memory_size = 64 << 20;
+  u32 seed = 0xdeaddabe;
+  vnet_classify_table_t *t;
+  u8 *mask = 0, *packets = 0;
+  u64 t0, t1;
+  u32 i, n_hits;
+  int rv;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "sessions %u", &n_sessions))
+	;
+      else if (unformat (input, "lookups %u", &n_lookups))
+	;
+      else if (unformat (input, "skip %u", &skip))
+	;
+      else if (unformat (input, "match %u", &match))
+	;
+      else if (unformat (input, "seed %u", &seed))
+	;
+      else if (unformat (input, "memory-size %U",
+			 unformat_memory_size, &memory_size))
+	;
+      else
+	return clib_error_return (0, "unknown input '%U'",
+				  format_unformat_error, input);
+    }
+
+  if (match < 1 || match > 5)
+    return clib_error_return (0, "match must be between 1 and 5");
+  if (n_sessions == 0)
+    return clib_error_return (0, "need at least one session");
+
+  packet_size = (skip + match) * sizeof (u32x4);
+
+  vec_validate_aligned (mask, match * sizeof (u32x4) - 1, sizeof (u32x4));
+  clib_memset (mask, 0xff, vec_len (mask));
+
+  rv = vnet_classify_add_del_table (cm, mask, max_pow2 (n_sessions / 2 + 1),
+				    memory_size, skip, match,
+				    ~0 /* next_table_index */ ,
+				    ~0 /* miss_next_index */ ,
+				    &table_index, 0, 0, 1 /* is_add */ ,
+				    0 /* del_chain */ );
+  if (rv)
+    {
+      error = clib_error_return (0, "table add failed, rv %d", rv);
+      goto done;
+    }
+
+  vec_validate_aligned (packets, n_sessions * packet_size - 1,
+			CLIB_CACHE_LINE_BYTES);
+  for (i = 0; i < vec_len (packets) / sizeof (u32); i++)
+    ((u32 *) packets)[i] = random_u32 (&seed);
+
+  for (i = 0; i < n_sessions; i++)
+    {
+      rv = vnet_classify_add_del_session (cm, table_index,
+					  packets + i * packet_size,
+					  ~0 /* hit_next_index */ ,
+					  i /* opaque_index */ ,
+					  0, 0, 0, 1 /* is_add */ );
+      if (rv)
+	{
+	  error = clib_error_return (0, "session %u add failed, rv %d",
+				     i, rv);
+	  goto done;
+	}
+    }
+
+  t = pool_elt_at_index (cm->tables, table_index);
+
+  t0 = clib_cpu_time_now ();
+  n_hits = CLIB_MARCH_FN_SELECT (classify_test_lookup) (t, packets,
+							packet_size,
+							n_sessions,
+							n_lookups);
+  t1 = clib_cpu_time_now ();
+
+  vlib_cli_output (vm, "%u sessions, skip %u match %u: %u lookups, "
+		   "%u hits, %.2f clocks/lookup",
+		   n_sessions, skip, match, n_lookups, n_hits,
+		   (f64) (t1 - t0) / (f64) (n_lookups ? n_lookups : 1));
+
+  if (n_hits != n_lookups)
+    error = clib_error_return (0, "lookup failed, %u of %u hits",
+			       n_hits, n_lookups);
+
+done:
+  if (~0 != table_index)
+    vnet_classify_add_del_table (cm, 0, 0, 0, 0, 0, 0, 0, &table_index,
+				 0, 0, 0 /* is_add */ , 0 /* del_chain */ );
+  vec_free (mask);
+  vec_free (packets);
+  return error;
+}
+
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (test_classify_command, static) =
+{
+  .path = "test classify",
+  .short_help = "test classify [sessions <n>] [lookups <n>] [skip <n>] "
+  "[match <1-5>] [seed <n>] [memory-size <nn>[kKmMgG]]",
+  .function = test_classify_command_fn,
+};
+/* *INDENT-ON* */
+#endif /* CLIB_MARCH_VARIANT */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2019 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vlib/vlib.h>
+
+/*
+ * Worker RPC and quiescent state test. The CLI runs with the barrier held,
+ * when workers don't pick up their RPCs, so the test runs in a process
+ * node and the CLI only starts it and reports its result.
+ */
+
+typedef enum
+{
+  WORKER_RPC_TEST_EVENT_START = 1,
+} worker_rpc_test_event_t;
+
+typedef struct
+{
+  /* RPCs run on each thread */
+  u32 *n_calls;
+
+  /* Replies the workers sent back to the main thread */
+  u32 *n_replies;
+
+  /* RPCs run on the wrong thread */
+  u32 n_errors;
+
+  u8 is_running;
+  u8 *result;
+} worker_rpc_test_main_t;
+
+static worker_rpc_test_main_t worker_rpc_test_main;
+
+#define WORKER_RPC_TEST(_cond, _comment, _args...)		\
+{								\
+  if (!(_cond)) {						\
+    tm->result = format (tm->result, "FAIL:%d: " _comment,	\
+			 __LINE__, ##_args);			\
+    return 1;							\
+  }								\
+}
+
+/* Runs on the main thread, posted back by each worker */
+static void
+worker_rpc_test_reply (vlib_main_t * vm, void *data)
+{
+  worker_rpc_test_main_t *tm = &worker_rpc_test_main;
+  u32 thread_index = *(u32 *) data;
+
+  if (vm->thread_index != 0 || vlib_get_thread_index () != 0)
+    tm->n_errors++;
+  tm->n_replies[thread_index]++;
+}
+
+static void
+worker_rpc_test_call (vlib_main_t * vm, void *data)
+{
+  worker_rpc_test_main_t *tm = &worker_rpc_test_main;
+  u32 thread_index = *(u32 *) data;
+
+  if (vm->thread_index != thread_index
+      || vlib_get_thread_index () != thread_index)
+    clib_atomic_fetch_add (&tm->n_errors, 1);
+  clib_atomic_fetch_add (&tm->n_calls[thread_index], 1);
+
+  /* queued, unless there is no worker */
+  vlib_worker_rpc_call (0, worker_rpc_test_reply, &thread_index,
+			sizeof (thread_index));
+}
+
+static int
+worker_rpc_test_is_quiescent (u32 thread_index, u32 loop_count)
+{
+  vlib_main_t *vm = vlib_mains[thread_index];
+
+  return *(volatile u32 *) &vm->main_loop_count != loop_count
+    || vm->worker_sleeping;
+}
+
+static int
+worker_rpc_test_run (vlib_main_t * vm)
+{
+  worker_rpc_test_main_t *tm = &worker_rpc_test_main;
+  u32 i, n_mains = vec_len (vlib_mains), first = n_mains > 1;
+  u32 *loop_counts = 0, n_done;
+  f64 deadline;
+
+  vec_reset_length (tm->n_calls);
+  vec_reset_length (tm->n_replies);
+  vec_validate (tm->n_calls, n_mains - 1);
+  vec_validate (tm->n_replies, n_mains - 1);
+  tm->n_errors = 0;
+
+  /* Every worker runs the call and posts the reply to the main thread */
+  for (i = first; i < n_mains; i++)
+    vlib_worker_rpc_call (i, worker_rpc_test_call, &i, sizeof (i));
+
+  deadline = vlib_time_now (vm) + 5.0;
+  do
+    {
+      vlib_process_suspend (vm, 1e-3);
+      n_done = 0;
+      for (i = first; i < n_mains; i++)
+	n_done += tm->n_replies[i] != 0;
+    }
+  while (n_done < n_mains - first && vlib_time_now (vm) < deadline);
+
+  for (i = first; i < n_mains; i++)
+    {
+      WORKER_RPC_TEST (tm->n_calls[i] == 1, "thread %u ran %u calls", i,
+		       tm->n_calls[i]);
+      WORKER_RPC_TEST (tm->n_replies[i] == 1, "thread %u sent %u replies",
+		       i, tm->n_replies[i]);
+    }
+  WORKER_RPC_TEST (tm->n_errors == 0, "%u RPCs ran on the wrong thread",
+		   tm->n_errors);
+
+  /* Every worker finished a main loop, or is sleeping. A sleeping worker
+     may wake up right after, give it the time to finish that loop. */
+  vec_validate (loop_counts, n_mains - 1);
+  for (i = 1; i < n_mains; i++)
+    loop_counts[i] = *(volatile u32 *) &vlib_mains[i]->main_loop_count;
+  vlib_worker_wait_for_quiescent_state ();
+  for (i = 1; i < n_mains; i++)
+    {
+      if (worker_rpc_test_is_quiescent (i, loop_counts[i]))
+	continue;
+      vlib_process_suspend (vm, 10e-3);
+      if (!worker_rpc_test_is_quiescent (i, loop_counts[i]))
+	break;
+    }
+  vec_free (loop_counts);
+  WORKER_RPC_TEST (i == n_mains, "thread %u not quiescent", i);
+
+  tm->result = format (tm->result, "worker rpc test passed: %u workers",
+		       n_mains - 1);
+  return 0;
+}
+
+static uword
+worker_rpc_test_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
+			 vlib_frame_t * f)
+{
+  worker_rpc_test_main_t *tm = &worker_rpc_test_main;
+  uword event_type, *event_data = 0;
+
+  while (1)
+    {
+      vlib_process_wait_for_event (vm);
+      event_type = vlib_process_get_events (vm, &event_data);
+      vec_reset_length (event_data);
+
+      if (event_type != WORKER_RPC_TEST_EVENT_START)
+	continue;
+
+      vec_reset_length (tm->result);
+      worker_rpc_test_run (vm);
+      tm->is_running = 0;
+    }
+
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (worker_rpc_test_process_node, static) = {
+  .function = worker_rpc_test_process,
+  .type = VLIB_NODE_TYPE_PROCESS,
+  .name = "worker-rpc-test-process",
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+test_worker_rpc_command_fn (vlib_main_t * vm,
+			    unformat_input_t * input, vlib_cli_command_t * cmd)
+{
+  worker_rpc_test_main_t *tm = &worker_rpc_test_main;
+
+  if (unformat (input, "result"))
+    {
+      if (tm->is_running)
+	vlib_cli_output (vm, "worker rpc test running");
+      else if (vec_len (tm->result))
+	vlib_cli_output (vm, "%v", tm->result);
+      else
+	vlib_cli_output (vm, "worker rpc test not run");
+      return 0;
+    }
+
+  if (tm->is_running)
+    return clib_error_return (0, "worker rpc test already running");
+
+  tm->is_running = 1;
+  vlib_process_signal_event (vm, worker_rpc_test_process_node.index,
+			     WORKER_RPC_TEST_EVENT_START, 0);
+  vlib_cli_output (vm, "worker rpc test started");
+  return 0;
+}
+
+/*?
+ * Unit test of the worker RPC queues and of the wait for a quiescent
+ * state. Each worker runs an RPC which posts a reply RPC back to the main
+ * thread. The test runs in the background, '<em>result</em>' reports it.
+ *
+ * @cliexpar
+ * @cliexcmd{test worker rpc}
+ * @cliexcmd{test worker rpc result}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (test_worker_rpc_command, static) =
+{
+  .path = "test worker rpc",
+  .short_help = "test worker rpc [result]",
+  .function = test_worker_rpc_command_fn,
+};
+/* *INDENT-ON* */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -504,6 +504,89 @@ vlib_buffer_chain_append_data_with_alloc (vlib_main_t * vm,
   return copied;
 }
 
+void
+vlib_buffer_depot_init (vlib_buffer_depot_t * d, u32 n_slots)
+{
+  u32 i;
+
+  d->head = d->tail = 0;
+  d->mask = n_slots - 1;
+  vec_validate_aligned (d->slots, n_slots - 1, CLIB_CACHE_LINE_BYTES);
+  for (i = 0; i < n_slots; i++)
+    d->slots[i].seq = i;
+}
+
+/* Enough magazines to hold every buffer of the pool, all initially empty,
+   so returning a magazine to either ring never fails */
+static void
+vlib_buffer_pool_depot_init (vlib_buffer_pool_t * bp)
+{
+  u32 i, n_magazines = bp->n_buffers / VLIB_BUFFER_MAGAZINE_SIZE;
+
+  if (n_magazines == 0)
+    return;
+
+  vec_validate_aligned (bp->magazines,
+			n_magazines * VLIB_BUFFER_MAGAZINE_SIZE - 1,
+			CLIB_CACHE_LINE_BYTES);
+  vlib_buffer_depot_init (&bp->full_magazines, max_pow2 (n_magazines));
+  vlib_buffer_depot_init (&bp->empty_magazines, max_pow2 (n_magazines));
+
+  for (i = 0; i < n_magazines; i++)
+    vlib_buffer_depot_enqueue (&bp->empty_magazines, i);
+}
+
+/* The pool ran dry. Dedicated pools borrow from their reserve pool, the
+   default pool of a numa node may take what is left in the default pools
+   of the other numa nodes. Buffers return to their own pool when freed. */
+u32
+vlib_buffer_alloc_fallback (vlib_main_t * vm, u32 * buffers,
+			    u32 n_buffers, u8 buffer_pool_index)
+{
+  vlib_buffer_main_t *bm = vm->buffer_main;
+  vlib_buffer_pool_t *bp, *fbp;
+  vlib_buffer_pool_thread_t *bpt;
+  u32 numa_node, n_alloc = 0;
+  u8 index;
+
+  bp = vec_elt_at_index (bm->buffer_pools, buffer_pool_index);
+  bpt = vec_elt_at_index (bp->threads, vm->thread_index);
+
+  if (bp->reserve_pool_index != (u8) ~ 0)
+    {
+      n_alloc = vlib_buffer_alloc_from_pool (vm, buffers, n_buffers,
+					     bp->reserve_pool_index);
+      bpt->n_reserve_borrowed += n_alloc;
+    }
+  else if (bm->numa_fallback &&
+	   bm->default_buffer_pool_index_for_numa[bp->numa_node] == bp->index)
+    {
+      for (numa_node = 0; numa_node < VLIB_BUFFER_MAX_NUMA_NODES;
+	   numa_node++)
+	{
+	  index = bm->default_buffer_pool_index_for_numa[numa_node];
+	  if (index == buffer_pool_index
+	      || index >= vec_len (bm->buffer_pools))
+	    continue;
+
+	  /* numa nodes without memory share the default pool of another */
+	  fbp = vec_elt_at_index (bm->buffer_pools, index);
+	  if (fbp->numa_node != numa_node)
+	    continue;
+
+	  n_alloc += vlib_buffer_alloc_from_pool (vm, buffers + n_alloc,
+						  n_buffers - n_alloc, index);
+	  if (n_alloc == n_buffers)
+	    break;
+	}
+      bpt->n_numa_steals += n_alloc;
+    }
+
+  bpt->n_alloc_failed += n_buffers - n_alloc;
+
+  return n_alloc;
+}
+
 //利用申请的内存构造buffer pool
 u8
 vlib_buffer_pool_create (vlib_main_t * vm, char *name, u32 data_size,
@@ -563,6 +646,7 @@ vlib_buffer_pool_create (vlib_main_t * vm, char *name, u32 data_size,
   bp->name = format (0, "%s%c", name, 0);
   bp->data_size = data_size;
   bp->numa_node = m->numa_node;
+  bp->reserve_pool_index = ~0;
 
   //保证线程缓存空间
   vec_validate_aligned (bp->threads, vec_len (vlib_mains) - 1,
@@ -602,6 +686,9 @@ vlib_buffer_pool_create (vlib_main_t * vm, char *name, u32 data_size,
 
   //指明申请的buffer数
   bp->n_buffers = vec_len (bp->buffers);
+
+  vlib_buffer_pool_depot_init (bp);
+
   return bp->index;
 }
 
@@ -611,7 +698,7 @@ format_vlib_buffer_pool (u8 * s, va_list * va)
   vlib_main_t *vm = va_arg (*va, vlib_main_t *);
   vlib_buffer_pool_t *bp = va_arg (*va, vlib_buffer_pool_t *);
   vlib_buffer_pool_thread_t *bpt;
-  u32 cached = 0;
+  u32 cached = 0, avail;
 
   if (!bp)
     return format (s, "%-20s%=6s%=6s%=6s%=11s%=6s%=8s%=8s%=8s",
@@ -623,11 +710,36 @@ format_vlib_buffer_pool (u8 * s, va_list * va)
     cached += vec_len (bpt->cached_buffers);
   /* *INDENT-ON* */
 
+  avail = vlib_buffer_pool_n_available (bp);
   s = format (s, "%-20s%=6d%=6d%=6u%=11u%=6u%=8u%=8u%=8u",
 	      bp->name, bp->index, bp->numa_node, bp->data_size +
 	      sizeof (vlib_buffer_t) + vm->buffer_main->ext_hdr_size,
-	      bp->data_size, bp->n_buffers, vec_len (bp->buffers), cached,
-	      bp->n_buffers - vec_len (bp->buffers) - cached);
+	      bp->data_size, bp->n_buffers, avail, cached,
+	      bp->n_buffers - avail - cached);
+
+  return s;
+}
+
+static u8 *
+format_vlib_buffer_pool_threads (u8 * s, va_list * va)
+{
+  vlib_buffer_pool_t *bp = va_arg (*va, vlib_buffer_pool_t *);
+  vlib_buffer_pool_thread_t *bpt;
+  u32 indent = format_get_indent (s);
+
+  s = format (s, "%-8s%=12s%=12s%=12s%=12s%=12s%=12s%=12s%=12s", "Thread",
+	      "Depot Gets", "Depot Puts", "Pool Gets", "Pool Puts",
+	      "Contended", "NUMA Steals", "Borrowed", "Failed");
+
+  /* *INDENT-OFF* */
+  vec_foreach (bpt, bp->threads)
+    s = format (s, "\n%U%-8u%=12llu%=12llu%=12llu%=12llu%=12llu%=12llu"
+		"%=12llu%=12llu",
+		format_white_space, indent, bpt - bp->threads,
+		bpt->n_depot_gets, bpt->n_depot_puts, bpt->n_pool_gets,
+		bpt->n_pool_puts, bpt->n_lock_contended, bpt->n_numa_steals,
+		bpt->n_reserve_borrowed, bpt->n_alloc_failed);
+  /* *INDENT-ON* */
 
   return s;
 }
@@ -638,6 +750,10 @@ show_buffers (vlib_main_t * vm,
 {
   vlib_buffer_main_t *bm = vm->buffer_main;
   vlib_buffer_pool_t *bp;
+  int verbose = 0;
+
+  if (unformat (input, "verbose"))
+    verbose = 1;
 
   vlib_cli_output (vm, "%U", format_vlib_buffer_pool, vm, 0);
 
@@ -646,13 +762,25 @@ show_buffers (vlib_main_t * vm,
     vlib_cli_output (vm, "%U", format_vlib_buffer_pool, vm, bp);
   /* *INDENT-ON* */
 
+  if (!verbose)
+    return 0;
+
+  /* *INDENT-OFF* */
+  vec_foreach (bp, bm->buffer_pools)
+    vlib_cli_output (vm, "\n%s%s%s:\n  %U", bp->name,
+		     bp->reserve_pool_index != (u8) ~0 ? ", reserve " : "",
+		     bp->reserve_pool_index != (u8) ~0 ?
+		     (char *) bm->buffer_pools[bp->reserve_pool_index].name :
+		     "", format_vlib_buffer_pool_threads, bp);
+  /* *INDENT-ON* */
+
   return 0;
 }
 
 /* *INDENT-OFF* */
 VLIB_CLI_COMMAND (show_buffers_command, static) = {
   .path = "show buffers",
-  .short_help = "Show packet buffer allocation",
+  .short_help = "show buffers [verbose]",
   .function = show_buffers,
 };
 /* *INDENT-ON* */
@@ -678,35 +806,31 @@ vlib_buffer_worker_init (vlib_main_t * vm)
 
 VLIB_WORKER_INIT_FUNCTION (vlib_buffer_worker_init);
 
-//构造numa_node对应的buffer pool
+/* Map memory for n_buffers default sized buffers on numa_node and build a
+   buffer pool on it, falling back to normal pages when there are no
+   hugepages */
 static clib_error_t *
-vlib_buffer_main_init_numa_node (struct vlib_main_t *vm, u32 numa_node,
-				 u8 * index)
+vlib_buffer_main_create_pool (struct vlib_main_t *vm, char *map_name,
+			      char *pool_name, u32 numa_node, u32 n_buffers,
+			      u32 n_buffers_unpriv, u8 * index)
 {
   vlib_buffer_main_t *bm = vm->buffer_main;
   clib_error_t *error;
   u32 physmem_map_index;
   uword n_pages, pagesize;
-  u32 buffers_per_numa;
   //buffer大小为：扩展头大小，buffer结构体大小，默认数据段大小
   u32 buffer_size = CLIB_CACHE_LINE_ROUND (bm->ext_hdr_size +
 					   sizeof (vlib_buffer_t) +
 					   vlib_buffer_get_default_data_size
 					   (vm));
-  u8 *name;
 
   pagesize = clib_mem_get_default_hugepage_size ();
-  name = format (0, "buffers-numa-%d%c", numa_node, 0);
-
-  //每个numa上的buffer数
-  buffers_per_numa = bm->buffers_per_numa ? bm->buffers_per_numa :
-    VLIB_BUFFER_DEFAULT_BUFFERS_PER_NUMA;
 
 retry:
   //首先计算一页可以存放多少buffer,再计算需要多少页来存储这些buffer
-  n_pages = (buffers_per_numa - 1) / (pagesize / buffer_size) + 1;
+  n_pages = (n_buffers - 1) / (pagesize / buffer_size) + 1;
   //申请这些页，并记录map到的内存对应的index
-  error = vlib_physmem_shared_map_create (vm, (char *) name/*buffer池名称*/,
+  error = vlib_physmem_shared_map_create (vm, map_name/*buffer池名称*/,
 					  n_pages * pagesize,//需要使用的总内存
 					  min_log2 (pagesize), numa_node/*在哪个node上创建*/,
 					  &physmem_map_index);
@@ -718,19 +842,15 @@ retry:
       vlib_log_warn (bm->log_default, "falling back to non-hugepage "
 		     "backed buffer pool");
       pagesize = clib_mem_get_page_size ();
-      buffers_per_numa = bm->buffers_per_numa ? bm->buffers_per_numa :
-	VLIB_BUFFER_DEFAULT_BUFFERS_PER_NUMA_UNPRIV;
+      n_buffers = n_buffers_unpriv;
       goto retry;
     }
 
   if (error)
     return error;
 
-  vec_reset_length (name);
-  name = format (name, "default-numa-%d%c", numa_node, 0);
-
   //利用申请的内存构造buffer pool
-  *index = vlib_buffer_pool_create (vm, (char *) name,
+  *index = vlib_buffer_pool_create (vm, pool_name,
 				    vlib_buffer_get_default_data_size (vm),
 				    physmem_map_index);
 
@@ -740,6 +860,34 @@ retry:
   return 0;
 }
 
+//构造numa_node对应的buffer pool
+static clib_error_t *
+vlib_buffer_main_init_numa_node (struct vlib_main_t *vm, u32 numa_node,
+				 u8 * index)
+{
+  vlib_buffer_main_t *bm = vm->buffer_main;
+  clib_error_t *error;
+  u8 *map_name, *pool_name;
+
+  //每个numa上的buffer数
+  u32 buffers_per_numa = bm->buffers_per_numa ? bm->buffers_per_numa :
+    VLIB_BUFFER_DEFAULT_BUFFERS_PER_NUMA;
+  u32 buffers_per_numa_unpriv = bm->buffers_per_numa ? bm->buffers_per_numa :
+    VLIB_BUFFER_DEFAULT_BUFFERS_PER_NUMA_UNPRIV;
+
+  map_name = format (0, "buffers-numa-%d%c", numa_node, 0);
+  pool_name = format (0, "default-numa-%d%c", numa_node, 0);
+
+  error = vlib_buffer_main_create_pool (vm, (char *) map_name,
+					(char *) pool_name, numa_node,
+					buffers_per_numa,
+					buffers_per_numa_unpriv, index);
+
+  vec_free (map_name);
+  vec_free (pool_name);
+  return error;
+}
+
 //申请并初始化buffer_main
 void
 vlib_buffer_main_alloc (vlib_main_t * vm)
@@ -793,7 +941,8 @@ buffer_gauges_update_used_fn (stat_segment_directory_entry_t * e, u32 index)
   if (!bp)
     return;
 
-  e->value = bp->n_buffers - vec_len (bp->buffers) - buffer_get_cached (bp);
+  e->value = bp->n_buffers - vlib_buffer_pool_n_available (bp) -
+    buffer_get_cached (bp);
 }
 
 static void
@@ -805,7 +954,7 @@ buffer_gauges_update_available_fn (stat_segment_directory_entry_t * e,
   if (!bp)
     return;
 
-  e->value = vec_len (bp->buffers);
+  e->value = vlib_buffer_pool_n_available (bp);
 }
 
 //更新缓存的buffer数目
@@ -822,6 +971,25 @@ buffer_gauges_update_cached_fn (stat_segment_directory_entry_t * e, u32 index)
   e->value = buffer_get_cached (bp);
 }
 
+static void
+buffer_gauges_update_failed_fn (stat_segment_directory_entry_t * e, u32 index)
+{
+  vlib_main_t *vm = vlib_get_main ();
+  vlib_buffer_pool_t *bp = buffer_get_by_index (vm->buffer_main, index);
+  vlib_buffer_pool_thread_t *bpt;
+  u64 failed = 0;
+
+  if (!bp)
+    return;
+
+  /* *INDENT-OFF* */
+  vec_foreach (bpt, bp->threads)
+    failed += bpt->n_alloc_failed;
+  /* *INDENT-ON* */
+
+  e->value = failed;
+}
+
 //初始化buffer
 clib_error_t *
 vlib_buffer_main_init (struct vlib_main_t * vm)
@@ -831,6 +999,7 @@ vlib_buffer_main_init (struct vlib_main_t * vm)
   clib_bitmap_t *bmp = 0, *bmp_has_memory = 0;
   u32 numa_node;
   vlib_buffer_pool_t *bp;
+  vlib_buffer_pool_config_t *pc;
   u8 *name = 0, first_valid_buffer_pool_index = ~0;
 
   vlib_buffer_main_alloc (vm);
@@ -894,6 +1063,37 @@ vlib_buffer_main_init (struct vlib_main_t * vm)
     });
   /* *INDENT-ON* */
 
+  /* *INDENT-OFF* */
+  vec_foreach (pc, bm->pool_configs)
+    {
+      u8 index;
+
+      vec_reset_length (name);
+      name = format (name, "buffers-%s%c", pc->name, 0);
+      if (pc->numa_node >= VLIB_BUFFER_MAX_NUMA_NODES ||
+	  !clib_bitmap_get (bmp, pc->numa_node))
+	err = clib_error_return (0, "no memory on numa node %u",
+				 pc->numa_node);
+      else
+	err = vlib_buffer_main_create_pool (vm, (char *) name,
+					    (char *) pc->name, pc->numa_node,
+					    pc->n_buffers, pc->n_buffers,
+					    &index);
+      if (err)
+	{
+	  clib_error_report (err);
+	  clib_error_free (err);
+	  err = 0;
+	  continue;
+	}
+
+      bp = vec_elt_at_index (bm->buffer_pools, index);
+      if (pc->borrow)
+	bp->reserve_pool_index =
+	  bm->default_buffer_pool_index_for_numa[pc->numa_node];
+    }
+  /* *INDENT-ON* */
+
   //遍历每个buffer pool，注册相应的测量函数
   vec_foreach (bp, bm->buffer_pools)
   {
@@ -914,6 +1114,11 @@ vlib_buffer_main_init (struct vlib_main_t * vm)
     name = format (name, "/buffer-pools/%s/available%c", bp->name, 0);
     stat_segment_register_gauge (name, buffer_gauges_update_available_fn,
 				 bp - bm->buffer_pools);
+
+    vec_reset_length (name);
+    name = format (name, "/buffer-pools/%s/alloc-failed%c", bp->name, 0);
+    stat_segment_register_gauge (name, buffer_gauges_update_failed_fn,
+				 bp - bm->buffer_pools);
   }
 
 done:
@@ -927,6 +1132,9 @@ static clib_error_t *
 vlib_buffers_configure (vlib_main_t * vm, unformat_input_t * input)
 {
   vlib_buffer_main_t *bm;
+  vlib_buffer_pool_config_t *pc;
+  unformat_input_t sub_input;
+  u8 *name;
 
   vlib_buffer_main_alloc (vm);
 
@@ -939,6 +1147,29 @@ vlib_buffers_configure (vlib_main_t * vm, unformat_input_t * input)
       else if (unformat (input, "default data-size %u",
 			 &bm->default_data_size))
 	;
+      else if (unformat (input, "numa-fallback"))
+	bm->numa_fallback = 1;
+      else if (unformat (input, "pool %s %U", &name,
+			 unformat_vlib_cli_sub_input, &sub_input))
+	{
+	  vec_add2 (bm->pool_configs, pc, 1);
+	  pc->name = format (name, "%c", 0);
+	  while (unformat_check_input (&sub_input) != UNFORMAT_END_OF_INPUT)
+	    {
+	      if (unformat (&sub_input, "buffers %u", &pc->n_buffers))
+		;
+	      else if (unformat (&sub_input, "numa %u", &pc->numa_node))
+		;
+	      else if (unformat (&sub_input, "borrow"))
+		pc->borrow = 1;
+	      else
+		return unformat_parse_error (&sub_input);
+	    }
+	  unformat_free (&sub_input);
+	  if (pc->n_buffers == 0)
+	    return clib_error_return (0, "buffer pool '%s' has no buffers",
+				      pc->name);
+	}
       else
 	return unformat_parse_error (input);
     }
@@ -383,7 +383,53 @@ typedef struct
   CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
   u32 *cached_buffers;//缓存的buffer
   u32 n_alloc;//缓存的数目
+
+  /* full magazines taken from and returned to the depot */
+  u64 n_depot_gets;
+  u64 n_depot_puts;
+
+  /* cache refills and spills which went through the locked pool */
+  u64 n_pool_gets;
+  u64 n_pool_puts;
+
+  /* pool lock found held by another thread */
+  u64 n_lock_contended;
+
+  /* buffers allocated from the pool of another numa node */
+  u64 n_numa_steals;
+
+  /* buffers borrowed from the reserve pool */
+  u64 n_reserve_borrowed;
+
+  /* buffers requested which could not be allocated */
+  u64 n_alloc_failed;
 } vlib_buffer_pool_thread_t;
+
+/* Number of buffer indices moved to or from the depot at once */
+#define VLIB_BUFFER_MAGAZINE_SIZE 256
+
+typedef struct
+{
+  volatile u64 seq;
+  u32 magazine;
+} vlib_buffer_depot_slot_t;
+
+/*
+ * Bounded multi-producer multi-consumer ring of magazine indices. A slot
+ * sequence number equal to the enqueue position marks it free, one more
+ * than the position marks it filled.
+ */
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  volatile u64 head;
+    CLIB_CACHE_LINE_ALIGN_MARK (cacheline1);
+  volatile u64 tail;
+    CLIB_CACHE_LINE_ALIGN_MARK (cacheline2);
+  u64 mask;
+  vlib_buffer_depot_slot_t *slots;
+} vlib_buffer_depot_t;
+
 typedef struct
 {
   CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
@@ -409,10 +455,29 @@ typedef struct
   //每个线程上会有一些缓存的buffer,threads是一个vector,每线程一个结构
   vlib_buffer_pool_thread_t *threads;
 
+  /* Lock-free depot of magazines, each holding VLIB_BUFFER_MAGAZINE_SIZE
+     buffer indices. Threads exchange whole magazines through the depot and
+     only take the pool lock when it runs dry or out of empty magazines. */
+  u32 *magazines;
+  vlib_buffer_depot_t full_magazines;
+  vlib_buffer_depot_t empty_magazines;
+
+  /* pool to borrow from when this one is exhausted, ~0 if none */
+  u8 reserve_pool_index;
+
   /* buffer metadata template */
   vlib_buffer_t buffer_template;
 } vlib_buffer_pool_t;
 
+/* Dedicated pool from the buffers startup config */
+typedef struct
+{
+  u8 *name;
+  u32 n_buffers;
+  u32 numa_node;
+  u8 borrow;
+} vlib_buffer_pool_config_t;
+
 #define VLIB_BUFFER_MAX_NUMA_NODES 32
 
 typedef struct
@@ -437,6 +502,12 @@ typedef struct
   u16 ext_hdr_size;//buffer扩展头部大小
   u32 default_data_size;//buffer默认的数据段大小
 
+  /* allocate from other numa nodes when the local default pool is empty */
+  u8 numa_fallback;
+
+  /* dedicated pools to create at init */
+  vlib_buffer_pool_config_t *pool_configs;
+
   /* logging */
   vlib_log_class_t log_default;
 } vlib_buffer_main_t;
@@ -474,6 +474,9 @@ void vlib_buffer_validate_alloc_free (vlib_main_t * vm, u32 * buffers,
 				      vlib_buffer_known_state_t
 				      expected_state);
 
+u32 vlib_buffer_alloc_fallback (vlib_main_t * vm, u32 * buffers,
+				u32 n_buffers, u8 buffer_pool_index);
+
 always_inline vlib_buffer_known_state_t
 vlib_buffer_is_known (vlib_main_t * vm, u32 buffer_index)
 {
@@ -498,6 +501,90 @@ vlib_get_buffer_pool (vlib_main_t * vm, u8 buffer_pool_index)
   return vec_elt_at_index (bm->buffer_pools, buffer_pool_index);
 }
 
+void vlib_buffer_depot_init (vlib_buffer_depot_t * d, u32 n_slots);
+
+static_always_inline int
+vlib_buffer_depot_enqueue (vlib_buffer_depot_t * d, u32 magazine)
+{
+  vlib_buffer_depot_slot_t *slot;
+  u64 pos = d->tail, seq;
+  i64 diff;
+
+  while (1)
+    {
+      slot = d->slots + (pos & d->mask);
+      seq = clib_atomic_load_acq_n (&slot->seq);
+      diff = (i64) (seq - pos);
+      if (diff == 0)
+	{
+	  if (clib_atomic_bool_cmp_and_swap (&d->tail, pos, pos + 1))
+	    break;
+	}
+      else if (diff < 0)
+	return -1;		/* full */
+      pos = d->tail;
+    }
+
+  slot->magazine = magazine;
+  clib_atomic_store_rel_n (&slot->seq, pos + 1);
+  return 0;
+}
+
+static_always_inline u32
+vlib_buffer_depot_dequeue (vlib_buffer_depot_t * d)
+{
+  vlib_buffer_depot_slot_t *slot;
+  u64 pos = d->head, seq;
+  u32 magazine;
+  i64 diff;
+
+  while (1)
+    {
+      slot = d->slots + (pos & d->mask);
+      seq = clib_atomic_load_acq_n (&slot->seq);
+      diff = (i64) (seq - (pos + 1));
+      if (diff == 0)
+	{
+	  if (clib_atomic_bool_cmp_and_swap (&d->head, pos, pos + 1))
+	    break;
+	}
+      else if (diff < 0)
+	return ~0;		/* empty */
+      pos = d->head;
+    }
+
+  magazine = slot->magazine;
+  clib_atomic_store_rel_n (&slot->seq, pos + d->mask + 1);
+  return magazine;
+}
+
+static_always_inline u32 *
+vlib_buffer_pool_magazine (vlib_buffer_pool_t * bp, u32 magazine)
+{
+  return bp->magazines + (uword) magazine * VLIB_BUFFER_MAGAZINE_SIZE;
+}
+
+/* Free buffers of the pool, in the locked vector or in the depot, not
+   counting the per-thread caches */
+static_always_inline u32
+vlib_buffer_pool_n_available (vlib_buffer_pool_t * bp)
+{
+  vlib_buffer_depot_t *d = &bp->full_magazines;
+
+  return vec_len (bp->buffers) +
+    (u32) (d->tail - d->head) * VLIB_BUFFER_MAGAZINE_SIZE;
+}
+
+static_always_inline void
+vlib_buffer_pool_lock (vlib_main_t * vm, vlib_buffer_pool_t * bp)
+{
+  if (PREDICT_FALSE (!clib_spinlock_trylock (&bp->lock)))
+    {
+      vec_elt (bp->threads, vm->thread_index).n_lock_contended++;
+      clib_spinlock_lock (&bp->lock);
+    }
+}
+
 //自pool中出队n_buffers个buffer,如果出队失败，则返回出队的buffer数
 static_always_inline uword
 vlib_buffer_pool_get (vlib_main_t * vm, u8 buffer_pool_index, u32 * buffers,
@@ -508,7 +595,7 @@ vlib_buffer_pool_get (vlib_main_t * vm, u8 buffer_pool_index, u32 * buffers,
 
   ASSERT (bp->buffers);
 
-  clib_spinlock_lock (&bp->lock);
+  vlib_buffer_pool_lock (vm, bp);
   len = vec_len (bp->buffers);
   if (PREDICT_TRUE (n_buffers < len))
     {
@@ -530,6 +617,43 @@ vlib_buffer_pool_get (vlib_main_t * vm, u8 buffer_pool_index, u32 * buffers,
 }
 
 
+/* Refill the empty per-thread cache with at least n_buffers buffers,
+   whole magazines from the depot first, then from the locked pool */
+static_always_inline u32
+vlib_buffer_pool_refill (vlib_main_t * vm, vlib_buffer_pool_t * bp,
+			 vlib_buffer_pool_thread_t * bpt, u32 n_buffers)
+{
+  u32 len = 0, magazine;
+
+  while (len < n_buffers && bp->magazines)
+    {
+      magazine = vlib_buffer_depot_dequeue (&bp->full_magazines);
+      if (magazine == ~0)
+	break;
+      vec_validate_aligned (bpt->cached_buffers,
+			    len + VLIB_BUFFER_MAGAZINE_SIZE - 1,
+			    CLIB_CACHE_LINE_BYTES);
+      vlib_buffer_copy_indices (bpt->cached_buffers + len,
+				vlib_buffer_pool_magazine (bp, magazine),
+				VLIB_BUFFER_MAGAZINE_SIZE);
+      vlib_buffer_depot_enqueue (&bp->empty_magazines, magazine);
+      len += VLIB_BUFFER_MAGAZINE_SIZE;
+      bpt->n_depot_gets++;
+    }
+
+  if (len < n_buffers)
+    {
+      vec_validate_aligned (bpt->cached_buffers, n_buffers - 1,
+			    CLIB_CACHE_LINE_BYTES);
+      len += vlib_buffer_pool_get (vm, bp->index, bpt->cached_buffers + len,
+				   n_buffers - len);
+      bpt->n_pool_gets++;
+    }
+
+  _vec_len (bpt->cached_buffers) = len;
+  return len;
+}
+
 /** \brief Allocate buffers from specific pool into supplied array
 
     @param vm - (vlib_main_t *) vlib main data structure pointer
@@ -583,13 +707,7 @@ vlib_buffer_alloc_from_pool (vlib_main_t * vm, u32 * buffers, u32 n_buffers/*需
     }
 
   //再自pool中批发一批
-  len = round_pow2 (n_left, 32);
-  //确保cached_buffers的大小
-  vec_validate_aligned (bpt->cached_buffers, len - 1, CLIB_CACHE_LINE_BYTES);
-  //自pool中出len个buffer到bpt->cached_buffers中
-  len = vlib_buffer_pool_get (vm, buffer_pool_index, bpt->cached_buffers,
-			      len);
-  _vec_len (bpt->cached_buffers) = len;
+  len = vlib_buffer_pool_refill (vm, bp, bpt, round_pow2 (n_left, 32));
 
   if (len)
     {
@@ -612,6 +730,37 @@ vlib_buffer_alloc_from_pool (vlib_main_t * vm, u32 * buffers, u32 n_buffers/*需
   return n_buffers;
 }
 
+/** \brief Allocate buffers from the pool of an rx queue
+
+    Same as vlib_buffer_alloc_from_pool(), except that an exhausted pool
+    borrows from its reserve pool, and the buffers which could not be
+    allocated are counted as failures of the pool. For drivers refilling
+    queues from a pool selected with vnet_hw_interface_get_rx_buffer_pool().
+
+    @param vm - (vlib_main_t *) vlib main data structure pointer
+    @param buffers - (u32 * ) buffer index array
+    @param n_buffers - (u32) number of buffers requested
+    @param buffer_pool_index - (u8) rx queue buffer pool
+    @return - (u32) number of buffers actually allocated, may be
+    less than the number requested or zero
+*/
+always_inline u32
+vlib_buffer_alloc_from_rx_pool (vlib_main_t * vm, u32 * buffers,
+				u32 n_buffers, u8 buffer_pool_index)
+{
+  u32 n_alloc;
+
+  n_alloc = vlib_buffer_alloc_from_pool (vm, buffers, n_buffers,
+					 buffer_pool_index);
+
+  if (PREDICT_FALSE (n_alloc < n_buffers))
+    n_alloc += vlib_buffer_alloc_fallback (vm, buffers + n_alloc,
+					   n_buffers - n_alloc,
+					   buffer_pool_index);
+
+  return n_alloc;
+}
+
 /** \brief Allocate buffers from specific numa node into supplied array
 
     @param vm - (vlib_main_t *) vlib main data structure pointer
@@ -626,7 +775,15 @@ vlib_buffer_alloc_on_numa (vlib_main_t * vm, u32 * buffers, u32 n_buffers,
 			   u32 numa_node)
 {
   u8 index = vlib_buffer_pool_get_default_for_numa (vm, numa_node);
-  return vlib_buffer_alloc_from_pool (vm, buffers, n_buffers, index);
+  u32 n_alloc;
+
+  n_alloc = vlib_buffer_alloc_from_pool (vm, buffers, n_buffers, index);
+
+  if (PREDICT_FALSE (n_alloc < n_buffers && vm->buffer_main->numa_fallback))
+    n_alloc += vlib_buffer_alloc_fallback (vm, buffers + n_alloc,
+					   n_buffers - n_alloc, index);
+
+  return n_alloc;
 }
 
 /** \brief Allocate buffers into supplied array
@@ -706,6 +863,41 @@ vlib_buffer_alloc_to_ring_from_pool (vlib_main_t * vm, u32 * ring, u32 start,
   return n_alloc;
 }
 
+/** \brief Allocate buffers into ring from the pool of an rx queue
+
+    @param vm - (vlib_main_t *) vlib main data structure pointer
+    @param buffers - (u32 * ) buffer index ring
+    @param start - (u32) first slot in the ring
+    @param ring_size - (u32) ring size
+    @param n_buffers - (u32) number of buffers requested
+    @param buffer_pool_index - (u8) rx queue buffer pool
+    @return - (u32) number of buffers actually allocated, may be
+    less than the number requested or zero
+*/
+always_inline u32
+vlib_buffer_alloc_to_ring_from_rx_pool (vlib_main_t * vm, u32 * ring,
+					u32 start, u32 ring_size,
+					u32 n_buffers, u8 buffer_pool_index)
+{
+  u32 n_alloc;
+
+  ASSERT (n_buffers <= ring_size);
+
+  if (PREDICT_TRUE (start + n_buffers <= ring_size))
+    return vlib_buffer_alloc_from_rx_pool (vm, ring + start, n_buffers,
+					   buffer_pool_index);
+
+  n_alloc = vlib_buffer_alloc_from_rx_pool (vm, ring + start,
+					    ring_size - start,
+					    buffer_pool_index);
+
+  if (PREDICT_TRUE (n_alloc == ring_size - start))
+    n_alloc += vlib_buffer_alloc_from_rx_pool (vm, ring, n_buffers - n_alloc,
+					       buffer_pool_index);
+
+  return n_alloc;
+}
+
 //将转换好的buffer index入队到pool内
 static_always_inline void
 vlib_buffer_pool_put (vlib_main_t * vm, u8 buffer_pool_index,
@@ -728,7 +920,23 @@ vlib_buffer_pool_put (vlib_main_t * vm, u8 buffer_pool_index,
   //如果入队到cache buffer后，数量过大，则再入队到buffer中
   if (vec_len (bpt->cached_buffers) > 4 * VLIB_FRAME_SIZE)
     {
-      clib_spinlock_lock (&bp->lock);
+      u32 magazine = bp->magazines ?
+	vlib_buffer_depot_dequeue (&bp->empty_magazines) : ~0;
+
+      if (PREDICT_TRUE (magazine != ~0))
+	{
+	  /* keep last stored buffers, as they are more likely hot */
+	  vlib_buffer_copy_indices (vlib_buffer_pool_magazine (bp, magazine),
+				    bpt->cached_buffers,
+				    VLIB_BUFFER_MAGAZINE_SIZE);
+	  vec_delete (bpt->cached_buffers, VLIB_BUFFER_MAGAZINE_SIZE, 0);
+	  vlib_buffer_depot_enqueue (&bp->full_magazines, magazine);
+	  bpt->n_depot_puts++;
+	  return;
+	}
+
+      bpt->n_pool_puts++;
+      vlib_buffer_pool_lock (vm, bp);
       /* keep last stored buffers, as they are more likely hot in the cache */
       vec_add_aligned (bp->buffers, bpt->cached_buffers, VLIB_FRAME_SIZE,
 		       CLIB_CACHE_LINE_BYTES);
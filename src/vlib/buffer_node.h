@@ -545,6 +545,7 @@ vlib_buffer_enqueue_to_thread (vlib_main_t * vm, u32 frame_queue_index/*指出
 	      goto next;
 	    }
 	  vlib_mains[next_thread_index]->check_frame_queues = 1;
+	  vlib_worker_wakeup (vlib_mains[next_thread_index]);
 
 	  if (hf)
 	    hf->n_vectors = VLIB_FRAME_SIZE - n_left_to_next_thread;
@@ -134,7 +134,7 @@ vlib_register_errors (vlib_main_t * vm,
   vlib_node_t *n = vlib_get_node (vm, node_index);
   uword l;
   void *oldheap;
-  void *vlib_stats_push_heap (void) __attribute__ ((weak));
+  void *vlib_stats_push_heap (void *) __attribute__ ((weak));
 
   ASSERT (vlib_get_thread_index () == 0);
 
@@ -161,7 +161,7 @@ vlib_register_errors (vlib_main_t * vm,
   vec_validate (vm->error_elog_event_types, l - 1);
 
   /* Switch to the stats segment ... */
-  oldheap = vlib_stats_push_heap ();
+  oldheap = vlib_stats_push_heap (em->counters);
 
   /* Allocate a counter/elog type for each error. */
   vec_validate (em->counters, l - 1);
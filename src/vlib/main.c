@@ -1202,6 +1202,28 @@ dispatch_pcap_trace (vlib_main_t * vm,
     }
 }
 
+static_always_inline void
+dispatch_node_histogram_update (vlib_main_t * vm, u32 node_index,
+				u32 n_vectors, u64 n_clocks)
+{
+  vlib_node_dispatch_histogram_main_t *hm =
+    &vlib_node_dispatch_histogram_main;
+  u32 bin;
+
+  bin = clib_min (min_log2 (n_vectors),
+		  VLIB_NODE_VECTOR_SIZE_HIST_N_BINS - 1);
+  vlib_increment_simple_counter (&hm->vector_size, vm->thread_index,
+				 node_index *
+				 VLIB_NODE_VECTOR_SIZE_HIST_N_BINS + bin, 1);
+
+  n_clocks /= n_vectors;
+  bin = n_clocks ? clib_min (min_log2 (n_clocks),
+			     VLIB_NODE_CLOCKS_HIST_N_BINS - 1) : 0;
+  vlib_increment_simple_counter (&hm->clocks_per_packet, vm->thread_index,
+				 node_index * VLIB_NODE_CLOCKS_HIST_N_BINS +
+				 bin, 1);
+}
+
 //节点调度
 static_always_inline u64
 dispatch_node (vlib_main_t * vm,
@@ -1285,6 +1307,9 @@ dispatch_node (vlib_main_t * vm,
       if (PREDICT_FALSE (vm->dispatch_pcap_enable))
           dispatch_pcap_trace (vm, node, frame);
 
+      if (PREDICT_FALSE (vm->trace_main.ring != 0))
+          vlib_trace_ring_dispatch (vm, node, frame);
+
       //执行node的function调用
       n = node->function (vm, node, frame);
   }
@@ -1294,6 +1319,9 @@ dispatch_node (vlib_main_t * vm,
       if (PREDICT_FALSE (vm->dispatch_pcap_enable))
           dispatch_pcap_trace (vm, node, frame);
 
+      if (PREDICT_FALSE (vm->trace_main.ring != 0))
+          vlib_trace_ring_dispatch (vm, node, frame);
+
       //执行node的function调用
       n = node->function (vm, node, frame);
   }
@@ -1323,6 +1351,12 @@ dispatch_node (vlib_main_t * vm,
 				      pmc_delta[0] /* PMC0 */ ,
 				      pmc_delta[1] /* PMC1 */ );
 
+  /* calls which found no work are left out of the histograms */
+  if (PREDICT_FALSE (node->node_index <
+		     vlib_node_dispatch_histogram_main.n_nodes) && n > 0)
+    dispatch_node_histogram_update (vm, node->node_index, n,
+				    t - last_time_stamp);
+
   /* When in interrupt mode and vector rate crosses threshold switch to
      polling mode. */
   //node转态转换
@@ -1417,6 +1451,56 @@ dispatch_node (vlib_main_t * vm,
   return t;
 }
 
+static_always_inline u32
+pending_frame_depth (vlib_main_t * vm, vlib_pending_frame_t * p)
+{
+  vlib_node_dispatch_order_main_t *om = &vlib_node_dispatch_order_main;
+  vlib_node_runtime_t *n;
+
+  n = vec_elt_at_index (vm->node_main.nodes_by_type[VLIB_NODE_TYPE_INTERNAL],
+			p->node_runtime_index);
+
+  return n->node_index < vec_len (om->depth_by_node_index) ?
+    om->depth_by_node_index[n->node_index] : 0;
+}
+
+/*
+ * Depth order dispatch: unless the pending frame in slot i is already
+ * large, move the first pending frame of the shallowest node into slot i.
+ * The frames in between keep their relative order, so the frames queued
+ * for a single node are still dispatched in order.
+ */
+static void
+dispatch_pending_pick_by_depth (vlib_main_t * vm, uword i)
+{
+  vlib_node_dispatch_order_main_t *om = &vlib_node_dispatch_order_main;
+  vlib_pending_frame_t *p = vm->node_main.pending_frames, tmp;
+  u32 depth, best_depth;
+  uword j, best = i;
+
+  if (vlib_get_frame (vm, p[i].frame_index)->n_vectors >=
+      om->defer_threshold)
+    return;
+
+  best_depth = pending_frame_depth (vm, p + i);
+  for (j = i + 1; j < vec_len (p) && best_depth; j++)
+    {
+      depth = pending_frame_depth (vm, p + j);
+      if (depth < best_depth)
+	{
+	  best = j;
+	  best_depth = depth;
+	}
+    }
+
+  if (best == i)
+    return;
+
+  tmp = p[best];
+  memmove (p + i + 1, p + i, (best - i) * sizeof (p[0]));
+  p[i] = tmp;
+}
+
 //处理pending_frame链上指定索引的元素，使对应的node处理它
 static u64
 dispatch_pending_node (vlib_main_t * vm, uword pending_frame_index/*pending_frame索引*/,
@@ -1917,6 +2001,9 @@ vlib_main_or_worker_loop (vlib_main_t * vm, int is_main/*是否为主线程*/)
     	  	  }
       }
 
+      if (PREDICT_FALSE (vec_len (vm->pending_worker_rpcs) > 0))
+	vlib_worker_rpc_process (vm);
+
       if (!is_main)
 	{
           //检查是否需要等待barrier
@@ -2027,6 +2114,8 @@ vlib_main_or_worker_loop (vlib_main_t * vm, int is_main/*是否为主线程*/)
       //现在遍历这些pending_frames,使相应的node处理它们,直到所有的节点均完成报文处理
       for (i = 0; i < _vec_len (nm->pending_frames); i++)
       {
+	  if (PREDICT_FALSE (vlib_node_dispatch_order_main.enabled))
+	    dispatch_pending_pick_by_depth (vm, i);
           //对internal node完成调度
     	  	  cpu_time_now = dispatch_pending_node (vm, i, cpu_time_now);
       }
@@ -2347,6 +2436,7 @@ vlib_main (vlib_main_t * volatile vm, unformat_input_t * input)
   _vec_len (vm->pending_rpc_requests) = 0;
   vec_validate (vm->processing_rpc_requests, 0);
   _vec_len (vm->processing_rpc_requests) = 0;
+  clib_spinlock_init (&vm->worker_rpc_lock);
 
   //调用所有其它非早期配置函数
   if ((error = vlib_call_all_config_functions (vm, input/*所有模块配置参数*/, 0 /* is_early */ )))
@@ -65,6 +65,21 @@ typedef struct
   pcap_main_t pcap_main;
 } vnet_pcap_t;
 
+struct vlib_main_t;
+
+/* Function run by a worker thread on behalf of another thread,
+   see vlib_worker_rpc_call */
+typedef void (vlib_worker_rpc_fn_t) (struct vlib_main_t * vm, void *data);
+
+#define VLIB_WORKER_RPC_DATA_BYTES 56
+
+typedef struct
+{
+  vlib_worker_rpc_fn_t *fn;
+  /* arguments, copied */
+  u8 data[VLIB_WORKER_RPC_DATA_BYTES];
+} vlib_worker_rpc_t;
+
 typedef struct vlib_main_t
 {
   CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
@@ -246,6 +261,17 @@ typedef struct vlib_main_t
   /* Need to check the frame queues */
   volatile uword check_frame_queues;
 
+  /* Worker blocked in its idle loop, see vlib_worker_wakeup */
+  volatile u32 worker_sleeping;
+
+  /* Wakes a sleeping worker up, set when adaptive worker sleep is on */
+  void (*worker_wakeup_fn) (struct vlib_main_t *);
+
+  /* RPCs posted to this worker, run at the top of its main loop */
+  vlib_worker_rpc_t *pending_worker_rpcs;
+  vlib_worker_rpc_t *processing_worker_rpcs;
+  clib_spinlock_t worker_rpc_lock;
+
   /* RPC requests, main thread only */
   uword *pending_rpc_requests;//记录本线程收到的rpc请求
   uword *processing_rpc_requests;
@@ -390,6 +416,20 @@ vlib_increment_main_loop_counter (vlib_main_t * vm)
     clib_longjmp (&vm->main_loop_exit, VLIB_MAIN_LOOP_EXIT_CLI);
 }
 
+/* Wake a worker up after posting it work from another thread */
+always_inline void
+vlib_worker_wakeup (vlib_main_t * vm)
+{
+  if (PREDICT_FALSE (vm->worker_wakeup_fn != 0))
+    {
+      /* Pairs with the barrier between setting worker_sleeping and
+         checking for pending work in the worker idle loop */
+      CLIB_MEMORY_BARRIER ();
+      if (vm->worker_sleeping)
+	vm->worker_wakeup_fn (vm);
+    }
+}
+
 always_inline void vlib_set_queue_signal_callback
   (vlib_main_t * vm, void (*fp) (vlib_main_t *))
 {
@@ -825,6 +825,177 @@ done:
   return error;
 }
 
+vlib_node_dispatch_histogram_main_t vlib_node_dispatch_histogram_main;
+
+void
+vlib_node_dispatch_histogram_clear (void)
+{
+  vlib_node_dispatch_histogram_main_t *hm =
+    &vlib_node_dispatch_histogram_main;
+
+  if (hm->vector_size.counters)
+    {
+      vlib_clear_simple_counters (&hm->vector_size);
+      vlib_clear_simple_counters (&hm->clocks_per_packet);
+    }
+}
+
+/*
+ * Start or stop recording the vector size and clocks per packet histograms
+ * of every node dispatch. Each thread only ever writes its own counter
+ * row, so the histograms are updated without locks. Nodes created after
+ * enabling are not profiled until the histograms are enabled again.
+ */
+int
+vlib_node_dispatch_histogram_enable_disable (vlib_main_t * vm, int enable)
+{
+  vlib_node_dispatch_histogram_main_t *hm =
+    &vlib_node_dispatch_histogram_main;
+  u32 n_nodes = vec_len (vm->node_main.nodes);
+
+  if (!enable)
+    {
+      hm->n_nodes = 0;
+      return 0;
+    }
+
+  hm->vector_size.name = "vector-size-histogram";
+  hm->vector_size.stat_segment_name = "/sys/node/vector-size-histogram";
+  hm->clocks_per_packet.name = "clocks-per-packet-histogram";
+  hm->clocks_per_packet.stat_segment_name =
+    "/sys/node/clocks-per-packet-histogram";
+
+  /* counter vectors may move, keep the workers out of dispatch_node */
+  vlib_worker_thread_barrier_sync (vm);
+
+  vlib_validate_simple_counter (&hm->vector_size,
+				n_nodes * VLIB_NODE_VECTOR_SIZE_HIST_N_BINS -
+				1);
+  vlib_validate_simple_counter (&hm->clocks_per_packet,
+				n_nodes * VLIB_NODE_CLOCKS_HIST_N_BINS - 1);
+  if (!hm->n_nodes)
+    vlib_node_dispatch_histogram_clear ();
+  hm->n_nodes = n_nodes;
+
+  vlib_worker_thread_barrier_release (vm);
+
+  return 0;
+}
+
+vlib_node_dispatch_order_main_t vlib_node_dispatch_order_main;
+
+static void
+vlib_node_dispatch_order_compute_depth (vlib_main_t * vm)
+{
+  vlib_node_dispatch_order_main_t *om = &vlib_node_dispatch_order_main;
+  vlib_node_main_t *nm = &vm->node_main;
+  u32 *fifo = 0, *depth, head, ni, i;
+  vlib_node_t *n;
+
+  vec_reset_length (om->depth_by_node_index);
+  vec_validate_init_empty (om->depth_by_node_index,
+			   vec_len (nm->nodes) - 1, ~0);
+  depth = om->depth_by_node_index;
+
+  for (ni = 0; ni < vec_len (nm->nodes); ni++)
+    {
+      n = nm->nodes[ni];
+      if (n->type == VLIB_NODE_TYPE_INPUT
+	  || n->type == VLIB_NODE_TYPE_PRE_INPUT
+	  || n->type == VLIB_NODE_TYPE_PROCESS)
+	{
+	  depth[ni] = 0;
+	  vec_add1 (fifo, ni);
+	}
+    }
+
+  /* breadth first walk, loops in the graph keep the first depth seen */
+  for (head = 0; head < vec_len (fifo); head++)
+    {
+      n = nm->nodes[fifo[head]];
+      for (i = 0; i < vec_len (n->next_nodes); i++)
+	{
+	  ni = n->next_nodes[i];
+	  if (ni == VLIB_INVALID_NODE_INDEX || depth[ni] != ~0)
+	    continue;
+	  depth[ni] = depth[n->index] + 1;
+	  vec_add1 (fifo, ni);
+	}
+    }
+
+  /* nodes only fed through handoff queues or frames put by hand */
+  for (ni = 0; ni < vec_len (depth); ni++)
+    if (depth[ni] == ~0)
+      depth[ni] = 0;
+
+  vec_free (fifo);
+}
+
+/*
+ * Switch between dispatching pending frames in queue order and by graph
+ * depth. In depth order a pending frame smaller than the defer threshold
+ * is dispatched only after the pending frames of shallower nodes, which
+ * may still append to it. The graph depth is computed when enabling, so
+ * nodes and arcs added later keep their old depth, or depth 0, until the
+ * mode is enabled again. Must be called with the worker barrier held.
+ */
+int
+vlib_node_dispatch_order_enable_disable (vlib_main_t * vm, int enable,
+					 u32 defer_threshold)
+{
+  vlib_node_dispatch_order_main_t *om = &vlib_node_dispatch_order_main;
+  vlib_node_main_t *nm = &vm->node_main;
+  vlib_main_t *stat_vm;
+  vlib_node_t *n;
+  u32 ni, i;
+
+  if (!enable)
+    {
+      om->enabled = 0;
+      return 0;
+    }
+
+  if (defer_threshold > VLIB_FRAME_SIZE)
+    return -1;
+
+  vlib_node_dispatch_order_compute_depth (vm);
+  om->defer_threshold = defer_threshold ? defer_threshold :
+    VLIB_NODE_DISPATCH_DEFER_THRESHOLD;
+
+  /* baseline for the vectors per call comparison */
+  vec_reset_length (om->vectors_before);
+  vec_reset_length (om->calls_before);
+  vec_reset_length (om->vectors_at_enable);
+  vec_reset_length (om->calls_at_enable);
+  vec_validate (om->vectors_before, vec_len (nm->nodes) - 1);
+  vec_validate (om->calls_before, vec_len (nm->nodes) - 1);
+  vec_validate (om->vectors_at_enable, vec_len (nm->nodes) - 1);
+  vec_validate (om->calls_at_enable, vec_len (nm->nodes) - 1);
+
+  for (i = 0; i < vec_len (vlib_mains); i++)
+    {
+      stat_vm = vlib_mains[i];
+      if (!stat_vm)
+	continue;
+      for (ni = 0; ni < vec_len (stat_vm->node_main.nodes)
+	   && ni < vec_len (om->calls_before); ni++)
+	{
+	  n = stat_vm->node_main.nodes[ni];
+	  vlib_node_sync_stats (stat_vm, n);
+	  om->vectors_before[ni] +=
+	    n->stats_total.vectors - n->stats_last_clear.vectors;
+	  om->calls_before[ni] +=
+	    n->stats_total.calls - n->stats_last_clear.calls;
+	  om->vectors_at_enable[ni] += n->stats_total.vectors;
+	  om->calls_at_enable[ni] += n->stats_total.calls;
+	}
+    }
+
+  om->enabled = 1;
+
+  return 0;
+}
+
 /*
  * fd.io coding-style-patch-verification: ON
  *
@@ -822,6 +822,54 @@ typedef struct
   vlib_node_registration_t *node_registrations;
 } vlib_node_main_t;
 
+/* Per-node dispatch histograms use log2 bins, the last bin is open ended */
+#define VLIB_NODE_VECTOR_SIZE_HIST_N_BINS 9
+#define VLIB_NODE_CLOCKS_HIST_N_BINS 16
+
+typedef struct
+{
+  /* Vector size and clocks per packet histograms of each dispatch,
+     counter index is node_index * n_bins + bin, one row per thread. */
+  vlib_simple_counter_main_t vector_size;
+  vlib_simple_counter_main_t clocks_per_packet;
+
+  /* Nodes with lower index are profiled, zero when disabled. */
+  volatile u32 n_nodes;
+} vlib_node_dispatch_histogram_main_t;
+
+extern vlib_node_dispatch_histogram_main_t vlib_node_dispatch_histogram_main;
+
+int vlib_node_dispatch_histogram_enable_disable (struct vlib_main_t * vm,
+						 int enable);
+void vlib_node_dispatch_histogram_clear (void);
+
+/* Pending frames at least this large are never deferred by default */
+#define VLIB_NODE_DISPATCH_DEFER_THRESHOLD (VLIB_FRAME_SIZE / 2)
+
+typedef struct
+{
+  /* Shortest distance of each node from an input node, by node index. */
+  u32 *depth_by_node_index;
+
+  /* Smaller pending frames wait until shallower pending nodes have run. */
+  u32 defer_threshold;
+
+  /* Dispatch pending frames by graph depth instead of queue order. */
+  volatile u8 enabled;
+
+  /* Per node vectors and calls since the last runtime stats clear, and
+     their totals, both summed over threads when the mode was enabled. */
+  u64 *vectors_before;
+  u64 *calls_before;
+  u64 *vectors_at_enable;
+  u64 *calls_at_enable;
+} vlib_node_dispatch_order_main_t;
+
+extern vlib_node_dispatch_order_main_t vlib_node_dispatch_order_main;
+
+int vlib_node_dispatch_order_enable_disable (struct vlib_main_t * vm,
+					     int enable, u32 defer_threshold);
+
 
 #define FRAME_QUEUE_MAX_NELTS 32
 typedef struct
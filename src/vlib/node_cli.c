@@ -518,6 +518,8 @@ clear_node_runtime (vlib_main_t * vm,
       nm->time_last_runtime_stats_clear = vlib_time_now (vm);
     }
 
+  vlib_node_dispatch_histogram_clear ();
+
   vlib_worker_thread_barrier_release (vm);
 
   vec_free (stat_vms);
@@ -743,6 +745,324 @@ VLIB_CLI_COMMAND (set_node_fn_command, static) = {
 };
 /* *INDENT-ON* */
 
+static clib_error_t *
+set_node_dispatch_histogram (vlib_main_t * vm, unformat_input_t * input,
+			     vlib_cli_command_t * cmd)
+{
+  int enable = -1;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "on") || unformat (input, "enable"))
+	enable = 1;
+      else if (unformat (input, "off") || unformat (input, "disable"))
+	enable = 0;
+      else
+	return clib_error_return (0, "unknown input '%U'",
+				  format_unformat_error, input);
+    }
+
+  if (enable < 0)
+    return clib_error_return (0, "please specify on or off");
+
+  vlib_node_dispatch_histogram_enable_disable (vm, enable);
+
+  return 0;
+}
+
+/*?
+ * Record per thread histograms of the vector size and of the clocks per
+ * packet of every node dispatch. The histograms are exported to the stats
+ * segment as /sys/node/vector-size-histogram and
+ * /sys/node/clocks-per-packet-histogram, indexed by
+ * node_index * number of bins + bin, where bin is the log2 of the value.
+ *
+ * @cliexpar
+ * @cliexcmd{set node dispatch-histogram on}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (set_node_dispatch_histogram_command, static) = {
+  .path = "set node dispatch-histogram",
+  .short_help = "set node dispatch-histogram <on|off>",
+  .function = set_node_dispatch_histogram,
+};
+/* *INDENT-ON* */
+
+static counter_t
+node_dispatch_histogram_get (vlib_simple_counter_main_t * cm, u32 index,
+			     u32 thread_index)
+{
+  if (thread_index == ~0)
+    return vlib_get_simple_counter (cm, index);
+
+  return cm->counters[thread_index][index];
+}
+
+/* Upper bound of a percentile falling in the given bin, the last bin
+   has none */
+static u8 *
+format_node_dispatch_histogram_bound (u8 * s, va_list * args)
+{
+  u32 bin = va_arg (*args, u32);
+  u32 n_bins = va_arg (*args, u32);
+
+  if (bin >= n_bins)
+    return format (s, "n/a");
+  if (bin == n_bins - 1)
+    return format (s, ">= %llu", 1ULL << bin);
+  return format (s, "< %llu", 1ULL << (bin + 1));
+}
+
+static u8 *
+format_node_dispatch_histogram (u8 * s, va_list * args)
+{
+  vlib_simple_counter_main_t *cm =
+    va_arg (*args, vlib_simple_counter_main_t *);
+  u32 node_index = va_arg (*args, u32);
+  u32 n_bins = va_arg (*args, u32);
+  u32 thread_index = va_arg (*args, u32);
+  u32 indent = format_get_indent (s);
+  counter_t c, sum = 0, total = 0;
+  u32 p50 = ~0, p99 = ~0;
+  u8 *range = 0;
+  u32 bin;
+
+  for (bin = 0; bin < n_bins; bin++)
+    total += node_dispatch_histogram_get (cm, node_index * n_bins + bin,
+					  thread_index);
+
+  for (bin = 0; bin < n_bins; bin++)
+    {
+      c = node_dispatch_histogram_get (cm, node_index * n_bins + bin,
+				       thread_index);
+      if (!c)
+	continue;
+
+      sum += c;
+      if (p50 == ~0 && sum * 100 >= total * 50)
+	p50 = bin;
+      if (p99 == ~0 && sum * 100 >= total * 99)
+	p99 = bin;
+
+      if (bin == n_bins - 1)
+	range = format (range, "[%llu, inf)", 1ULL << bin);
+      else
+	range = format (range, "[%llu, %llu)", 1ULL << bin, 1ULL << (bin + 1));
+      s = format (s, "%-16v%12llu %5.1f%%\n%U", range, c,
+		  (f64) c * 100 / total, format_white_space, indent);
+      vec_reset_length (range);
+    }
+
+  vec_free (range);
+  s = format (s, "p50 %U, p99 %U", format_node_dispatch_histogram_bound,
+	      p50, n_bins, format_node_dispatch_histogram_bound, p99, n_bins);
+
+  return s;
+}
+
+static clib_error_t *
+show_node_dispatch_histogram (vlib_main_t * vm, unformat_input_t * input,
+			      vlib_cli_command_t * cmd)
+{
+  vlib_node_dispatch_histogram_main_t *hm =
+    &vlib_node_dispatch_histogram_main;
+  u32 node_index = ~0, thread_index = ~0;
+  u32 i, n_nodes, bin;
+  counter_t calls;
+  vlib_node_t *n;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "thread %u", &thread_index))
+	;
+      else if (unformat (input, "%U", unformat_vlib_node, vm, &node_index))
+	;
+      else
+	return clib_error_return (0, "unknown input '%U'",
+				  format_unformat_error, input);
+    }
+
+  n_nodes = hm->n_nodes;
+  if (!n_nodes)
+    {
+      vlib_cli_output (vm, "node dispatch histograms are disabled");
+      return 0;
+    }
+
+  if (thread_index != ~0 && thread_index >= vec_len (vlib_mains))
+    return clib_error_return (0, "invalid thread index %u", thread_index);
+
+  for (i = 0; i < n_nodes; i++)
+    {
+      if (node_index != ~0 && i != node_index)
+	continue;
+
+      calls = 0;
+      for (bin = 0; bin < VLIB_NODE_VECTOR_SIZE_HIST_N_BINS; bin++)
+	calls += node_dispatch_histogram_get
+	  (&hm->vector_size, i * VLIB_NODE_VECTOR_SIZE_HIST_N_BINS + bin,
+	   thread_index);
+      if (!calls)
+	continue;
+
+      n = vlib_get_node (vm, i);
+      vlib_cli_output (vm, "%v: %llu calls", n->name, calls);
+      vlib_cli_output (vm, "  vector size:\n    %U",
+		       format_node_dispatch_histogram, &hm->vector_size, i,
+		       VLIB_NODE_VECTOR_SIZE_HIST_N_BINS, thread_index);
+      vlib_cli_output (vm, "  clocks per packet:\n    %U",
+		       format_node_dispatch_histogram, &hm->clocks_per_packet,
+		       i, VLIB_NODE_CLOCKS_HIST_N_BINS, thread_index);
+    }
+
+  return 0;
+}
+
+/*?
+ * Display the node dispatch histograms summed over all threads, or of the
+ * given thread only. Nodes which were not dispatched with work are omitted.
+ *
+ * @cliexpar
+ * @cliexcmd{show node dispatch-histogram ip4-lookup thread 1}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (show_node_dispatch_histogram_command, static) = {
+  .path = "show node dispatch-histogram",
+  .short_help = "show node dispatch-histogram [<node-name>] [thread <n>]",
+  .function = show_node_dispatch_histogram,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+set_node_dispatch_order (vlib_main_t * vm, unformat_input_t * input,
+			 vlib_cli_command_t * cmd)
+{
+  u32 defer_threshold = 0;
+  int enable = -1;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "depth"))
+	enable = 1;
+      else if (unformat (input, "fifo"))
+	enable = 0;
+      else if (unformat (input, "defer-threshold %u", &defer_threshold))
+	;
+      else
+	return clib_error_return (0, "unknown input '%U'",
+				  format_unformat_error, input);
+    }
+
+  if (enable < 0)
+    return clib_error_return (0, "please specify depth or fifo");
+
+  if (vlib_node_dispatch_order_enable_disable (vm, enable, defer_threshold))
+    return clib_error_return (0, "defer-threshold must not exceed %u",
+			      VLIB_FRAME_SIZE);
+
+  return 0;
+}
+
+/*?
+ * Select the order in which the pending frames of internal nodes are
+ * dispatched. The default 'fifo' order dispatches frames as they were
+ * queued. In 'depth' order a pending frame with fewer vectors than the
+ * defer threshold waits until the pending frames of nodes closer to the
+ * input nodes have been dispatched, as these may still add vectors to it.
+ * The default threshold is half the frame size.
+ *
+ * @cliexpar
+ * @cliexcmd{set node dispatch-order depth defer-threshold 64}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (set_node_dispatch_order_command, static) = {
+  .path = "set node dispatch-order",
+  .short_help = "set node dispatch-order <fifo|depth [defer-threshold <n>]>",
+  .function = set_node_dispatch_order,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+show_node_dispatch_order (vlib_main_t * vm, unformat_input_t * input,
+			  vlib_cli_command_t * cmd)
+{
+  vlib_node_dispatch_order_main_t *om = &vlib_node_dispatch_order_main;
+  u64 *vectors = 0, *calls = 0;
+  vlib_main_t *stat_vm;
+  vlib_node_t *n;
+  f64 before, after;
+  u32 i, ni;
+
+  if (!om->enabled)
+    {
+      vlib_cli_output (vm, "dispatch order: fifo");
+      return 0;
+    }
+
+  vlib_cli_output (vm, "dispatch order: depth, defer threshold %u\n",
+		   om->defer_threshold);
+
+  vec_validate (vectors, vec_len (om->calls_at_enable) - 1);
+  vec_validate (calls, vec_len (om->calls_at_enable) - 1);
+
+  vlib_worker_thread_barrier_sync (vm);
+  for (i = 0; i < vec_len (vlib_mains); i++)
+    {
+      stat_vm = vlib_mains[i];
+      if (!stat_vm)
+	continue;
+      for (ni = 0; ni < vec_len (stat_vm->node_main.nodes)
+	   && ni < vec_len (calls); ni++)
+	{
+	  n = stat_vm->node_main.nodes[ni];
+	  vlib_node_sync_stats (stat_vm, n);
+	  vectors[ni] += n->stats_total.vectors;
+	  calls[ni] += n->stats_total.calls;
+	}
+    }
+  vlib_worker_thread_barrier_release (vm);
+
+  vlib_cli_output (vm, "%-30s%8s%20s%20s", "Name", "Depth",
+		   "Vectors/Call Before", "Vectors/Call After");
+  for (ni = 0; ni < vec_len (calls); ni++)
+    {
+      n = vlib_get_node (vm, ni);
+      if (n->type != VLIB_NODE_TYPE_INTERNAL)
+	continue;
+
+      vectors[ni] -= om->vectors_at_enable[ni];
+      calls[ni] -= om->calls_at_enable[ni];
+      if (!calls[ni] && !om->calls_before[ni])
+	continue;
+
+      before = om->calls_before[ni] ?
+	(f64) om->vectors_before[ni] / om->calls_before[ni] : 0;
+      after = calls[ni] ? (f64) vectors[ni] / calls[ni] : 0;
+      vlib_cli_output (vm, "%-30v%8u%20.2f%20.2f", n->name,
+		       om->depth_by_node_index[ni], before, after);
+    }
+
+  vec_free (vectors);
+  vec_free (calls);
+
+  return 0;
+}
+
+/*?
+ * Display the graph depth of the internal nodes and their average vectors
+ * per call before and after depth order dispatch was enabled.
+ *
+ * @cliexpar
+ * @cliexcmd{show node dispatch-order}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (show_node_dispatch_order_command, static) = {
+  .path = "show node dispatch-order",
+  .short_help = "show node dispatch-order",
+  .function = show_node_dispatch_order,
+};
+/* *INDENT-ON* */
+
 /* Dummy function to get us linked in. */
 void
 vlib_node_cli_reference (void)
@@ -210,6 +210,7 @@ vlib_node_set_interrupt_pending (vlib_main_t * vm, u32 node_index)
   clib_spinlock_lock_if_init (&nm->pending_interrupt_lock);
   vec_add1 (nm->pending_interrupt_node_runtime_indices, n->runtime_index);
   clib_spinlock_unlock_if_init (&nm->pending_interrupt_lock);
+  vlib_worker_wakeup (vm);
 }
 
 //通过node取其对应的process
@@ -823,6 +823,9 @@ start_workers (vlib_main_t * vm)
 	      vm_clone->pending_rpc_requests = 0;
 	      vec_validate (vm_clone->pending_rpc_requests, 0);
 	      _vec_len (vm_clone->pending_rpc_requests) = 0;
+	      vm_clone->pending_worker_rpcs = 0;
+	      vm_clone->processing_worker_rpcs = 0;
+	      clib_spinlock_init (&vm_clone->worker_rpc_lock);
 	      clib_memset (&vm_clone->random_buffer, 0,
 			   sizeof (vm_clone->random_buffer));
 
@@ -1446,7 +1449,7 @@ vlib_worker_thread_barrier_sync_int (vlib_main_t * vm, const char *func_name)
   f64 t_entry;
   f64 t_open;
   f64 t_closed;
-  u32 count;
+  u32 count, i;
 
   if (vec_len (vlib_mains) < 2)
     return;
@@ -1494,6 +1497,11 @@ vlib_worker_thread_barrier_sync_int (vlib_main_t * vm, const char *func_name)
 
   //标明需要等待barrier
   *vlib_worker_threads->wait_at_barrier = 1;
+
+  /* Wake up workers sleeping in their idle loop */
+  for (i = 1; i <= count; i++)
+    vlib_worker_wakeup (vlib_mains[i]);
+
   while (*vlib_worker_threads->workers_at_barrier != count)
     {
       //等待barrier通过，如果到达超时仍未通过，则告警并主动panic
@@ -1898,6 +1906,97 @@ vlib_rpc_call_main_thread (void *callback, u8 * args, u32 arg_size)
     clib_warning ("BUG: rpc_call_main_thread_cb_fn NULL!");
 }
 
+void
+vlib_worker_rpc_call (u32 thread_index, vlib_worker_rpc_fn_t * fn,
+		      void *data, u32 data_len)
+{
+  vlib_main_t *vm = vlib_mains[thread_index];
+  vlib_worker_rpc_t *rpc;
+
+  ASSERT (data_len <= VLIB_WORKER_RPC_DATA_BYTES);
+
+  if (thread_index == vlib_get_thread_index ())
+    {
+      fn (vm, data);
+      return;
+    }
+
+  clib_spinlock_lock (&vm->worker_rpc_lock);
+  vec_add2 (vm->pending_worker_rpcs, rpc, 1);
+  rpc->fn = fn;
+  clib_memcpy_fast (rpc->data, data, data_len);
+  clib_spinlock_unlock (&vm->worker_rpc_lock);
+
+  vlib_worker_wakeup (vm);
+}
+
+void
+vlib_worker_rpc_call_all (vlib_worker_rpc_fn_t * fn, void *data,
+			  u32 data_len)
+{
+  u32 i;
+
+  if (vec_len (vlib_mains) == 1)
+    {
+      vlib_worker_rpc_call (0, fn, data, data_len);
+      return;
+    }
+
+  for (i = 1; i < vec_len (vlib_mains); i++)
+    vlib_worker_rpc_call (i, fn, data, data_len);
+}
+
+void
+vlib_worker_rpc_process (vlib_main_t * vm)
+{
+  vlib_worker_rpc_t *rpc, *tmp;
+
+  clib_spinlock_lock (&vm->worker_rpc_lock);
+  tmp = vm->processing_worker_rpcs;
+  vm->processing_worker_rpcs = vm->pending_worker_rpcs;
+  vm->pending_worker_rpcs = tmp;
+  clib_spinlock_unlock (&vm->worker_rpc_lock);
+
+  vec_foreach (rpc, vm->processing_worker_rpcs) rpc->fn (vm, rpc->data);
+  vec_reset_length (vm->processing_worker_rpcs);
+}
+
+void
+vlib_worker_wait_for_quiescent_state (void)
+{
+  vlib_main_t *vm = vlib_get_main ();
+  u32 i, n_mains = vec_len (vlib_mains);
+  u32 *loop_counts = 0;
+  f64 deadline;
+
+  ASSERT (vlib_get_thread_index () == 0);
+
+  /* No worker, or all of them held at the barrier */
+  if (n_mains < 2 || vlib_worker_threads[0].recursion_level)
+    return;
+
+  vec_validate (loop_counts, n_mains - 1);
+  for (i = 1; i < n_mains; i++)
+    loop_counts[i] = *(volatile u32 *) &vlib_mains[i]->main_loop_count;
+
+  deadline = vlib_time_now (vm) + BARRIER_SYNC_TIMEOUT;
+  for (i = 1; i < n_mains; i++)
+    {
+      while (*(volatile u32 *) &vlib_mains[i]->main_loop_count ==
+	     loop_counts[i] && !vlib_mains[i]->worker_sleeping)
+	{
+	  if (vlib_time_now (vm) > deadline)
+	    {
+	      fformat (stderr, "%s: worker thread deadlock\n", __FUNCTION__);
+	      os_panic ();
+	    }
+	  CLIB_PAUSE ();
+	}
+    }
+
+  vec_free (loop_counts);
+}
+
 clib_error_t *
 threads_init (vlib_main_t * vm)
 {
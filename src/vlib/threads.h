@@ -658,6 +658,42 @@ vlib_process_signal_event_mt_helper (vlib_process_signal_event_mt_args_t *
 				     args);
 void vlib_rpc_call_main_thread (void *function, u8 * args, u32 size);
 
+/**
+ * @brief Run a function on a worker thread without a barrier sync
+ *
+ * The function is run at the top of the thread's main loop, before any
+ * packet is processed. It is run right away when called from the
+ * given thread. Any thread, the main thread included, may be given; the
+ * main thread only picks it up once its main loop stops waiting for
+ * input, at most 10ms later.
+ *
+ * @param thread_index thread running the function
+ * @param fn           function to run
+ * @param data         arguments, copied
+ * @param data_len     arguments size, up to VLIB_WORKER_RPC_DATA_BYTES
+ */
+void vlib_worker_rpc_call (u32 thread_index, vlib_worker_rpc_fn_t * fn,
+			   void *data, u32 data_len);
+
+/**
+ * @brief Run the function on every worker thread, or on the main thread
+ * when there is no worker
+ */
+void vlib_worker_rpc_call_all (vlib_worker_rpc_fn_t * fn, void *data,
+			       u32 data_len);
+
+void vlib_worker_rpc_process (vlib_main_t * vm);
+
+/**
+ * @brief Wait until every worker went through a quiescent state
+ *
+ * Once it returns, workers no longer hold references to data unpublished
+ * before the call, which can then be freed. Workers are quiescent between
+ * main loops, and when sleeping or held at the barrier.
+ * Main thread only.
+ */
+void vlib_worker_wait_for_quiescent_state (void);
+
 u32 elog_global_id_for_msg_name (const char *msg_name);
 #endif /* included_vlib_threads_h */
 
@@ -523,6 +523,424 @@ VLIB_CLI_COMMAND (clear_trace_cli,static) = {
 };
 /* *INDENT-ON* */
 
+vlib_trace_ring_main_t vlib_trace_ring_main;
+
+void *vlib_stats_push_heap (void *);
+
+void vlib_stats_register_trace_rings (void **) __attribute__ ((weak));
+void
+vlib_stats_register_trace_rings (void **notused)
+{
+}
+
+/* *INDENT-OFF* */
+STATIC_ASSERT_SIZEOF (vlib_trace_ring_record_t, 2 * CLIB_CACHE_LINE_BYTES);
+STATIC_ASSERT_SIZEOF (vlib_trace_ring_t, CLIB_CACHE_LINE_BYTES);
+/* *INDENT-ON* */
+
+static_always_inline void
+vlib_trace_ring_add (vlib_main_t * vm, vlib_trace_ring_t * ring,
+		     u32 node_index, u32 bi)
+{
+  vlib_buffer_t *b = vlib_get_buffer (vm, bi);
+  /* vnet_buffer (b)->sw_if_index[], opaque to vlib */
+  u32 *sw_if_index = (u32 *) b->opaque;
+  u64 head = ring->head;
+  vlib_trace_ring_record_t *r;
+
+  r = ring->records + (head & (ring->n_records - 1));
+
+  /* Readers drop the record until it is complete again */
+  r->seq = 0;
+  __atomic_thread_fence (__ATOMIC_RELEASE);
+
+  r->time = clib_cpu_time_now ();
+  r->node_index = node_index;
+  r->buffer_index = bi;
+  r->sw_if_index[VLIB_RX] = sw_if_index[VLIB_RX];
+  r->sw_if_index[VLIB_TX] = sw_if_index[VLIB_TX];
+  r->flags = b->flags;
+  r->length = vlib_buffer_length_in_chain (vm, b);
+  r->n_data = clib_min (b->current_length, VLIB_TRACE_RING_SNAP_BYTES);
+  clib_memcpy_fast (r->data, vlib_buffer_get_current (b), r->n_data);
+
+  clib_atomic_store_rel_n (&r->seq, head + 1);
+  clib_atomic_store_rel_n (&ring->head, head + 1);
+}
+
+static_always_inline int
+vlib_trace_ring_sw_if_index_match (vlib_main_t * vm, uword * bitmap, u32 bi)
+{
+  u32 *sw_if_index = (u32 *) vlib_get_buffer (vm, bi)->opaque;
+
+  return clib_bitmap_get (bitmap, sw_if_index[VLIB_RX])
+    || clib_bitmap_get (bitmap, sw_if_index[VLIB_TX]);
+}
+
+/*
+ * Record one in sample_interval packets dispatched to the filtered nodes.
+ * Only called while this thread's ring is set.
+ */
+void
+vlib_trace_ring_dispatch (vlib_main_t * vm, vlib_node_runtime_t * node,
+			  vlib_frame_t * frame)
+{
+  vlib_trace_ring_main_t *trm = &vlib_trace_ring_main;
+  vlib_trace_main_t *tm = &vm->trace_main;
+  u32 *from, n_left;
+
+  /* Input nodes don't have frames yet */
+  if (frame == 0 || frame->n_vectors == 0)
+    return;
+
+  if (trm->node_bitmap
+      && !clib_bitmap_get (trm->node_bitmap, node->node_index))
+    return;
+
+  from = vlib_frame_vector_args (frame);
+  n_left = frame->n_vectors;
+
+  if (PREDICT_TRUE (trm->sw_if_index_bitmap == 0))
+    {
+      /* Skip straight to the sampled packets */
+      while (n_left >= tm->ring_countdown)
+	{
+	  from += tm->ring_countdown;
+	  n_left -= tm->ring_countdown;
+	  vlib_trace_ring_add (vm, tm->ring, node->node_index, from[-1]);
+	  tm->ring_countdown = trm->sample_interval;
+	}
+      tm->ring_countdown -= n_left;
+      return;
+    }
+
+  for (; n_left > 0; n_left--, from++)
+    {
+      if (!vlib_trace_ring_sw_if_index_match (vm, trm->sw_if_index_bitmap,
+					      from[0]))
+	continue;
+      if (--tm->ring_countdown)
+	continue;
+      vlib_trace_ring_add (vm, tm->ring, node->node_index, from[0]);
+      tm->ring_countdown = trm->sample_interval;
+    }
+}
+
+static vlib_trace_ring_t *
+vlib_trace_ring_alloc (vlib_main_t * vm, u32 n_records)
+{
+  vlib_trace_ring_t *ring;
+  uword size;
+
+  size = sizeof (*ring) + n_records * sizeof (ring->records[0]);
+  ring = clib_mem_alloc_aligned_or_null (size, CLIB_CACHE_LINE_BYTES);
+  if (ring == 0)
+    return 0;
+
+  clib_memset (ring, 0, size);
+  ring->n_records = n_records;
+  ring->thread_index = vm->thread_index;
+  ring->seconds_per_clock = vm->clib_time.seconds_per_clock;
+  ring->base_cpu_time = clib_cpu_time_now ();
+  ring->base_unix_time = unix_time_now ();
+  return ring;
+}
+
+/* Rings live on the stats heap, or the main heap without stats segment */
+static void
+vlib_trace_ring_free (vlib_trace_ring_t ** rings)
+{
+  void *oldheap = vlib_stats_push_heap (0);
+  int i;
+
+  for (i = 0; i < vec_len (rings); i++)
+    if (rings[i])
+      clib_mem_free (rings[i]);
+
+  if (oldheap)
+    clib_mem_set_heap (oldheap);
+}
+
+/*
+ * Start or stop sampling into the per thread rings. Called with the worker
+ * barrier held. The rings are only reallocated when their size changes,
+ * stopping keeps the last records readable. On error sampling carries on
+ * as it was.
+ */
+clib_error_t *
+vlib_trace_ring_enable_disable (int enable, u32 n_records,
+				u32 sample_interval)
+{
+  vlib_trace_ring_main_t *trm = &vlib_trace_ring_main;
+  vlib_trace_ring_t **rings = 0;
+  void *oldheap;
+  int i;
+
+  if (!enable)
+    {
+      /* *INDENT-OFF* */
+      foreach_vlib_main ((
+	{
+	  this_vlib_main->trace_main.ring = 0;
+	}));
+      /* *INDENT-ON* */
+      trm->enabled = 0;
+      return 0;
+    }
+
+  if (n_records == 0 || !is_pow2 (n_records))
+    return clib_error_return (0, "ring size %u is not a power of 2",
+			      n_records);
+  if (sample_interval == 0)
+    return clib_error_return (0, "sample interval must be at least 1");
+
+  if (n_records != trm->n_records
+      || vec_len (trm->rings) != vec_len (vlib_mains))
+    {
+      vec_validate (rings, vec_len (vlib_mains) - 1);
+      oldheap = vlib_stats_push_heap (0);
+      for (i = 0; i < vec_len (vlib_mains); i++)
+	{
+	  if (vlib_mains[i] == 0)
+	    continue;
+	  rings[i] = vlib_trace_ring_alloc (vlib_mains[i], n_records);
+	  if (rings[i] == 0)
+	    break;
+	}
+      if (oldheap)
+	clib_mem_set_heap (oldheap);
+
+      if (i < vec_len (vlib_mains))
+	{
+	  vlib_trace_ring_free (rings);
+	  vec_free (rings);
+	  return clib_error_return (0, "not enough memory for %u trace "
+				    "records per thread, increase the "
+				    "statseg size", n_records);
+	}
+
+      /* Readers switch to the new rings before the old ones go away */
+      vlib_stats_register_trace_rings ((void **) rings);
+      vlib_trace_ring_free (trm->rings);
+      vec_free (trm->rings);
+      trm->rings = rings;
+      trm->n_records = n_records;
+    }
+
+  trm->sample_interval = sample_interval;
+  trm->enabled = 1;
+
+  /* *INDENT-OFF* */
+  foreach_vlib_main ((
+    {
+      vlib_trace_main_t *tm = &this_vlib_main->trace_main;
+      tm->ring_countdown = sample_interval;
+      tm->ring = trm->rings[this_vlib_main->thread_index];
+    }));
+  /* *INDENT-ON* */
+
+  return 0;
+}
+
+/* Called with the worker barrier held */
+void
+vlib_trace_ring_node_filter (u32 node_index, int is_add)
+{
+  vlib_trace_ring_main_t *trm = &vlib_trace_ring_main;
+
+  trm->node_bitmap = clib_bitmap_set (trm->node_bitmap, node_index, is_add);
+  if (clib_bitmap_is_zero (trm->node_bitmap))
+    clib_bitmap_free (trm->node_bitmap);
+}
+
+/* Called with the worker barrier held */
+void
+vlib_trace_ring_sw_if_index_filter (u32 sw_if_index, int is_add)
+{
+  vlib_trace_ring_main_t *trm = &vlib_trace_ring_main;
+
+  trm->sw_if_index_bitmap =
+    clib_bitmap_set (trm->sw_if_index_bitmap, sw_if_index, is_add);
+  if (clib_bitmap_is_zero (trm->sw_if_index_bitmap))
+    clib_bitmap_free (trm->sw_if_index_bitmap);
+}
+
+static clib_error_t *
+cli_trace_ring (vlib_main_t * vm,
+		unformat_input_t * input, vlib_cli_command_t * cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  vlib_trace_ring_main_t *trm = &vlib_trace_ring_main;
+  u32 n_records, sample_interval, node_index, i;
+  u32 *add_nodes = 0, *del_nodes = 0;
+  int enable = trm->enabled, no_nodes = 0;
+  clib_error_t *error = 0;
+
+  n_records = trm->n_records ? trm->n_records :
+    VLIB_TRACE_RING_DEFAULT_N_RECORDS;
+  sample_interval = trm->sample_interval ? trm->sample_interval :
+    VLIB_TRACE_RING_DEFAULT_SAMPLE_INTERVAL;
+
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return 0;
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "on"))
+	enable = 1;
+      else if (unformat (line_input, "off"))
+	enable = 0;
+      else if (unformat (line_input, "size %u", &n_records))
+	;
+      else if (unformat (line_input, "sample %u", &sample_interval))
+	;
+      else if (unformat (line_input, "node none"))
+	no_nodes = 1;
+      else if (unformat (line_input, "node %U del",
+			 unformat_vlib_node, vm, &node_index))
+	vec_add1 (del_nodes, node_index);
+      else if (unformat (line_input, "node %U",
+			 unformat_vlib_node, vm, &node_index))
+	vec_add1 (add_nodes, node_index);
+      else
+	{
+	  error = clib_error_return (0, "unknown input `%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+
+  error = vlib_trace_ring_enable_disable (enable, n_records,
+					  sample_interval);
+  if (error)
+    goto done;
+
+  /* Filters only change once the command is known to succeed */
+  if (no_nodes)
+    clib_bitmap_free (trm->node_bitmap);
+  for (i = 0; i < vec_len (del_nodes); i++)
+    vlib_trace_ring_node_filter (del_nodes[i], 0);
+  for (i = 0; i < vec_len (add_nodes); i++)
+    vlib_trace_ring_node_filter (add_nodes[i], 1);
+
+done:
+  vec_free (add_nodes);
+  vec_free (del_nodes);
+  unformat_free (line_input);
+
+  return error;
+}
+
+/*?
+ * Sample packets into a binary trace ring per thread, for always-on
+ * troubleshooting. Unlike '<em>trace add</em>', nothing is formatted
+ * while forwarding: one in '<em>sample</em>' packets dispatched to the
+ * selected nodes is stored as a fixed size record with the node, buffer
+ * index, rx and tx sw_if_index, buffer flags, length and the first 80
+ * bytes of data. The rings live in the statistics segment as
+ * '<em>/sys/trace_ring</em>', so external tools read them with the stat
+ * client while VPP keeps forwarding, e.g. '<em>vpp_get_stats trace</em>'.
+ *
+ * Each ring holds '<em>size</em>' records (a power of 2, default 4096)
+ * and overwrites the oldest ones. Stopping keeps the last records
+ * readable. Packets of input nodes are seen in the node they are handed
+ * to. Use '<em>trace ring interface</em>' to only sample packets of
+ * some interfaces.
+ *
+ * @cliexpar
+ * @cliexstart{trace ring on sample 100 node ip4-lookup node ip6-lookup}
+ * @cliexend
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (trace_ring_cli,static) = {
+  .path = "trace ring",
+  .short_help = "trace ring [on|off] [size <n>] [sample <n>] "
+    "[node <node> [del]] [node none]",
+  .function = cli_trace_ring,
+};
+/* *INDENT-ON* */
+
+static u8 *
+format_vlib_trace_ring_record (u8 * s, va_list * args)
+{
+  vlib_main_t *vm = va_arg (*args, vlib_main_t *);
+  vlib_trace_ring_t *ring = va_arg (*args, vlib_trace_ring_t *);
+  vlib_trace_ring_record_t *r = va_arg (*args, vlib_trace_ring_record_t *);
+  f64 t;
+
+  t = (r->time - ring->base_cpu_time) * ring->seconds_per_clock;
+  s = format (s, "%.6f %U buffer 0x%x rx %d tx %d len %u flags 0x%x",
+	      ring->base_unix_time + t, format_vlib_node_name, vm,
+	      r->node_index, r->buffer_index, r->sw_if_index[VLIB_RX],
+	      r->sw_if_index[VLIB_TX], r->length, r->flags);
+  s = format (s, "\n  %U", format_hex_bytes, r->data, r->n_data);
+  return s;
+}
+
+static clib_error_t *
+cli_show_trace_ring (vlib_main_t * vm,
+		     unformat_input_t * input, vlib_cli_command_t * cmd)
+{
+  vlib_trace_ring_main_t *trm = &vlib_trace_ring_main;
+  vlib_trace_ring_record_t *r;
+  vlib_trace_ring_t *ring;
+  u32 max = 10, i, n;
+  uword index;
+
+  if (unformat (input, "max %u", &max))
+    ;
+
+  vlib_cli_output (vm, "trace ring %s, %u records per thread, sample 1/%u",
+		   trm->enabled ? "on" : "off", trm->n_records,
+		   trm->sample_interval);
+  if (trm->node_bitmap)
+    {
+      vlib_cli_output (vm, "nodes:");
+      /* *INDENT-OFF* */
+      clib_bitmap_foreach (index, trm->node_bitmap,
+      ({
+        vlib_cli_output (vm, "  %U", format_vlib_node_name, vm, index);
+      }));
+      /* *INDENT-ON* */
+    }
+  if (trm->sw_if_index_bitmap)
+    {
+      vlib_cli_output (vm, "sw_if_index:");
+      /* *INDENT-OFF* */
+      clib_bitmap_foreach (index, trm->sw_if_index_bitmap,
+      ({
+        vlib_cli_output (vm, "  %u", index);
+      }));
+      /* *INDENT-ON* */
+    }
+
+  for (i = 0; i < vec_len (trm->rings); i++)
+    {
+      ring = trm->rings[i];
+      if (ring == 0)
+	continue;
+      vlib_cli_output (vm, "Thread %u: %llu records", i, ring->head);
+      n = clib_min (ring->head, clib_min (max, ring->n_records));
+      while (n > 0)
+	{
+	  r = ring->records + ((ring->head - n) & (ring->n_records - 1));
+	  vlib_cli_output (vm, "%U", format_vlib_trace_ring_record, vm, ring,
+			   r);
+	  n--;
+	}
+    }
+
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (show_trace_ring_cli,static) = {
+  .path = "show trace ring",
+  .short_help = "show trace ring [max <n>]",
+  .function = cli_show_trace_ring,
+};
+/* *INDENT-ON* */
+
 /* Dummy function to get us linked in. */
 void
 vlib_trace_cli_reference (void)
@@ -41,6 +41,7 @@
 #define included_vlib_trace_h
 
 #include <vppinfra/pool.h>
+#include <vlib/trace_ring.h>
 
 typedef struct
 {
@@ -87,8 +88,39 @@ typedef struct
 
   /* verbosity */
   int verbose;
+
+  /* Binary trace ring of this thread, 0 unless sampling is on */
+  vlib_trace_ring_t *ring;
+
+  /* Packets left until the next ring sample */
+  u32 ring_countdown;
 } vlib_trace_main_t;
 
+typedef struct
+{
+  /* Per thread rings on the stats segment heap, kept when sampling stops */
+  vlib_trace_ring_t **rings;
+
+  /* Records per ring, power of 2 */
+  u32 n_records;
+
+  /* Record one in sample_interval packets */
+  u32 sample_interval;
+
+  int enabled;
+
+  /* Sample only these nodes, all nodes if empty */
+  uword *node_bitmap;
+
+  /* Sample only packets with these rx or tx sw_if_index, all if empty */
+  uword *sw_if_index_bitmap;
+} vlib_trace_ring_main_t;
+
+#define VLIB_TRACE_RING_DEFAULT_N_RECORDS 4096
+#define VLIB_TRACE_RING_DEFAULT_SAMPLE_INTERVAL 1024
+
+extern vlib_trace_ring_main_t vlib_trace_ring_main;
+
 format_function_t format_vlib_trace;
 
 #endif /* included_vlib_trace_h */
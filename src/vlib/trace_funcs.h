@@ -189,6 +189,14 @@ vlib_trace_frame_buffers_only (vlib_main_t * vm,
 			       uword next_buffer_stride,
 			       uword n_buffer_data_bytes_in_trace);
 
+/* Sample the frame into the binary trace ring, see trace_ring.h */
+void vlib_trace_ring_dispatch (vlib_main_t * vm, vlib_node_runtime_t * node,
+			       vlib_frame_t * frame);
+clib_error_t *vlib_trace_ring_enable_disable (int enable, u32 n_records,
+					      u32 sample_interval);
+void vlib_trace_ring_node_filter (u32 node_index, int is_add);
+void vlib_trace_ring_sw_if_index_filter (u32 sw_if_index, int is_add);
+
 #endif /* included_vlib_trace_funcs_h */
 
 /*
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2019 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef included_vlib_trace_ring_h
+#define included_vlib_trace_ring_h
+
+#include <stdint.h>
+
+/*
+ * Binary packet trace ring, shared with stats segment clients.
+ *
+ * Each thread owns one ring and is its only writer. The writer never
+ * waits for readers, old records are simply overwritten. A record holds
+ * its sequence number plus one, 0 while it is being written; a reader
+ * copies a record and keeps it only if the sequence number was the
+ * expected one both before and after the copy.
+ */
+
+/* Packet bytes kept per record, record is two cache lines */
+#define VLIB_TRACE_RING_SNAP_BYTES 80
+
+typedef struct
+{
+  /* Sequence number of the record plus one, 0 while being written */
+  uint64_t seq;
+
+  /* CPU time stamp of the dispatch */
+  uint64_t time;
+
+  /* Node the packet was dispatched to */
+  uint32_t node_index;
+  uint32_t buffer_index;
+
+  /* vnet_buffer sw_if_index[VLIB_RX] and [VLIB_TX] */
+  uint32_t sw_if_index[2];
+
+  /* Buffer flags */
+  uint32_t flags;
+
+  /* Packet length, including chained buffers */
+  uint32_t length;
+
+  /* Number of bytes in data, from the current data offset */
+  uint32_t n_data;
+  uint32_t pad;
+
+  uint8_t data[VLIB_TRACE_RING_SNAP_BYTES];
+} vlib_trace_ring_record_t;
+
+typedef struct
+{
+  /* Number of records written so far */
+  uint64_t head;
+
+  /* Ring size, power of 2 */
+  uint32_t n_records;
+  uint32_t thread_index;
+
+  /* Convert record time stamps: base_unix_time +
+     (time - base_cpu_time) * seconds_per_clock */
+  double seconds_per_clock;
+  uint64_t base_cpu_time;
+  double base_unix_time;
+
+  uint64_t pad[3];
+
+  vlib_trace_ring_record_t records[0];
+} vlib_trace_ring_t;
+
+#endif /* included_vlib_trace_ring_h */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -49,6 +49,10 @@
 #ifdef HAVE_LINUX_EPOLL
 
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+/* epoll event data of the worker wakeup eventfd */
+#define LINUX_EPOLL_WAKEUP_EVENT (~0)
 
 typedef struct
 {
@@ -57,13 +61,65 @@ typedef struct
   struct epoll_event *epoll_events;//epoll 事件
   int n_epoll_fds;
 
+  /* Adaptive worker sleep: eventfd kicked by other threads, and
+     consecutive idle main loops */
+  int wakeup_fd;
+  u32 idle_loops;
+  u32 last_vector_stats_index;
+  u32 last_vector_count;
+
   /* Statistics. */
   u64 epoll_files_ready;
   u64 epoll_waits;
+  u64 sleeps;
+  u64 wakeups_by_file;
+  u64 wakeups_by_kick;
+  u64 wakeups_by_timeout;
+  f64 time_asleep;
 } linux_epoll_main_t;
 
 static linux_epoll_main_t *linux_epoll_mains = 0;
 
+static void
+linux_epoll_worker_wakeup (vlib_main_t * vm)
+{
+  linux_epoll_main_t *em = vec_elt_at_index (linux_epoll_mains,
+					     vm->thread_index);
+  u64 one = 1;
+
+  if (write (em->wakeup_fd, &one, sizeof (one)) < 0 && errno != EAGAIN)
+    clib_unix_warning ("write wakeup fd");
+}
+
+/* No vector processed since the previous main loop */
+static_always_inline int
+linux_epoll_worker_is_idle (vlib_main_t * vm, linux_epoll_main_t * em)
+{
+  u32 i = vlib_vector_input_stats_index (vm, 0);
+  u32 v = vm->vector_counts_per_main_loop[i];
+  int is_idle;
+
+  /* the count restarts from 0 when switching to the next stats slot */
+  if (i == em->last_vector_stats_index)
+    is_idle = (v == em->last_vector_count);
+  else
+    is_idle = (v == 0);
+
+  em->last_vector_stats_index = i;
+  em->last_vector_count = v;
+  return is_idle;
+}
+
+/* Work posted by other threads which would not wake the worker up once
+   it is blocked */
+static_always_inline int
+linux_epoll_worker_has_pending_work (vlib_main_t * vm)
+{
+  return _vec_len (vm->node_main.pending_interrupt_node_runtime_indices)
+    || vm->check_frame_queues || *vlib_worker_threads->wait_at_barrier
+    || vec_len (vm->pending_worker_rpcs);
+}
+
 static void
 linux_epoll_file_update (clib_file_t * f, clib_file_update_type_t update_type)
 {
@@ -138,7 +194,9 @@ linux_epoll_input_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
   clib_file_main_t *fm = &file_main;
   linux_epoll_main_t *em = vec_elt_at_index (linux_epoll_mains, thread_index);
   struct epoll_event *e;
-  int n_fds_ready;
+  int n_fds_ready = 0;
+  int n_kicks = 0;
+  u64 sleep_start = 0;
   int is_main = (thread_index == 0);
 
   {
@@ -194,8 +252,31 @@ linux_epoll_input_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
 	  }
 	node->input_main_loops_per_call = 0;
       }
-    else if (is_main == 0 && vector_rate < 2 &&
-	     nm->input_node_counts_by_state[VLIB_NODE_STATE_POLLING] == 0)
+    /*
+     * Adaptive worker sleep: once all input nodes are in interrupt mode
+     * and nothing was processed for a number of main loops, block until
+     * an input file is ready or another thread kicks the wakeup fd. A
+     * worker with work is busy, it doesn't poll its epoll fd every loop.
+     */
+    else if (is_main == 0 && um->worker_idle_loops
+	     && nm->input_node_counts_by_state[VLIB_NODE_STATE_POLLING] == 0
+	     && linux_epoll_worker_is_idle (vm, em))
+      {
+	node->input_main_loops_per_call = 0;
+	if (++em->idle_loops >= um->worker_idle_loops)
+	  {
+	    vm->worker_sleeping = 1;
+	    CLIB_MEMORY_BARRIER ();
+	    /* Work posted before we announced going to sleep */
+	    if (!linux_epoll_worker_has_pending_work (vm))
+	      {
+		timeout_ms = max_timeout_ms;
+		sleep_start = clib_cpu_time_now ();
+	      }
+	  }
+      }
+    else if (is_main == 0 && um->worker_idle_loops == 0 && vector_rate < 2
+	     && nm->input_node_counts_by_state[VLIB_NODE_STATE_POLLING] == 0)
       {
 	timeout = 10e-3;
 	timeout_ms = max_timeout_ms;
@@ -203,6 +284,7 @@ linux_epoll_input_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
       }
     else			/* busy */
       {
+	em->idle_loops = 0;
 	/* Don't come back for a respectable number of dispatch cycles */
 	node->input_main_loops_per_call = 1024;
       }
@@ -256,6 +338,15 @@ linux_epoll_input_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
       clib_error_t *errors[4];
       int n_errors = 0;
 
+      if (PREDICT_FALSE (i == LINUX_EPOLL_WAKEUP_EVENT))
+	{
+	  u64 n;
+	  if (read (em->wakeup_fd, &n, sizeof (n)) < 0 && errno != EAGAIN)
+	    clib_unix_warning ("read wakeup fd");
+	  n_kicks++;
+	  continue;
+	}
+
       if (PREDICT_FALSE (pool_is_free (fm->file_pool, f)))
 	{
 	  /*
@@ -320,6 +411,24 @@ linux_epoll_input_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
     }
 
 done:
+  if (PREDICT_FALSE (vm->worker_sleeping))
+    {
+      vm->worker_sleeping = 0;
+      em->idle_loops = 0;
+      if (sleep_start)
+	{
+	  em->sleeps++;
+	  em->time_asleep += (clib_cpu_time_now () - sleep_start) *
+	    vm->clib_time.seconds_per_clock;
+	  if (n_fds_ready > n_kicks)
+	    em->wakeups_by_file++;
+	  else if (n_kicks)
+	    em->wakeups_by_kick++;
+	  else
+	    em->wakeups_by_timeout++;
+	}
+    }
+
   if (PREDICT_FALSE (vm->cpu_id != clib_get_current_cpu_id ()))
     {
       vm->cpu_id = clib_get_current_cpu_id ();
@@ -351,11 +460,50 @@ VLIB_REGISTER_NODE (linux_epoll_input_node,static) = {
 };
 /* *INDENT-ON* */
 
+static clib_error_t *
+show_unix_worker_sleep (vlib_main_t * vm,
+			unformat_input_t * input, vlib_cli_command_t * cmd)
+{
+  unix_main_t *um = &unix_main;
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  linux_epoll_main_t *em;
+  u32 i;
+
+  if (!um->worker_idle_loops)
+    {
+      vlib_cli_output (vm, "adaptive worker sleep disabled");
+      return 0;
+    }
+
+  vlib_cli_output (vm, "idle loops before sleeping: %u",
+		   um->worker_idle_loops);
+  vlib_cli_output (vm, "%=8s%=14s%=14s%=14s%=14s%=14s", "Thread", "Sleeps",
+		   "File wakeups", "Kick wakeups", "Timeouts", "Asleep (s)");
+  for (i = 1; i < tm->n_vlib_mains; i++)
+    {
+      em = vec_elt_at_index (linux_epoll_mains, i);
+      vlib_cli_output (vm, "%=8u%=14lu%=14lu%=14lu%=14lu%=14.3f", i,
+		       em->sleeps, em->wakeups_by_file, em->wakeups_by_kick,
+		       em->wakeups_by_timeout, em->time_asleep);
+    }
+
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (cli_unix_show_worker_sleep, static) = {
+  .path = "show unix worker-sleep",
+  .short_help = "Show adaptive worker sleep statistics",
+  .function = show_unix_worker_sleep,
+};
+/* *INDENT-ON* */
+
 clib_error_t *
 linux_epoll_input_init (vlib_main_t * vm)
 {
   linux_epoll_main_t *em;
   clib_file_main_t *fm = &file_main;
+  unix_main_t *um = &unix_main;
   vlib_thread_main_t *tm = vlib_get_thread_main ();
 
 
@@ -374,10 +522,32 @@ linux_epoll_input_init (vlib_main_t * vm)
 	if (em->epoll_fd < 0)
 	  return clib_error_return_unix (0, "epoll_create");
       }
+    else if (um->worker_idle_loops)
+      {
+	/* sleeping workers are woken up through an eventfd in their
+	   epoll set, which stays open for the process lifetime */
+	struct epoll_event e = { 0 };
+
+	em->epoll_fd = epoll_create (1);
+	if (em->epoll_fd < 0)
+	  return clib_error_return_unix (0, "epoll_create");
+	em->wakeup_fd = eventfd (0, EFD_NONBLOCK);
+	if (em->wakeup_fd < 0)
+	  return clib_error_return_unix (0, "eventfd");
+	e.events = EPOLLIN;
+	e.data.u32 = LINUX_EPOLL_WAKEUP_EVENT;
+	if (epoll_ctl (em->epoll_fd, EPOLL_CTL_ADD, em->wakeup_fd, &e) < 0)
+	  return clib_error_return_unix (0, "epoll_ctl");
+	em->n_epoll_fds = 1;
+      }
     else
       em->epoll_fd = -1;
   }
 
+  /* copied to the worker mains when they are started */
+  if (um->worker_idle_loops)
+    vm->worker_wakeup_fn = linux_epoll_worker_wakeup;
+
   fm->file_update = linux_epoll_file_update;
 
   return 0;
@@ -415,6 +415,9 @@ unix_config (vlib_main_t * vm, unformat_input_t * input)
 	um->cli_no_pager = 1;
       else if (unformat (input, "poll-sleep-usec %d", &um->poll_sleep_usec))
 	;
+      else if (unformat (input, "worker-idle-loops %d",
+			 &um->worker_idle_loops))
+	;
       else if (unformat (input, "cli-pager-buffer-limit %d",
 			 &um->cli_pager_buffer_limit))
 	;
@@ -105,6 +105,10 @@ typedef struct
 
   u32 poll_sleep_usec;
 
+  /* Idle main loops before a worker with no polling input node blocks
+     until woken up, 0 keeps the fixed 10ms worker sleep */
+  u32 worker_idle_loops;
+
 } unix_main_t;
 
 /* Global main structure. */
@@ -72,13 +72,13 @@
   _(18, IS_DVR, "dvr", 1)                               \
   _(19, QOS_DATA_VALID, "qos-data-valid", 0)            \
   _(20, GSO, "gso", 0)                                  \
-  _(21, AVAIL1, "avail1", 1)                            \
-  _(22, AVAIL2, "avail2", 1)                            \
-  _(23, AVAIL3, "avail3", 1)                            \
-  _(24, AVAIL4, "avail4", 1)                            \
-  _(25, AVAIL5, "avail5", 1)                            \
-  _(26, AVAIL6, "avail6", 1)                            \
-  _(27, AVAIL7, "avail7", 1)
+  _(21, RX_TIMESTAMP_VALID, "rx-timestamp-valid", 0)    \
+  _(22, AVAIL1, "avail1", 1)                            \
+  _(23, AVAIL2, "avail2", 1)                            \
+  _(24, AVAIL3, "avail3", 1)                            \
+  _(25, AVAIL4, "avail4", 1)                            \
+  _(26, AVAIL5, "avail5", 1)                            \
+  _(27, AVAIL6, "avail6", 1)
 
 /*
  * Please allocate the FIRST available bit, redefine
@@ -88,8 +88,7 @@
 
 #define VNET_BUFFER_FLAGS_ALL_AVAIL                                     \
   (VNET_BUFFER_F_AVAIL1 | VNET_BUFFER_F_AVAIL2 | VNET_BUFFER_F_AVAIL3 | \
-   VNET_BUFFER_F_AVAIL4 | VNET_BUFFER_F_AVAIL5 | VNET_BUFFER_F_AVAIL6 | \
-   VNET_BUFFER_F_AVAIL7)
+   VNET_BUFFER_F_AVAIL4 | VNET_BUFFER_F_AVAIL5 | VNET_BUFFER_F_AVAIL6)
 
 #define VNET_BUFFER_FLAGS_VLAN_BITS \
   (VNET_BUFFER_F_VLAN_1_DEEP | VNET_BUFFER_F_VLAN_2_DEEP)
@@ -426,6 +425,12 @@ typedef struct
       u64 pad[1];
       u64 pg_replay_timestamp;
     };
+    struct
+    {
+      u64 pad2[2];
+      /* CPU time stamp taken on input, see interface latency */
+      u64 rx_timestamp;
+    };
     u32 unused[8];
   };
 } vnet_buffer_opaque2_t;
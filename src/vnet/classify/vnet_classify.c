@@ -130,8 +130,11 @@ vnet_classify_new_table (vnet_classify_main_t * cm,
   pool_get_aligned (cm->tables, t, CLIB_CACHE_LINE_BYTES);
   clib_memset (t, 0, sizeof (*t));
 
-  vec_validate_aligned (t->mask, match_n_vectors - 1, sizeof (u32x4));
+  /* zero padded, so the wide lookup variants can over-read the mask */
+  vec_validate_aligned (t->mask, VNET_CLASSIFY_MASK_N_VECTORS - 1,
+			CLIB_CACHE_LINE_BYTES);
   clib_memcpy_fast (t->mask, mask, match_n_vectors * sizeof (u32x4));
+  t->load_mask = pow2_mask (match_n_vectors * 2);
 
   t->next_table_index = ~0;
   t->nbuckets = nbuckets;
@@ -176,6 +179,7 @@ vnet_classify_delete_table_index (vnet_classify_main_t * cm,
 
   vec_free (t->mask);
   vec_free (t->buckets);
+  vec_free (t->bloom);
 #if USE_DLMALLOC == 0
   mheap_free (t->mheap);
 #else
@@ -183,6 +187,8 @@ vnet_classify_delete_table_index (vnet_classify_main_t * cm,
 #endif
 
   pool_put (cm->tables, t);
+
+  vnet_classify_chain_compile (cm);
 }
 
 static vnet_classify_entry_t *
@@ -416,6 +422,224 @@ vnet_classify_entry_release_resource (vnet_classify_entry_t * e)
     }
 }
 
+#define VNET_CLASSIFY_BLOOM_MAX_LOG2_BITS 24
+
+/* 16 bits per session, not less than 4k nor more than 16M bits */
+static u32
+vnet_classify_bloom_size (vnet_classify_table_t * t)
+{
+  u32 n = clib_max (t->active_elements, t->nbuckets);
+
+  return clib_min (clib_max (max_log2 (n) + 4, 12),
+		   VNET_CLASSIFY_BLOOM_MAX_LOG2_BITS);
+}
+
+/*
+ * Build a bloom prefilter populated with the hashes of all of the
+ * table's sessions. Called with the writer lock held.
+ */
+static u64 *
+vnet_classify_bloom_build (vnet_classify_table_t * t)
+{
+  vnet_classify_bucket_t *b;
+  vnet_classify_entry_t *v;
+  u64 *bloom = 0;
+  u8 *key_minus_skip;
+  int i, j;
+
+  ASSERT (t->writer_lock[0]);
+
+  vec_validate_aligned (bloom, (1 << vnet_classify_bloom_size (t)) / 64 - 1,
+			CLIB_CACHE_LINE_BYTES);
+
+  for (i = 0; i < t->nbuckets; i++)
+    {
+      b = &t->buckets[i];
+      if (b->offset == 0)
+	continue;
+
+      v = vnet_classify_get_entry (t, b->offset);
+      for (j = 0; j < (1 << b->log2_pages) * t->entries_per_page; j++)
+	{
+	  vnet_classify_entry_t *e = vnet_classify_entry_at_index (t, v, j);
+
+	  if (vnet_classify_entry_is_free (e))
+	    continue;
+
+	  key_minus_skip = (u8 *) e->key;
+	  key_minus_skip -= t->skip_n_vectors * sizeof (u32x4);
+	  vnet_classify_bloom_add (bloom,
+				   vnet_classify_hash_packet (t,
+							      key_minus_skip));
+	}
+    }
+
+  return bloom;
+}
+
+static void
+vnet_classify_bloom_retire (u64 * bloom)
+{
+  if (bloom == 0)
+    return;
+
+  /* the workers may still be looking at the old prefilter */
+  vlib_worker_wait_for_quiescent_state ();
+  vec_free (bloom);
+}
+
+static void
+vnet_classify_bloom_rebuild (vnet_classify_table_t * t)
+{
+  u64 *old;
+
+  /* build under the writer lock so no concurrent add is lost */
+  while (clib_atomic_test_and_set (t->writer_lock))
+    ;
+
+  old = t->bloom;
+  t->bloom = vnet_classify_bloom_build (t);
+  t->bloom_n_stale = 0;
+
+  CLIB_MEMORY_BARRIER ();
+  t->writer_lock[0] = 0;
+
+  vnet_classify_bloom_retire (old);
+}
+
+static void
+vnet_classify_bloom_disable (vnet_classify_table_t * t)
+{
+  u64 *old;
+
+  while (clib_atomic_test_and_set (t->writer_lock))
+    ;
+
+  old = t->bloom;
+  t->bloom = 0;
+  t->bloom_n_stale = 0;
+
+  CLIB_MEMORY_BARRIER ();
+  t->writer_lock[0] = 0;
+
+  vnet_classify_bloom_retire (old);
+}
+
+/*
+ * Rebuild the prefilters vnet_classify_add_del asked for, on the main
+ * thread and outside of any node.
+ */
+static uword
+vnet_classify_bloom_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
+			     vlib_frame_t * f)
+{
+  vnet_classify_main_t *cm = &vnet_classify_main;
+  vnet_classify_table_t *t;
+  uword *event_data = 0;
+  int i;
+
+  while (1)
+    {
+      vlib_process_wait_for_event (vm);
+      vlib_process_get_events (vm, &event_data);
+
+      for (i = 0; i < vec_len (event_data); i++)
+	{
+	  if (pool_is_free_index (cm->tables, event_data[i]))
+	    continue;
+	  t = pool_elt_at_index (cm->tables, event_data[i]);
+	  t->bloom_rebuild_pending = 0;
+	  if (t->bloom)
+	    vnet_classify_bloom_rebuild (t);
+	}
+      vec_reset_length (event_data);
+    }
+
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (vnet_classify_bloom_process_node, static) = {
+  .function = vnet_classify_bloom_process,
+  .type = VLIB_NODE_TYPE_PROCESS,
+  .name = "classify-bloom-process",
+};
+/* *INDENT-ON* */
+
+static int
+vnet_classify_tables_share_key (vnet_classify_table_t * a,
+				vnet_classify_table_t * b)
+{
+  return (a->skip_n_vectors == b->skip_n_vectors &&
+	  a->match_n_vectors == b->match_n_vectors &&
+	  a->current_data_flag == b->current_data_flag &&
+	  a->current_data_offset == b->current_data_offset &&
+	  !memcmp (a->mask, b->mask, a->match_n_vectors * sizeof (u32x4)));
+}
+
+/*
+ * Compile the classify chains: for each table reached through another's
+ * next_table_index, note whether the hash of the previous table can be
+ * reused and build its bloom prefilter; drop the prefilter from tables
+ * that are no longer in a chain. Call after any chain link changes.
+ */
+void
+vnet_classify_chain_compile (vnet_classify_main_t * cm)
+{
+  vnet_classify_table_t *t, *nt;
+  u8 *has_prev = 0, *shared = 0;
+  u32 ti;
+
+  vec_validate_init_empty (has_prev, pool_len (cm->tables), 0);
+  vec_validate_init_empty (shared, pool_len (cm->tables), 1);
+
+  /* *INDENT-OFF* */
+  pool_foreach (t, cm->tables,
+  ({
+    if (t->next_table_index == ~0 ||
+        pool_is_free_index (cm->tables, t->next_table_index))
+      continue;
+
+    nt = pool_elt_at_index (cm->tables, t->next_table_index);
+    has_prev[t->next_table_index] = 1;
+    shared[t->next_table_index] &= vnet_classify_tables_share_key (t, nt);
+  }));
+
+  pool_foreach (t, cm->tables,
+  ({
+    ti = t - cm->tables;
+    t->chain_hash_shared = has_prev[ti] && shared[ti];
+
+    if (has_prev[ti] && !t->bloom)
+      vnet_classify_bloom_rebuild (t);
+    else if (!has_prev[ti] && t->bloom)
+      vnet_classify_bloom_disable (t);
+  }));
+  /* *INDENT-ON* */
+
+  vec_free (has_prev);
+  vec_free (shared);
+}
+
+static void
+vnet_classify_table_set_next (vnet_classify_main_t * cm,
+			      vnet_classify_table_t * t,
+			      u32 next_table_index)
+{
+  /*
+   * The new predecessor may not share the next table's key, so stop
+   * reusing hashes into it before it can be reached, then recompile.
+   */
+  if (next_table_index != ~0 &&
+      !pool_is_free_index (cm->tables, next_table_index))
+    pool_elt_at_index (cm->tables, next_table_index)->chain_hash_shared = 0;
+
+  CLIB_MEMORY_BARRIER ();
+  t->next_table_index = next_table_index;
+
+  vnet_classify_chain_compile (cm);
+}
+
 int
 vnet_classify_add_del (vnet_classify_table_t * t,
 		       vnet_classify_entry_t * add_v, int is_add)
@@ -444,11 +668,15 @@ vnet_classify_add_del (vnet_classify_table_t * t,
   bucket_index = hash & (t->nbuckets - 1);
   b = &t->buckets[bucket_index];
 
-  hash >>= t->log2_nbuckets;
-
   while (clib_atomic_test_and_set (t->writer_lock))
     ;
 
+  /* set the prefilter bits before the entry becomes visible */
+  if (t->bloom && is_add)
+    vnet_classify_bloom_add (t->bloom, hash);
+
+  hash >>= t->log2_nbuckets;
+
   /* First elt in the bucket? */
   if (b->offset == 0)
     {
@@ -545,6 +773,9 @@ vnet_classify_add_del (vnet_classify_table_t * t,
 	      CLIB_MEMORY_BARRIER ();
 	      b->as_u64 = t->saved_bucket.as_u64;
 	      t->active_elements--;
+	      /* the session leaves its prefilter bits set */
+	      if (t->bloom)
+		t->bloom_n_stale++;
 	      goto unlock;
 	    }
 	}
@@ -642,6 +873,24 @@ expand_ok:
 unlock:
   CLIB_MEMORY_BARRIER ();
   t->writer_lock[0] = 0;
+
+  /*
+   * Rebuild the prefilter once the bits of deleted sessions dominate, or
+   * once it is too small for the sessions. This may run in a node, so
+   * the rebuild is left to the classify bloom process.
+   */
+  if (PREDICT_FALSE (t->bloom && !t->bloom_rebuild_pending &&
+		     (t->bloom_n_stale > t->active_elements + 1024 ||
+		      (t->active_elements > vec_len (t->bloom) * 64 / 8 &&
+		       vnet_classify_bloom_log2_bits (t->bloom) <
+		       VNET_CLASSIFY_BLOOM_MAX_LOG2_BITS))))
+    {
+      t->bloom_rebuild_pending = 1;
+      vlib_process_signal_event_mt (vlib_get_main (),
+				    vnet_classify_bloom_process_node.index,
+				    0, t - vnet_classify_main.tables);
+    }
+
   return rv;
 }
 
@@ -776,18 +1025,18 @@ vnet_classify_add_del_table (vnet_classify_main_t * cm,
 
 	  t = vnet_classify_new_table (cm, mask, nbuckets, memory_size,
 				       skip, match);
-	  t->next_table_index = next_table_index;
 	  t->miss_next_index = miss_next_index;
 	  t->current_data_flag = current_data_flag;
 	  t->current_data_offset = current_data_offset;
 	  *table_index = t - cm->tables;
+	  vnet_classify_table_set_next (cm, t, next_table_index);
 	}
       else			/* update */
 	{
 	  vnet_classify_main_t *cm = &vnet_classify_main;
 	  t = pool_elt_at_index (cm->tables, *table_index);
 
-	  t->next_table_index = next_table_index;
+	  vnet_classify_table_set_next (cm, t, next_table_index);
 	}
       return 0;
     }
@@ -1638,7 +1887,12 @@ format_vnet_classify_table (u8 * s, va_list * args)
 	      t->current_data_flag, t->current_data_offset);
   s = format (s, "\n  mask %U", format_hex_bytes, t->mask,
 	      t->match_n_vectors * sizeof (u32x4));
-  s = format (s, "\n  linear-search buckets %d\n", t->linear_buckets);
+  s = format (s, "\n  linear-search buckets %d", t->linear_buckets);
+  if (t->bloom)
+    s = format (s, "\n  chain prefilter %d bits, %d stale, %s hash",
+		vec_len (t->bloom) * 64, t->bloom_n_stale,
+		t->chain_hash_shared ? "shared" : "own");
+  s = format (s, "\n");
 
   if (verbose == 0)
     return s;
@@ -66,6 +66,12 @@ typedef enum vnet_classify_action_t_
 struct _vnet_classify_main;
 typedef struct _vnet_classify_main vnet_classify_main_t;
 
+/*
+ * The mask is stored padded out to this many u32x4s, so that the
+ * AVX2/AVX-512 variants can load it with full-width loads.
+ */
+#define VNET_CLASSIFY_MASK_N_VECTORS 8
+
 #define foreach_size_in_u32x4                   \
 _(1)                                            \
 _(2)                                            \
@@ -159,6 +165,8 @@ typedef struct
   /* Config parameters */
   u32 match_n_vectors;
   u32 skip_n_vectors;
+  /* One bit per u64 of the match, for the wide masked loads */
+  u16 load_mask;
   u32 nbuckets;
   u32 log2_nbuckets;
   u32 linear_buckets;
@@ -170,6 +178,23 @@ typedef struct
   /* Index of next table to try */
   u32 next_table_index;
 
+  /*
+   * Chain compilation, see vnet_classify_chain_compile ().
+   * Set when every table chaining to this one has the same key layout,
+   * so the hash computed for the previous table can be reused.
+   */
+  u8 chain_hash_shared;
+
+  /*
+   * Bloom prefilter over the hashes of this table's sessions. Only built
+   * for tables reached through next_table_index, so a miss walking the
+   * chain rarely has to touch the buckets. Its size is its vector
+   * length, so a rebuild can resize it under the readers.
+   */
+  u64 *bloom;
+  u32 bloom_n_stale;
+  u8 bloom_rebuild_pending;
+
   /* Miss next index, return if next_table_index = 0 */
   u32 miss_next_index;
 
@@ -219,14 +244,42 @@ vnet_classify_hash_packet_inline (vnet_classify_table_t * t, u8 * h)
 {
   u32x4 *mask;
 
+  ASSERT (t);
+  mask = t->mask;
+#if defined (CLIB_HAVE_VEC512)
+  {
+    u64 *data64 = (u64 *) h + 2 * t->skip_n_vectors;
+    u64x8 sum;
+
+    sum = u64x8_mask_load_zero (data64, t->load_mask) & ((u64x8 *) mask)[0];
+    if (PREDICT_FALSE (t->load_mask >> 8))
+      sum ^= (u64x8_mask_load_zero (data64 + 8, t->load_mask >> 8) &
+	      ((u64x8 *) mask)[1]);
+
+    return clib_xxhash (u64x8_xor_reduce (sum));
+  }
+#elif defined (CLIB_HAVE_VEC256)
+  {
+    u64 *data64 = (u64 *) h + 2 * t->skip_n_vectors;
+    u64x4 sum;
+
+    sum = u64x4_mask_load_zero (data64, t->load_mask) & ((u64x4 *) mask)[0];
+    if (t->load_mask >> 4)
+      sum ^= (u64x4_mask_load_zero (data64 + 4, t->load_mask >> 4) &
+	      ((u64x4 *) mask)[1]);
+    if (PREDICT_FALSE (t->load_mask >> 8))
+      sum ^= (u64x4_mask_load_zero (data64 + 8, t->load_mask >> 8) &
+	      ((u64x4 *) mask)[2]);
+
+    return clib_xxhash (u64x4_xor_reduce (sum));
+  }
+#else
   union
   {
     u32x4 as_u32x4;
     u64 as_u64[2];
   } xor_sum __attribute__ ((aligned (sizeof (u32x4))));
 
-  ASSERT (t);
-  mask = t->mask;
 #ifdef CLIB_HAVE_VEC128
   if (U32X4_ALIGNED (h))
     {				//SSE can't handle unaligned data
@@ -286,6 +339,7 @@ vnet_classify_hash_packet_inline (vnet_classify_table_t * t, u8 * h)
     }
 
   return clib_xxhash (xor_sum.as_u64[0] ^ xor_sum.as_u64[1]);
+#endif /* CLIB_HAVE_VEC512 */
 }
 
 static inline void
@@ -361,6 +415,59 @@ vnet_classify_prefetch_entry (vnet_classify_table_t * t, u64 hash)
   CLIB_PREFETCH (e, CLIB_CACHE_LINE_BYTES, LOAD);
 }
 
+static inline u32
+vnet_classify_bloom_log2_bits (u64 * bloom)
+{
+  return min_log2 (vec_len (bloom)) + 6;
+}
+
+static inline void
+vnet_classify_bloom_bits (u64 * bloom, u64 hash, u32 * i0, u32 * i1)
+{
+  u32 log2_bits = vnet_classify_bloom_log2_bits (bloom);
+  u32 h32 = hash >> 32;
+
+  /* the low bits of the hash pick the bucket, so use the high ones */
+  *i0 = h32 & pow2_mask (log2_bits);
+  *i1 = (h32 * 0x9e3779b1) >> (32 - log2_bits);
+}
+
+static inline int
+vnet_classify_bloom_test (u64 * bloom, u64 hash)
+{
+  u32 i0, i1;
+
+  vnet_classify_bloom_bits (bloom, hash, &i0, &i1);
+
+  return ((bloom[i0 / 64] >> (i0 % 64)) &
+	  (bloom[i1 / 64] >> (i1 % 64)) & 1);
+}
+
+static inline void
+vnet_classify_bloom_add (u64 * bloom, u64 hash)
+{
+  u32 i0, i1;
+
+  vnet_classify_bloom_bits (bloom, hash, &i0, &i1);
+
+  bloom[i0 / 64] |= 1ULL << (i0 % 64);
+  bloom[i1 / 64] |= 1ULL << (i1 % 64);
+}
+
+/*
+ * The hash of the packet for table t, which was reached through
+ * next_table_index from a table whose hash was prev_hash.
+ */
+static inline u64
+vnet_classify_chain_hash_packet_inline (vnet_classify_table_t * t,
+					u8 * h, u64 prev_hash)
+{
+  if (t->chain_hash_shared)
+    return prev_hash;
+
+  return vnet_classify_hash_packet_inline (t, h);
+}
+
 vnet_classify_entry_t *vnet_classify_find_entry (vnet_classify_table_t * t,
 						 u8 * h, u64 hash, f64 now);
 
@@ -370,17 +477,17 @@ vnet_classify_find_entry_inline (vnet_classify_table_t * t,
 {
   vnet_classify_entry_t *v;
   u32x4 *mask, *key;
-  union
-  {
-    u32x4 as_u32x4;
-    u64 as_u64[2];
-  } result __attribute__ ((aligned (sizeof (u32x4))));
   vnet_classify_bucket_t *b;
+  u64 *bloom;
   u32 value_index;
   u32 bucket_index;
   u32 limit;
   int i;
 
+  bloom = t->bloom;
+  if (bloom && !vnet_classify_bloom_test (bloom, hash))
+    return 0;
+
   bucket_index = hash & (t->nbuckets - 1);
   b = &t->buckets[bucket_index];
   mask = t->mask;
@@ -401,6 +508,82 @@ vnet_classify_find_entry_inline (vnet_classify_table_t * t,
 
   v = vnet_classify_entry_at_index (t, v, value_index);
 
+#if defined (CLIB_HAVE_VEC512)
+  {
+    /* the masked packet data is the same for every entry in the bucket */
+    u64 *data64 = (u64 *) h + 2 * t->skip_n_vectors;
+    u16 load_mask = t->load_mask;
+    u64x8 d0, d1 = { };
+    u64x8 r;
+
+    d0 = u64x8_mask_load_zero (data64, load_mask) & ((u64x8 *) mask)[0];
+    if (PREDICT_FALSE (load_mask >> 8))
+      d1 = (u64x8_mask_load_zero (data64 + 8, load_mask >> 8) &
+	    ((u64x8 *) mask)[1]);
+
+    for (i = 0; i < limit; i++)
+      {
+	key = v->key;
+	r = d0 ^ u64x8_mask_load_zero (key, load_mask);
+	if (PREDICT_FALSE (load_mask >> 8))
+	  r |= d1 ^ u64x8_mask_load_zero ((u64 *) key + 8, load_mask >> 8);
+
+	if (u64x8_is_all_zero (r))
+	  {
+	    if (PREDICT_TRUE (now))
+	      {
+		v->hits++;
+		v->last_heard = now;
+	      }
+	    return (v);
+	  }
+	v = vnet_classify_entry_at_index (t, v, 1);
+      }
+  }
+#elif defined (CLIB_HAVE_VEC256)
+  {
+    /* the masked packet data is the same for every entry in the bucket */
+    u64 *data64 = (u64 *) h + 2 * t->skip_n_vectors;
+    u16 load_mask = t->load_mask;
+    u64x4 d0, d1 = { }, d2 = { };
+    u64x4 r;
+
+    d0 = u64x4_mask_load_zero (data64, load_mask) & ((u64x4 *) mask)[0];
+    if (load_mask >> 4)
+      d1 = (u64x4_mask_load_zero (data64 + 4, load_mask >> 4) &
+	    ((u64x4 *) mask)[1]);
+    if (PREDICT_FALSE (load_mask >> 8))
+      d2 = (u64x4_mask_load_zero (data64 + 8, load_mask >> 8) &
+	    ((u64x4 *) mask)[2]);
+
+    for (i = 0; i < limit; i++)
+      {
+	key = v->key;
+	r = d0 ^ u64x4_mask_load_zero (key, load_mask);
+	if (load_mask >> 4)
+	  r |= d1 ^ u64x4_mask_load_zero ((u64 *) key + 4, load_mask >> 4);
+	if (PREDICT_FALSE (load_mask >> 8))
+	  r |= d2 ^ u64x4_mask_load_zero ((u64 *) key + 8, load_mask >> 8);
+
+	if (u64x4_is_all_zero (r))
+	  {
+	    if (PREDICT_TRUE (now))
+	      {
+		v->hits++;
+		v->last_heard = now;
+	      }
+	    return (v);
+	  }
+	v = vnet_classify_entry_at_index (t, v, 1);
+      }
+  }
+#else
+  union
+  {
+    u32x4 as_u32x4;
+    u64 as_u64[2];
+  } result __attribute__ ((aligned (sizeof (u32x4))));
+
 #ifdef CLIB_HAVE_VEC128
   if (U32X4_ALIGNED (h))
     {
@@ -503,6 +686,7 @@ vnet_classify_find_entry_inline (vnet_classify_table_t * t,
 	  v = vnet_classify_entry_at_index (t, v, 1);
 	}
     }
+#endif /* CLIB_HAVE_VEC512 */
   return 0;
 }
 
@@ -512,6 +696,8 @@ vnet_classify_table_t *vnet_classify_new_table (vnet_classify_main_t * cm,
 						u32 skip_n_vectors,
 						u32 match_n_vectors);
 
+void vnet_classify_chain_compile (vnet_classify_main_t * cm);
+
 int vnet_classify_add_del_session (vnet_classify_main_t * cm,
 				   u32 table_index,
 				   u8 * match,
@@ -347,7 +347,58 @@ vnet_hw_interface_get_rx_mode (vnet_main_t * vnm, u32 hw_if_index,
   return VNET_API_ERROR_INVALID_INTERFACE;
 }
 
+/*
+ * Select the buffer pool rx queues refill from, ~0 restores the default
+ * pool of the numa node of the polling thread. A queue_id of ~0 sets the
+ * pool of all queues without a pool of their own. Only drivers which set
+ * VNET_HW_INTERFACE_FLAG_SUPPORTS_RX_BUFFER_POOL read the setting, and pick
+ * the pool up when they (re)initialize the queue.
+ */
+int
+vnet_hw_interface_set_rx_buffer_pool (vnet_main_t * vnm, u32 hw_if_index,
+				      u32 queue_id, u8 buffer_pool_index)
+{
+  vnet_hw_interface_t *hw = vnet_get_hw_interface (vnm, hw_if_index);
+  vlib_buffer_main_t *bm = vlib_get_main ()->buffer_main;
+
+  if ((hw->flags & VNET_HW_INTERFACE_FLAG_SUPPORTS_RX_BUFFER_POOL) == 0)
+    return VNET_API_ERROR_UNSUPPORTED;
+
+  if (buffer_pool_index != (u8) ~ 0 &&
+      buffer_pool_index >= vec_len (bm->buffer_pools))
+    return VNET_API_ERROR_INVALID_VALUE;
+
+  if (queue_id == ~0)
+    {
+      hw->rx_buffer_pool_index = buffer_pool_index;
+      return 0;
+    }
 
+  if (queue_id > 0xffff)
+    return VNET_API_ERROR_INVALID_QUEUE;
+
+  vec_validate_init_empty (hw->rx_buffer_pool_index_by_queue, queue_id, ~0);
+  hw->rx_buffer_pool_index_by_queue[queue_id] = buffer_pool_index;
+
+  return 0;
+}
+
+u8
+vnet_hw_interface_get_rx_buffer_pool (vnet_main_t * vnm, u32 hw_if_index,
+				      u16 queue_id, u32 numa_node)
+{
+  vnet_hw_interface_t *hw = vnet_get_hw_interface (vnm, hw_if_index);
+  vlib_main_t *vm = vlib_get_main ();
+
+  if (queue_id < vec_len (hw->rx_buffer_pool_index_by_queue) &&
+      hw->rx_buffer_pool_index_by_queue[queue_id] != (u8) ~ 0)
+    return hw->rx_buffer_pool_index_by_queue[queue_id];
+
+  if (hw->rx_buffer_pool_index != (u8) ~ 0)
+    return hw->rx_buffer_pool_index;
+
+  return vlib_buffer_pool_get_default_for_numa (vm, numa_node);
+}
 
 static clib_error_t *
 vnet_device_init (vlib_main_t * vm)
@@ -94,6 +94,11 @@ int vnet_hw_interface_set_rx_mode (vnet_main_t * vnm, u32 hw_if_index,
 int vnet_hw_interface_get_rx_mode (vnet_main_t * vnm, u32 hw_if_index,
 				   u16 queue_id,
 				   vnet_hw_interface_rx_mode * mode);
+int vnet_hw_interface_set_rx_buffer_pool (vnet_main_t * vnm,
+					  u32 hw_if_index, u32 queue_id,
+					  u8 buffer_pool_index);
+u8 vnet_hw_interface_get_rx_buffer_pool (vnet_main_t * vnm, u32 hw_if_index,
+					 u16 queue_id, u32 numa_node);
 
 static inline u64
 vnet_get_aggregate_rx_packets (void)
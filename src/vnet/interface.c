@@ -767,6 +767,7 @@ vnet_register_interface (vnet_main_t * vnm,
   hw_index = hw - im->hw_interfaces;
   hw->hw_if_index = hw_index;
   hw->default_rx_mode = VNET_HW_INTERFACE_RX_MODE_POLLING;
+  hw->rx_buffer_pool_index = ~0;
 
   //如果dev定义了名称format函数，则调用初始化hardware的名称
   //如果hw有format函数，则使用hw的
@@ -1031,6 +1032,7 @@ vnet_delete_hw_interface (vnet_main_t * vnm, u32 hw_if_index)
   vec_free (hw->hw_address);
   vec_free (hw->input_node_thread_index_by_queue);
   vec_free (hw->dq_runtime_index_by_queue);
+  vec_free (hw->rx_buffer_pool_index_by_queue);
 
   pool_put (im->hw_interfaces, hw);
 }
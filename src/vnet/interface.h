@@ -483,6 +483,9 @@ typedef enum vnet_hw_interface_flags_t_
 
   /* gso */
   VNET_HW_INTERFACE_FLAG_SUPPORTS_GSO = (1 << 18),
+
+  /* rx queues refill from the buffer pool selected for them */
+  VNET_HW_INTERFACE_FLAG_SUPPORTS_RX_BUFFER_POOL = (1 << 19),
 } vnet_hw_interface_flags_t;
 
 #define VNET_HW_INTERFACE_FLAG_DUPLEX_SHIFT 1
@@ -575,6 +578,10 @@ typedef struct vnet_hw_interface_t
   u8 *rx_mode_by_queue;
   vnet_hw_interface_rx_mode default_rx_mode;/*接口收包方式，例如polling*/
 
+  /* buffer pool to refill rx queues from, by queue, ~0 for the default */
+  u8 *rx_buffer_pool_index_by_queue;
+  u8 rx_buffer_pool_index;
+
   /* device input device_and_queue runtime index */
   //按queue_id索引device_queue
   uword *dq_runtime_index_by_queue;
@@ -806,9 +813,32 @@ typedef struct
 typedef struct
 {
   u32 *split_buffers;
-  u32 padding[14];
+  /* packets left until the next latency sample */
+  u32 latency_countdown;
+  u32 padding[13];
 } vnet_interface_per_thread_data_t;
 
+/* Latency histograms use log2 bins of CPU clocks, the last bin is open
+   ended */
+#define VNET_INTERFACE_LATENCY_HIST_N_BINS 32
+#define VNET_INTERFACE_LATENCY_DEFAULT_SAMPLE_INTERVAL 1024
+
+typedef struct
+{
+  /* Forwarding latency of packets received on an interface, by rx
+     sw_if_index. Counter index is tx hw_if_index * n_bins + bin. */
+  vlib_simple_counter_main_t *hist_by_rx_sw_if_index;
+
+  /* Tx columns of the histograms, up to the highest enabled hw_if_index */
+  u32 n_tx_columns;
+
+  /* Interfaces with latency measurement enabled */
+  uword *enabled_sw_if_indices;
+
+  /* One in sample_interval received packets is time stamped */
+  u32 sample_interval;
+} vnet_interface_latency_main_t;
+
 typedef struct
 {
   /* Hardware interfaces. */
@@ -855,6 +885,9 @@ typedef struct
   /* enable GSO processing in packet path if this count is > 0 */
   u32 gso_interface_count;
 
+  /* rx to tx latency measurement */
+  vnet_interface_latency_main_t latency;
+
   /* feature_arc_index */
   u8 output_feature_arc_index;
 } vnet_interface_main_t;
@@ -1488,6 +1488,108 @@ VLIB_CLI_COMMAND (cmd_set_if_rx_mode,static) = {
 };
 /* *INDENT-ON* */
 
+static clib_error_t *
+set_interface_rx_buffer_pool (vlib_main_t * vm, unformat_input_t * input,
+			      vlib_cli_command_t * cmd)
+{
+  clib_error_t *error = 0;
+  unformat_input_t _line_input, *line_input = &_line_input;
+  vnet_main_t *vnm = vnet_get_main ();
+  vlib_buffer_main_t *bm = vm->buffer_main;
+  vlib_buffer_pool_t *bp;
+  u32 hw_if_index = (u32) ~ 0;
+  u32 queue_id = (u32) ~ 0;
+  u8 *pool_name = 0;
+  u8 pool_index = ~0;
+  int rv, is_default = 0;
+
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return 0;
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat
+	  (line_input, "%U", unformat_vnet_hw_interface, vnm, &hw_if_index))
+	;
+      else if (unformat (line_input, "queue %d", &queue_id))
+	;
+      else if (unformat (line_input, "default"))
+	is_default = 1;
+      else if (unformat (line_input, "%s", &pool_name))
+	;
+      else
+	{
+	  error = clib_error_return (0, "parse error: '%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+
+  if (hw_if_index == (u32) ~ 0)
+    {
+      error = clib_error_return (0, "please specify valid interface name");
+      goto done;
+    }
+
+  if (!is_default)
+    {
+      if (!pool_name)
+	{
+	  error = clib_error_return (0, "please specify buffer pool");
+	  goto done;
+	}
+      vec_add1 (pool_name, 0);
+
+      /* *INDENT-OFF* */
+      vec_foreach (bp, bm->buffer_pools)
+	if (!strcmp ((char *) bp->name, (char *) pool_name))
+	  pool_index = bp->index;
+      /* *INDENT-ON* */
+
+      if (pool_index == (u8) ~ 0)
+	{
+	  error = clib_error_return (0, "unknown buffer pool '%s'",
+				     pool_name);
+	  goto done;
+	}
+    }
+
+  rv = vnet_hw_interface_set_rx_buffer_pool (vnm, hw_if_index, queue_id,
+					     pool_index);
+  if (rv == VNET_API_ERROR_UNSUPPORTED)
+    error = clib_error_return (0, "interface driver does not support "
+			       "rx buffer pools");
+  else if (rv)
+    error = clib_error_return (0, "failed to set rx buffer pool: %U",
+			       format_vnet_api_errno, rv);
+
+done:
+  vec_free (pool_name);
+  unformat_free (line_input);
+  return error;
+}
+
+/*?
+ * This command selects the buffer pool the receive queues of an interface
+ * are refilled from, so that a bursty interface can only exhaust its own
+ * pool. Dedicated pools are created in the '<em>buffers</em>' section of
+ * the startup configuration, optionally borrowing from the default pool of
+ * their numa node when exhausted. Buffers which could not be allocated are
+ * counted per pool by '<em>show buffers verbose</em>'. Only memif
+ * interfaces support it so far, other drivers reject the command. A memif
+ * applies the pool to its queues when it next connects.
+ *
+ * @cliexpar
+ * @cliexcmd{set interface rx-buffer-pool memif0/0 queue 0 tenant-a}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (cmd_set_if_rx_buffer_pool,static) = {
+    .path = "set interface rx-buffer-pool",
+    .short_help = "set interface rx-buffer-pool <interface> [queue <n>] <pool-name> | default",
+    .function = set_interface_rx_buffer_pool,
+};
+/* *INDENT-ON* */
+
 static clib_error_t *
 show_interface_rx_placement_fn (vlib_main_t * vm, unformat_input_t * input,
 				vlib_cli_command_t * cmd)
@@ -1992,6 +2094,51 @@ VLIB_CLI_COMMAND (pcap_rx_trace_command, static) = {
 };
 /* *INDENT-ON* */
 
+static clib_error_t *
+trace_ring_interface_command_fn (vlib_main_t * vm,
+				 unformat_input_t * input,
+				 vlib_cli_command_t * cmd)
+{
+  vnet_main_t *vnm = vnet_get_main ();
+  u32 sw_if_index = ~0;
+  int is_add = 1;
+
+  if (unformat (input, "none"))
+    {
+      clib_bitmap_free (vlib_trace_ring_main.sw_if_index_bitmap);
+      return 0;
+    }
+
+  if (!unformat (input, "%U", unformat_vnet_sw_interface, vnm, &sw_if_index))
+    return clib_error_return (0, "unknown input `%U'",
+			      format_unformat_error, input);
+  if (unformat (input, "del"))
+    is_add = 0;
+
+  vlib_trace_ring_sw_if_index_filter (sw_if_index, is_add);
+
+  return 0;
+}
+
+/*?
+ * Only sample packets received or sent on the given interfaces into the
+ * binary trace ring, see '<em>trace ring</em>'. A packet matches on its
+ * rx or tx sw_if_index; nodes which keep a FIB index in the tx slot may
+ * let a few other packets through. Without interfaces all packets are
+ * sampled.
+ *
+ * @cliexpar
+ * @cliexstart{trace ring interface GigabitEthernet2/0/0}
+ * @cliexend
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (trace_ring_interface_command, static) = {
+  .path = "trace ring interface",
+  .short_help = "trace ring interface <interface> [del] | none",
+  .function = trace_ring_interface_command_fn,
+};
+/* *INDENT-ON* */
+
 
 /*
  * fd.io coding-style-patch-verification: ON
@@ -406,6 +406,8 @@ void vnet_sw_interface_update_unnumbered (u32 sw_if_index,
 
 int vnet_sw_interface_stats_collect_enable_disable (u32 sw_if_index,
 						    u8 enable);
+int vnet_sw_interface_latency_enable_disable (u32 sw_if_index, u8 enable);
+int vnet_interface_latency_set_sample_interval (u32 sample_interval);
 void vnet_sw_interface_ip_directed_broadcast (vnet_main_t * vnm,
 					      u32 sw_if_index, u8 enable);
 
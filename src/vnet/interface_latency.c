@@ -0,0 +1,534 @@
+/*
+ * Copyright (c) 2019 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Forwarding latency measurement. One in sample_interval packets received
+ * on an enabled interface gets the CPU time stamp of the device-input
+ * feature node in its opaque2. When a stamped packet is sent on an enabled
+ * interface the clocks elapsed are counted in a log2 histogram of the
+ * (rx, tx) interface pair, exported to the stats segment as
+ * /if/latency/<rx sw_if_index>, indexed by tx hw_if_index * n_bins + bin.
+ * Only enabled interfaces send sampled packets, so the histograms have
+ * columns up to the highest enabled hw_if_index and grow on enable only.
+ *
+ * This is not free even for unsampled packets. Every packet received or
+ * sent on an enabled interface passes through one more feature node, and
+ * with a device-input feature enabled the device drivers no longer hand
+ * ethernet-input frames flagged as coming from a single sw_if_index, so
+ * ethernet-input falls back to its per packet interface lookup. Enable it
+ * to diagnose, not on every interface all the time.
+ *
+ * The tx feature is enabled on the interface-output arc of the HW
+ * interface only. Packets sent on its sub-interfaces do not pass through
+ * it and are not sampled, nor are packets sent by nodes that bypass
+ * interface-output.
+ */
+
+#include <vlib/vlib.h>
+#include <vnet/vnet.h>
+#include <vnet/feature/feature.h>
+
+#ifndef CLIB_MARCH_VARIANT
+static void
+interface_latency_validate (vnet_interface_main_t * im, u32 sw_if_index)
+{
+  vnet_interface_latency_main_t *lm = &im->latency;
+  vlib_simple_counter_main_t *cm;
+  vnet_sw_interface_t *si;
+
+  vec_validate (lm->hist_by_rx_sw_if_index, sw_if_index);
+  cm = vec_elt_at_index (lm->hist_by_rx_sw_if_index, sw_if_index);
+  if (!cm->stat_segment_name)
+    {
+      cm->name = (char *) format (0, "latency-%u%c", sw_if_index, 0);
+      cm->stat_segment_name =
+	(char *) format (0, "/if/latency/%u%c", sw_if_index, 0);
+    }
+
+  /* A column for the interface as tx, in every histogram */
+  si = pool_elt_at_index (im->sw_interfaces, sw_if_index);
+  lm->n_tx_columns = clib_max (lm->n_tx_columns, si->hw_if_index + 1);
+  vec_foreach (cm, lm->hist_by_rx_sw_if_index)
+  {
+    if (cm->stat_segment_name)
+      vlib_validate_simple_counter (cm, lm->n_tx_columns *
+				    VNET_INTERFACE_LATENCY_HIST_N_BINS - 1);
+  }
+}
+
+int
+vnet_sw_interface_latency_enable_disable (u32 sw_if_index, u8 enable)
+{
+  vnet_main_t *vnm = vnet_get_main ();
+  vnet_interface_main_t *im = &vnm->interface_main;
+  vnet_interface_latency_main_t *lm = &im->latency;
+  vnet_sw_interface_t *si;
+
+  if (!vnet_sw_interface_is_valid (vnm, sw_if_index))
+    return VNET_API_ERROR_INVALID_SW_IF_INDEX;
+
+  /*
+   * Packets are stamped on the device-input arc, so only HW interfaces
+   * are supported. Packets received on their sub-interfaces are counted
+   * against the HW interface.
+   */
+  si = vnet_get_sw_interface (vnm, sw_if_index);
+  if (si->type != VNET_SW_INTERFACE_TYPE_HARDWARE)
+    return VNET_API_ERROR_INVALID_VALUE;
+
+  enable = ! !enable;
+  if (clib_bitmap_get (lm->enabled_sw_if_indices, sw_if_index) == enable)
+    return 0;
+
+  if (enable)
+    interface_latency_validate (im, sw_if_index);
+
+  lm->enabled_sw_if_indices =
+    clib_bitmap_set (lm->enabled_sw_if_indices, sw_if_index, enable);
+
+  vnet_feature_enable_disable ("device-input", "interface-latency-rx",
+			       sw_if_index, enable, 0, 0);
+  vnet_feature_enable_disable ("interface-output", "interface-latency-tx",
+			       sw_if_index, enable, 0, 0);
+
+  return 0;
+}
+
+int
+vnet_interface_latency_set_sample_interval (u32 sample_interval)
+{
+  vnet_interface_main_t *im = &vnet_get_main ()->interface_main;
+  vnet_interface_per_thread_data_t *ptd;
+
+  if (sample_interval == 0)
+    return VNET_API_ERROR_INVALID_VALUE;
+
+  im->latency.sample_interval = sample_interval;
+  vec_foreach (ptd, im->per_thread_data)
+  {
+    ptd->latency_countdown = 0;
+  }
+
+  return 0;
+}
+#endif /* CLIB_MARCH_VARIANT */
+
+static_always_inline void
+interface_latency_stamp (vnet_interface_latency_main_t * lm,
+			 vnet_interface_per_thread_data_t * ptd,
+			 vlib_buffer_t * b, u64 now)
+{
+  /* The flag may be stale from an earlier use of the buffer */
+  b->flags &= ~VNET_BUFFER_F_RX_TIMESTAMP_VALID;
+
+  if (PREDICT_TRUE (ptd->latency_countdown > 1))
+    {
+      ptd->latency_countdown--;
+      return;
+    }
+
+  ptd->latency_countdown = lm->sample_interval;
+  vnet_buffer2 (b)->rx_timestamp = now;
+  b->flags |= VNET_BUFFER_F_RX_TIMESTAMP_VALID;
+}
+
+static_always_inline void
+interface_latency_sample (vlib_main_t * vm, vnet_main_t * vnm,
+			  vnet_interface_latency_main_t * lm,
+			  vlib_buffer_t * b, u64 now)
+{
+  vlib_simple_counter_main_t *cm;
+  vnet_sw_interface_t *si;
+  u32 tx, index, bin;
+  u64 rx_timestamp, dt;
+
+  b->flags &= ~VNET_BUFFER_F_RX_TIMESTAMP_VALID;
+  rx_timestamp = vnet_buffer2 (b)->rx_timestamp;
+  tx = vnet_get_sw_interface (vnm,
+			      vnet_buffer (b)->sw_if_index[VLIB_TX])->
+    hw_if_index;
+  si = vnet_get_sup_sw_interface (vnm,
+				  vnet_buffer (b)->sw_if_index[VLIB_RX]);
+
+  /* Not stamped on an enabled interface, the flag is stale */
+  if (!clib_bitmap_get (lm->enabled_sw_if_indices, si->sw_if_index))
+    return;
+
+  dt = now > rx_timestamp ? now - rx_timestamp : 0;
+  bin = dt ? clib_min (min_log2 (dt),
+		       VNET_INTERFACE_LATENCY_HIST_N_BINS - 1) : 0;
+  index = tx * VNET_INTERFACE_LATENCY_HIST_N_BINS + bin;
+
+  cm = vec_elt_at_index (lm->hist_by_rx_sw_if_index, si->sw_if_index);
+  if (PREDICT_TRUE (index < vec_len (cm->counters[vm->thread_index])))
+    vlib_increment_simple_counter (cm, vm->thread_index, index, 1);
+}
+
+static_always_inline uword
+interface_latency_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
+			  vlib_frame_t * frame, vlib_rx_or_tx_t rxtx)
+{
+  vnet_main_t *vnm = vnet_get_main ();
+  vnet_interface_main_t *im = &vnm->interface_main;
+  vnet_interface_latency_main_t *lm = &im->latency;
+  vnet_interface_per_thread_data_t *ptd =
+    vec_elt_at_index (im->per_thread_data, vm->thread_index);
+  vlib_buffer_t *bufs[VLIB_FRAME_SIZE], **b = bufs;
+  u16 nexts[VLIB_FRAME_SIZE], *next = nexts;
+  u32 n_left, *from, next0;
+  u64 now;
+
+  /* One time stamp for the whole frame */
+  now = clib_cpu_time_now ();
+
+  from = vlib_frame_vector_args (frame);
+  n_left = frame->n_vectors;
+  vlib_get_buffers (vm, from, bufs, n_left);
+
+  while (n_left > 0)
+    {
+      if (VLIB_RX == rxtx)
+	interface_latency_stamp (lm, ptd, b[0], now);
+      else if (PREDICT_FALSE
+	       (b[0]->flags & VNET_BUFFER_F_RX_TIMESTAMP_VALID))
+	interface_latency_sample (vm, vnm, lm, b[0], now);
+
+      vnet_feature_next (&next0, b[0]);
+      next[0] = next0;
+
+      b += 1;
+      next += 1;
+      n_left -= 1;
+    }
+
+  vlib_buffer_enqueue_to_next (vm, node, from, nexts, frame->n_vectors);
+
+  return frame->n_vectors;
+}
+
+VLIB_NODE_FN (interface_latency_rx_node) (vlib_main_t * vm,
+					  vlib_node_runtime_t * node,
+					  vlib_frame_t * frame)
+{
+  return interface_latency_inline (vm, node, frame, VLIB_RX);
+}
+
+VLIB_NODE_FN (interface_latency_tx_node) (vlib_main_t * vm,
+					  vlib_node_runtime_t * node,
+					  vlib_frame_t * frame)
+{
+  return interface_latency_inline (vm, node, frame, VLIB_TX);
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (interface_latency_rx_node) = {
+  .vector_size = sizeof (u32),
+  .type = VLIB_NODE_TYPE_INTERNAL,
+  .n_errors = 0,
+  .n_next_nodes = 0,
+  .name = "interface-latency-rx",
+};
+
+VLIB_REGISTER_NODE (interface_latency_tx_node) = {
+  .vector_size = sizeof (u32),
+  .type = VLIB_NODE_TYPE_INTERNAL,
+  .n_errors = 0,
+  .n_next_nodes = 0,
+  .name = "interface-latency-tx",
+};
+
+VNET_FEATURE_INIT (interface_latency_rx_node, static) = {
+  .arc_name = "device-input",
+  .node_name = "interface-latency-rx",
+  .runs_before = VNET_FEATURES ("ethernet-input"),
+};
+
+VNET_FEATURE_INIT (interface_latency_tx_node, static) = {
+  .arc_name = "interface-output",
+  .node_name = "interface-latency-tx",
+  .runs_before = VNET_FEATURES ("interface-tx"),
+};
+/* *INDENT-ON* */
+
+#ifndef CLIB_MARCH_VARIANT
+static clib_error_t *
+interface_latency_add_del (vnet_main_t * vnm, u32 sw_if_index, u32 is_add)
+{
+  vnet_interface_latency_main_t *lm = &vnm->interface_main.latency;
+  vlib_simple_counter_main_t *cm;
+  vnet_sw_interface_t *si;
+  u32 bin, tx;
+
+  if (is_add)
+    return 0;
+
+  lm->enabled_sw_if_indices =
+    clib_bitmap_set (lm->enabled_sw_if_indices, sw_if_index, 0);
+
+  /* Forget the deleted interface, its indices may be reused. Only a HW
+     interface has a tx column. */
+  si = vnet_get_sw_interface (vnm, sw_if_index);
+  tx = si->type == VNET_SW_INTERFACE_TYPE_HARDWARE ? si->hw_if_index : ~0;
+  vec_foreach (cm, lm->hist_by_rx_sw_if_index)
+  {
+    if (!cm->stat_segment_name)
+      continue;
+    if (cm - lm->hist_by_rx_sw_if_index == sw_if_index)
+      vlib_clear_simple_counters (cm);
+    else if (tx < lm->n_tx_columns)
+      for (bin = 0; bin < VNET_INTERFACE_LATENCY_HIST_N_BINS; bin++)
+	vlib_zero_simple_counter (cm, tx *
+				  VNET_INTERFACE_LATENCY_HIST_N_BINS + bin);
+  }
+
+  return 0;
+}
+
+VNET_SW_INTERFACE_ADD_DEL_FUNCTION (interface_latency_add_del);
+
+static u8 *
+format_interface_latency_histogram (u8 * s, va_list * args)
+{
+  vlib_main_t *vm = va_arg (*args, vlib_main_t *);
+  vlib_simple_counter_main_t *cm =
+    va_arg (*args, vlib_simple_counter_main_t *);
+  u32 tx_hw_if_index = va_arg (*args, u32);
+  u32 indent = format_get_indent (s);
+  f64 ns_per_clock = vm->clib_time.seconds_per_clock * 1e9;
+  counter_t c, sum = 0, total = 0;
+  f64 p50 = 0, p99 = 0;
+  u8 *range = 0;
+  u32 bin, index;
+
+  index = tx_hw_if_index * VNET_INTERFACE_LATENCY_HIST_N_BINS;
+  for (bin = 0; bin < VNET_INTERFACE_LATENCY_HIST_N_BINS; bin++)
+    total += vlib_get_simple_counter (cm, index + bin);
+
+  for (bin = 0; bin < VNET_INTERFACE_LATENCY_HIST_N_BINS; bin++)
+    {
+      c = vlib_get_simple_counter (cm, index + bin);
+      if (!c)
+	continue;
+
+      sum += c;
+      if (!p50 && sum * 100 >= total * 50)
+	p50 = (1ULL << (bin + 1)) * ns_per_clock;
+      if (!p99 && sum * 100 >= total * 99)
+	p99 = (1ULL << (bin + 1)) * ns_per_clock;
+
+      if (bin == VNET_INTERFACE_LATENCY_HIST_N_BINS - 1)
+	range = format (range, "[%.0f, inf)", (1ULL << bin) * ns_per_clock);
+      else
+	range = format (range, "[%.0f, %.0f)", (1ULL << bin) * ns_per_clock,
+			(1ULL << (bin + 1)) * ns_per_clock);
+      s = format (s, "%-24v%12llu %5.1f%%\n%U", range, c,
+		  (f64) c * 100 / total, format_white_space, indent);
+      vec_reset_length (range);
+    }
+
+  vec_free (range);
+  s = format (s, "p50 < %.0f ns, p99 < %.0f ns", p50, p99);
+
+  return s;
+}
+
+static clib_error_t *
+set_interface_latency_command_fn (vlib_main_t * vm,
+				  unformat_input_t * input,
+				  vlib_cli_command_t * cmd)
+{
+  vnet_main_t *vnm = vnet_get_main ();
+  u32 sw_if_index = ~0, sample_interval = 0;
+  u8 enable = 1;
+  int rv;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "%U", unformat_vnet_sw_interface, vnm,
+		    &sw_if_index))
+	;
+      else if (unformat (input, "disable"))
+	enable = 0;
+      else if (unformat (input, "sample-interval %u", &sample_interval))
+	;
+      else
+	return clib_error_return (0, "unknown input '%U'",
+				  format_unformat_error, input);
+    }
+
+  if (sw_if_index == ~0 && sample_interval == 0)
+    return clib_error_return (0, "please specify interface or "
+			      "sample-interval");
+
+  if (sample_interval)
+    vnet_interface_latency_set_sample_interval (sample_interval);
+
+  if (sw_if_index == ~0)
+    return 0;
+
+  rv = vnet_sw_interface_latency_enable_disable (sw_if_index, enable);
+  if (rv == VNET_API_ERROR_INVALID_VALUE)
+    return clib_error_return (0, "only hardware interfaces are supported");
+  else if (rv)
+    return clib_error_return (0, "enable/disable failed, rv %d", rv);
+
+  return 0;
+}
+
+/*?
+ * Measure the forwarding latency of packets received and sent on the
+ * interfaces with latency enabled. One in 'sample-interval' received
+ * packets is time stamped, the default is 1024. Packets sent on an enabled
+ * interface are counted in a histogram per received and sent interface
+ * pair, exported to the statistics segment as /if/latency/<sw_if_index>
+ * of the receive interface. Each histogram has 32 log2 bins of CPU clocks
+ * per sending interface, at its hw_if_index (the 'Idx' of
+ * 'show hardware-interfaces') times 32.
+ *
+ * Only hardware interfaces can be enabled. Packets received on their
+ * sub-interfaces are counted, packets sent on their sub-interfaces are
+ * not. Enabling costs two feature nodes in the forwarding path, and
+ * ethernet-input loses its single interface fast path on the receive
+ * interface, whether a packet is sampled or not.
+ *
+ * @cliexpar
+ * @cliexcmd{set interface latency GigabitEthernet2/0/0}
+ * @cliexcmd{set interface latency sample-interval 256}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (set_interface_latency_command, static) = {
+  .path = "set interface latency",
+  .short_help = "set interface latency [<interface> [disable]] "
+    "[sample-interval <n>]",
+  .function = set_interface_latency_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+show_interface_latency_command_fn (vlib_main_t * vm,
+				   unformat_input_t * input,
+				   vlib_cli_command_t * cmd)
+{
+  vnet_main_t *vnm = vnet_get_main ();
+  vnet_interface_main_t *im = &vnm->interface_main;
+  vnet_interface_latency_main_t *lm = &im->latency;
+  vlib_simple_counter_main_t *cm;
+  u32 rx_sw_if_index = ~0, rx, tx, bin;
+  counter_t n_samples;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "%U", unformat_vnet_sw_interface, vnm,
+		    &rx_sw_if_index))
+	;
+      else
+	return clib_error_return (0, "unknown input '%U'",
+				  format_unformat_error, input);
+    }
+
+  vlib_cli_output (vm, "sample interval %u", lm->sample_interval);
+
+  vec_foreach (cm, lm->hist_by_rx_sw_if_index)
+  {
+    rx = cm - lm->hist_by_rx_sw_if_index;
+    if (!cm->stat_segment_name)
+      continue;
+    if (rx_sw_if_index != ~0 && rx != rx_sw_if_index)
+      continue;
+
+    for (tx = 0; tx < lm->n_tx_columns; tx++)
+      {
+	if (pool_is_free_index (im->hw_interfaces, tx))
+	  continue;
+
+	n_samples = 0;
+	for (bin = 0; bin < VNET_INTERFACE_LATENCY_HIST_N_BINS; bin++)
+	  n_samples += vlib_get_simple_counter
+	    (cm, tx * VNET_INTERFACE_LATENCY_HIST_N_BINS + bin);
+	if (!n_samples)
+	  continue;
+
+	vlib_cli_output (vm, "%U -> %U: %llu samples\n  %U",
+			 format_vnet_sw_if_index_name, vnm, rx,
+			 format_vnet_hw_if_index_name, vnm, tx, n_samples,
+			 format_interface_latency_histogram, vm, cm, tx);
+      }
+  }
+
+  return 0;
+}
+
+/*?
+ * Display the latency histograms of the interfaces with latency enabled,
+ * summed over all threads. Interface pairs without samples are omitted.
+ *
+ * @cliexpar
+ * @cliexcmd{show interface latency GigabitEthernet2/0/0}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (show_interface_latency_command, static) = {
+  .path = "show interface latency",
+  .short_help = "show interface latency [<interface>]",
+  .function = show_interface_latency_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+clear_interface_latency_command_fn (vlib_main_t * vm,
+				    unformat_input_t * input,
+				    vlib_cli_command_t * cmd)
+{
+  vnet_interface_latency_main_t *lm =
+    &vnet_get_main ()->interface_main.latency;
+  vlib_simple_counter_main_t *cm;
+
+  vec_foreach (cm, lm->hist_by_rx_sw_if_index)
+  {
+    if (cm->stat_segment_name)
+      vlib_clear_simple_counters (cm);
+  }
+
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (clear_interface_latency_command, static) = {
+  .path = "clear interface latency",
+  .short_help = "clear interface latency",
+  .function = clear_interface_latency_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+interface_latency_init (vlib_main_t * vm)
+{
+  vnet_interface_main_t *im = &vnet_get_main ()->interface_main;
+
+  im->latency.sample_interval =
+    VNET_INTERFACE_LATENCY_DEFAULT_SAMPLE_INTERVAL;
+
+  return 0;
+}
+
+VLIB_INIT_FUNCTION (interface_latency_init);
+#endif /* CLIB_MARCH_VARIANT */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -31,6 +31,7 @@
 #include <vnet/ip/ip_punt_drop.h>
 #include <vnet/fib/fib_table.h>
 #include <vnet/fib/fib_api.h>
+#include <vnet/fib/fib_path_list.h>
 #include <vnet/dpo/drop_dpo.h>
 #include <vnet/dpo/receive_dpo.h>
 #include <vnet/dpo/lookup_dpo.h>
@@ -93,6 +94,7 @@ _(PROXY_ARP_INTFC_ENABLE_DISABLE, proxy_arp_intfc_enable_disable)       \
  _(PROXY_ARP_INTFC_DUMP, proxy_arp_intfc_dump)                          \
 _(RESET_FIB, reset_fib)							\
 _(IP_ADD_DEL_ROUTE, ip_add_del_route)                                   \
+_(IP_ADD_DEL_ROUTE_BULK, ip_add_del_route_bulk)                         \
 _(IP_TABLE_ADD_DEL, ip_table_add_del)                                   \
 _(IP_PUNT_POLICE, ip_punt_police)                                       \
 _(IP_PUNT_REDIRECT, ip_punt_redirect)                                   \
@@ -1192,6 +1194,152 @@ vl_api_ip_add_del_route_t_handler (vl_api_ip_add_del_route_t * mp)
   /* *INDENT-ON* */
 }
 
+static int
+ip_add_del_route_bulk_t_handler (vl_api_ip_add_del_route_bulk_t * mp,
+				 u32 * n_routes)
+{
+  u32 fib_index, next_hop_fib_index, n_prefixes, ii;
+  fib_node_index_t path_list_index;
+  fib_route_path_t *paths = NULL;
+  fib_protocol_t fproto;
+  dpo_proto_t dproto;
+  int rv;
+
+  fproto = (mp->is_ipv6 ? FIB_PROTOCOL_IP6 : FIB_PROTOCOL_IP4);
+  dproto = fib_proto_to_dpo (fproto);
+  n_prefixes = ntohl (mp->n_prefixes);
+
+  /* the prefixes must all be within the received message */
+  if (sizeof (*mp) + (u64) n_prefixes * sizeof (mp->prefixes[0]) >
+      vl_msg_api_get_msg_length (mp))
+    return (VNET_API_ERROR_INVALID_VALUE);
+
+  rv = add_del_route_check (fproto,
+			    mp->table_id,
+			    mp->next_hop_sw_if_index,
+			    dproto,
+			    mp->next_hop_table_id,
+			    0, &fib_index, &next_hop_fib_index);
+
+  if (0 != rv)
+    return (rv);
+
+  /*
+   * validate the whole batch before touching the FIB so that a bad
+   * prefix does not leave the table half programmed.
+   */
+  for (ii = 0; ii < n_prefixes; ii++)
+    {
+      if (clib_net_to_host_u32 (mp->prefixes[ii].address.af) !=
+	  (mp->is_ipv6 ? ADDRESS_IP6 : ADDRESS_IP4))
+	return (VNET_API_ERROR_INVALID_ADDRESS_FAMILY);
+      if (mp->prefixes[ii].address_length >
+	  (mp->is_ipv6 ? 128 : 32))
+	return (VNET_API_ERROR_INVALID_VALUE);
+    }
+
+  fib_route_path_t path = {
+    .frp_proto = dproto,
+    .frp_sw_if_index = ntohl (mp->next_hop_sw_if_index),
+    .frp_fib_index = next_hop_fib_index,
+    .frp_weight = mp->next_hop_weight,
+    .frp_preference = mp->next_hop_preference,
+    .frp_flags = FIB_ROUTE_PATH_FLAG_NONE,
+  };
+  if (mp->is_ipv6)
+    clib_memcpy (&path.frp_addr.ip6, mp->next_hop_address,
+		 sizeof (path.frp_addr.ip6));
+  else
+    clib_memcpy (&path.frp_addr.ip4, mp->next_hop_address,
+		 sizeof (path.frp_addr.ip4));
+
+  if (path.frp_sw_if_index == ~0 && ip46_address_is_zero (&path.frp_addr)
+      && path.frp_fib_index != ~0)
+    path.frp_flags |= FIB_ROUTE_PATH_DEAG;
+
+  vec_add1 (paths, path);
+
+  /*
+   * Create, resolve and hold the shared path-list once for an added batch.
+   * Each route's own path-list create then resolves to this one via the
+   * path-list DB, and becomes a child of it, rather than resolving its
+   * own. A delete only looks the routes' path-lists up, creating one for
+   * it would resolve paths that are about to go.
+   */
+  path_list_index = FIB_NODE_INDEX_INVALID;
+  if (mp->is_add)
+    {
+      path_list_index =
+	fib_path_list_create (FIB_PATH_LIST_FLAG_SHARED, paths);
+      fib_path_list_lock (path_list_index);
+    }
+
+  stats_dslock_with_hint (1 /* release hint */ , 2 /* tag */ );
+
+  for (ii = 0; ii < n_prefixes; ii++)
+    {
+      fib_prefix_t pfx;
+
+      ip_prefix_decode (&mp->prefixes[ii], &pfx);
+
+      if (mp->is_multipath)
+	{
+	  if (mp->is_add)
+	    fib_table_entry_path_add2 (fib_index, &pfx,
+				       FIB_SOURCE_API,
+				       FIB_ENTRY_FLAG_NONE, paths);
+	  else
+	    fib_table_entry_path_remove2 (fib_index, &pfx,
+					  FIB_SOURCE_API, paths);
+	}
+      else
+	{
+	  if (mp->is_add)
+	    fib_table_entry_update (fib_index, &pfx,
+				    FIB_SOURCE_API,
+				    FIB_ENTRY_FLAG_NONE, paths);
+	  else
+	    fib_table_entry_delete (fib_index, &pfx, FIB_SOURCE_API);
+	}
+    }
+  *n_routes = n_prefixes;
+
+  stats_dsunlock ();
+
+  if (FIB_NODE_INDEX_INVALID != path_list_index)
+    fib_path_list_unlock (path_list_index);
+  vec_free (paths);
+
+  return (0);
+}
+
+void
+vl_api_ip_add_del_route_bulk_t_handler (vl_api_ip_add_del_route_bulk_t * mp)
+{
+  vl_api_ip_add_del_route_bulk_reply_t *rmp;
+  vlib_main_t *vm = vlib_get_main ();
+  vnet_main_t *vnm = vnet_get_main ();
+  u32 n_routes = 0;
+  f64 t[2];
+  int rv;
+
+  vnm->api_errno = 0;
+
+  t[0] = vlib_time_now (vm);
+  rv = ip_add_del_route_bulk_t_handler (mp, &n_routes);
+  t[1] = vlib_time_now (vm);
+
+  rv = (rv == 0) ? vnm->api_errno : rv;
+
+  /* *INDENT-OFF* */
+  REPLY_MACRO2 (VL_API_IP_ADD_DEL_ROUTE_BULK_REPLY,
+  ({
+    rmp->n_routes = htonl (n_routes);
+    rmp->elapsed_usec = clib_host_to_net_u64 ((u64) ((t[1] - t[0]) * 1e6));
+  }))
+  /* *INDENT-ON* */
+}
+
 void
 ip_table_create (fib_protocol_t fproto,
 		 u32 table_id, u8 is_api, const u8 * name)
@@ -185,7 +185,7 @@ ip_in_out_acl_inline (vlib_main_t * vm,
 	}
 
       vnet_buffer (b0)->l2_classify.hash =
-	vnet_classify_hash_packet (t0, (u8 *) h0);
+	vnet_classify_hash_packet_inline (t0, (u8 *) h0);
 
       vnet_classify_prefetch_bucket (t0, vnet_buffer (b0)->l2_classify.hash);
 
@@ -204,7 +204,7 @@ ip_in_out_acl_inline (vlib_main_t * vm,
 	}
 
       vnet_buffer (b1)->l2_classify.hash =
-	vnet_classify_hash_packet (t1, (u8 *) h1);
+	vnet_classify_hash_packet_inline (t1, (u8 *) h1);
 
       vnet_classify_prefetch_bucket (t1, vnet_buffer (b1)->l2_classify.hash);
 
@@ -250,7 +250,7 @@ ip_in_out_acl_inline (vlib_main_t * vm,
 	}
 
       vnet_buffer (b0)->l2_classify.hash =
-	vnet_classify_hash_packet (t0, (u8 *) h0);
+	vnet_classify_hash_packet_inline (t0, (u8 *) h0);
 
       vnet_buffer (b0)->l2_classify.table_index = table_index0;
       vnet_classify_prefetch_bucket (t0, vnet_buffer (b0)->l2_classify.hash);
@@ -335,7 +335,7 @@ ip_in_out_acl_inline (vlib_main_t * vm,
 	      if (is_output)
 		h0 += vnet_buffer (b0)->l2_classify.pad.l2_len;
 
-	      e0 = vnet_classify_find_entry (t0, (u8 *) h0, hash0, now);
+	      e0 = vnet_classify_find_entry_inline (t0, (u8 *) h0, hash0, now);
 	      if (e0)
 		{
 		  vnet_buffer (b0)->l2_classify.opaque_index
@@ -405,8 +405,9 @@ ip_in_out_acl_inline (vlib_main_t * vm,
 		      if (is_output)
 			h0 += vnet_buffer (b0)->l2_classify.pad.l2_len;
 
-		      hash0 = vnet_classify_hash_packet (t0, (u8 *) h0);
-		      e0 = vnet_classify_find_entry
+		      hash0 = vnet_classify_chain_hash_packet_inline
+			(t0, (u8 *) h0, hash0);
+		      e0 = vnet_classify_find_entry_inline
 			(t0, (u8 *) h0, hash0, now);
 		      if (e0)
 			{
@@ -1061,6 +1061,13 @@ l2_api_hookup (vlib_main_t * vm)
   foreach_vpe_api_msg;
 #undef _
 
+  /*
+   * Mark the l2fib add/del API as MP safe, the MAC table is a bihash
+   * already written by the learning workers
+   */
+  am->is_mp_safe[VL_API_L2FIB_ADD_DEL] = 1;
+  am->is_mp_safe[VL_API_L2FIB_ADD_DEL_REPLY] = 1;
+
   /*
    * Set up the (msg_name, crc, message-id) table
    */
@@ -404,7 +404,6 @@ l2fib_add_entry (const u8 * mac, u32 bd_index,
   l2fib_entry_result_t result;
   __attribute__ ((unused)) u32 bucket_contents;
   l2fib_main_t *fm = &l2fib_main;
-  l2learn_main_t *lm = &l2learn_main;
   BVT (clib_bihash_kv) kv;
 
   /* set up key */
@@ -415,9 +414,8 @@ l2fib_add_entry (const u8 * mac, u32 bd_index,
     {
       /* decrement counter if overwriting a learned mac  */
       result.raw = kv.value;
-      if ((!l2fib_entry_result_is_set_AGE_NOT (&result))
-	  && (lm->global_learn_count))
-	lm->global_learn_count--;
+      if (!l2fib_entry_result_is_set_AGE_NOT (&result))
+	l2learn_global_learn_count_dec ();
     }
 
   /* set up result */
@@ -700,9 +698,8 @@ l2fib_del_entry (const u8 * mac, u32 bd_index, u32 sw_if_index)
     return 1;
 
   /* decrement counter if dynamically learned mac */
-  if ((!l2fib_entry_result_is_set_AGE_NOT (&result)) &&
-      (l2learn_main.global_learn_count))
-    l2learn_main.global_learn_count--;
+  if (!l2fib_entry_result_is_set_AGE_NOT (&result))
+    l2learn_global_learn_count_dec ();
 
   /* Remove entry from hash table */
   BV (clib_bihash_add_del) (&mp->mac_table, &kv, 0 /* is_add */ );
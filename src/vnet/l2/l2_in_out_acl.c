@@ -204,7 +204,7 @@ l2_in_out_acl_node_fn (vlib_main_t * vm,
 	h0 = (void *) vlib_buffer_get_current (b0);
 
       vnet_buffer (b0)->l2_classify.hash =
-	vnet_classify_hash_packet (t0, (u8 *) h0);
+	vnet_classify_hash_packet_inline (t0, (u8 *) h0);
 
       vnet_classify_prefetch_bucket (t0, vnet_buffer (b0)->l2_classify.hash);
 
@@ -214,7 +214,7 @@ l2_in_out_acl_node_fn (vlib_main_t * vm,
 	h1 = (void *) vlib_buffer_get_current (b1);
 
       vnet_buffer (b1)->l2_classify.hash =
-	vnet_classify_hash_packet (t1, (u8 *) h1);
+	vnet_classify_hash_packet_inline (t1, (u8 *) h1);
 
       vnet_classify_prefetch_bucket (t1, vnet_buffer (b1)->l2_classify.hash);
 
@@ -251,7 +251,7 @@ l2_in_out_acl_node_fn (vlib_main_t * vm,
 	h0 = (void *) vlib_buffer_get_current (b0);
 
       vnet_buffer (b0)->l2_classify.hash =
-	vnet_classify_hash_packet (t0, (u8 *) h0);
+	vnet_classify_hash_packet_inline (t0, (u8 *) h0);
 
       vnet_buffer (b0)->l2_classify.table_index = table_index0;
       vnet_classify_prefetch_bucket (t0, vnet_buffer (b0)->l2_classify.hash);
@@ -335,7 +335,7 @@ l2_in_out_acl_node_fn (vlib_main_t * vm,
 	      else
 		h0 = (void *) vlib_buffer_get_current (b0);
 
-	      e0 = vnet_classify_find_entry (t0, (u8 *) h0, hash0, now);
+	      e0 = vnet_classify_find_entry_inline (t0, (u8 *) h0, hash0, now);
 	      if (e0)
 		{
 		  vnet_buffer (b0)->l2_classify.opaque_index
@@ -390,8 +390,9 @@ l2_in_out_acl_node_fn (vlib_main_t * vm,
 		      else
 			h0 = (void *) vlib_buffer_get_current (b0);
 
-		      hash0 = vnet_classify_hash_packet (t0, (u8 *) h0);
-		      e0 = vnet_classify_find_entry
+		      hash0 = vnet_classify_chain_hash_packet_inline
+			(t0, (u8 *) h0, hash0);
+		      e0 = vnet_classify_find_entry_inline
 			(t0, (u8 *) h0, hash0, now);
 		      if (e0)
 			{
@@ -233,7 +233,7 @@ VLIB_NODE_FN (l2_input_classify_node) (vlib_main_t * vm,
 	  t0 = pool_elt_at_index (vcm->tables, table_index0);
 
 	  vnet_buffer (b0)->l2_classify.hash = hash0 =
-	    vnet_classify_hash_packet (t0, (u8 *) h0);
+	    vnet_classify_hash_packet_inline (t0, (u8 *) h0);
 	  vnet_classify_prefetch_bucket (t0, hash0);
 	}
 
@@ -247,7 +247,7 @@ VLIB_NODE_FN (l2_input_classify_node) (vlib_main_t * vm,
 	  t1 = pool_elt_at_index (vcm->tables, table_index1);
 
 	  vnet_buffer (b1)->l2_classify.hash = hash1 =
-	    vnet_classify_hash_packet (t1, (u8 *) h1);
+	    vnet_classify_hash_packet_inline (t1, (u8 *) h1);
 	  vnet_classify_prefetch_bucket (t1, hash1);
 	}
 
@@ -291,7 +291,7 @@ VLIB_NODE_FN (l2_input_classify_node) (vlib_main_t * vm,
 	  t0 = pool_elt_at_index (vcm->tables, table_index0);
 
 	  vnet_buffer (b0)->l2_classify.hash = hash0 =
-	    vnet_classify_hash_packet (t0, (u8 *) h0);
+	    vnet_classify_hash_packet_inline (t0, (u8 *) h0);
 	  vnet_classify_prefetch_bucket (t0, hash0);
 	}
       from++;
@@ -360,7 +360,7 @@ VLIB_NODE_FN (l2_input_classify_node) (vlib_main_t * vm,
 	      hash0 = vnet_buffer (b0)->l2_classify.hash;
 	      t0 = pool_elt_at_index (vcm->tables, table_index0);
 
-	      e0 = vnet_classify_find_entry (t0, (u8 *) h0, hash0, now);
+	      e0 = vnet_classify_find_entry_inline (t0, (u8 *) h0, hash0, now);
 	      if (e0)
 		{
 		  vnet_buffer (b0)->l2_classify.opaque_index
@@ -385,9 +385,10 @@ VLIB_NODE_FN (l2_input_classify_node) (vlib_main_t * vm,
 			  break;
 			}
 
-		      hash0 = vnet_classify_hash_packet (t0, (u8 *) h0);
-		      e0 =
-			vnet_classify_find_entry (t0, (u8 *) h0, hash0, now);
+		      hash0 = vnet_classify_chain_hash_packet_inline
+			(t0, (u8 *) h0, hash0);
+		      e0 = vnet_classify_find_entry_inline
+			(t0, (u8 *) h0, hash0, now);
 		      if (e0)
 			{
 			  vnet_buffer (b0)->l2_classify.opaque_index
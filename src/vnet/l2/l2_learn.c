@@ -173,7 +173,7 @@ l2learn_process (vlib_node_runtime_t * node,
 	return;
 
       /* It is ok to learn */
-      msm->global_learn_count++;
+      clib_atomic_fetch_add (&msm->global_learn_count, 1);
       //写入result准备插入
       result0->raw = 0;		/* clear all fields */
       result0->fields.sw_if_index = sw_if_index0;
@@ -216,7 +216,7 @@ l2learn_process (vlib_node_runtime_t * node,
       if (l2fib_entry_result_is_set_AGE_NOT (result0))
 	{
 	  /* The mac was provisioned */
-	  msm->global_learn_count++;
+	  clib_atomic_fetch_add (&msm->global_learn_count, 1);
 	  l2fib_entry_result_clear_AGE_NOT (result0);
 	}
       if (msm->client_pid != 0)
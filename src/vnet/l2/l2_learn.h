@@ -50,6 +50,24 @@ typedef struct
 
 extern l2learn_main_t l2learn_main;
 
+/* The learn count is updated by the learning workers and by the MP safe
+   l2fib add/del handlers, decrement it without going below zero */
+always_inline void
+l2learn_global_learn_count_dec (void)
+{
+  l2learn_main_t *msm = &l2learn_main;
+  u32 count;
+
+  do
+    {
+      count = msm->global_learn_count;
+      if (!count)
+	return;
+    }
+  while (!clib_atomic_bool_cmp_and_swap (&msm->global_learn_count, count,
+					 count - 1));
+}
+
 extern vlib_node_registration_t l2fib_mac_age_scanner_process_node;
 
 typedef enum
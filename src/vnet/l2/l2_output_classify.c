@@ -226,7 +226,7 @@ VLIB_NODE_FN (l2_output_classify_node) (vlib_main_t * vm,
 	  t0 = pool_elt_at_index (vcm->tables, table_index0);
 
 	  vnet_buffer (b0)->l2_classify.hash = hash0 =
-	    vnet_classify_hash_packet (t0, (u8 *) h0);
+	    vnet_classify_hash_packet_inline (t0, (u8 *) h0);
 	  vnet_classify_prefetch_bucket (t0, hash0);
 	}
 
@@ -240,7 +240,7 @@ VLIB_NODE_FN (l2_output_classify_node) (vlib_main_t * vm,
 	  t1 = pool_elt_at_index (vcm->tables, table_index1);
 
 	  vnet_buffer (b1)->l2_classify.hash = hash1 =
-	    vnet_classify_hash_packet (t1, (u8 *) h1);
+	    vnet_classify_hash_packet_inline (t1, (u8 *) h1);
 	  vnet_classify_prefetch_bucket (t1, hash1);
 	}
 
@@ -283,7 +283,7 @@ VLIB_NODE_FN (l2_output_classify_node) (vlib_main_t * vm,
 	  t0 = pool_elt_at_index (vcm->tables, table_index0);
 
 	  vnet_buffer (b0)->l2_classify.hash = hash0 =
-	    vnet_classify_hash_packet (t0, (u8 *) h0);
+	    vnet_classify_hash_packet_inline (t0, (u8 *) h0);
 	  vnet_classify_prefetch_bucket (t0, hash0);
 	}
       from++;
@@ -352,7 +352,7 @@ VLIB_NODE_FN (l2_output_classify_node) (vlib_main_t * vm,
 	      hash0 = vnet_buffer (b0)->l2_classify.hash;
 	      t0 = pool_elt_at_index (vcm->tables, table_index0);
 
-	      e0 = vnet_classify_find_entry (t0, (u8 *) h0, hash0, now);
+	      e0 = vnet_classify_find_entry_inline (t0, (u8 *) h0, hash0, now);
 	      if (e0)
 		{
 		  vnet_buffer (b0)->l2_classify.opaque_index
@@ -377,9 +377,10 @@ VLIB_NODE_FN (l2_output_classify_node) (vlib_main_t * vm,
 			  break;
 			}
 
-		      hash0 = vnet_classify_hash_packet (t0, (u8 *) h0);
-		      e0 =
-			vnet_classify_find_entry (t0, (u8 *) h0, hash0, now);
+		      hash0 = vnet_classify_chain_hash_packet_inline
+			(t0, (u8 *) h0, hash0);
+		      e0 = vnet_classify_find_entry_inline
+			(t0, (u8 *) h0, hash0, now);
 		      if (e0)
 			{
 			  vnet_buffer (b0)->l2_classify.opaque_index
@@ -221,23 +221,25 @@ VLIB_NODE_FN (l2_rw_node) (vlib_main_t * vm,
 	  t0 = pool_elt_at_index (vcm->tables, config0->table_index);
 	  t1 = pool_elt_at_index (vcm->tables, config1->table_index);
 
-	  hash0 = vnet_classify_hash_packet (t0, (u8 *) h0);
-	  hash1 = vnet_classify_hash_packet (t1, (u8 *) h1);
-	  e0 = vnet_classify_find_entry (t0, (u8 *) h0, hash0, now);
-	  e1 = vnet_classify_find_entry (t1, (u8 *) h1, hash1, now);
+	  hash0 = vnet_classify_hash_packet_inline (t0, (u8 *) h0);
+	  hash1 = vnet_classify_hash_packet_inline (t1, (u8 *) h1);
+	  e0 = vnet_classify_find_entry_inline (t0, (u8 *) h0, hash0, now);
+	  e1 = vnet_classify_find_entry_inline (t1, (u8 *) h1, hash1, now);
 
 	  while (!e0 && (t0->next_table_index != ~0))
 	    {
 	      t0 = pool_elt_at_index (vcm->tables, t0->next_table_index);
-	      hash0 = vnet_classify_hash_packet (t0, (u8 *) h0);
-	      e0 = vnet_classify_find_entry (t0, (u8 *) h0, hash0, now);
+	      hash0 = vnet_classify_chain_hash_packet_inline (t0, (u8 *) h0,
+								hash0);
+	      e0 = vnet_classify_find_entry_inline (t0, (u8 *) h0, hash0, now);
 	    }
 
 	  while (!e1 && (t1->next_table_index != ~0))
 	    {
 	      t1 = pool_elt_at_index (vcm->tables, t1->next_table_index);
-	      hash1 = vnet_classify_hash_packet (t1, (u8 *) h1);
-	      e1 = vnet_classify_find_entry (t1, (u8 *) h1, hash1, now);
+	      hash1 = vnet_classify_chain_hash_packet_inline (t1, (u8 *) h1,
+								hash1);
+	      e1 = vnet_classify_find_entry_inline (t1, (u8 *) h1, hash1, now);
 	    }
 
 	  rwe_index0 = e0 ? e0->opaque_index : config0->miss_index;
@@ -306,14 +308,15 @@ VLIB_NODE_FN (l2_rw_node) (vlib_main_t * vm,
 	  config0 = l2_rw_get_config (sw_if_index0);	/*TODO: check sw_if_index0 value */
 	  t0 = pool_elt_at_index (vcm->tables, config0->table_index);
 
-	  hash0 = vnet_classify_hash_packet (t0, (u8 *) h0);
-	  e0 = vnet_classify_find_entry (t0, (u8 *) h0, hash0, now);
+	  hash0 = vnet_classify_hash_packet_inline (t0, (u8 *) h0);
+	  e0 = vnet_classify_find_entry_inline (t0, (u8 *) h0, hash0, now);
 
 	  while (!e0 && (t0->next_table_index != ~0))
 	    {
 	      t0 = pool_elt_at_index (vcm->tables, t0->next_table_index);
-	      hash0 = vnet_classify_hash_packet (t0, (u8 *) h0);
-	      e0 = vnet_classify_find_entry (t0, (u8 *) h0, hash0, now);
+	      hash0 = vnet_classify_chain_hash_packet_inline (t0, (u8 *) h0,
+								hash0);
+	      e0 = vnet_classify_find_entry_inline (t0, (u8 *) h0, hash0, now);
 	    }
 
 	  rwe_index0 = e0 ? e0->opaque_index : config0->miss_index;
@@ -36,8 +36,9 @@ struct stat_client_main_t
 {
   uint64_t current_epoch;
   stat_segment_shared_header_t *shared_header;
-  stat_segment_directory_entry_t *directory_vector;
   ssize_t memory_size;
+  /* Copies of each directory entry thrown away, by directory index */
+  uint32_t *entry_retries;
 };
 
 stat_client_main_t stat_client_main;
@@ -89,21 +90,6 @@ recv_fd (int sock)
   return fd;
 }
 
-static stat_segment_directory_entry_t *
-get_stat_vector_r (stat_client_main_t * sm)
-{
-  ASSERT (sm->shared_header);
-  return stat_segment_pointer (sm->shared_header,
-			       sm->shared_header->directory_offset);
-}
-
-static stat_segment_directory_entry_t *
-get_stat_vector (void)
-{
-  stat_client_main_t *sm = &stat_client_main;
-  return get_stat_vector_r (sm);
-}
-
 int
 stat_segment_connect_r (const char *socket_name, stat_client_main_t * sm)
 {
@@ -156,8 +142,6 @@ stat_segment_connect_r (const char *socket_name, stat_client_main_t * sm)
   close (mfd);
   sm->memory_size = st.st_size;
   sm->shared_header = memaddr;
-  sm->directory_vector =
-    stat_segment_pointer (memaddr, sm->shared_header->directory_offset);
 
   return 0;
 }
@@ -173,6 +157,7 @@ void
 stat_segment_disconnect_r (stat_client_main_t * sm)
 {
   munmap (sm->shared_header, sm->memory_size);
+  vec_free (sm->entry_retries);
   return;
 }
 
@@ -186,8 +171,9 @@ stat_segment_disconnect (void)
 double
 stat_segment_heartbeat_r (stat_client_main_t * sm)
 {
-  stat_segment_directory_entry_t *vec = get_stat_vector_r (sm);
-  double *hb = stat_segment_pointer (sm->shared_header, vec[4].offset);
+  stat_segment_directory_entry_t *ep =
+    stat_segment_directory_entry (sm->shared_header, STAT_COUNTER_HEARTBEAT);
+  double *hb = stat_segment_pointer (sm->shared_header, ep->offset);
   return *hb;
 }
 
@@ -276,70 +262,210 @@ copy_data (stat_segment_directory_entry_t * ep, stat_client_main_t * sm)
 	}
       break;
 
+    case STAT_DIR_TYPE_TRACE_RING:
+      /* Records are read with stat_segment_trace_ring_read */
+      break;
+
     default:
       fprintf (stderr, "Unknown type: %d\n", ep->type);
     }
   return result;
 }
 
-void
-stat_segment_data_free (stat_segment_data_t * res)
+/*
+ * As copy_data, but counter vectors are summed over the per-thread rows
+ * while reading, giving a single row. Saves copying one vector per thread
+ * when the client only wants totals.
+ */
+static stat_segment_data_t
+copy_data_sum (stat_segment_directory_entry_t * ep, stat_client_main_t * sm)
 {
+  stat_segment_data_t result = { 0 };
   int i, j;
-  for (i = 0; i < vec_len (res); i++)
+  vlib_counter_t **combined_c;	/* Combined counter */
+  counter_t **simple_c;		/* Simple counter */
+  counter_t *sum_c = 0;
+  vlib_counter_t *sum_cc = 0;
+  uint64_t *offset_vector;
+
+  switch (ep->type)
     {
-      switch (res[i].type)
+    case STAT_DIR_TYPE_COUNTER_VECTOR_SIMPLE:
+      if (ep->offset == 0)
+	break;
+      result.type = ep->type;
+      result.name = strdup (ep->name);
+      simple_c = stat_segment_pointer (sm->shared_header, ep->offset);
+      offset_vector =
+	stat_segment_pointer (sm->shared_header, ep->offset_vector);
+      for (i = 0; i < vec_len (simple_c); i++)
 	{
-	case STAT_DIR_TYPE_COUNTER_VECTOR_SIMPLE:
-	  for (j = 0; j < vec_len (res[i].simple_counter_vec); j++)
-	    vec_free (res[i].simple_counter_vec[j]);
-	  vec_free (res[i].simple_counter_vec);
-	  break;
-	case STAT_DIR_TYPE_COUNTER_VECTOR_COMBINED:
-	  for (j = 0; j < vec_len (res[i].combined_counter_vec); j++)
-	    vec_free (res[i].combined_counter_vec[j]);
-	  vec_free (res[i].combined_counter_vec);
-	  break;
-	default:
-	  ;
+	  counter_t *cb =
+	    stat_segment_pointer (sm->shared_header, offset_vector[i]);
+	  if (vec_len (cb) > vec_len (sum_c))
+	    vec_validate (sum_c, vec_len (cb) - 1);
+	  for (j = 0; j < vec_len (cb); j++)
+	    sum_c[j] += cb[j];
+	}
+      vec_add1 (result.simple_counter_vec, sum_c);
+      return result;
+
+    case STAT_DIR_TYPE_COUNTER_VECTOR_COMBINED:
+      if (ep->offset == 0)
+	break;
+      result.type = ep->type;
+      result.name = strdup (ep->name);
+      combined_c = stat_segment_pointer (sm->shared_header, ep->offset);
+      offset_vector =
+	stat_segment_pointer (sm->shared_header, ep->offset_vector);
+      for (i = 0; i < vec_len (combined_c); i++)
+	{
+	  vlib_counter_t *cb =
+	    stat_segment_pointer (sm->shared_header, offset_vector[i]);
+	  if (vec_len (cb) > vec_len (sum_cc))
+	    vec_validate (sum_cc, vec_len (cb) - 1);
+	  for (j = 0; j < vec_len (cb); j++)
+	    {
+	      sum_cc[j].packets += cb[j].packets;
+	      sum_cc[j].bytes += cb[j].bytes;
+	    }
 	}
-      free (res[i].name);
+      vec_add1 (result.combined_counter_vec, sum_cc);
+      return result;
+
+    default:
+      break;
     }
+  return copy_data (ep, sm);
+}
+
+static void
+stat_segment_data_free_one (stat_segment_data_t * r)
+{
+  int j;
+
+  switch (r->type)
+    {
+    case STAT_DIR_TYPE_COUNTER_VECTOR_SIMPLE:
+      for (j = 0; j < vec_len (r->simple_counter_vec); j++)
+	vec_free (r->simple_counter_vec[j]);
+      vec_free (r->simple_counter_vec);
+      break;
+    case STAT_DIR_TYPE_COUNTER_VECTOR_COMBINED:
+      for (j = 0; j < vec_len (r->combined_counter_vec); j++)
+	vec_free (r->combined_counter_vec[j]);
+      vec_free (r->combined_counter_vec);
+      break;
+    case STAT_DIR_TYPE_NAME_VECTOR:
+      for (j = 0; j < vec_len (r->name_vector); j++)
+	vec_free (r->name_vector[j]);
+      vec_free (r->name_vector);
+      break;
+    default:
+      ;
+    }
+  free (r->name);
+}
+
+void
+stat_segment_data_free (stat_segment_data_t * res)
+{
+  int i;
+  for (i = 0; i < vec_len (res); i++)
+    stat_segment_data_free_one (&res[i]);
   vec_free (res);
 }
 
+/* Copies of an entry thrown away before giving up on it */
+#define STAT_SEGMENT_ACCESS_RETRIES 16
 
+/*
+ * Entries are copied without locking. Directory entries never move, and
+ * the writer keeps an entry's version odd while it changes the entry or
+ * frees data it points to. A copy is kept if the version was even and
+ * unchanged over the copy, otherwise only that entry is copied again.
+ */
 typedef struct
 {
-  uint64_t epoch;
+  uint64_t version;
+  uint64_t error_version;
 } stat_segment_access_t;
 
 static void
 stat_segment_access_start (stat_segment_access_t * sa,
+			   stat_segment_directory_entry_t * ep,
 			   stat_client_main_t * sm)
 {
   stat_segment_shared_header_t *shared_header = sm->shared_header;
-  sa->epoch = shared_header->epoch;
-  while (shared_header->in_progress != 0)
+
+  while ((sa->version = clib_atomic_load_acq_n (&ep->version)) & 1)
     ;
+  /* Error counters all live in the shared error vector */
+  sa->error_version = 0;
+  if (ep->type == STAT_DIR_TYPE_ERROR_INDEX)
+    while ((sa->error_version =
+	    clib_atomic_load_acq_n (&shared_header->error_version)) & 1)
+      ;
 }
 
 static bool
-stat_segment_access_end (stat_segment_access_t * sa, stat_client_main_t * sm)
+stat_segment_access_end (stat_segment_access_t * sa,
+			 stat_segment_directory_entry_t * ep,
+			 stat_client_main_t * sm)
 {
   stat_segment_shared_header_t *shared_header = sm->shared_header;
 
-  if (shared_header->epoch != sa->epoch || shared_header->in_progress)
+  /* Order the copy before the version checks */
+  CLIB_MEMORY_BARRIER ();
+  if (ep->version != sa->version)
+    return false;
+  if (ep->type == STAT_DIR_TYPE_ERROR_INDEX &&
+      shared_header->error_version != sa->error_version)
     return false;
   return true;
 }
 
-uint32_t *
-stat_segment_ls_r (uint8_t ** patterns, stat_client_main_t * sm)
+/* Copy a single entry, retrying it alone if the writer changed it */
+static int
+stat_segment_copy_entry (uint32_t index, stat_segment_data_t * result,
+			 int sum, stat_client_main_t * sm)
 {
+  stat_segment_directory_entry_t *ep;
   stat_segment_access_t sa;
+  int i;
+
+  if (index >= sm->shared_header->n_directory_entries)
+    return -1;
+
+  ep = stat_segment_directory_entry (sm->shared_header, index);
+  for (i = 0; i < STAT_SEGMENT_ACCESS_RETRIES; i++)
+    {
+      stat_segment_access_start (&sa, ep, sm);
+      *result = sum ? copy_data_sum (ep, sm) : copy_data (ep, sm);
+      if (stat_segment_access_end (&sa, ep, sm))
+	return 0;
+      stat_segment_data_free_one (result);
+      vec_validate (sm->entry_retries, index);
+      sm->entry_retries[index]++;
+    }
 
-  uint32_t *dir = 0;
+  fprintf (stderr, "Entry %u kept changing while reading\n", index);
+  return -1;
+}
+
+/*
+ * Match the directory entries from *next_index on against the patterns and
+ * append the matching indices to dir. The directory is append only and
+ * names never change, so after an epoch change a client only needs to scan
+ * the new entries.
+ */
+uint32_t *
+stat_segment_ls_incremental_r (uint8_t ** patterns, uint32_t * dir,
+			       uint32_t * next_index, stat_client_main_t * sm)
+{
+  stat_segment_shared_header_t *shared_header = sm->shared_header;
+  uint64_t epoch;
+  uint32_t n_entries;
   regex_t regex[vec_len (patterns)];
 
   int i, j;
@@ -349,18 +475,22 @@ stat_segment_ls_r (uint8_t ** patterns, stat_client_main_t * sm)
       if (rv)
 	{
 	  fprintf (stderr, "Could not compile regex %s\n", patterns[i]);
+	  for (j = 0; j < i; j++)
+	    regfree (&regex[j]);
 	  return dir;
 	}
     }
 
-  stat_segment_access_start (&sa, sm);
+  epoch = shared_header->epoch;
+  n_entries = clib_atomic_load_acq_n (&shared_header->n_directory_entries);
 
-  stat_segment_directory_entry_t *counter_vec = get_stat_vector_r (sm);
-  for (j = 0; j < vec_len (counter_vec); j++)
+  for (j = *next_index; j < n_entries; j++)
     {
+      stat_segment_directory_entry_t *ep =
+	stat_segment_directory_entry (shared_header, j);
       for (i = 0; i < vec_len (patterns); i++)
 	{
-	  int rv = regexec (&regex[i], counter_vec[j].name, 0, NULL, 0);
+	  int rv = regexec (&regex[i], ep->name, 0, NULL, 0);
 	  if (rv == 0)
 	    {
 	      vec_add1 (dir, j);
@@ -374,16 +504,32 @@ stat_segment_ls_r (uint8_t ** patterns, stat_client_main_t * sm)
   for (i = 0; i < vec_len (patterns); i++)
     regfree (&regex[i]);
 
-  if (!stat_segment_access_end (&sa, sm))
-    {
-      /* Failed, clean up */
-      vec_free (dir);
-      return 0;
+  /* Update last version */
+  *next_index = n_entries;
+  sm->current_epoch = epoch;
+  return dir;
+}
 
-    }
+uint32_t *
+stat_segment_ls_incremental (uint8_t ** patterns, uint32_t * dir,
+			     uint32_t * next_index)
+{
+  stat_client_main_t *sm = &stat_client_main;
+  return stat_segment_ls_incremental_r (patterns, dir, next_index, sm);
+}
+
+uint32_t *
+stat_segment_ls_r (uint8_t ** patterns, stat_client_main_t * sm)
+{
+  uint32_t next_index = 0;
+  uint32_t *dir;
+
+  dir = stat_segment_ls_incremental_r (patterns, 0, &next_index, sm);
+
+  /* Failed, clean up */
+  if (next_index == 0)
+    vec_free (dir);
 
-  /* Update last version */
-  sm->current_epoch = sa.epoch;
   return dir;
 }
 
@@ -394,32 +540,31 @@ stat_segment_ls (uint8_t ** patterns)
   return stat_segment_ls_r ((uint8_t **) patterns, sm);
 }
 
-stat_segment_data_t *
-stat_segment_dump_r (uint32_t * stats, stat_client_main_t * sm)
+static stat_segment_data_t *
+stat_segment_dump_inline (uint32_t * stats, int sum, stat_client_main_t * sm)
 {
   int i;
-  stat_segment_directory_entry_t *ep;
   stat_segment_data_t *res = 0;
-  stat_segment_access_t sa;
-
-  /* Has directory been update? */
-  if (sm->shared_header->epoch != sm->current_epoch)
-    return 0;
+  stat_segment_data_t r;
 
-  stat_segment_access_start (&sa, sm);
   for (i = 0; i < vec_len (stats); i++)
     {
       /* Collect counter */
-      ep = vec_elt_at_index (sm->directory_vector, stats[i]);
-      vec_add1 (res, copy_data (ep, sm));
+      if (stat_segment_copy_entry (stats[i], &r, sum, sm))
+	{
+	  stat_segment_data_free (res);
+	  return 0;
+	}
+      vec_add1 (res, r);
     }
 
-  if (stat_segment_access_end (&sa, sm))
-    return res;
+  return res;
+}
 
-  fprintf (stderr, "Epoch changed while reading, invalid results\n");
-  // TODO increase counter
-  return 0;
+stat_segment_data_t *
+stat_segment_dump_r (uint32_t * stats, stat_client_main_t * sm)
+{
+  return stat_segment_dump_inline (stats, 0 /* sum */ , sm);
 }
 
 stat_segment_data_t *
@@ -429,6 +574,33 @@ stat_segment_dump (uint32_t * stats)
   return stat_segment_dump_r (stats, sm);
 }
 
+stat_segment_data_t *
+stat_segment_dump_sum_r (uint32_t * stats, stat_client_main_t * sm)
+{
+  return stat_segment_dump_inline (stats, 1 /* sum */ , sm);
+}
+
+stat_segment_data_t *
+stat_segment_dump_sum (uint32_t * stats)
+{
+  stat_client_main_t *sm = &stat_client_main;
+  return stat_segment_dump_sum_r (stats, sm);
+}
+
+/* Copies thrown away so far, by directory index; owned by the client */
+uint32_t *
+stat_segment_entry_retries_r (stat_client_main_t * sm)
+{
+  return sm->entry_retries;
+}
+
+uint32_t *
+stat_segment_entry_retries (void)
+{
+  stat_client_main_t *sm = &stat_client_main;
+  return stat_segment_entry_retries_r (sm);
+}
+
 /* Wrapper for accessing vectors from other languages */
 int
 stat_segment_vec_len (void *vec)
@@ -457,19 +629,14 @@ stat_segment_string_vector (uint8_t ** string_vector, const char *string)
 stat_segment_data_t *
 stat_segment_dump_entry_r (uint32_t index, stat_client_main_t * sm)
 {
-  stat_segment_directory_entry_t *ep;
   stat_segment_data_t *res = 0;
-  stat_segment_access_t sa;
-
-  stat_segment_access_start (&sa, sm);
+  stat_segment_data_t r;
 
   /* Collect counter */
-  ep = vec_elt_at_index (sm->directory_vector, index);
-  vec_add1 (res, copy_data (ep, sm));
-
-  if (stat_segment_access_end (&sa, sm))
-    return res;
-  return 0;
+  if (stat_segment_copy_entry (index, &r, 0 /* sum */ , sm))
+    return 0;
+  vec_add1 (res, r);
+  return res;
 }
 
 stat_segment_data_t *
@@ -482,12 +649,187 @@ stat_segment_dump_entry (uint32_t index)
 char *
 stat_segment_index_to_name (uint32_t index)
 {
-  char *name;
-  stat_segment_directory_entry_t *counter_vec = get_stat_vector ();
+  stat_client_main_t *sm = &stat_client_main;
+  stat_segment_directory_entry_t *ep;
+
+  if (index >= sm->shared_header->n_directory_entries)
+    return 0;
+  ep = stat_segment_directory_entry (sm->shared_header, index);
+  return strdup (ep->name);
+}
+
+/*
+ * Trace ring of a thread behind the entry, 0 if there is none or it does
+ * not fit the segment. Call between access start and end, the writer may
+ * be freeing the rings.
+ */
+static vlib_trace_ring_t *
+stat_segment_trace_ring (stat_segment_directory_entry_t * ep,
+			 uint32_t thread_index, stat_client_main_t * sm)
+{
+  vlib_trace_ring_t *ring;
+  uint64_t *offset_vector;
+  uint64_t offset, n_records;
+
+  if (ep->offset_vector == 0
+      || ep->offset_vector + sizeof (uint64_t) > sm->memory_size)
+    return 0;
+  offset_vector = stat_segment_pointer (sm->shared_header, ep->offset_vector);
+  if (thread_index >= vec_len (offset_vector))
+    return 0;
+
+  offset = offset_vector[thread_index];
+  if (offset == 0 || offset + sizeof (*ring) > sm->memory_size)
+    return 0;
+  ring = stat_segment_pointer (sm->shared_header, offset);
+  n_records = ring->n_records;
+  if (n_records == 0 || (n_records & (n_records - 1))
+      || offset + sizeof (*ring) + n_records * sizeof (ring->records[0]) >
+      sm->memory_size)
+    return 0;
+
+  return ring;
+}
+
+/* Number of per thread rings behind a trace ring entry, 0 until enabled */
+int
+stat_segment_trace_ring_n_threads_r (uint32_t index, stat_client_main_t * sm)
+{
+  stat_segment_directory_entry_t *ep;
+  stat_segment_access_t sa;
+  uint64_t *offset_vector;
+  int i, n_threads;
+
+  if (index >= sm->shared_header->n_directory_entries)
+    return -1;
+  ep = stat_segment_directory_entry (sm->shared_header, index);
+  if (ep->type != STAT_DIR_TYPE_TRACE_RING)
+    return -1;
+
+  for (i = 0; i < STAT_SEGMENT_ACCESS_RETRIES; i++)
+    {
+      stat_segment_access_start (&sa, ep, sm);
+      n_threads = 0;
+      if (ep->offset_vector
+	  && ep->offset_vector + sizeof (uint64_t) <= sm->memory_size)
+	{
+	  offset_vector =
+	    stat_segment_pointer (sm->shared_header, ep->offset_vector);
+	  n_threads = vec_len (offset_vector);
+	}
+      if (stat_segment_access_end (&sa, ep, sm))
+	return n_threads;
+    }
+  return -1;
+}
+
+int
+stat_segment_trace_ring_n_threads (uint32_t index)
+{
+  stat_client_main_t *sm = &stat_client_main;
+  return stat_segment_trace_ring_n_threads_r (index, sm);
+}
+
+/*
+ * Append the records of a thread's trace ring from sequence number
+ * *next_seq on to *records, then advance *next_seq. Start with *next_seq
+ * 0 to get every record still in the ring. Records the writer overwrote
+ * before they could be copied are added to *n_lost. The ring header,
+ * needed to convert time stamps, is copied to header unless it is 0.
+ * Returns 0, or -1 if the ring can't be read.
+ */
+int
+stat_segment_trace_ring_read_r (uint32_t index, uint32_t thread_index,
+				uint64_t * next_seq,
+				vlib_trace_ring_record_t ** records,
+				uint64_t * n_lost, vlib_trace_ring_t * header,
+				stat_client_main_t * sm)
+{
   stat_segment_directory_entry_t *ep;
-  ep = vec_elt_at_index (counter_vec, index);
-  name = strdup (ep->name);
-  return name;
+  stat_segment_access_t sa;
+  vlib_trace_ring_t *ring;
+  vlib_trace_ring_record_t *r, *copy;
+  uint64_t head, seq, oldest, lost;
+  uint32_t n_records, len;
+  int i;
+
+  if (index >= sm->shared_header->n_directory_entries)
+    return -1;
+  ep = stat_segment_directory_entry (sm->shared_header, index);
+  if (ep->type != STAT_DIR_TYPE_TRACE_RING)
+    return -1;
+
+  for (i = 0; i < STAT_SEGMENT_ACCESS_RETRIES; i++)
+    {
+      stat_segment_access_start (&sa, ep, sm);
+      ring = stat_segment_trace_ring (ep, thread_index, sm);
+      if (ring == 0)
+	{
+	  if (stat_segment_access_end (&sa, ep, sm))
+	    return -1;
+	  continue;
+	}
+
+      len = vec_len (*records);
+      n_records = ring->n_records;
+      head = clib_atomic_load_acq_n (&ring->head);
+      lost = 0;
+
+      /* A new ring starts again from 0 */
+      seq = *next_seq <= head ? *next_seq : 0;
+      oldest = head > n_records ? head - n_records : 0;
+      if (seq < oldest)
+	{
+	  if (seq)
+	    lost = oldest - seq;
+	  seq = oldest;
+	}
+
+      for (; seq < head; seq++)
+	{
+	  r = ring->records + (seq & (n_records - 1));
+	  if (clib_atomic_load_acq_n (&r->seq) != seq + 1)
+	    {
+	      lost++;
+	      continue;
+	    }
+	  vec_add2 (*records, copy, 1);
+	  clib_memcpy_fast (copy, r, sizeof (*r));
+	  /* Order the copy before checking it wasn't overwritten */
+	  __atomic_thread_fence (__ATOMIC_ACQUIRE);
+	  if (r->seq != seq + 1)
+	    {
+	      _vec_len (*records) -= 1;
+	      lost++;
+	    }
+	}
+      if (header)
+	clib_memcpy_fast (header, ring, sizeof (*header));
+
+      if (stat_segment_access_end (&sa, ep, sm))
+	{
+	  *next_seq = head;
+	  if (n_lost)
+	    *n_lost += lost;
+	  return 0;
+	}
+      if (*records)
+	_vec_len (*records) = len;
+    }
+
+  fprintf (stderr, "Entry %u kept changing while reading\n", index);
+  return -1;
+}
+
+int
+stat_segment_trace_ring_read (uint32_t index, uint32_t thread_index,
+			      uint64_t * next_seq,
+			      vlib_trace_ring_record_t ** records,
+			      uint64_t * n_lost, vlib_trace_ring_t * header)
+{
+  stat_client_main_t *sm = &stat_client_main;
+  return stat_segment_trace_ring_read_r (index, thread_index, next_seq,
+					 records, n_lost, header, sm);
 }
 
 /*
@@ -20,6 +20,7 @@
 #include <stdint.h>
 #include <unistd.h>
 #include <vlib/counter_types.h>
+#include <vlib/trace_ring.h>
 
 typedef enum
 {
@@ -29,6 +30,7 @@ typedef enum
   STAT_DIR_TYPE_COUNTER_VECTOR_COMBINED,
   STAT_DIR_TYPE_ERROR_INDEX,
   STAT_DIR_TYPE_NAME_VECTOR,
+  STAT_DIR_TYPE_TRACE_RING,
 } stat_directory_type_t;
 
 /* Default socket to exchange segment fd */
@@ -62,9 +64,19 @@ int stat_segment_vec_len (void *vec);
 void stat_segment_vec_free (void *vec);
 uint32_t *stat_segment_ls_r (uint8_t ** patterns, stat_client_main_t * sm);
 uint32_t *stat_segment_ls (uint8_t ** pattern);
+uint32_t *stat_segment_ls_incremental_r (uint8_t ** patterns, uint32_t * dir,
+					 uint32_t * next_index,
+					 stat_client_main_t * sm);
+uint32_t *stat_segment_ls_incremental (uint8_t ** patterns, uint32_t * dir,
+				       uint32_t * next_index);
 stat_segment_data_t *stat_segment_dump_r (uint32_t * stats,
 					  stat_client_main_t * sm);
 stat_segment_data_t *stat_segment_dump (uint32_t * counter_vec);
+stat_segment_data_t *stat_segment_dump_sum_r (uint32_t * stats,
+					      stat_client_main_t * sm);
+stat_segment_data_t *stat_segment_dump_sum (uint32_t * counter_vec);
+uint32_t *stat_segment_entry_retries_r (stat_client_main_t * sm);
+uint32_t *stat_segment_entry_retries (void);
 stat_segment_data_t *stat_segment_dump_entry_r (uint32_t index,
 						stat_client_main_t * sm);
 stat_segment_data_t *stat_segment_dump_entry (uint32_t index);
@@ -75,6 +87,20 @@ double stat_segment_heartbeat (void);
 
 char *stat_segment_index_to_name (uint32_t index);
 
+int stat_segment_trace_ring_n_threads_r (uint32_t index,
+					 stat_client_main_t * sm);
+int stat_segment_trace_ring_n_threads (uint32_t index);
+int stat_segment_trace_ring_read_r (uint32_t index, uint32_t thread_index,
+				    uint64_t * next_seq,
+				    vlib_trace_ring_record_t ** records,
+				    uint64_t * n_lost,
+				    vlib_trace_ring_t * header,
+				    stat_client_main_t * sm);
+int stat_segment_trace_ring_read (uint32_t index, uint32_t thread_index,
+				  uint64_t * next_seq,
+				  vlib_trace_ring_record_t ** records,
+				  uint64_t * n_lost, vlib_trace_ring_t * header);
+
 #endif /* included_stat_client_h */
 
 /*
@@ -18,8 +18,35 @@ typedef enum {
   STAT_DIR_TYPE_COUNTER_VECTOR_SIMPLE,
   STAT_DIR_TYPE_COUNTER_VECTOR_COMBINED,
   STAT_DIR_TYPE_ERROR_INDEX,
+  STAT_DIR_TYPE_NAME_VECTOR,
+  STAT_DIR_TYPE_TRACE_RING,
 } stat_directory_type_t;
 
+typedef struct
+{
+  uint64_t seq;
+  uint64_t time;
+  uint32_t node_index;
+  uint32_t buffer_index;
+  uint32_t sw_if_index[2];
+  uint32_t flags;
+  uint32_t length;
+  uint32_t n_data;
+  uint32_t pad;
+  uint8_t data[80];
+} vlib_trace_ring_record_t;
+
+typedef struct
+{
+  uint64_t head;
+  uint32_t n_records;
+  uint32_t thread_index;
+  double seconds_per_clock;
+  uint64_t base_cpu_time;
+  double base_unix_time;
+  uint64_t pad[3];
+} vlib_trace_ring_t;
+
 typedef struct
 {
   stat_directory_type_t type;
@@ -29,6 +56,7 @@ typedef struct
     uint64_t value;
   };
   uint64_t offset_vector;
+  uint64_t version;
   char name[128]; // TODO change this to pointer to "somewhere"
 } stat_segment_directory_entry_t;
 
@@ -49,17 +77,19 @@ typedef struct
 {
   uint64_t epoch;
   uint64_t in_progress;
-  uint64_t directory_offset;
+  uint64_t n_directory_entries;
   uint64_t error_offset;
   uint64_t stats_offset;
+  uint64_t error_version;
+  uint64_t directory_chunk_offset[256];
 } stat_segment_shared_header_t;
 
 typedef struct
 {
   uint64_t current_epoch;
   stat_segment_shared_header_t *shared_header;
-  stat_segment_directory_entry_t *directory_vector;
   ssize_t memory_size;
+  uint32_t *entry_retries;
 } stat_client_main_t;
 
 stat_client_main_t * stat_client_get(void);
@@ -71,14 +101,30 @@ void stat_segment_disconnect (void);
 
 uint32_t *stat_segment_ls_r (uint8_t ** patterns, stat_client_main_t * sm);
 uint32_t *stat_segment_ls (uint8_t ** pattern);
+uint32_t *stat_segment_ls_incremental_r (uint8_t ** patterns, uint32_t * dir,
+                                         uint32_t * next_index,
+                                         stat_client_main_t * sm);
 stat_segment_data_t *stat_segment_dump_r (uint32_t * stats, stat_client_main_t * sm);
 stat_segment_data_t *stat_segment_dump (uint32_t * counter_vec);
+stat_segment_data_t *stat_segment_dump_sum_r (uint32_t * stats,
+                                              stat_client_main_t * sm);
+uint32_t *stat_segment_entry_retries_r (stat_client_main_t * sm);
 void stat_segment_data_free (stat_segment_data_t * res);
 
 double stat_segment_heartbeat_r (stat_client_main_t * sm);
 double stat_segment_heartbeat (void);
 int stat_segment_vec_len(void *vec);
+void stat_segment_vec_free(void *vec);
 uint8_t **stat_segment_string_vector(uint8_t **string_vector, char *string);
+
+int stat_segment_trace_ring_n_threads_r (uint32_t index,
+                                         stat_client_main_t * sm);
+int stat_segment_trace_ring_read_r (uint32_t index, uint32_t thread_index,
+                                    uint64_t * next_seq,
+                                    vlib_trace_ring_record_t ** records,
+                                    uint64_t * n_lost,
+                                    vlib_trace_ring_t * header,
+                                    stat_client_main_t * sm);
 """)
 
 
@@ -124,6 +170,18 @@ def combined_counter_vec_list(api, e):
     return vec
 
 
+def trace_ring_record_dict(header, r):
+    t = (r.time - header.base_cpu_time) * header.seconds_per_clock
+    return {'seq': r.seq - 1,
+            'time': header.base_unix_time + t,
+            'node_index': r.node_index,
+            'buffer_index': r.buffer_index,
+            'sw_if_index': [r.sw_if_index[0], r.sw_if_index[1]],
+            'flags': r.flags,
+            'length': r.length,
+            'data': bytes(ffi.buffer(r.data, r.n_data))}
+
+
 def stat_entry_to_python(api, e):
     # Scalar index
     if e.type == 1:
@@ -200,9 +258,22 @@ class VPPStats(object):
                                                              patterns),
                                           self.client)
 
-    def dump(self, counters):
+    def ls_incremental(self, patterns, next_index=0):
+        """ Directory indices from next_index on matching the patterns.
+        Returns the indices and the next_index to continue from. """
+        n = ffi.new('uint32_t *', next_index)
+        rv = self.api.stat_segment_ls_incremental_r(
+            make_string_vector(self.api, patterns), ffi.NULL, n, self.client)
+        indices = [rv[i] for i in range(self.api.stat_segment_vec_len(rv))]
+        self.api.stat_segment_vec_free(rv)
+        return indices, n[0]
+
+    def dump(self, counters, sum=False):
         stats = {}
-        rv = self.api.stat_segment_dump_r(counters, self.client)
+        if sum:
+            rv = self.api.stat_segment_dump_sum_r(counters, self.client)
+        else:
+            rv = self.api.stat_segment_dump_r(counters, self.client)
         # Raise exception and retry
         if rv == ffi.NULL:
             raise VPPStatsIOError()
@@ -214,6 +285,18 @@ class VPPStats(object):
                 stats[n] = e
         return stats
 
+    def dump_sum(self, counters):
+        """ As dump, with the per-thread rows of counter vectors summed
+        into a single row. """
+        return self.dump(counters, sum=True)
+
+    def entry_retries(self):
+        """ Copies of entries thrown away because the writer changed them,
+        by directory index. """
+        rv = self.api.stat_segment_entry_retries_r(self.client)
+        return {i: rv[i] for i in range(self.api.stat_segment_vec_len(rv))
+                if rv[i]}
+
     def get_counter(self, name):
         retries = 0
         while True:
@@ -230,6 +313,35 @@ class VPPStats(object):
                     return None
                 retries += 1
 
+    def trace_ring_index(self):
+        indices = self.ls('^/sys/trace_ring$')
+        if self.api.stat_segment_vec_len(indices) != 1:
+            raise AttributeError('No trace ring in the stat segment')
+        return indices[0]
+
+    def trace_ring_n_threads(self):
+        return self.api.stat_segment_trace_ring_n_threads_r(
+            self.trace_ring_index(), self.client)
+
+    def trace_ring_read(self, thread_index, next_seq=0):
+        """ Records of a thread's trace ring from sequence number next_seq
+        on. Returns the records, the next_seq to continue from and the
+        number of records overwritten before they could be read. """
+        seq = ffi.new('uint64_t *', next_seq)
+        n_lost = ffi.new('uint64_t *', 0)
+        records = ffi.new('vlib_trace_ring_record_t **')
+        header = ffi.new('vlib_trace_ring_t *')
+        rv = self.api.stat_segment_trace_ring_read_r(
+            self.trace_ring_index(), thread_index, seq, records, n_lost,
+            header, self.client)
+        if rv != 0:
+            raise VPPStatsIOError()
+        n_records = self.api.stat_segment_vec_len(records[0])
+        result = [trace_ring_record_dict(header, records[0][i])
+                  for i in range(n_records)]
+        self.api.stat_segment_vec_free(records[0])
+        return result, seq[0], n_lost[0]
+
     def disconnect(self):
         self.api.stat_segment_disconnect_r(self.client)
         self.api.stat_client_free(self.client)
@@ -109,14 +109,150 @@ enum stat_client_cmd_e
   STAT_CLIENT_CMD_POLL,
   STAT_CLIENT_CMD_DUMP,
   STAT_CLIENT_CMD_TIGHTPOLL,
+  STAT_CLIENT_CMD_BENCH,
+  STAT_CLIENT_CMD_TRACE,
 };
 
+/*
+ * Time directory listing and counter dumps, summing the per-thread
+ * counter rows while reading when sum is set.
+ */
+static int
+stat_bench (u8 ** patterns, u32 iterations, int sum)
+{
+  stat_segment_data_t *res;
+  u32 *dir, next_index = 0;
+  f64 start, ls_time, dump_time = 0;
+  u32 i, n_retries = 0;
+
+  start = unix_time_now ();
+  for (i = 0; i < iterations; i++)
+    {
+      dir = stat_segment_ls (patterns);
+      vec_free (dir);
+    }
+  ls_time = unix_time_now () - start;
+
+  dir = stat_segment_ls_incremental (patterns, 0, &next_index);
+  if (!dir)
+    return -1;
+
+  for (i = 0; i < iterations; i++)
+    {
+      start = unix_time_now ();
+      res = sum ? stat_segment_dump_sum (dir) : stat_segment_dump (dir);
+      dump_time += unix_time_now () - start;
+      if (!res)
+	{
+	  /* Pick up entries added meanwhile, only new ones are scanned */
+	  dir = stat_segment_ls_incremental (patterns, dir, &next_index);
+	  n_retries++;
+	  continue;
+	}
+      stat_segment_data_free (res);
+    }
+
+  fformat (stdout, "%u entries, %u iterations, %u retries\n",
+	   vec_len (dir), iterations, n_retries);
+  fformat (stdout, "ls: %.3f ms, dump%s: %.3f ms per iteration\n",
+	   ls_time * 1e3 / iterations, sum ? " sum" : "",
+	   dump_time * 1e3 / iterations);
+  vec_free (dir);
+  return 0;
+}
+
+static u32
+stat_lookup_index (const char *pattern)
+{
+  u8 **patterns = stat_segment_string_vector (0, pattern);
+  u32 *dir = stat_segment_ls (patterns);
+  u32 index = vec_len (dir) ? dir[0] : ~0;
+
+  vec_free (dir);
+  vec_free (patterns[0]);
+  vec_free (patterns);
+  return index;
+}
+
+/*
+ * Follow the binary packet trace rings of all threads, printing the new
+ * records every 100ms until interrupted.
+ */
+static int
+stat_trace_ring_follow (void)
+{
+  struct timespec ts, tsrem;
+  stat_segment_data_t *names = 0;
+  vlib_trace_ring_record_t *records = 0, *r;
+  vlib_trace_ring_t header;
+  u64 *next_seq = 0, n_lost;
+  u32 ring_index, names_index;
+  u8 **node_names;
+  char *node_name;
+  int i, n_threads;
+  f64 t;
+
+  ring_index = stat_lookup_index ("^/sys/trace_ring$");
+  names_index = stat_lookup_index ("^/sys/node/names$");
+  if (ring_index == ~0)
+    return -1;
+
+  while (1)
+    {
+      n_threads = stat_segment_trace_ring_n_threads (ring_index);
+      if (n_threads < 0)
+	return -1;
+      if (n_threads)
+	vec_validate (next_seq, n_threads - 1);
+
+      for (i = 0; i < n_threads; i++)
+	{
+	  n_lost = 0;
+	  if (stat_segment_trace_ring_read (ring_index, i, &next_seq[i],
+					    &records, &n_lost, &header))
+	    continue;
+	  if (n_lost)
+	    fformat (stdout, "thread %d: %llu records lost\n", i, n_lost);
+
+	  vec_foreach (r, records)
+	  {
+	    /* Nodes created since the last lookup */
+	    if (names_index != ~0 && (names == 0 || r->node_index >=
+				      vec_len (names[0].name_vector)))
+	      {
+		stat_segment_data_free (names);
+		names = stat_segment_dump_entry (names_index);
+	      }
+	    node_names = names ? names[0].name_vector : 0;
+	    node_name = r->node_index < vec_len (node_names)
+	      && node_names[r->node_index] ?
+	      (char *) node_names[r->node_index] : "unknown";
+
+	    t = header.base_unix_time +
+	      (r->time - header.base_cpu_time) * header.seconds_per_clock;
+	    fformat (stdout, "%.6f thread %d %s buffer 0x%x rx %d tx %d "
+		     "len %u flags 0x%x\n  %U\n", t, i, node_name,
+		     r->buffer_index, r->sw_if_index[0], r->sw_if_index[1],
+		     r->length, r->flags, format_hex_bytes, r->data,
+		     r->n_data);
+	  }
+	  vec_reset_length (records);
+	}
+
+      ts.tv_sec = 0;
+      ts.tv_nsec = 100 * 1000 * 1000;
+      while (nanosleep (&ts, &tsrem) < 0)
+	ts = tsrem;
+    }
+}
+
 int
 main (int argc, char **argv)
 {
   unformat_input_t _argv, *a = &_argv;
   u8 *stat_segment_name, *pattern = 0, **patterns = 0;
-  int rv;
+  u32 iterations = 1000;
+  int rv, sum = 0;
   enum stat_client_cmd_e cmd = STAT_CLIENT_CMD_UNKNOWN;
 
   /* Create a heap of 64MB */
@@ -146,6 +282,18 @@ main (int argc, char **argv)
 	{
 	  cmd = STAT_CLIENT_CMD_TIGHTPOLL;
 	}
+      else if (unformat (a, "bench"))
+	{
+	  cmd = STAT_CLIENT_CMD_BENCH;
+	}
+      else if (unformat (a, "trace"))
+	{
+	  cmd = STAT_CLIENT_CMD_TRACE;
+	}
+      else if (unformat (a, "iterations %u", &iterations))
+	;
+      else if (unformat (a, "sum"))
+	sum = 1;
       else if (unformat (a, "%s", &pattern))
 	{
 	  vec_add1 (patterns, pattern);
@@ -153,7 +301,7 @@ main (int argc, char **argv)
       else
 	{
 	  fformat (stderr,
-		   "%s: usage [socket-name <name>] [ls|dump|poll] <patterns> ...\n",
+		   "%s: usage [socket-name <name>] [ls|dump|poll|bench|trace] [sum] [iterations <n>] <patterns> ...\n",
 		   argv[0]);
 	  exit (1);
 	}
@@ -186,7 +334,7 @@ reconnect:
       break;
 
     case STAT_CLIENT_CMD_DUMP:
-      res = stat_segment_dump (dir);
+      res = sum ? stat_segment_dump_sum (dir) : stat_segment_dump (dir);
       for (i = 0; i < vec_len (res); i++)
 	{
 	  switch (res[i].type)
@@ -258,9 +406,19 @@ reconnect:
 	}
       break;
 
+    case STAT_CLIENT_CMD_BENCH:
+      if (iterations == 0 || stat_bench (patterns, iterations, sum))
+	fformat (stderr, "Benchmark failed\n");
+      break;
+
+    case STAT_CLIENT_CMD_TRACE:
+      if (stat_trace_ring_follow ())
+	fformat (stderr, "No trace ring in the stat segment\n");
+      break;
+
     default:
       fformat (stderr,
-	       "%s: usage [socket-name <name>] [ls|dump|poll] <patterns> ...\n",
+	       "%s: usage [socket-name <name>] [ls|dump|poll|bench|trace] [sum] [iterations <n>] <patterns> ...\n",
 	       argv[0]);
     }
 
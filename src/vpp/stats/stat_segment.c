@@ -44,6 +44,77 @@ vlib_stat_segment_unlock (void)
   clib_spinlock_unlock (sm->stat_segment_lockp);
 }
 
+/*
+ * Readers copy an entry without locking and retry it if its version
+ * changed meanwhile. The version is odd from before the writer frees
+ * anything the entry points to until the entry is consistent again.
+ */
+static inline void
+stat_segment_version_begin (u64 * version)
+{
+  if (*version & 1)
+    return;
+  clib_atomic_store_rel_n (version, *version + 1);
+  CLIB_MEMORY_BARRIER ();
+}
+
+static inline void
+stat_segment_version_end (u64 * version)
+{
+  if (!(*version & 1))
+    return;
+  clib_atomic_store_rel_n (version, *version + 1);
+}
+
+static u64 *
+stat_segment_version_by_index (u32 index)
+{
+  stat_segment_main_t *sm = &stat_segment_main;
+
+  if (index == ~0)
+    return &sm->shared_header->error_version;
+  return &stat_segment_directory_entry (sm->shared_header, index)->version;
+}
+
+/*
+ * Append an entry to the directory. Called with the stats heap set and
+ * the stat segment lock held. Returns the directory index, ~0 if full.
+ */
+static u32
+stat_segment_directory_add (stat_segment_directory_entry_t * e)
+{
+  stat_segment_main_t *sm = &stat_segment_main;
+  stat_segment_shared_header_t *shared_header = sm->shared_header;
+  stat_segment_directory_entry_t *ep;
+  u32 index = shared_header->n_directory_entries;
+  u32 chunk = index / STAT_SEGMENT_DIRECTORY_CHUNK_SIZE;
+
+  if (chunk >= STAT_SEGMENT_DIRECTORY_MAX_CHUNKS)
+    {
+      clib_warning ("stat segment directory full, dropping %s", e->name);
+      return ~0;
+    }
+
+  if (index % STAT_SEGMENT_DIRECTORY_CHUNK_SIZE == 0)
+    {
+      ep = clib_mem_alloc_aligned (STAT_SEGMENT_DIRECTORY_CHUNK_SIZE *
+				   sizeof (*ep), CLIB_CACHE_LINE_BYTES);
+      clib_memset (ep, 0, STAT_SEGMENT_DIRECTORY_CHUNK_SIZE * sizeof (*ep));
+      shared_header->directory_chunk_offset[chunk] =
+	stat_segment_offset (shared_header, ep);
+    }
+
+  ep = stat_segment_directory_entry (shared_header, index);
+  clib_memcpy (ep, e, sizeof (*ep));
+  ep->version = 0;
+
+  /* Entry is complete before readers can see it */
+  CLIB_MEMORY_STORE_BARRIER ();
+  shared_header->n_directory_entries = index + 1;
+
+  return index;
+}
+
 /*
  * Change heap to the stats shared memory segment
  */
@@ -51,12 +122,52 @@ void *
 vlib_stats_push_heap (void *old)
 {
   stat_segment_main_t *sm = &stat_segment_main;
+  uword *p;
 
   sm->last = old;
   ASSERT (sm && sm->shared_header);
+
+  /*
+   * The caller is about to reallocate a vector readers may be copying,
+   * flag its entry before the old copy is freed.
+   */
+  p = old ? hash_get (sm->directory_index_by_vector, old) : 0;
+  if (p)
+    {
+      vlib_stat_segment_lock ();
+      sm->pending_version = stat_segment_version_by_index (p[0]);
+      stat_segment_version_begin (sm->pending_version);
+      vlib_stat_segment_unlock ();
+    }
+
   return clib_mem_set_heap (sm->heap);
 }
 
+/* Track the counter vector of a directory entry, see push heap */
+static void
+stat_segment_track_vector (void *old, void *new, u32 index)
+{
+  stat_segment_main_t *sm = &stat_segment_main;
+
+  if (old == new)
+    return;
+  if (old)
+    hash_unset (sm->directory_index_by_vector, old);
+  if (new)
+    hash_set (sm->directory_index_by_vector, new, index);
+}
+
+/* Readers may trust the flagged entry again */
+static void
+stat_segment_pending_version_end (void)
+{
+  stat_segment_main_t *sm = &stat_segment_main;
+
+  if (sm->pending_version)
+    stat_segment_version_end (sm->pending_version);
+  sm->pending_version = 0;
+}
+
 /* Name to vector index hash */
 static u32
 lookup_or_create_hash_index (void *oldheap, char *name, u32 next_vector_index)
@@ -103,7 +214,7 @@ vlib_stats_pop_heap (void *cm_arg, void *oldheap, u32 cindex,
   /* Lookup hash-table is on the main heap */
   stat_segment_name =
     cm->stat_segment_name ? cm->stat_segment_name : cm->name;
-  u32 next_vector_index = vec_len (sm->directory_vector);
+  u32 next_vector_index = shared_header->n_directory_entries;
   clib_mem_set_heap (oldheap);	/* Exit stats segment */
   u32 vector_index = lookup_or_create_hash_index (oldheap, stat_segment_name,
 						  next_vector_index);
@@ -116,10 +227,19 @@ vlib_stats_pop_heap (void *cm_arg, void *oldheap, u32 cindex,
     {				/* New */
       strncpy (e.name, stat_segment_name, 128 - 1);
       e.type = type;
-      vec_add1 (sm->directory_vector, e);
+      if (stat_segment_directory_add (&e) == ~0)
+	{
+	  clib_mem_set_heap (oldheap);
+	  hash_unset (sm->directory_vector_by_name, stat_segment_name);
+	  stat_segment_pending_version_end ();
+	  vlib_stat_segment_unlock ();
+	  return;
+	}
     }
 
-  stat_segment_directory_entry_t *ep = &sm->directory_vector[vector_index];
+  stat_segment_directory_entry_t *ep =
+    stat_segment_directory_entry (shared_header, vector_index);
+  stat_segment_version_begin (&ep->version);
   ep->offset = stat_segment_offset (shared_header, cm->counters);	/* Vector of threads of vectors of counters */
   u64 *offset_vector =
     ep->offset_vector ? stat_segment_pointer (shared_header,
@@ -140,15 +260,13 @@ vlib_stats_pop_heap (void *cm_arg, void *oldheap, u32 cindex,
       stat_segment_offset (shared_header, cm->counters[cindex]);
 
   ep->offset_vector = stat_segment_offset (shared_header, offset_vector);
-  sm->directory_vector[vector_index].offset =
-    stat_segment_offset (shared_header, cm->counters);
-
-  /* Reset the client hash table pointer, since it WILL change! */
-  shared_header->directory_offset =
-    stat_segment_offset (shared_header, sm->directory_vector);
+  stat_segment_version_end (&ep->version);
+  sm->pending_version = 0;
 
   vlib_stat_segment_unlock ();
   clib_mem_set_heap (oldheap);
+
+  stat_segment_track_vector (sm->last, cm->counters, vector_index);
 }
 
 void
@@ -163,18 +281,54 @@ vlib_stats_register_error_index (u8 * name, u64 * em_vec, u64 index)
 
   vlib_stat_segment_lock ();
 
+  clib_memset (&e, 0, sizeof (e));
   memcpy (e.name, name, vec_len (name));
   e.name[vec_len (name)] = '\0';
   e.type = STAT_DIR_TYPE_ERROR_INDEX;
   e.offset = index;
   e.offset_vector = 0;
-  vec_add1 (sm->directory_vector, e);
+  stat_segment_directory_add (&e);
+
+  vlib_stat_segment_unlock ();
+}
+
+/*
+ * Publish the per thread binary trace rings, see vlib/trace_ring.h. The
+ * caller allocated them on the stats heap and frees the previous rings
+ * after this returns; readers drop what they copied from those when the
+ * entry version changes.
+ */
+void
+vlib_stats_register_trace_rings (void **rings)
+{
+  stat_segment_main_t *sm = &stat_segment_main;
+  stat_segment_shared_header_t *shared_header = sm->shared_header;
+  stat_segment_directory_entry_t *ep;
+  u64 *offset_vector = 0, *old_offset_vector;
+  void *oldheap;
+  int i;
+
+  ASSERT (shared_header);
+
+  oldheap = clib_mem_set_heap (sm->heap);
+  vec_validate (offset_vector, vec_len (rings) - 1);
+  for (i = 0; i < vec_len (rings); i++)
+    if (rings[i])
+      offset_vector[i] = stat_segment_offset (shared_header, rings[i]);
 
-  /* Warn clients to refresh any pointers they might be holding */
-  shared_header->directory_offset =
-    stat_segment_offset (shared_header, sm->directory_vector);
+  vlib_stat_segment_lock ();
+
+  ep = stat_segment_directory_entry (shared_header, STAT_COUNTER_TRACE_RING);
+  old_offset_vector = ep->offset_vector ?
+    stat_segment_pointer (shared_header, ep->offset_vector) : 0;
+  stat_segment_version_begin (&ep->version);
+  ep->offset_vector = stat_segment_offset (shared_header, offset_vector);
+  stat_segment_version_end (&ep->version);
 
   vlib_stat_segment_unlock ();
+
+  vec_free (old_offset_vector);
+  clib_mem_set_heap (oldheap);
 }
 
 static void
@@ -187,6 +341,8 @@ stat_validate_counter_vector (stat_segment_directory_entry_t * ep, u32 max)
   int i;
   u64 *offset_vector = 0;
 
+  /* Readers drop what they copy from here on, see version begin */
+  stat_segment_version_begin (&ep->version);
   vec_validate_aligned (counters, tm->n_vlib_mains - 1,
 			CLIB_CACHE_LINE_BYTES);
   for (i = 0; i < tm->n_vlib_mains; i++)
@@ -197,6 +353,7 @@ stat_validate_counter_vector (stat_segment_directory_entry_t * ep, u32 max)
     }
   ep->offset = stat_segment_offset (shared_header, counters);
   ep->offset_vector = stat_segment_offset (shared_header, offset_vector);
+  stat_segment_version_end (&ep->version);
 }
 
 void
@@ -209,14 +366,15 @@ vlib_stats_pop_heap2 (u64 * error_vector, u32 thread_index, void *oldheap)
 
   vlib_stat_segment_lock ();
 
-  /* Reset the client hash table pointer, since it WILL change! */
+  /* Reset the client error vector pointer, since it WILL change! */
   shared_header->error_offset =
     stat_segment_offset (shared_header, error_vector);
-  shared_header->directory_offset =
-    stat_segment_offset (shared_header, sm->directory_vector);
+  stat_segment_pending_version_end ();
 
   vlib_stat_segment_unlock ();
   clib_mem_set_heap (oldheap);
+
+  stat_segment_track_vector (sm->last, error_vector, ~0);
 }
 
 clib_error_t *
@@ -224,7 +382,7 @@ vlib_map_stat_segment_init (void)
 {
   stat_segment_main_t *sm = &stat_segment_main;
   stat_segment_shared_header_t *shared_header;
-  stat_segment_directory_entry_t *ep;
+  stat_segment_directory_entry_t e;
   void *oldheap;
   ssize_t memory_size;
   int mfd;
@@ -265,27 +423,26 @@ vlib_map_stat_segment_init (void)
   sm->memfd = mfd;
 
   sm->directory_vector_by_name = hash_create_string (0, sizeof (uword));
+  /* The heap starts after the shared header page */
+  ASSERT (sizeof (*shared_header) <= getpagesize ());
   sm->shared_header = shared_header = memaddr;
   sm->stat_segment_lockp = clib_mem_alloc (sizeof (clib_spinlock_t));
   clib_spinlock_init (sm->stat_segment_lockp);
 
-  oldheap = clib_mem_set_heap (sm->heap);
+  sm->directory_index_by_vector = hash_create (0, sizeof (uword));
 
-  /* Set up the name to counter-vector hash table */
-  sm->directory_vector = 0;
+  oldheap = clib_mem_set_heap (sm->heap);
 
   shared_header->epoch = 1;
 
   /* Scalar stats and node counters */
-  vec_validate (sm->directory_vector, STAT_COUNTERS - 1);
 #define _(E,t,n,p)							\
-  strcpy(sm->directory_vector[STAT_COUNTER_##E].name,  #p "/" #n); \
-  sm->directory_vector[STAT_COUNTER_##E].type = STAT_DIR_TYPE_##t;
+  clib_memset (&e, 0, sizeof (e));					\
+  strcpy (e.name, #p "/" #n);						\
+  e.type = STAT_DIR_TYPE_##t;						\
+  stat_segment_directory_add (&e);
   foreach_stat_segment_counter_name
 #undef _
-    /* Save the vector offset in the shared segment, for clients */
-    shared_header->directory_offset =
-    stat_segment_offset (shared_header, sm->directory_vector);
 
   clib_mem_set_heap (oldheap);
 
@@ -326,6 +483,10 @@ format_stat_dir_entry (u8 * s, va_list * args)
       type_name = "ErrIndex";
       break;
 
+    case STAT_DIR_TYPE_TRACE_RING:
+      type_name = "TraceRing";
+      break;
+
     default:
       type_name = "illegal!";
       break;
@@ -342,8 +503,8 @@ show_stat_segment_command_fn (vlib_main_t * vm,
   stat_segment_main_t *sm = &stat_segment_main;
   counter_t *counter;
   hash_pair_t *p;
-  stat_segment_directory_entry_t *show_data, *this;
-  int i, j;
+  stat_segment_directory_entry_t *show_data = 0;
+  u32 i, n_entries;
 
   int verbose = 0;
   u8 *s;
@@ -351,9 +512,12 @@ show_stat_segment_command_fn (vlib_main_t * vm,
   if (unformat (input, "verbose"))
     verbose = 1;
 
-  /* Lock even as reader, as this command doesn't handle epoch changes */
+  /* Lock even as reader, as this command doesn't handle entry changes */
   vlib_stat_segment_lock ();
-  show_data = vec_dup (sm->directory_vector);
+  n_entries = sm->shared_header->n_directory_entries;
+  vec_validate (show_data, n_entries - 1);
+  for (i = 0; i < n_entries; i++)
+    show_data[i] = *stat_segment_directory_entry (sm->shared_header, i);
   vlib_stat_segment_unlock ();
 
   vec_sort_with_function (show_data, name_sort_cmp);
@@ -365,6 +529,7 @@ show_stat_segment_command_fn (vlib_main_t * vm,
       vlib_cli_output (vm, "%-100U", format_stat_dir_entry,
 		       vec_elt_at_index (show_data, i));
     }
+  vec_free (show_data);
 
   if (verbose)
     {
@@ -418,18 +583,24 @@ update_node_counters (stat_segment_main_t * sm)
       void *oldheap = clib_mem_set_heap (sm->heap);
       vlib_stat_segment_lock ();
 
-      stat_validate_counter_vector (&sm->directory_vector
-				    [STAT_COUNTER_NODE_CLOCKS], l);
-      stat_validate_counter_vector (&sm->directory_vector
-				    [STAT_COUNTER_NODE_VECTORS], l);
-      stat_validate_counter_vector (&sm->directory_vector
-				    [STAT_COUNTER_NODE_CALLS], l);
-      stat_validate_counter_vector (&sm->directory_vector
-				    [STAT_COUNTER_NODE_SUSPENDS], l);
+      stat_validate_counter_vector (stat_segment_directory_entry
+				    (shared_header, STAT_COUNTER_NODE_CLOCKS),
+				    l);
+      stat_validate_counter_vector (stat_segment_directory_entry
+				    (shared_header, STAT_COUNTER_NODE_VECTORS),
+				    l);
+      stat_validate_counter_vector (stat_segment_directory_entry
+				    (shared_header, STAT_COUNTER_NODE_CALLS),
+				    l);
+      stat_validate_counter_vector (stat_segment_directory_entry
+				    (shared_header,
+				     STAT_COUNTER_NODE_SUSPENDS), l);
 
-      vec_validate (sm->nodes, l);
       stat_segment_directory_entry_t *ep;
-      ep = &sm->directory_vector[STAT_COUNTER_NODE_NAMES];
+      ep = stat_segment_directory_entry (shared_header,
+					 STAT_COUNTER_NODE_NAMES);
+      stat_segment_version_begin (&ep->version);
+      vec_validate (sm->nodes, l);
       ep->offset = stat_segment_offset (shared_header, sm->nodes);
 
       int i;
@@ -453,6 +624,7 @@ update_node_counters (stat_segment_main_t * sm)
 
 	}
       ep->offset_vector = stat_segment_offset (shared_header, offset_vector);
+      stat_segment_version_end (&ep->version);
 
       vlib_stat_segment_unlock ();
       clib_mem_set_heap (oldheap);
@@ -472,29 +644,33 @@ update_node_counters (stat_segment_main_t * sm)
 
 	  counters =
 	    stat_segment_pointer (shared_header,
-				  sm->directory_vector
-				  [STAT_COUNTER_NODE_CLOCKS].offset);
+				  stat_segment_directory_entry
+				  (shared_header,
+				   STAT_COUNTER_NODE_CLOCKS)->offset);
 	  c = counters[j];
 	  c[n->index] = n->stats_total.clocks - n->stats_last_clear.clocks;
 
 	  counters =
 	    stat_segment_pointer (shared_header,
-				  sm->directory_vector
-				  [STAT_COUNTER_NODE_VECTORS].offset);
+				  stat_segment_directory_entry
+				  (shared_header,
+				   STAT_COUNTER_NODE_VECTORS)->offset);
 	  c = counters[j];
 	  c[n->index] = n->stats_total.vectors - n->stats_last_clear.vectors;
 
 	  counters =
 	    stat_segment_pointer (shared_header,
-				  sm->directory_vector
-				  [STAT_COUNTER_NODE_CALLS].offset);
+				  stat_segment_directory_entry
+				  (shared_header,
+				   STAT_COUNTER_NODE_CALLS)->offset);
 	  c = counters[j];
 	  c[n->index] = n->stats_total.calls - n->stats_last_clear.calls;
 
 	  counters =
 	    stat_segment_pointer (shared_header,
-				  sm->directory_vector
-				  [STAT_COUNTER_NODE_SUSPENDS].offset);
+				  stat_segment_directory_entry
+				  (shared_header,
+				   STAT_COUNTER_NODE_SUSPENDS)->offset);
 	  c = counters[j];
 	  c[n->index] =
 	    n->stats_total.suspends - n->stats_last_clear.suspends;
@@ -505,6 +681,7 @@ update_node_counters (stat_segment_main_t * sm)
 static void
 do_stat_segment_updates (stat_segment_main_t * sm)
 {
+  stat_segment_shared_header_t *shared_header = sm->shared_header;
   vlib_main_t *vm = vlib_mains[0];
   f64 vector_rate;
   u64 input_packets, last_input_packets;
@@ -526,20 +703,25 @@ do_stat_segment_updates (stat_segment_main_t * sm)
     }
   vector_rate /= (f64) (i - start);
 
-  sm->directory_vector[STAT_COUNTER_VECTOR_RATE].value =
+  stat_segment_directory_entry (shared_header,
+				STAT_COUNTER_VECTOR_RATE)->value =
     vector_rate / ((f64) (vec_len (vlib_mains) - start));
 
   /*
    * Compute the aggregate input rate
    */
   now = vlib_time_now (vm);
-  dt = now - sm->directory_vector[STAT_COUNTER_LAST_UPDATE].value;
+  dt = now - stat_segment_directory_entry (shared_header,
+					   STAT_COUNTER_LAST_UPDATE)->value;
   input_packets = vnet_get_aggregate_rx_packets ();
-  sm->directory_vector[STAT_COUNTER_INPUT_RATE].value =
+  stat_segment_directory_entry (shared_header,
+				STAT_COUNTER_INPUT_RATE)->value =
     (f64) (input_packets - sm->last_input_packets) / dt;
-  sm->directory_vector[STAT_COUNTER_LAST_UPDATE].value = now;
+  stat_segment_directory_entry (shared_header,
+				STAT_COUNTER_LAST_UPDATE)->value = now;
   sm->last_input_packets = input_packets;
-  sm->directory_vector[STAT_COUNTER_LAST_STATS_CLEAR].value =
+  stat_segment_directory_entry (shared_header,
+				STAT_COUNTER_LAST_STATS_CLEAR)->value =
     vm->node_main.time_last_runtime_stats_clear;
 
   if (sm->node_counters_enabled)
@@ -550,12 +732,14 @@ do_stat_segment_updates (stat_segment_main_t * sm)
   stat_segment_gauges_pool_t *g;
   pool_foreach(g, sm->gauges,
   ({
-    g->fn(&sm->directory_vector[g->directory_index], g->caller_index);
+    g->fn(stat_segment_directory_entry (shared_header, g->directory_index),
+          g->caller_index);
   }));
   /* *INDENT-ON* */
 
   /* Heartbeat, so clients detect we're still here */
-  sm->directory_vector[STAT_COUNTER_HEARTBEAT].value++;
+  stat_segment_directory_entry (shared_header,
+				STAT_COUNTER_HEARTBEAT)->value++;
 }
 
 /*
@@ -679,15 +863,14 @@ stat_segment_register_gauge (u8 * name, stat_segment_update_fn update_fn,
   e.type = STAT_DIR_TYPE_SCALAR_INDEX;
 
   memcpy (e.name, name, vec_len (name));
-  index = vec_len (sm->directory_vector);
-  vec_add1 (sm->directory_vector, e);//将e加入到目录vector中
-
-  shared_header->directory_offset =
-    stat_segment_offset (shared_header, sm->directory_vector);
+  index = stat_segment_directory_add (&e);//将e加入到目录vector中
 
   vlib_stat_segment_unlock ();
   clib_mem_set_heap (oldheap);
 
+  if (index == ~0)
+    return clib_error_return (0, "stat segment directory full");
+
   /* Back on our own heap */
   //记录gauge
   pool_get (sm->gauges, gauge);
@@ -736,6 +919,11 @@ statseg_sw_interface_add_del (vnet_main_t * vnm, u32 sw_if_index, u32 is_add)
   void *oldheap = vlib_stats_push_heap (sm->interfaces);
   vlib_stat_segment_lock ();
 
+  stat_segment_directory_entry_t *ep;
+  ep = stat_segment_directory_entry (shared_header,
+				     STAT_COUNTER_INTERFACE_NAMES);
+  stat_segment_version_begin (&ep->version);
+
   vec_validate (sm->interfaces, sw_if_index);
   if (is_add)
     {
@@ -760,8 +948,6 @@ statseg_sw_interface_add_del (vnet_main_t * vnm, u32 sw_if_index, u32 is_add)
       sm->interfaces[sw_if_index] = 0;
     }
 
-  stat_segment_directory_entry_t *ep;
-  ep = &sm->directory_vector[STAT_COUNTER_INTERFACE_NAMES];
   ep->offset = stat_segment_offset (shared_header, sm->interfaces);
 
   int i;
@@ -788,6 +974,7 @@ statseg_sw_interface_add_del (vnet_main_t * vnm, u32 sw_if_index, u32 is_add)
 	stat_segment_offset (shared_header, sm->interfaces[sw_if_index]) : 0;
     }
   ep->offset_vector = stat_segment_offset (shared_header, offset_vector);
+  stat_segment_version_end (&ep->version);
 
   vlib_stat_segment_unlock ();
   clib_mem_set_heap (oldheap);
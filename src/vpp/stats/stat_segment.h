@@ -34,6 +34,7 @@ typedef enum
  STAT_COUNTER_NODE_SUSPENDS,
  STAT_COUNTER_INTERFACE_NAMES,
  STAT_COUNTER_NODE_NAMES,
+ STAT_COUNTER_TRACE_RING,
  STAT_COUNTERS
 } stat_segment_counter_t;
 
@@ -48,7 +49,8 @@ typedef enum
   _(NODE_CALLS, COUNTER_VECTOR_SIMPLE, calls, /sys/node)	\
   _(NODE_SUSPENDS, COUNTER_VECTOR_SIMPLE, suspends, /sys/node)	\
   _(INTERFACE_NAMES, NAME_VECTOR, names, /if)                   \
-  _(NODE_NAMES, NAME_VECTOR, names, /sys/node)
+  _(NODE_NAMES, NAME_VECTOR, names, /sys/node)		\
+  _(TRACE_RING, TRACE_RING, trace_ring, /sys)
 
 typedef struct
 {
@@ -59,6 +61,8 @@ typedef struct
     uint64_t value;
   };//记录结果
   uint64_t offset_vector;
+  /* Odd while the writer changes the entry or the data behind it */
+  uint64_t version;
   //目录名称
   char name[128]; // TODO change this to pointer to "somewhere"
 } stat_segment_directory_entry_t;
@@ -66,6 +70,14 @@ typedef struct
 /* Default stat segment 32m */
 #define STAT_SEGMENT_DEFAULT_SIZE	(32<<20)
 
+/*
+ * The directory is a set of fixed size chunks of entries. Chunks are
+ * appended as the directory grows and are never moved or freed, so an
+ * entry stays at the same place for the lifetime of the segment.
+ */
+#define STAT_SEGMENT_DIRECTORY_CHUNK_SIZE	512
+#define STAT_SEGMENT_DIRECTORY_MAX_CHUNKS	256
+
 /*
  * Shared header first in the shared memory segment.
  */
@@ -73,9 +85,12 @@ typedef struct
 {
   atomic_int_fast64_t epoch;
   atomic_int_fast64_t in_progress;
-  atomic_int_fast64_t directory_offset;
+  atomic_int_fast64_t n_directory_entries;
   atomic_int_fast64_t error_offset;
   atomic_int_fast64_t stats_offset;
+  /* Odd while the writer moves the error counter vector */
+  uint64_t error_version;
+  uint64_t directory_chunk_offset[STAT_SEGMENT_DIRECTORY_MAX_CHUNKS];
 } stat_segment_shared_header_t;
 
 static inline uint64_t
@@ -90,6 +105,18 @@ stat_segment_pointer (void *start, uint64_t offset)
   return ((char *) start + offset);
 }
 
+static inline stat_segment_directory_entry_t *
+stat_segment_directory_entry (stat_segment_shared_header_t * shared_header,
+			      uint32_t index)
+{
+  stat_segment_directory_entry_t *chunk;
+
+  chunk = stat_segment_pointer (shared_header,
+				shared_header->directory_chunk_offset
+				[index / STAT_SEGMENT_DIRECTORY_CHUNK_SIZE]);
+  return &chunk[index % STAT_SEGMENT_DIRECTORY_CHUNK_SIZE];
+}
+
 typedef void (*stat_segment_update_fn)(stat_segment_directory_entry_t * e, u32 i);
 
 typedef struct {
@@ -105,7 +132,11 @@ typedef struct
 
   /* statistics segment */
   uword *directory_vector_by_name;
-  stat_segment_directory_entry_t *directory_vector;
+
+  /* directory index by counter vector, ~0 for the error counters */
+  uword *directory_index_by_vector;
+  /* version of the vector being reallocated between push and pop heap */
+  u64 *pending_version;
   u8 **interfaces;
   u8 **nodes;
 
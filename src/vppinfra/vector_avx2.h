@@ -247,6 +247,21 @@ u32x8_scatter_one (u32x8 r, int index, void *p)
   *(u32 *) p = r[index];
 }
 
+/* load the u64 lanes selected by the low 4 bits of mask, zero the rest;
+   masked-out lanes are never read so they may cross a page boundary */
+static_always_inline u64x4
+u64x4_mask_load_zero (void *p, u8 mask)
+{
+  i64x4 m = (i64x4) ((u64x4_splat (mask) & (u64x4) { 1, 2, 4, 8 }) != 0);
+  return (u64x4) _mm256_maskload_epi64 ((const long long *) p, (__m256i) m);
+}
+
+static_always_inline u64
+u64x4_xor_reduce (u64x4 v)
+{
+  return v[0] ^ v[1] ^ v[2] ^ v[3];
+}
+
 static_always_inline u8x32
 u8x32_is_greater (u8x32 v1, u8x32 v2)
 {
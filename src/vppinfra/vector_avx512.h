@@ -63,6 +63,22 @@ foreach_avx512_vec512i foreach_avx512_vec512u
 #undef _
 /* *INDENT-ON* */
 
+/* load the u64 lanes selected by mask, zero the rest; masked-out lanes
+   are never read so they may cross a page boundary */
+static_always_inline u64x8
+u64x8_mask_load_zero (void *p, u8 mask)
+{
+  return (u64x8) _mm512_maskz_loadu_epi64 ((__mmask8) mask, p);
+}
+
+static_always_inline u64
+u64x8_xor_reduce (u64x8 v)
+{
+  u64x4 r = (u64x4) _mm512_extracti64x4_epi64 ((__m512i) v, 0) ^
+    (u64x4) _mm512_extracti64x4_epi64 ((__m512i) v, 1);
+  return r[0] ^ r[1] ^ r[2] ^ r[3];
+}
+
 static_always_inline u32
 u16x32_msb_mask (u16x32 v)
 {
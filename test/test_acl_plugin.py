@@ -4,6 +4,8 @@
 
 import unittest
 import random
+import re
+from socket import inet_pton, AF_INET, AF_INET6
 
 from scapy.packet import Raw
 from scapy.layers.l2 import Ether
@@ -41,6 +43,9 @@ class TestACLplugin(VppTestCase):
     UDP = 1
     PROTO_ALL = 0
 
+    # lookups through the decision tree rather than the hash
+    use_dtree = 0
+
     # port ranges
     PORTS_ALL = -1
     PORTS_RANGE = 0
@@ -492,6 +497,7 @@ class TestACLplugin(VppTestCase):
                                      dst_if.name)
                     self.verify_capture(dst_if, capture,
                                         traffic_type, ip_type, etype)
+        return pkts_cnt
 
     def run_verify_negat_test(self, traffic_type=0, ip_type=0, proto=-1,
                               ports=0, frags=False, etype=-1):
@@ -1480,5 +1486,157 @@ class TestACLplugin(VppTestCase):
 
         self.logger.info("ACLP_TEST_FINISH_0315")
 
+    def hash_mask_counters(self):
+        out = self.vapi.cli("show acl-plugin tables applied")
+        counters = re.findall(r"mask type probes (\d+), "
+                              r"bloom filter skips (\d+)", out)
+        self.assertTrue(counters)
+        return (sum(int(p) for p, s in counters),
+                sum(int(s) for p, s in counters))
+
+    def test_0320_hash_mask_counters(self):
+        """ hash lookups count mask type probes and bloom filter skips
+        """
+        self.logger.info("ACLP_TEST_START_0320")
+
+        # the counters are kept by the hash lookup only
+        self.vapi.cli("set acl-plugin use-dtree-acl-matching 0")
+        probes, skips = self.hash_mask_counters()
+
+        # UDP rules first: their mask types are probed for every TCP
+        # packet, and most probes are rejected by their bloom filters
+        rules = []
+        rules.append(self.create_rule(self.IPV4, self.DENY, self.PORTS_RANGE,
+                     self.proto[self.IP][self.UDP]))
+        rules.append(self.create_rule(self.IPV4, self.PERMIT, self.PORTS_RANGE,
+                     self.proto[self.IP][self.TCP]))
+        rules.append(self.create_rule(self.IPV4, self.DENY, self.PORTS_ALL, 0))
+        reply = self.vapi.acl_add_replace(acl_index=4294967295, r=rules,
+                                          tag=b"hash mask counters")
+        for i in self.pg_interfaces:
+            self.vapi.acl_interface_set_acl_list(sw_if_index=i.sw_if_index,
+                                                 n_input=1,
+                                                 acls=[reply.acl_index])
+
+        n_pkts = self.run_verify_test(self.IP, self.IPV4,
+                                      self.proto[self.IP][self.TCP])
+
+        new_probes, new_skips = self.hash_mask_counters()
+        # at least the UDP and the TCP mask types for every packet
+        self.assertGreaterEqual(new_probes - probes, 2 * n_pkts)
+        self.assertGreater(new_skips, skips)
+        self.assertLess(new_skips - skips, new_probes - probes)
+
+        for i in self.pg_interfaces:
+            self.vapi.acl_interface_set_acl_list(sw_if_index=i.sw_if_index,
+                                                 n_input=0, acls=[])
+        self.vapi.acl_del(reply.acl_index)
+        self.vapi.cli("set acl-plugin use-dtree-acl-matching %u" %
+                      self.use_dtree)
+
+        self.logger.info("ACLP_TEST_FINISH_0320")
+
+
+class TestACLpluginDtree(TestACLplugin):
+    """ ACL plugin Test Case with decision tree lookups """
+
+    use_dtree = 1
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestACLpluginDtree, cls).setUpClass()
+        cls.vapi.cli("set acl-plugin use-dtree-acl-matching 1")
+
+    def create_range_rule(self, ip):
+        proto = random.choice([self.proto[self.IP][self.TCP],
+                               self.proto[self.IP][self.UDP]])
+        sport_from = random.randint(0, 65535)
+        dport_from = random.randint(0, 65535)
+        s_prefix = random.choice([0, 8, 16, 24])
+        s_ip = inet_pton(AF_INET6 if ip else AF_INET,
+                         "2001:db8::" if ip else
+                         "10.%u.0.0" % random.randint(0, 3))
+        return ({'is_permit': random.randint(0, 1), 'is_ipv6': ip,
+                 'proto': proto,
+                 'srcport_or_icmptype_first': sport_from,
+                 'srcport_or_icmptype_last':
+                 random.randint(sport_from, 65535),
+                 'src_ip_prefix_len': s_prefix, 'src_ip_addr': s_ip,
+                 'dstport_or_icmpcode_first': dport_from,
+                 'dstport_or_icmpcode_last':
+                 random.randint(dport_from, min(dport_from + 1000, 65535)),
+                 'dst_ip_prefix_len': 0,
+                 'dst_ip_addr': inet_pton(AF_INET6 if ip else AF_INET,
+                                          "::" if ip else "0.0.0.0")})
+
+    def test_0400_dtree_lookup_compare(self):
+        """ decision tree matches the linear lookup on port range rules
+        """
+        self.logger.info("ACLP_TEST_START_0400")
+
+        for n_rules in [10, 100, 1000]:
+            rules = [self.create_range_rule(random.randint(0, 1))
+                     for i in range(n_rules)]
+            self.apply_rules_to(rules, b"dtree port ranges",
+                                self.pg0.sw_if_index)
+
+            out = self.vapi.cli("show acl-plugin interface sw_if_index %u "
+                                "detail" % self.pg0.sw_if_index)
+            lc_index = int(re.search(r"input lookup context index: (\d+)",
+                                     out).group(1))
+            self.assertIn("lc_index %u:" % lc_index,
+                          self.vapi.cli("show acl-plugin tables dtree"))
+
+            reply = self.vapi.cli("test acl-plugin lookup lc_index %u "
+                                  "packets 20000" % lc_index)
+            self.logger.info(reply)
+            self.assertNotIn("mismatch on", reply)
+
+        self.vapi.acl_interface_set_acl_list(
+            sw_if_index=self.pg0.sw_if_index, n_input=0, acls=[])
+
+        self.logger.info("ACLP_TEST_FINISH_0400")
+
+    def test_0410_dtree_hitcount(self):
+        """ decision tree matches count rule hits and mark the trace
+        """
+        self.logger.info("ACLP_TEST_START_0410")
+
+        rules = []
+        rules.append(self.create_rule(self.IPV4, self.PERMIT, self.PORTS_RANGE,
+                     self.proto[self.IP][self.TCP]))
+        rules.append(self.create_rule(self.IPV4, self.DENY, self.PORTS_ALL, 0))
+        reply = self.vapi.acl_add_replace(acl_index=4294967295, r=rules,
+                                          tag=b"dtree hitcount")
+        for i in self.pg_interfaces:
+            self.vapi.acl_interface_set_acl_list(sw_if_index=i.sw_if_index,
+                                                 n_input=1,
+                                                 acls=[reply.acl_index])
+        self.assertIn("rules", self.vapi.cli("show acl-plugin tables dtree"))
+
+        n_pkts = self.run_verify_test(self.IP, self.IPV4,
+                                      self.proto[self.IP][self.TCP])
+
+        # every packet hit the permit rule, on one of the applied entries
+        out = self.vapi.cli("show acl-plugin tables applied")
+        hits = re.findall(r"acl %u rule 0 .* hitcount (\d+)" %
+                          reply.acl_index, out)
+        self.assertTrue(hits)
+        self.assertEqual(sum(int(h) for h in hits), n_pkts)
+        hits = re.findall(r"acl %u rule 1 .* hitcount (\d+)" %
+                          reply.acl_index, out)
+        self.assertEqual(sum(int(h) for h in hits), 0)
+
+        # and the acl-plugin trace tells the tree made the decision
+        self.assertIn("trace_bits 20000000",
+                      self.vapi.cli("show trace max 10"))
+
+        for i in self.pg_interfaces:
+            self.vapi.acl_interface_set_acl_list(sw_if_index=i.sw_if_index,
+                                                 n_input=0, acls=[])
+        self.vapi.acl_del(reply.acl_index)
+
+        self.logger.info("ACLP_TEST_FINISH_0410")
+
 if __name__ == '__main__':
     unittest.main(testRunner=VppTestRunner)
@@ -1,6 +1,7 @@
 #!/usr/bin/env python
 """ ACL plugin extended stateful tests """
 
+import re
 import unittest
 from framework import VppTestCase, VppTestRunner, running_extended_tests
 from scapy.layers.l2 import Ether
@@ -408,3 +409,163 @@ class ACLPluginConnTestCase(VppTestCase):
     def test_3006_tcp_transient_teardown_conn_test(self):
         """ IPv6: transient TCP session (3WHS,ACK,FINACK), ref. on egress """
         self.run_tcp_transient_teardown_conn_test(AF_INET6, 1)
+
+
+@unittest.skipUnless(running_extended_tests, "part of extended tests")
+class ACLPluginConnTimerWheelTestCase(VppTestCase):
+    """ ACL plugin session aging by the per-worker timer wheels """
+
+    @classmethod
+    def setUpClass(cls):
+        super(ACLPluginConnTimerWheelTestCase, cls).setUpClass()
+        cls.create_pg_interfaces(range(2))
+        # must be set before the session table gets initialized
+        cmd = "set acl-plugin session table timer-wheel 1"
+        cls.logger.info(cls.vapi.cli(cmd))
+        for i in cls.pg_interfaces:
+            i.admin_up()
+            i.config_ip4()
+            i.resolve_arp()
+
+    @classmethod
+    def tearDownClass(cls):
+        super(ACLPluginConnTimerWheelTestCase, cls).tearDownClass()
+
+    def tearDown(self):
+        super(ACLPluginConnTimerWheelTestCase, self).tearDown()
+        if not self.vpp_dead:
+            self.logger.info(self.vapi.cli("show acl-plugin sessions"))
+
+    def session_counters(self):
+        """ Session and timer counters of the main thread """
+        reply = self.vapi.cli("show acl-plugin sessions")
+        c = {}
+        m = re.search(r"Sessions total: add (\d+) - del (\d+)", reply)
+        c['total'] = int(m.group(1)) - int(m.group(2))
+        m = re.search(r"Sessions being purged: deact (\d+) - del (\d+)",
+                      reply)
+        c['purged'] = int(m.group(1)) - int(m.group(2))
+        m = re.search(r"Session timers restarted: (\d+)", reply)
+        c['restarted'] = int(m.group(1))
+        m = re.search(r"Session timers expired: (\d+), running: (\d+)",
+                      reply)
+        c['expired'] = int(m.group(1))
+        c['running'] = int(m.group(2))
+        return c
+
+    def assert_conn_gone(self, conn):
+        try:
+            p2 = conn.send_through(1).command()
+        except:
+            # the conn has timed out, the packet was dropped
+            p2 = None
+        self.assert_equal(p2, None, "packet on long-idle conn")
+
+    def test_0000_prepare(self):
+        """ Prepare the timeouts, check the aging mode """
+        self.vapi.ppcli("set acl-plugin session timeout udp idle 1")
+        reply = self.vapi.cli("show acl-plugin sessions")
+        self.assertIn("Session aging: timer wheel", reply)
+
+    def test_0001_idle_expiry(self):
+        """ Idle session expires after its timeout, then leaves purgatory """
+        conn1 = Conn(self, self.pg0, self.pg1, AF_INET, UDP, 43001, 4343)
+        conn1.apply_acls(0, 0)
+        conn1.send_through(0)
+        c0 = self.session_counters()
+        self.assert_equal(c0['total'], 1, "sessions")
+        self.assert_equal(c0['running'], 1, "running session timers")
+        # well within the 1 second idle timeout
+        self.sleep(0.5)
+        conn1.send_through(1)
+        # past the timeout counted from the last packet, plus a few ticks
+        self.sleep(2.0)
+        self.assert_conn_gone(conn1)
+        c1 = self.session_counters()
+        # one for the idle timer, one for the purgatory timer
+        self.assertGreaterEqual(c1['expired'] - c0['expired'], 2)
+        self.assert_equal(c1['running'], 0, "running session timers")
+        self.assert_equal(c1['purged'], 0, "sessions in purgatory")
+        self.assert_equal(c1['total'], 0, "sessions")
+
+    def test_0002_active_rearm(self):
+        """ Active session outlives its timeout, its timer is re-armed """
+        conn1 = Conn(self, self.pg0, self.pg1, AF_INET, UDP, 43002, 4343)
+        conn1.apply_acls(0, 0)
+        conn1.send_through(0)
+        c0 = self.session_counters()
+        # twice the idle timeout, the session must stay up
+        for i in IterateWithSleep(self, 10, "Keep conn active", 0.2):
+            conn1.send_through(1)
+        c1 = self.session_counters()
+        self.assertGreaterEqual(c1['restarted'] - c0['restarted'], 1)
+        self.assert_equal(c1['running'], 1, "running session timers")
+        self.assert_equal(c1['total'], 1, "sessions")
+        self.sleep(2.0)
+        self.assert_conn_gone(conn1)
+
+
+@unittest.skipUnless(running_extended_tests, "part of extended tests")
+class ACLPluginConnPerWorkerTestCase(VppTestCase):
+    """ ACL plugin per-worker session tables, with two workers """
+
+    @classmethod
+    def setUpConstants(cls):
+        cls.extra_vpp_punt_config = ["cpu", "{", "workers", "2", "}"]
+        super(ACLPluginConnPerWorkerTestCase, cls).setUpConstants()
+
+    @classmethod
+    def setUpClass(cls):
+        super(ACLPluginConnPerWorkerTestCase, cls).setUpClass()
+        cls.create_pg_interfaces(range(2))
+        # must be set before the session table gets initialized
+        cmd = "set acl-plugin session table per-worker 1"
+        cls.logger.info(cls.vapi.cli(cmd))
+        for i in cls.pg_interfaces:
+            i.admin_up()
+            i.config_ip4()
+            i.resolve_arp()
+
+    @classmethod
+    def tearDownClass(cls):
+        super(ACLPluginConnPerWorkerTestCase, cls).tearDownClass()
+
+    def tearDown(self):
+        super(ACLPluginConnPerWorkerTestCase, self).tearDown()
+        if not self.vpp_dead:
+            self.logger.info(self.vapi.cli("show acl-plugin sessions"))
+
+    def send_through(self, conn, side, worker):
+        """ Send one packet of the conn from the side, on the worker """
+        self.pg_interfaces[side].add_stream([conn.pkt(side)], worker=worker)
+        self.pg_interfaces[1 - side].enable_capture()
+        self.pg_start()
+        return self.pg_interfaces[1 - side].wait_for_packet(1)
+
+    def remote_session_counters(self):
+        """ Sessions, remote lookups and remote hits of each thread """
+        reply = self.vapi.cli("show acl-plugin sessions")
+        self.assertIn("Session tables: per worker", reply)
+        return [[int(x) for x in c] for c in re.findall(
+            r"Sessions in table: (\d+), remote lookups: (\d+), "
+            r"hits: (\d+)", reply)]
+
+    def test_0001_cross_worker_return_flow(self):
+        """ Return flow on another worker finds the forward flow session """
+        conn1 = Conn(self, self.pg0, self.pg1, AF_INET, UDP, 44001, 4444)
+        # deny on pg1 input, reflect on pg1 output
+        conn1.apply_acls(0, 1)
+        c0 = self.remote_session_counters()
+        self.assert_equal(len(c0), 3, "threads")
+        # the forward flow creates the session on the first worker
+        self.send_through(conn1, 0, 0)
+        # the return flow is only permitted by the session,
+        # which the second worker has to find in the first one's table
+        self.send_through(conn1, 1, 1)
+        c1 = self.remote_session_counters()
+        self.assert_equal(c1[1][0], 1, "sessions of the first worker")
+        self.assert_equal(c1[2][0], 0, "sessions of the second worker")
+        self.assert_equal(c1[2][2] - c0[2][2], 1,
+                          "remote session hits of the second worker")
+        self.assert_equal(c1[1][2] - c0[1][2], 0,
+                          "remote session hits of the first worker")
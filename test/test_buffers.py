@@ -0,0 +1,96 @@
+#!/usr/bin/env python
+
+import unittest
+
+from framework import VppTestCase, VppTestRunner
+
+
+class TestBuffers(VppTestCase):
+    """ Buffer pool Test Cases """
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestBuffers, cls).setUpClass()
+
+    def setUp(self):
+        super(TestBuffers, self).setUp()
+
+    def tearDown(self):
+        super(TestBuffers, self).tearDown()
+
+    def test_buffer_depot(self):
+        """ Buffer depot FIFO Test """
+        error = self.vapi.cli("test buffer depot")
+
+        self.assertIn("depot fifo test passed", error)
+        self.assertNotIn('failed', error)
+
+    def test_buffer_depot_threads(self):
+        """ Buffer depot Thread Test """
+        error = self.vapi.cli("test buffer depot threads 4 magazines 16")
+
+        self.assertIn("depot threads test passed", error)
+        self.assertNotIn('failed', error)
+
+
+class TestBufferRxPools(VppTestCase):
+    """ Buffer pool rx refill Test Cases """
+
+    @classmethod
+    def setUpConstants(cls):
+        cls.extra_vpp_punt_config = ["buffers", "{",
+                                     "pool", "small", "{",
+                                     "buffers", "512", "}",
+                                     "pool", "lender", "{",
+                                     "buffers", "512", "borrow", "}",
+                                     "}"]
+        super(TestBufferRxPools, cls).setUpConstants()
+
+    def pool_total(self, name):
+        for line in self.vapi.cli("show buffers").splitlines():
+            fields = line.split()
+            if fields and fields[0] == name:
+                return int(fields[5])
+        self.fail("no buffer pool %s" % name)
+
+    def pool_thread_counters(self, name):
+        out = self.vapi.cli("show buffers verbose")
+        in_pool = False
+        for line in out.splitlines():
+            fields = line.split()
+            if line.startswith((name + ":", name + ",")):
+                in_pool = True
+            elif in_pool and fields and fields[0] == "0":
+                return {"borrowed": int(fields[-2]),
+                        "failed": int(fields[-1])}
+        self.fail("no thread counters for pool %s: %s" % (name, out))
+
+    def rx_pool_alloc(self, name, n_buffers):
+        out = self.vapi.cli("test buffer rx-pool %s buffers %u" %
+                            (name, n_buffers))
+        self.assertIn("of %u buffers" % n_buffers, out)
+        return int(out.split("allocated")[1].split()[0])
+
+    def test_rx_pool_failed(self):
+        """ Refill from a dry pool counts the shortfall """
+        total = self.pool_total("small")
+        self.assertLess(total, 1024)
+
+        self.assertEqual(self.rx_pool_alloc("small", 1024), total)
+        counters = self.pool_thread_counters("small")
+        self.assertEqual(counters["borrowed"], 0)
+        self.assertEqual(counters["failed"], 1024 - total)
+
+    def test_rx_pool_borrow(self):
+        """ Refill from a dry pool borrows from its reserve pool """
+        total = self.pool_total("lender")
+        self.assertLess(total, 1024)
+
+        self.assertEqual(self.rx_pool_alloc("lender", 1024), 1024)
+        counters = self.pool_thread_counters("lender")
+        self.assertEqual(counters["borrowed"], 1024 - total)
+        self.assertEqual(counters["failed"], 0)
+
+
+if __name__ == '__main__':
+    unittest.main(testRunner=VppTestRunner)
@@ -1,6 +1,7 @@
 #!/usr/bin/env python
 
 import binascii
+import re
 import socket
 import unittest
 
@@ -815,5 +816,91 @@ class TestClassifierPBR(TestClassifier):
         # and the table should be gone.
         self.assertFalse(self.verify_vrf(self.pbr_vrfid))
 
+
+class TestClassifierChain(TestClassifier):
+    """ Classifier chain prefilter Test Case """
+
+    def chain_prefilter(self, table_index):
+        out = self.vapi.cli("show classify tables index %u" % table_index)
+        m = re.search(r"chain prefilter (\d+) bits, (\d+) stale, (\w+) hash",
+                      out)
+        self.assertIsNotNone(m, out)
+        return int(m.group(1)), int(m.group(2)), m.group(3)
+
+    def test_chain_prefilter(self):
+        """ Chained table prefilter add, delete and rebuild
+
+        Test scenario for the prefilter of a table reached through
+        next_table_index
+            - Delete a session, then delete it again.
+            - Add sessions until the prefilter is rebuilt larger.
+            - Send and verify received packets on pg1 interface.
+        """
+        mask = self.build_ip_mask(dst_ip='ffffffff')
+        self.create_classify_table('tail', mask)
+        tail = self.acl_tbl_idx.get('tail')
+        r = self.vapi.classify_add_del_table(
+            is_add=1,
+            mask=binascii.unhexlify(mask),
+            match_n_vectors=(len(mask) - 1) // 32 + 1,
+            next_table_index=tail,
+            miss_next_index=0,
+            current_data_flag=1)
+        self.acl_tbl_idx['head'] = r.new_table_index
+
+        # only the tail is reached through a chain, with the same key
+        self.assertNotIn("chain prefilter", self.vapi.cli(
+            "show classify tables index %u" % r.new_table_index))
+        self.assertEqual(self.chain_prefilter(tail), (4096, 0, "shared"))
+
+        # only a session really deleted leaves stale bits
+        match = self.build_ip_match(dst_ip=self.pg1.remote_ip4)
+        self.create_classify_session(tail, match)
+        self.create_classify_session(tail, match, is_add=0)
+        self.assertEqual(self.chain_prefilter(tail), (4096, 1, "shared"))
+        with self.vapi.assert_negative_api_retval():
+            self.create_classify_session(tail, match, is_add=0)
+        self.assertEqual(self.chain_prefilter(tail), (4096, 1, "shared"))
+        self.create_classify_session(tail, match)
+
+        # past 8 bits per session the prefilter is rebuilt with 16, in
+        # the background
+        for i in range(520):
+            self.create_classify_session(
+                tail,
+                self.build_ip_match(dst_ip="10.0.%u.%u" % (i // 256,
+                                                           i % 256)))
+        for i in range(20):
+            prefilter = self.chain_prefilter(tail)
+            if prefilter[0] != 4096:
+                break
+            self.sleep(0.1)
+        self.assertEqual(prefilter, (16384, 0, "shared"))
+
+        # and the session still matches through the chain
+        pkts = self.create_stream(self.pg0, self.pg1, self.pg_if_packet_sizes)
+        self.pg0.add_stream(pkts)
+        self.input_acl_set_interface(self.pg0, self.acl_tbl_idx.get('head'))
+        self.acl_active_table = 'head'
+
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+
+        pkts = self.pg1.get_capture(len(pkts))
+        self.verify_capture(self.pg1, pkts)
+
+
+class TestClassifierUnittest(TestClassifier):
+    """ Classifier hash/lookup unit test """
+
+    def test_classify_unittest(self):
+        """ Classify hash/lookup test for all match sizes """
+        for match in range(1, 6):
+            error = self.vapi.cli("test classify sessions 1000 "
+                                  "lookups 10000 skip 1 match %d" % match)
+            if error:
+                self.logger.critical(error)
+                self.assertNotIn('failed', error)
+
 if __name__ == '__main__':
     unittest.main(testRunner=VppTestRunner)
@@ -0,0 +1,107 @@
+#!/usr/bin/env python
+
+import unittest
+
+from scapy.packet import Raw
+from scapy.layers.l2 import Ether
+from scapy.layers.inet import IP, UDP
+
+from framework import VppTestCase, VppTestRunner
+
+N_BINS = 32
+
+
+class TestInterfaceLatency(VppTestCase):
+    """ Interface forwarding latency """
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestInterfaceLatency, cls).setUpClass()
+        cls.create_pg_interfaces(range(2))
+        for i in cls.pg_interfaces:
+            i.admin_up()
+            i.config_ip4()
+            i.resolve_arp()
+
+    @classmethod
+    def tearDownClass(cls):
+        if not cls.vpp_dead:
+            for i in cls.pg_interfaces:
+                i.unconfig_ip4()
+                i.admin_down()
+        super(TestInterfaceLatency, cls).tearDownClass()
+
+    def create_stream(self, n_pkts):
+        return [(Ether(dst=self.pg0.local_mac, src=self.pg0.remote_mac) /
+                 IP(src=self.pg0.remote_ip4, dst=self.pg1.remote_ip4) /
+                 UDP(sport=1234, dport=5678) /
+                 Raw('\xa5' * 64)) for i in range(n_pkts)]
+
+    def hw_if_index(self, intf):
+        """ Idx column of show hardware-interfaces """
+        out = self.vapi.cli("show hardware-interfaces brief %s" % intf.name)
+        for line in out.splitlines():
+            fields = line.split()
+            if fields and fields[0] == intf.name:
+                return int(fields[1])
+        self.fail("no hardware interface %s" % intf.name)
+
+    def latency_samples(self, rx, tx):
+        """ Samples of the rx -> tx histogram, summed over threads """
+        hist = self.statistics.get_counter("^/if/latency/%u$" %
+                                           rx.sw_if_index)
+        # tx columns are by hw_if_index, up to the highest enabled one
+        first = self.hw_if_index(tx) * N_BINS
+        return sum(sum(row[first:first + N_BINS]) for row in hist)
+
+    def test_latency_sample_every_packet(self):
+        """ Sample interval 1 counts one sample per packet """
+        self.vapi.cli("set interface latency sample-interval 1")
+        self.vapi.cli("set interface latency %s" % self.pg0.name)
+        self.vapi.cli("set interface latency %s" % self.pg1.name)
+        self.vapi.cli("clear interface latency")
+
+        try:
+            pkts = self.create_stream(257)
+            self.pg0.add_stream(pkts)
+            self.pg_enable_capture(self.pg_interfaces)
+            self.pg_start()
+            self.pg1.get_capture(len(pkts))
+
+            self.assertEqual(self.latency_samples(self.pg0, self.pg1),
+                             len(pkts))
+            self.assertEqual(self.latency_samples(self.pg0, self.pg0), 0)
+            self.assertEqual(self.latency_samples(self.pg1, self.pg0), 0)
+
+            out = self.vapi.cli("show interface latency %s" %
+                                self.pg0.name)
+            self.assertIn("sample interval 1", out)
+            self.assertIn("%s -> %s: %u samples" %
+                          (self.pg0.name, self.pg1.name, len(pkts)), out)
+
+            # packets are not stamped once latency is disabled on rx
+            self.vapi.cli("set interface latency %s disable" %
+                          self.pg0.name)
+            self.pg0.add_stream(pkts)
+            self.pg_enable_capture(self.pg_interfaces)
+            self.pg_start()
+            self.pg1.get_capture(len(pkts))
+            self.assertEqual(self.latency_samples(self.pg0, self.pg1),
+                             len(pkts))
+        finally:
+            self.vapi.cli("set interface latency %s disable" %
+                          self.pg0.name)
+            self.vapi.cli("set interface latency %s disable" %
+                          self.pg1.name)
+            self.vapi.cli("set interface latency sample-interval 1024")
+
+    def test_latency_sub_interface(self):
+        """ Latency is only enabled on hardware interfaces """
+        self.vapi.cli("create sub-interfaces %s 10" % self.pg1.name)
+        out = self.vapi.cli("set interface latency %s.10" % self.pg1.name)
+        self.assertIn("only hardware interfaces are supported", out)
+        self.vapi.cli("delete sub-interface %s.10" % self.pg1.name)
+
+
+if __name__ == '__main__':
+    unittest.main(testRunner=VppTestRunner)
@@ -13,6 +13,7 @@ from six import moves
 
 from framework import VppTestCase, VppTestRunner
 from util import ppp
+from vpp_ip import VppIpPrefix
 from vpp_ip_route import VppIpRoute, VppRoutePath, VppIpMRoute, \
     VppMRoutePath, MRouteItfFlags, MRouteEntryFlags, VppMplsIpBind, \
     VppMplsTable, VppIpTable
@@ -564,6 +565,49 @@ class TestIPv4FibCrud(VppTestCase):
         fib_dump = self.vapi.ip_fib_dump()
         self.verify_not_in_route_dump(fib_dump, self.deleted_routes)
 
+    def test_5_bulk_routes(self):
+        """ Add/delete 1k routes in one bulk message
+
+        - add 1k routes in a single batch check with traffic script.
+        - delete them in a single batch check with route dump.
+        """
+        dest_addr = int(binascii.hexlify(socket.inet_pton(socket.AF_INET,
+                                         "10.1.0.0")), 16)
+        ips = []
+        for i in range(1000):
+            ips.append(socket.inet_ntoa(
+                binascii.unhexlify('{:08x}'.format(dest_addr + i))))
+        prefixes = [VppIpPrefix(ip, 32).encode() for ip in ips]
+        n_next_hop_addr = socket.inet_pton(socket.AF_INET,
+                                           self.pg0.remote_ip4)
+
+        r = self.vapi.ip_add_del_route_bulk(
+            next_hop_address=n_next_hop_addr,
+            n_prefixes=len(prefixes),
+            prefixes=prefixes)
+        self.assertEqual(r.n_routes, len(prefixes))
+
+        fib_dump = self.vapi.ip_fib_dump()
+        self.verify_route_dump(fib_dump, ips)
+
+        self.stream_1 = self.create_stream(self.pg1, self.pg0, ips, 100)
+        self.pg1.add_stream(self.stream_1)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+
+        pkts = self.pg0.get_capture(len(self.stream_1))
+        self.verify_capture(self.pg0, pkts, self.stream_1)
+
+        r = self.vapi.ip_add_del_route_bulk(
+            next_hop_address=n_next_hop_addr,
+            n_prefixes=len(prefixes),
+            prefixes=prefixes,
+            is_add=0)
+        self.assertEqual(r.n_routes, len(prefixes))
+
+        fib_dump = self.vapi.ip_fib_dump()
+        self.verify_not_in_route_dump(fib_dump, ips)
+
 
 class TestIPNull(VppTestCase):
     """ IPv4 routes via NULL """
@@ -8,7 +8,7 @@ from scapy.layers.l2 import Ether, Dot1Q
 from scapy.layers.inet import IP, UDP
 
 from framework import VppTestCase, VppTestRunner
-from util import Host, ppp
+from util import Host, ppp, mac_pton
 from vpp_sub_interface import VppDot1QSubint, VppDot1ADSubint
 
 
@@ -281,5 +281,70 @@ class TestL2bd(VppTestCase):
         self.run_l2bd_test(self.dl_pkts_per_burst)
 
 
+class TestL2bdWorkers(VppTestCase):
+    """ L2BD with workers Test Case """
+
+    @classmethod
+    def setUpConstants(cls):
+        super(TestL2bdWorkers, cls).setUpConstants()
+        cls.vpp_cmdline.extend(["cpu", "{", "workers", "2", "}"])
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestL2bdWorkers, cls).setUpClass()
+
+        cls.bd_id = 1
+        try:
+            cls.create_pg_interfaces(range(2))
+
+            # no learning and no flooding: only the static entries forward
+            cls.vapi.bridge_domain_add_del(bd_id=cls.bd_id, uu_flood=0,
+                                           learn=0)
+            for pg_if in cls.pg_interfaces:
+                cls.vapi.sw_interface_set_l2_bridge(
+                    rx_sw_if_index=pg_if.sw_if_index, bd_id=cls.bd_id)
+                pg_if.admin_up()
+        except Exception:
+            super(TestL2bdWorkers, cls).tearDownClass()
+            raise
+
+    def tearDown(self):
+        super(TestL2bdWorkers, self).tearDown()
+        if not self.vpp_dead:
+            self.logger.info(self.vapi.ppcli("show l2fib verbose"))
+
+    def create_stream(self, worker):
+        return [(Ether(dst=self.pg1.remote_mac, src=self.pg0.remote_mac) /
+                 IP(src=self.pg0.remote_ip4, dst=self.pg1.remote_ip4) /
+                 UDP(sport=1234 + worker, dport=5678 + i) /
+                 Raw('\xa5' * 64)) for i in range(10)]
+
+    def send_from_workers(self, forwarded):
+        # one round per worker, a second stream on pg0 replaces the first
+        for worker in range(2):
+            pkts = self.create_stream(worker)
+            self.pg0.add_stream(pkts, worker=worker)
+            self.pg_enable_capture(self.pg_interfaces)
+            self.pg_start()
+            if forwarded:
+                self.pg1.get_capture(len(pkts))
+            else:
+                self.pg1.get_capture(0, timeout=1)
+                self.pg1.assert_nothing_captured()
+
+    def test_l2fib_add_del_workers(self):
+        """ L2FIB add and delete while the workers forward """
+        # the L2FIB API is mp-safe, the workers see the entries without a
+        # barrier sync
+        self.vapi.l2fib_add_del(mac_pton(self.pg1.remote_mac), self.bd_id,
+                                self.pg1.sw_if_index, static_mac=1)
+        self.send_from_workers(forwarded=True)
+
+        self.vapi.l2fib_add_del(mac_pton(self.pg1.remote_mac), self.bd_id,
+                                self.pg1.sw_if_index, is_add=0)
+        self.send_from_workers(forwarded=False)
+        self.assertIn("no l2fib entries", self.vapi.cli("show l2fib"))
+
+
 if __name__ == '__main__':
     unittest.main(testRunner=VppTestRunner)
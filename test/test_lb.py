@@ -489,3 +489,102 @@ class TestLB(VppTestCase):
                 "lb vip 2001::/16 protocol udp port 20000 encap nat6"
                 " type clusterip target_port 3307 del")
             self.vapi.cli("test lb flowtable flush")
+
+    def test_lb_sticky_evictions(self):
+        """ Load Balancer sticky table eviction and growth """
+        try:
+            self.vapi.cli("lb conf buckets 4 max-buckets 16")
+            self.vapi.cli(
+                "lb vip 90.0.0.0/8 encap gre4")
+            for asid in self.ass:
+                self.vapi.cli(
+                    "lb as 90.0.0.0/8 10.0.0.%u"
+                    % (asid))
+
+            # more flows than the 16 entries of the table
+            pkts = [(Ether(dst=self.pg0.local_mac, src=self.pg0.remote_mac) /
+                     self.getIPv4Flow(flowid) /
+                     Raw('\xa5' * 100)) for flowid in range(64)]
+            self.pg0.add_stream(pkts)
+            self.pg_enable_capture(self.pg_interfaces)
+            self.pg_start()
+            self.pg1.get_capture(len(pkts))
+
+            out = self.vapi.cli("show lb")
+            evictions = int(out.split("evictions:")[1].split()[0])
+            self.assertGreater(evictions, 0)
+            out = self.vapi.cli("show lb vip verbose")
+            self.assertIn("untracked packet: 0", out)
+            evicted = out.split("evicting an older session:")[1]
+            self.assertEqual(int(evicted.split()[0]), evictions)
+
+            # the resize process runs every second, the worker switches
+            # to the bigger table on its next frame
+            self.sleep(2)
+            self.pg0.add_stream(pkts)
+            self.pg_enable_capture(self.pg_interfaces)
+            self.pg_start()
+            self.pg1.get_capture(len(pkts))
+
+            out = self.vapi.cli("show lb")
+            self.assertIn("sticky table max buckets: 16", out)
+            self.assertNotIn("grows: 0", out)
+
+        finally:
+            for asid in self.ass:
+                self.vapi.cli(
+                    "lb as 90.0.0.0/8 10.0.0.%u del"
+                    % (asid))
+            self.vapi.cli(
+                "lb vip 90.0.0.0/8 encap gre4 del")
+            self.vapi.cli("test lb flowtable flush")
+            self.vapi.cli("lb conf buckets 1024 max-buckets 0")
+
+    def test_lb_maglev(self):
+        """ Load Balancer Maglev new flow table """
+        try:
+            self.vapi.cli(
+                "lb vip 90.0.0.0/8 encap gre4 new_len 1024 maglev")
+            for asid in self.ass:
+                self.vapi.cli(
+                    "lb as 90.0.0.0/8 10.0.0.%u"
+                    % (asid))
+
+            out = self.vapi.cli("show lb vip verbose")
+            # table length is rounded up to a prime
+            self.assertIn("new_size:1031 maglev", out)
+
+            self.pg0.add_stream(self.generatePackets(self.pg0, isv4=True))
+            self.pg_enable_capture(self.pg_interfaces)
+            self.pg_start()
+            self.checkCapture(encap='gre4', isv4=True)
+
+            # adding one AS moves about 1/N of the buckets only
+            self.vapi.cli("lb as 90.0.0.0/8 10.0.0.%u" % len(self.ass))
+            out = self.vapi.cli("show lb vip verbose")
+            moved = int(out.split("last update moved:")[1].split()[0])
+            expected = 1031.0 / (len(self.ass) + 1)
+            self.assertGreater(moved, expected * 0.9)
+            self.assertLess(moved, expected * 1.2)
+
+            # weights change the share of buckets, a mix of existing
+            # and new ASs is accepted
+            out = self.vapi.cli("lb as 90.0.0.0/8 10.0.0.%u 10.0.0.%u "
+                                "weight 0"
+                                % (len(self.ass), len(self.ass) + 1))
+            self.assertNotIn("error", out)
+            out = self.vapi.cli("show lb vip verbose")
+            self.assertIn("10.0.0.%u 0 buckets" % len(self.ass), out)
+            self.assertIn("10.0.0.%u 0 buckets" % (len(self.ass) + 1), out)
+            self.vapi.cli("lb as 90.0.0.0/8 10.0.0.%u del"
+                          % (len(self.ass) + 1))
+            self.vapi.cli("lb as 90.0.0.0/8 10.0.0.%u del" % len(self.ass))
+
+        finally:
+            for asid in self.ass:
+                self.vapi.cli(
+                    "lb as 90.0.0.0/8 10.0.0.%u del"
+                    % (asid))
+            self.vapi.cli(
+                "lb vip 90.0.0.0/8 encap gre4 del")
+            self.vapi.cli("test lb flowtable flush")
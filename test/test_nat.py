@@ -28,7 +28,7 @@ from io import BytesIO
 from vpp_papi import VppEnum
 from scapy.all import bind_layers, Packet, ByteEnumField, ShortField, \
     IPField, IntField, LongField, XByteField, FlagsField, FieldLenField, \
-    PacketListField
+    PacketListField, ConditionalField
 
 
 # NAT HA protocol event data
@@ -67,6 +67,46 @@ class HANATStateSync(Packet):
                                    count_from=lambda pkt: pkt.count)]
 
 
+# NAT HA protocol compact (version 2) delete and refresh event data
+class CompactEvent(Packet):
+    name = "Compact event"
+    fields_desc = [ByteEnumField("event_type", None,
+                                 {1: "add", 2: "del", 3: "refresh"}),
+                   ByteEnumField("protocol", None,
+                                 {0: "udp", 1: "tcp", 2: "icmp"}),
+                   ShortField("out_port", None),
+                   IPField("out_addr", None),
+                   IPField("eh_addr", None),
+                   ShortField("eh_port", None),
+                   IntField("fib_index", None),
+                   ConditionalField(IntField("total_pkts", 0),
+                                    lambda pkt: pkt.event_type == 3),
+                   ConditionalField(LongField("total_bytes", 0),
+                                    lambda pkt: pkt.event_type == 3)]
+
+    def extract_padding(self, s):
+        return "", s
+
+
+def ha_compact_event(s):
+    """ add events keep the full layout in compact messages """
+    if scapy.compat.orb(s[0]) == 1:
+        return Event(s)
+    return CompactEvent(s)
+
+
+# NAT HA protocol header, compact encoding
+class HANATStateSyncCompact(Packet):
+    name = "HA NAT state sync compact"
+    fields_desc = [XByteField("version", 2),
+                   FlagsField("flags", 0, 8, ['ACK']),
+                   FieldLenField("count", None, count_of="events"),
+                   IntField("sequence_number", 1),
+                   IntField("thread_index", 0),
+                   PacketListField("events", [], ha_compact_event,
+                                   count_from=lambda pkt: pkt.count)]
+
+
 class MethodHolder(VppTestCase):
     """ NAT create capture and verify method holder """
 
@@ -119,6 +159,7 @@ class MethodHolder(VppTestCase):
 
         self.vapi.nat_ha_set_listener('0.0.0.0', 0)
         self.vapi.nat_ha_set_failover('0.0.0.0', 0)
+        self.vapi.cli("nat ha sync-options coalesce-window 0 full")
 
         interfaces = self.vapi.nat44_interface_dump()
         for intf in interfaces:
@@ -1628,6 +1669,33 @@ class TestNAT44(MethodHolder):
         sessions = self.statistics.get_counter('/nat44/total-sessions')
         self.assertEqual(sessions[0][0], 3)
 
+    def test_dynamic_port_alloc(self):
+        """ NAT44 dynamic outside port allocation """
+        self.nat44_add_address(self.nat_addr)
+        self.vapi.nat44_interface_add_del_feature(self.pg0.sw_if_index)
+        self.vapi.nat44_interface_add_del_feature(self.pg1.sw_if_index,
+                                                  is_inside=0)
+
+        pkts = []
+        for i in range(64):
+            p = (Ether(src=self.pg0.remote_mac, dst=self.pg0.local_mac) /
+                 IP(src=self.pg0.remote_ip4, dst=self.pg1.remote_ip4) /
+                 UDP(sport=1025 + i, dport=53))
+            pkts.append(p)
+        self.pg0.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        capture = self.pg1.get_capture(len(pkts))
+        ports = set()
+        for p in capture:
+            self.assertEqual(p[IP].src, self.nat_addr)
+            self.assertGreater(p[UDP].sport, 1024)
+            ports.add(p[UDP].sport)
+        self.assertEqual(len(ports), len(pkts))
+
+        alg = self.vapi.cli("show nat addr-port-assignment-alg")
+        self.assertIn("attempts", alg)
+
     def test_dynamic_icmp_errors_in2out_ttl_1(self):
         """ NAT44 handling of client packets with TTL=1 """
 
@@ -3978,6 +4046,168 @@ class TestNAT44(MethodHolder):
         stats = self.statistics.get_counter('/nat44/ha/ack-recv')
         self.assertEqual(stats[0][0], 2)
 
+    def test_ha_coalesce(self):
+        """ Coalesce HA session synchronization events (active) """
+        self.nat44_add_address(self.nat_addr)
+        self.vapi.nat44_interface_add_del_feature(self.pg0.sw_if_index)
+        self.vapi.nat44_interface_add_del_feature(self.pg1.sw_if_index,
+                                                  is_inside=0)
+        self.vapi.nat_ha_set_listener(self.pg3.local_ip4, port=12345)
+        self.vapi.nat_ha_set_failover(self.pg3.remote_ip4, port=12346)
+        self.vapi.cli("nat ha sync-options coalesce-window 60000")
+        bind_layers(UDP, HANATStateSync, sport=12345)
+
+        # create sessions, add events are held back
+        pkts = self.create_stream_in(self.pg0, self.pg1)
+        self.pg0.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        capture = self.pg1.get_capture(len(pkts))
+        self.verify_capture_out(capture)
+
+        # delete one session before its add event was sent
+        self.vapi.nat44_del_session(self.pg0.remote_ip4n, self.tcp_port_in,
+                                    IP_PROTOS.tcp)
+        self.vapi.nat_ha_flush()
+        stats = self.statistics.get_counter('/nat44/ha/event-coalesced')
+        self.assertEqual(stats[0][0], 2)
+        stats = self.statistics.get_counter('/nat44/ha/add-event-send')
+        self.assertEqual(stats[0][0], 2)
+        stats = self.statistics.get_counter('/nat44/ha/del-event-send')
+        self.assertEqual(stats[0][0], 0)
+        capture = self.pg3.get_capture(1)
+        hanat = capture[0][HANATStateSync]
+        self.assertEqual(hanat.count, 2)
+        for event in hanat.events:
+            self.assertEqual(event.event_type, 1)
+            self.assertNotEqual(event.in_port, self.tcp_port_in)
+
+        ha = self.vapi.cli("show nat ha")
+        self.assertIn("coalesce-window 60000msec full encoding", ha)
+        self.assertIn("2 events coalesced", ha)
+
+    def test_ha_compact_send(self):
+        """ Send compact HA session synchronization events (active) """
+        self.nat44_add_address(self.nat_addr)
+        self.vapi.nat44_interface_add_del_feature(self.pg0.sw_if_index)
+        self.vapi.nat44_interface_add_del_feature(self.pg1.sw_if_index,
+                                                  is_inside=0)
+        self.vapi.nat_ha_set_listener(self.pg3.local_ip4, port=12345)
+        self.vapi.nat_ha_set_failover(self.pg3.remote_ip4, port=12346)
+        self.vapi.cli("nat ha sync-options compact")
+
+        # create sessions, add events keep the full layout
+        pkts = self.create_stream_in(self.pg0, self.pg1)
+        self.pg0.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        capture = self.pg1.get_capture(len(pkts))
+        self.verify_capture_out(capture)
+        self.vapi.nat_ha_flush()
+        capture = self.pg3.get_capture(1)
+        payload = scapy.compat.raw(capture[0][UDP].payload)
+        hanat = HANATStateSyncCompact(payload)
+        self.assertEqual(hanat.version, 2)
+        self.assertEqual(hanat.count, 3)
+        for event in hanat.events:
+            self.assertEqual(event.event_type, 1)
+            self.assertEqual(event.in_addr, self.pg0.remote_ip4)
+            self.assertEqual(event.out_addr, self.nat_addr)
+        seq = hanat.sequence_number
+
+        # ACK received events
+        ack = (Ether(dst=self.pg3.local_mac, src=self.pg3.remote_mac) /
+               IP(src=self.pg3.remote_ip4, dst=self.pg3.local_ip4) /
+               UDP(sport=12346, dport=12345) /
+               HANATStateSync(sequence_number=seq, flags='ACK'))
+        self.pg3.add_stream(ack)
+        self.pg_start()
+
+        # delete one session, the delete event is compact
+        self.pg_enable_capture(self.pg_interfaces)
+        self.vapi.nat44_del_session(self.pg0.remote_ip4n, self.tcp_port_in,
+                                    IP_PROTOS.tcp)
+        self.vapi.nat_ha_flush()
+        capture = self.pg3.get_capture(1)
+        payload = scapy.compat.raw(capture[0][UDP].payload)
+        # 12 bytes of header and 18 bytes of event
+        self.assertEqual(len(payload), 30)
+        hanat = HANATStateSyncCompact(payload)
+        self.assertEqual(hanat.version, 2)
+        self.assertEqual(hanat.count, 1)
+        event = hanat.events[0]
+        self.assertEqual(event.event_type, 2)
+        self.assertEqual(event.protocol, 1)
+        self.assertEqual(event.out_addr, self.nat_addr)
+        self.assertEqual(event.out_port, self.tcp_port_out)
+        self.assertEqual(event.eh_addr, self.pg1.remote_ip4)
+        self.assertEqual(event.eh_port, self.tcp_external_port)
+        self.assertEqual(event.fib_index, 0)
+
+    def test_ha_compact_recv(self):
+        """ Receive compact HA session synchronization events (passive) """
+        self.nat44_add_address(self.nat_addr)
+        self.vapi.nat44_interface_add_del_feature(self.pg0.sw_if_index)
+        self.vapi.nat44_interface_add_del_feature(self.pg1.sw_if_index,
+                                                  is_inside=0)
+        self.vapi.nat_ha_set_listener(self.pg3.local_ip4, port=12345)
+        bind_layers(UDP, HANATStateSync, sport=12345)
+        self.tcp_port_out = random.randint(1025, 65535)
+
+        def send_ha(events, seq):
+            p = (Ether(dst=self.pg3.local_mac, src=self.pg3.remote_mac) /
+                 IP(src=self.pg3.remote_ip4, dst=self.pg3.local_ip4) /
+                 UDP(sport=12346, dport=12345) /
+                 HANATStateSyncCompact(sequence_number=seq, events=events))
+            self.pg3.add_stream(p)
+            self.pg_enable_capture(self.pg_interfaces)
+            self.pg_start()
+            capture = self.pg3.get_capture(1)
+            hanat = capture[0][HANATStateSync]
+            self.assertEqual(hanat.sequence_number, seq)
+            self.assertEqual(hanat.flags, 'ACK')
+
+        def user_sessions():
+            users = self.vapi.nat44_user_dump()
+            if len(users) == 0:
+                return []
+            return self.vapi.nat44_user_session_dump(users[0].ip_address,
+                                                     users[0].vrf_id)
+
+        # add events keep the full layout
+        send_ha([Event(event_type='add', protocol='tcp',
+                       in_addr=self.pg0.remote_ip4, out_addr=self.nat_addr,
+                       in_port=self.tcp_port_in, out_port=self.tcp_port_out,
+                       eh_addr=self.pg1.remote_ip4,
+                       ehn_addr=self.pg1.remote_ip4,
+                       eh_port=self.tcp_external_port,
+                       ehn_port=self.tcp_external_port, fib_index=0)], 1)
+        sessions = user_sessions()
+        self.assertEqual(len(sessions), 1)
+
+        send_ha([CompactEvent(event_type='refresh', protocol='tcp',
+                              out_addr=self.nat_addr,
+                              out_port=self.tcp_port_out,
+                              eh_addr=self.pg1.remote_ip4,
+                              eh_port=self.tcp_external_port, fib_index=0,
+                              total_bytes=1024, total_pkts=2)], 2)
+        sessions = user_sessions()
+        self.assertEqual(len(sessions), 1)
+        self.assertEqual(sessions[0].total_bytes, 1024)
+        self.assertEqual(sessions[0].total_pkts, 2)
+        stats = self.statistics.get_counter('/nat44/ha/refresh-event-recv')
+        self.assertEqual(stats[0][0], 1)
+
+        send_ha([CompactEvent(event_type='del', protocol='tcp',
+                              out_addr=self.nat_addr,
+                              out_port=self.tcp_port_out,
+                              eh_addr=self.pg1.remote_ip4,
+                              eh_port=self.tcp_external_port,
+                              fib_index=0)], 3)
+        self.assertEqual(len(user_sessions()), 0)
+        stats = self.statistics.get_counter('/nat44/ha/del-event-recv')
+        self.assertEqual(stats[0][0], 1)
+
     def test_ha_recv(self):
         """ Receive HA session synchronization events (passive) """
         self.nat44_add_address(self.nat_addr)
@@ -6279,6 +6509,76 @@ class TestNAT44EndpointDependent(MethodHolder):
             nsessions = nsessions + user.nsessions
         self.assertLess(nsessions, 2 * max_sessions)
 
+    def test_session_timer_expiry(self):
+        """ NAT44 sessions expire without further traffic """
+        self.nat44_add_address(self.nat_addr)
+        self.vapi.nat44_interface_add_del_feature(self.pg0.sw_if_index)
+        self.vapi.nat44_interface_add_del_feature(self.pg1.sw_if_index,
+                                                  is_inside=0)
+        self.vapi.nat_set_timeouts(icmp=2)
+
+        pkts = []
+        for i in range(0, 10):
+            p = (Ether(dst=self.pg0.local_mac, src=self.pg0.remote_mac) /
+                 IP(src=self.pg0.remote_ip4, dst=self.pg1.remote_ip4) /
+                 ICMP(id=1025 + i, type='echo-request'))
+            pkts.append(p)
+        self.pg0.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        self.pg1.get_capture(len(pkts))
+
+        users = self.vapi.nat44_user_dump()
+        self.assertEqual(len(users), 1)
+        self.assertEqual(users[0].nsessions, len(pkts))
+
+        sleep(5)
+
+        users = self.vapi.nat44_user_dump()
+        self.assertEqual(len(users), 0)
+        sessions = self.vapi.cli("show nat44 sessions")
+        self.assertIn("expired %d" % len(pkts), sessions)
+
+    def test_rss_aware_ports(self):
+        """ NAT44 RSS-aware outside port selection """
+        self.nat44_add_address(self.nat_addr)
+        self.vapi.nat44_interface_add_del_feature(self.pg0.sw_if_index)
+        self.vapi.nat44_interface_add_del_feature(self.pg1.sw_if_index,
+                                                  is_inside=0)
+        self.vapi.cli("nat44 rss-aware-ports %s reta-size 64" %
+                      self.pg1.name)
+
+        try:
+            pkts = []
+            for i in range(0, 10):
+                p = (Ether(dst=self.pg0.local_mac, src=self.pg0.remote_mac) /
+                     IP(src=self.pg0.remote_ip4, dst=self.pg1.remote_ip4) /
+                     UDP(sport=1025 + i, dport=53))
+                pkts.append(p)
+            self.pg0.add_stream(pkts)
+            self.pg_enable_capture(self.pg_interfaces)
+            self.pg_start()
+            capture = self.pg1.get_capture(len(pkts))
+            for p in capture:
+                self.assertEqual(p[IP].src, self.nat_addr)
+
+            rss = self.vapi.cli("show nat44 rss-aware-ports")
+            self.assertIn("reta-size 64", rss)
+            self.assertIn("ports matched %d" % len(pkts), rss)
+
+            # an explicit table must only name existing receive queues
+            self.vapi.cli("nat44 rss-aware-ports %s reta 0 0 0 0" %
+                          self.pg1.name)
+            rss = self.vapi.cli("show nat44 rss-aware-ports")
+            self.assertIn("reta-size 4", rss)
+            reply = self.vapi.cli("nat44 rss-aware-ports %s reta 0 1" %
+                                  self.pg1.name)
+            self.assertIn("reta does not match the receive queues", reply)
+            rss = self.vapi.cli("show nat44 rss-aware-ports")
+            self.assertIn("reta-size 4", rss)
+        finally:
+            self.vapi.cli("nat44 rss-aware-ports disable")
+
     @unittest.skipUnless(running_extended_tests, "part of extended tests")
     def test_session_rst_timeout(self):
         """ NAT44 session RST timeouts """
@@ -6422,6 +6722,77 @@ class TestNAT44EndpointDependent(MethodHolder):
             self.vapi.cli("clear logging")
 
 
+class TestNAT44EDWorkers(MethodHolder):
+    """ Endpoint-Dependent NAT44 worker handoff test cases """
+
+    @classmethod
+    def setUpConstants(cls):
+        super(TestNAT44EDWorkers, cls).setUpConstants()
+        cls.vpp_cmdline.extend(["nat", "{", "endpoint-dependent", "}",
+                                "cpu", "{", "workers", "2", "}"])
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestNAT44EDWorkers, cls).setUpClass()
+        cls.vapi.cli("set log class nat level debug")
+        try:
+            cls.nat_addr = '10.0.0.3'
+            cls.create_pg_interfaces(range(2))
+            for i in cls.pg_interfaces:
+                i.admin_up()
+                i.config_ip4()
+                i.resolve_arp()
+        except Exception:
+            super(TestNAT44EDWorkers, cls).tearDownClass()
+            raise
+
+    def handoff_counters(self, node):
+        return [self.statistics.get_counter("/err/%s/%s" % (node, name))
+                for name in ("same worker", "do handoff")]
+
+    def test_handoff_same_worker(self):
+        """ NAT44 handoff skips the frame queue for the owner thread """
+        self.nat44_add_address(self.nat_addr)
+        self.vapi.nat44_interface_add_del_feature(self.pg0.sw_if_index)
+        self.vapi.nat44_interface_add_del_feature(self.pg1.sw_if_index,
+                                                  is_inside=0)
+
+        n_pkts = 20
+        pkts = [(Ether(dst=self.pg0.local_mac, src=self.pg0.remote_mac) /
+                 IP(src=self.pg0.remote_ip4, dst=self.pg1.remote_ip4) /
+                 UDP(sport=1025 + i, dport=53)) for i in range(n_pkts)]
+        self.pg0.add_stream(pkts, worker=0)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        capture = self.pg1.get_capture(n_pkts)
+
+        same, handoff = self.handoff_counters("nat44-in2out-worker-handoff")
+        self.assertEqual(same + handoff, n_pkts)
+
+        # the replies are sent once from each worker, each reply arrives
+        # exactly once on the worker owning its session
+        replies = [(Ether(dst=self.pg1.local_mac, src=self.pg1.remote_mac) /
+                    IP(src=self.pg1.remote_ip4, dst=self.nat_addr) /
+                    UDP(sport=53, dport=p[UDP].sport)) for p in capture]
+        for worker in range(2):
+            self.pg1.add_stream(replies, worker=worker)
+            self.pg_enable_capture(self.pg_interfaces)
+            self.pg_start()
+            for p in self.pg0.get_capture(n_pkts):
+                self.assertEqual(p[IP].dst, self.pg0.remote_ip4)
+
+        same, handoff = self.handoff_counters("nat44-out2in-worker-handoff")
+        self.assertEqual(same, n_pkts)
+        self.assertEqual(handoff, n_pkts)
+
+    def tearDown(self):
+        super(TestNAT44EDWorkers, self).tearDown()
+        if not self.vpp_dead:
+            self.logger.info(self.vapi.cli("show nat44 sessions detail"))
+            self.clear_nat44()
+            self.vapi.cli("clear logging")
+
+
 class TestNAT44Out2InDPO(MethodHolder):
     """ NAT44 Test Cases using out2in DPO """
 
@@ -7467,6 +7838,66 @@ class TestNAT64(MethodHolder):
         capture = self.pg2.get_capture(len(pkts))
         self.verify_capture_in_ip6(capture, ip[IPv6].src, self.pg2.remote_ip6)
 
+    def test_stateless(self):
+        """ NAT64 stateless prefix mapping test """
+        self.tcp_port_in = 6303
+        self.udp_port_in = 6304
+        self.icmp_id_in = 6305
+        self.tcp_port_out = self.tcp_port_in
+        self.udp_port_out = self.udp_port_in
+        self.icmp_id_out = self.icmp_id_in
+
+        # map inside /120 to outside /24, host byte is copied
+        host_n = socket.inet_pton(socket.AF_INET6, self.pg0.remote_ip6)
+        in_prefix = socket.inet_ntop(socket.AF_INET6, host_n[:15] + b'\x00')
+        nat_ip = '10.1.1.%d' % scapy.compat.orb(host_n[15])
+
+        self.vapi.nat64_add_del_interface(self.pg0.sw_if_index)
+        self.vapi.nat64_add_del_interface(self.pg1.sw_if_index, is_inside=0)
+        self.vapi.cli("nat64 add stateless mapping %s/120 10.1.1.0/24" %
+                      in_prefix)
+
+        # in2out
+        statelessn = self.statistics.get_counter(
+            '/err/nat64-in2out/stateless translated packets')
+
+        pkts = self.create_stream_in_ip6(self.pg0, self.pg1)
+        self.pg0.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        capture = self.pg1.get_capture(len(pkts))
+        self.verify_capture_out(capture, nat_ip=nat_ip, same_port=True,
+                                dst_ip=self.pg1.remote_ip4)
+
+        err = self.statistics.get_counter(
+            '/err/nat64-in2out/stateless translated packets')
+        self.assertEqual(err - statelessn, 3)
+
+        # out2in
+        statelessn = self.statistics.get_counter(
+            '/err/nat64-out2in/stateless translated packets')
+
+        pkts = self.create_stream_out(self.pg1, dst_ip=nat_ip)
+        self.pg1.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        capture = self.pg0.get_capture(len(pkts))
+        ip = IPv6(src=''.join(['64:ff9b::', self.pg1.remote_ip4]))
+        self.verify_capture_in_ip6(capture, ip[IPv6].src, self.pg0.remote_ip6)
+
+        err = self.statistics.get_counter(
+            '/err/nat64-out2in/stateless translated packets')
+        self.assertEqual(err - statelessn, 3)
+
+        # no BIB or session entries are created
+        bibs = self.statistics.get_counter('/nat64/total-bibs')
+        self.assertEqual(bibs[0][0], 0)
+        sessions = self.statistics.get_counter('/nat64/total-sessions')
+        self.assertEqual(sessions[0][0], 0)
+
+        self.vapi.cli("nat64 add stateless mapping %s/120 10.1.1.0/24 del" %
+                      in_prefix)
+
     def test_static(self):
         """ NAT64 static translation test """
         self.tcp_port_in = 60303
@@ -8500,6 +8931,7 @@ class TestNAT64(MethodHolder):
             self.logger.info(self.vapi.cli("show nat64 pool"))
             self.logger.info(self.vapi.cli("show nat64 interfaces"))
             self.logger.info(self.vapi.cli("show nat64 prefix"))
+            self.logger.info(self.vapi.cli("show nat64 stateless mapping"))
             self.logger.info(self.vapi.cli("show nat64 bib all"))
             self.logger.info(self.vapi.cli("show nat64 session table all"))
             self.logger.info(self.vapi.cli("show nat virtual-reassembly"))
@@ -1,24 +1,153 @@
 #!/usr/bin/env python2.7
 
+import threading
 import unittest
 
 import psutil
+from scapy.layers.inet import IP, UDP
+from scapy.layers.l2 import Ether
+from scapy.packet import Raw
 from vpp_papi.vpp_stats import VPPStats
 
 from framework import VppTestCase, VppTestRunner
+from vpp_lo_interface import VppLoInterface
 
 
 class StatsClientTestCase(VppTestCase):
     """Test Stats Client"""
 
+    @classmethod
+    def setUpConstants(cls):
+        super(StatsClientTestCase, cls).setUpConstants()
+        cls.vpp_cmdline.extend(["cpu", "{", "workers", "2", "}"])
+
     @classmethod
     def setUpClass(cls):
         super(StatsClientTestCase, cls).setUpClass()
+        try:
+            cls.create_pg_interfaces(range(1))
+            cls.pg0.admin_up()
+        except Exception:
+            super(StatsClientTestCase, cls).tearDownClass()
+            raise
 
     @classmethod
     def tearDownClass(cls):
         super(StatsClientTestCase, cls).tearDownClass()
 
+    def test_0100_ls_incremental(self):
+        """ Incremental ls returns only the new entries """
+        _, next_index = self.statistics.ls_incremental([])
+
+        # a new interface registers its output node and error counters
+        lo = VppLoInterface(self)
+        new, next_index2 = self.statistics.ls_incremental(['^/err/'],
+                                                          next_index)
+        expected, _ = self.statistics.ls_incremental(
+            '^/err/%s-output/' % lo.name)
+        self.assertGreater(len(new), 0)
+        self.assertEqual(sorted(new), sorted(expected))
+        self.assertTrue(all(i >= next_index for i in new))
+        self.assertGreaterEqual(next_index2, next_index + len(new))
+
+        # nothing new since
+        new, _ = self.statistics.ls_incremental(['^/err/'], next_index2)
+        self.assertEqual(new, [])
+
+    def test_0200_dump_sum(self):
+        """ Summed dump equals the per-thread rows added up """
+        # one stream from each worker
+        for worker in range(2):
+            pkts = [(Ether(dst=self.pg0.local_mac, src=self.pg0.remote_mac) /
+                     IP(src=self.pg0.remote_ip4, dst=self.pg0.local_ip4) /
+                     UDP(sport=1234, dport=5678 + i) /
+                     Raw('\xa5' * 64)) for i in range(10)]
+            self.pg0.add_stream(pkts, worker=worker)
+            self.pg_enable_capture(self.pg_interfaces)
+            self.pg_start()
+
+        indices = self.statistics.ls(['^/if/rx$', '^/if/drops$'])
+        per_thread = self.statistics.dump(indices)
+        summed = self.statistics.dump_sum(indices)
+        self.assertEqual(sorted(summed.keys()), sorted(per_thread.keys()))
+
+        rx = per_thread['/if/rx']
+        self.assertGreaterEqual(
+            len([t for t in rx if t[self.pg0.sw_if_index]['packets']]), 2)
+        for name, rows in per_thread.items():
+            self.assertEqual(len(summed[name]), 1)
+            for i, c in enumerate(summed[name][0]):
+                if isinstance(c, dict):
+                    self.assertEqual(
+                        c, {k: sum(t[i][k] for t in rows if i < len(t))
+                            for k in ('packets', 'bytes')})
+                else:
+                    self.assertEqual(
+                        c, sum(t[i] for t in rows if i < len(t)))
+
+    def test_0300_dump_while_changing(self):
+        """ Dump while interfaces are created and deleted """
+        # a second client, its copies race the API calls below
+        stats = VPPStats(socketname=self.stats_sock)
+        done = threading.Event()
+        errors = []
+        n_dumps = [0]
+
+        def dump_all():
+            try:
+                while not done.is_set():
+                    stats.dump(stats.ls([]))
+                    n_dumps[0] += 1
+            except Exception as e:
+                errors.append(e)
+
+        t = threading.Thread(target=dump_all)
+        t.start()
+        try:
+            for _ in range(10):
+                los = [VppLoInterface(self) for _ in range(4)]
+                for lo in los:
+                    lo.remove_vpp_config()
+        finally:
+            done.set()
+            t.join()
+        retries = stats.entry_retries()
+        stats.disconnect()
+
+        self.assertEqual(errors, [])
+        self.assertGreater(n_dumps[0], 0)
+        # only the entries the writer changed are copied again, never
+        # the scalars
+        changed, _ = self.statistics.ls_incremental(
+            ['^/if/', '^/sys/node', '^/err/'])
+        self.logger.info("entries retried: %s" % retries)
+        self.assertEqual(set(retries.keys()) - set(changed), set())
+
+    def test_0400_directory_growth(self):
+        """ Directory grows past a chunk """
+        chunk = 512
+        _, n_entries = self.statistics.ls_incremental([])
+        boundary = (n_entries // chunk + 1) * chunk
+
+        # each new loopback adds the error counters of its output node
+        for _ in range(chunk):
+            lo = VppLoInterface(self)
+            _, n_entries = self.statistics.ls_incremental([])
+            if n_entries > boundary:
+                break
+        else:
+            self.fail("directory stuck at %u entries" % n_entries)
+
+        indices, _ = self.statistics.ls_incremental(
+            '^/err/%s-output/' % lo.name)
+        self.assertGreaterEqual(max(indices), boundary)
+        counters = self.statistics.dump(
+            self.statistics.ls('^/err/%s-output/' % lo.name))
+        self.assertEqual(len(counters), len(indices))
+        for name, value in counters.items():
+            self.assertTrue(name.startswith('/err/%s-output/' % lo.name))
+            self.assertEqual(value, 0)
+
     def test_client_fd_leak(self):
         """Test file descriptor count - VPP-1486"""
 
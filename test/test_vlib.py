@@ -0,0 +1,256 @@
+#!/usr/bin/env python
+
+import unittest
+
+from scapy.packet import Raw
+from scapy.layers.l2 import Ether
+from scapy.layers.inet import IP, UDP
+
+from framework import VppTestCase, VppTestRunner
+
+
+class VlibTestCase(VppTestCase):
+    """ Common setup of the vlib main loop tests """
+
+    @classmethod
+    def setUpClass(cls):
+        super(VlibTestCase, cls).setUpClass()
+        cls.create_pg_interfaces(range(2))
+        for i in cls.pg_interfaces:
+            i.admin_up()
+            i.config_ip4()
+            i.resolve_arp()
+
+    @classmethod
+    def tearDownClass(cls):
+        if not cls.vpp_dead:
+            for i in cls.pg_interfaces:
+                i.unconfig_ip4()
+                i.admin_down()
+        super(VlibTestCase, cls).tearDownClass()
+
+    def create_stream(self, n_pkts=65):
+        return [(Ether(dst=self.pg0.local_mac, src=self.pg0.remote_mac) /
+                 IP(src=self.pg0.remote_ip4, dst=self.pg1.remote_ip4) /
+                 UDP(sport=1234 + i, dport=5678) /
+                 Raw('\xa5' * 64)) for i in range(n_pkts)]
+
+
+class TestWorkerSleep(VlibTestCase):
+    """ Adaptive worker sleep """
+
+    @classmethod
+    def setUpConstants(cls):
+        cls.extra_vpp_punt_config = ["cpu", "{", "workers", "1", "}",
+                                     "unix", "{", "worker-idle-loops",
+                                     "100", "}"]
+        super(TestWorkerSleep, cls).setUpConstants()
+
+    def worker_sleep_stats(self):
+        out = self.vapi.cli("show unix worker-sleep")
+        self.assertIn("idle loops before sleeping: 100", out)
+        for line in out.splitlines():
+            fields = line.split()
+            if fields and fields[0] == "1":
+                return {"sleeps": int(fields[1]),
+                        "file": int(fields[2]),
+                        "kick": int(fields[3]),
+                        "timeout": int(fields[4])}
+        self.fail("no worker sleep statistics: %s" % out)
+
+    def test_sleep_and_wakeup(self):
+        """ Idle worker sleeps and is kicked by the barrier """
+        # the worker has no polling input node, it blocks once idle
+        self.sleep(1)
+        before = self.worker_sleep_stats()
+        self.assertGreater(before["sleeps"], 0)
+
+        # each binary API call syncs the barrier, which kicks the
+        # sleeping worker through its eventfd
+        self.vapi.cli("show version")
+        after = self.worker_sleep_stats()
+        self.assertGreater(after["kick"], before["kick"])
+
+        # traffic handled by the worker still forwards
+        pkts = self.create_stream()
+        self.pg0.add_stream(pkts, worker=0)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        self.pg1.get_capture(len(pkts))
+
+        # and the worker goes back to sleep afterwards
+        self.sleep(1)
+        self.assertGreater(self.worker_sleep_stats()["sleeps"],
+                           after["sleeps"])
+
+
+class TestDispatchHistogram(VlibTestCase):
+    """ Node dispatch histograms """
+
+    def histogram_total(self, name):
+        return sum(sum(row) for row in self.statistics.get_counter(name))
+
+    def test_dispatch_histogram(self):
+        """ Dispatch histograms count the node calls with work """
+        self.vapi.cli("set node dispatch-histogram on")
+        self.vapi.cli("clear runtime")
+
+        # two full frames, all in the open ended last vector size bin
+        pkts = self.create_stream(512)
+        self.pg0.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        self.pg1.get_capture(len(pkts))
+
+        out = self.vapi.cli("show node dispatch-histogram ip4-lookup")
+        calls = int(out.split("ip4-lookup:")[1].split()[0])
+        self.assertGreater(calls, 0)
+        self.assertIn("[256, inf)", out)
+        self.assertIn("p50 >= 256", out)
+
+        for name in ("/sys/node/vector-size-histogram",
+                     "/sys/node/clocks-per-packet-histogram"):
+            self.assertGreater(self.histogram_total(name), 0)
+
+        self.vapi.cli("clear runtime")
+        for name in ("/sys/node/vector-size-histogram",
+                     "/sys/node/clocks-per-packet-histogram"):
+            self.assertEqual(self.histogram_total(name), 0)
+
+        self.vapi.cli("set node dispatch-histogram off")
+        out = self.vapi.cli("show node dispatch-histogram")
+        self.assertIn("disabled", out)
+
+
+class TestDispatchOrder(VlibTestCase):
+    """ Graph depth dispatch order """
+
+    def test_dispatch_order_depth(self):
+        """ Depth ordered dispatch still forwards all packets """
+        out = self.vapi.cli("set node dispatch-order depth "
+                            "defer-threshold 1000")
+        self.assertIn("defer-threshold must not exceed", out)
+        self.assertIn("fifo", self.vapi.cli("show node dispatch-order"))
+
+        self.vapi.cli("set node dispatch-order depth defer-threshold 64")
+        try:
+            pkts = self.create_stream(300)
+            self.pg0.add_stream(pkts)
+            self.pg_enable_capture(self.pg_interfaces)
+            self.pg_start()
+            rx = self.pg1.get_capture(len(pkts))
+
+            # frames of one node are never reordered
+            sports = [p[UDP].sport for p in rx]
+            self.assertEqual(sports, [p[UDP].sport for p in pkts])
+
+            out = self.vapi.cli("show node dispatch-order")
+            self.assertIn("defer threshold 64", out)
+            self.assertIn("ip4-lookup", out)
+        finally:
+            self.vapi.cli("set node dispatch-order fifo")
+
+        self.assertIn("fifo", self.vapi.cli("show node dispatch-order"))
+
+
+class TestTraceRing(VlibTestCase):
+    """ Binary packet trace ring """
+
+    def create_stream(self, n_pkts, first_sport=1234):
+        return [(Ether(dst=self.pg0.local_mac, src=self.pg0.remote_mac) /
+                 IP(src=self.pg0.remote_ip4, dst=self.pg1.remote_ip4) /
+                 UDP(sport=first_sport + i, dport=5678) /
+                 Raw('\xa5' * 64)) for i in range(n_pkts)]
+
+    def send_and_expect_forwarded(self, pkts):
+        self.pg0.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        self.pg1.get_capture(len(pkts))
+
+    def verify_records(self, records, pkts, first_seq):
+        self.assertEqual(len(records), len(pkts))
+        node_index = records[0]['node_index']
+        for i, (r, p) in enumerate(zip(records, pkts)):
+            # ip4-lookup sees the packet from its IP header on
+            ip = bytes(p[IP])
+            self.assertEqual(r['seq'], first_seq + i)
+            self.assertEqual(r['node_index'], node_index)
+            self.assertEqual(r['sw_if_index'][0], self.pg0.sw_if_index)
+            self.assertEqual(r['length'], len(ip))
+            self.assertEqual(r['data'], ip[:80])
+
+    def test_trace_ring(self):
+        """ Trace ring records every sampled packet """
+        # invalid arguments leave the ring and its filters alone
+        out = self.vapi.cli("trace ring on size 3 node ip4-input")
+        self.assertIn("not a power of 2", out)
+        out = self.vapi.cli("show trace ring")
+        self.assertIn("trace ring off", out)
+        self.assertNotIn("ip4-input", out)
+
+        self.vapi.cli("trace ring on size 64 sample 1 node ip4-lookup")
+        try:
+            out = self.vapi.cli("trace ring on size 3")
+            self.assertIn("not a power of 2", out)
+            self.assertIn("trace ring on, 64 records per thread, "
+                          "sample 1/1", self.vapi.cli("show trace ring"))
+            self.assertEqual(self.statistics.trace_ring_n_threads(), 1)
+
+            pkts = self.create_stream(40)
+            self.send_and_expect_forwarded(pkts)
+
+            records, next_seq, n_lost = self.statistics.trace_ring_read(0)
+            self.verify_records(records, pkts, 0)
+            self.assertEqual(next_seq, len(pkts))
+            self.assertEqual(n_lost, 0)
+            self.assertIn("ip4-lookup",
+                          self.vapi.cli("show trace ring max 1"))
+
+            # the ring wraps, the records overwritten before they were
+            # read are counted as lost
+            pkts = self.create_stream(100, first_sport=2000)
+            self.send_and_expect_forwarded(pkts)
+
+            records, next_seq, n_lost = \
+                self.statistics.trace_ring_read(0, next_seq)
+            self.verify_records(records, pkts[100 - 64:], 40 + 100 - 64)
+            self.assertEqual(next_seq, 140)
+            self.assertEqual(n_lost, 100 - 64)
+
+            # nothing new since
+            records, next_seq, n_lost = \
+                self.statistics.trace_ring_read(0, next_seq)
+            self.assertEqual(records, [])
+            self.assertEqual(n_lost, 0)
+        finally:
+            self.vapi.cli("trace ring off node none")
+
+        self.assertIn("trace ring off", self.vapi.cli("show trace ring"))
+
+
+class TestWorkerRpc(VppTestCase):
+    """ Worker RPCs """
+
+    @classmethod
+    def setUpConstants(cls):
+        cls.extra_vpp_punt_config = ["cpu", "{", "workers", "2", "}"]
+        super(TestWorkerRpc, cls).setUpConstants()
+
+    def test_worker_rpc(self):
+        """ RPCs reach each worker and the main thread """
+        # API CLIs run with the workers held at the barrier, the test
+        # runs in a process node and is polled for its result
+        self.assertIn("worker rpc test started",
+                      self.vapi.cli("test worker rpc"))
+        for i in range(50):
+            out = self.vapi.cli("test worker rpc result")
+            if "running" not in out:
+                break
+            self.sleep(0.1)
+        self.assertNotIn("FAIL", out)
+        self.assertIn("worker rpc test passed: 2 workers", out)
+
+
+if __name__ == '__main__':
+    unittest.main(testRunner=VppTestRunner)
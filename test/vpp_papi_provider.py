@@ -80,6 +80,8 @@ defaultmapping = {
                          'next_hop_weight': 1, 'next_hop_via_label': 1048576,
                          'next_hop_id': 4294967295,
                          'classify_table_index': 4294967295, 'is_add': 1, },
+    'ip_add_del_route_bulk': {'next_hop_sw_if_index': 4294967295,
+                              'next_hop_weight': 1, 'is_add': 1, },
     'ip_mroute_add_del': {'is_add': 1, },
     'ip_neighbor_add_del': {'is_add': 1, },
     'ip_punt_police': {'is_add': 1, },
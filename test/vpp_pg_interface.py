@@ -125,11 +125,12 @@ class VppPGInterface(VppInterface):
         self.test.vapi.cli(self.capture_cli)
         self._pcap_reader = None
 
-    def add_stream(self, pkts):
+    def add_stream(self, pkts, worker=None):
         """
         Add a stream of packets to this packet-generator
 
         :param pkts: iterable packets
+        :param worker: index of the worker to send the stream from
 
         """
         try:
@@ -148,7 +149,10 @@ class VppPGInterface(VppInterface):
         wrpcap(self.in_path, pkts)
         self.test.register_capture(self.cap_name)
         # FIXME this should be an API, but no such exists atm
-        self.test.vapi.cli(self.input_cli)
+        cli = self.input_cli
+        if worker is not None:
+            cli += " worker %d" % worker
+        self.test.vapi.cli(cli)
 
     def generate_debug_aid(self, kind):
         """ Create a hardlink to the out file with a counter and a file